@@ -31,6 +31,8 @@
 #endif
 
 #include <directxmath.h>
+#include <directxpackedvector.h>
+#include <directxcollision.h>
 
 #define DIRECTX_MESH_VERSION 120
 
@@ -64,6 +66,112 @@ namespace DirectX
     std::vector<std::pair<size_t,size_t>> __cdecl ComputeSubsets( _In_reads_opt_(nFaces) const uint32_t* attributes, _In_ size_t nFaces );
         // Returns a list of face offset,counts for attribute groups
 
+    //---------------------------------------------------------------------------------
+    // Instrumentation
+
+    struct MeshStageStats
+    {
+        const char*     stage;
+            // Name of the entry-point, such as "OptimizeFaces"
+
+        uint64_t        elapsedMicroseconds;
+            // Wall-clock time spent in the entry-point, including any stages it calls
+
+        size_t          tempBytes;
+            // Total bytes of temporary working memory allocated by the entry-point
+
+        size_t          nFaces;
+        size_t          nVerts;
+            // Element counts passed to the entry-point
+    };
+
+    typedef void (__cdecl *MeshStatsCallback)( _In_ const MeshStageStats& stats, _In_opt_ void* context );
+
+    void __cdecl SetMeshStatsCallback( _In_opt_ MeshStatsCallback callback, _In_opt_ void* context = nullptr );
+        // Installs a callback invoked as GenerateAdjacencyAndPointReps, Validate*, Clean, ComputeNormals, ComputeTangentFrame,
+        // AttributeSort, OptimizeFaces*, OptimizeVertices, OptimizeMesh, GeneratePositionStream, FinalizeVB*, PartitionMesh,
+        // GenerateAdjacencyChunked, ComputeNormalsChunked, OptimizeMeshChunked, ComputeMeshlets, WeldVertices, and
+        // SimplifyMesh return; applies only to the calling thread
+
+    //---------------------------------------------------------------------------------
+    // Scratch Memory
+
+    class ScratchArena
+    {
+    public:
+        ScratchArena();
+        ScratchArena(ScratchArena&& moveFrom);
+        ScratchArena& operator= (ScratchArena&& moveFrom);
+
+        ScratchArena(ScratchArena const&) = delete;
+        ScratchArena& operator= (ScratchArena const&) = delete;
+
+        ~ScratchArena();
+
+        HRESULT __cdecl Reserve( _In_ size_t bytes );
+            // Grows the arena to hold at least 'bytes' of scratch, such as a value from ComputeScratchSize
+
+        void __cdecl Release();
+            // Frees the arena memory
+
+        size_t __cdecl GetCapacity() const;
+
+        size_t __cdecl GetPeakUsage() const;
+            // Most scratch in use at once, including requests too large for the arena that fell back to the heap
+
+    private:
+        // Private implementation.
+        class Impl;
+
+        std::unique_ptr<Impl> pImpl;
+
+        friend void __cdecl SetScratchArena( _In_opt_ ScratchArena* arena );
+    };
+
+    void __cdecl SetScratchArena( _In_opt_ ScratchArena* arena );
+        // Serves temporary buffers for functions called on this thread from the arena instead of the heap, or
+        // restores the heap when null. An arena is used by one thread at a time and grows to its peak usage
+        // whenever it is idle; OpenMP worker threads always use the heap.
+
+    enum SCRATCH_OPERATION
+    {
+        SCRATCH_ADJACENCY = 0,
+            // GenerateAdjacencyAndPointReps and ConvertPointRepsToAdjacency
+
+        SCRATCH_VALIDATE,
+        SCRATCH_CLEAN,
+        SCRATCH_NORMALS,
+        SCRATCH_TANGENTFRAME,
+
+        SCRATCH_OPTIMIZEFACES,
+            // OptimizeFaces and OptimizeFacesEx
+
+        SCRATCH_OPTIMIZEFACES_LRU,
+            // OptimizeFacesLRU, OptimizeFacesLRUFast, and their Ex versions
+
+        SCRATCH_OPTIMIZEVERTICES,
+
+        SCRATCH_REMAP,
+            // ReorderIB, ReorderIBAndAdjacency, FinalizeIB, FinalizeVB, and FinalizeVBAndPointReps (with any flags)
+
+        SCRATCH_OPTIMIZEMESH,
+
+        SCRATCH_PARTITION,
+            // PartitionMesh, and ExtractChunk when nFaces is the chunk size
+
+        SCRATCH_ATTRIBUTESORT,
+        SCRATCH_OPTIMIZEFACES_OVERDRAW,
+        SCRATCH_POSITIONSTREAM,
+        SCRATCH_WELDVERTICES,
+        SCRATCH_SIMPLIFY,
+    };
+
+    size_t __cdecl ComputeScratchSize( _In_ SCRATCH_OPERATION op, _In_ size_t nFaces, _In_ size_t nVerts, _In_ size_t extra = 0 );
+        // Returns an upper bound on the arena bytes the operation uses on the calling thread, or 0 if op is unknown
+        // extra is the vertex cache size for SCRATCH_OPTIMIZEFACES, SCRATCH_OPTIMIZEMESH, and SCRATCH_POSITIONSTREAM
+        // (0 for OPTFACES_V_DEFAULT), the VB stride for SCRATCH_REMAP, where nVerts also counts any duplicated vertices,
+        // and the element count for SCRATCH_WELDVERTICES
+
     //---------------------------------------------------------------------------------
     // Mesh Optimization Utilities
     void __cdecl ComputeVertexCacheMissRate( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
@@ -72,9 +180,47 @@ namespace DirectX
                                              _In_ size_t cacheSize, _Out_ float& acmr, _Out_ float& atvr );
         // Compute the average cache miss ratio and average triangle vertex reuse for the post-transform vertex cache
 
+    enum VCACHE_FLAGS
+    {
+        VCACHE_FIFO                     = 0x0,
+            // Default is to simulate FIFO replacement
+
+        VCACHE_LRU                      = 0x1,
+            // Simulate least-recently-used replacement
+    };
+
+    HRESULT __cdecl ComputeVertexCacheMissRates( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
+                                                 _In_reads_(nCaches) const size_t* cacheSizes, _In_ size_t nCaches, _In_ DWORD flags,
+                                                 _Out_writes_(nCaches) float* acmr, _Out_writes_(nCaches) float* atvr );
+    HRESULT __cdecl ComputeVertexCacheMissRates( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
+                                                 _In_reads_(nCaches) const size_t* cacheSizes, _In_ size_t nCaches, _In_ DWORD flags,
+                                                 _Out_writes_(nCaches) float* acmr, _Out_writes_(nCaches) float* atvr );
+        // Compute the average cache miss ratio and average triangle vertex reuse for several cache sizes in one pass
+
     //---------------------------------------------------------------------------------
     // Vertex Buffer Reader/Writer
 
+    enum VBELEMENT_TYPE
+    {
+        VBELEMENT_VECTOR = 0,
+            // Element data is an array of XMVECTOR
+
+        VBELEMENT_FLOAT,
+        VBELEMENT_FLOAT2,
+        VBELEMENT_FLOAT3,
+        VBELEMENT_FLOAT4,
+            // Element data is an array of float, XMFLOAT2, XMFLOAT3, or XMFLOAT4
+    };
+
+    struct VBElementData
+    {
+        const char*         semanticName;
+        unsigned int        semanticIndex;
+        VBELEMENT_TYPE      type;
+        void*               data;
+        bool                x2bias;
+    };
+
     class VBReader
     {
     public:
@@ -109,6 +255,9 @@ namespace DirectX
         HRESULT __cdecl Read( _Out_writes_(count) XMFLOAT4* buffer, _In_z_ const char* semanticName, _In_ unsigned int semanticIndex, _In_ size_t count, bool x2bias = false ) const;
             // Helpers for data extraction
 
+        HRESULT __cdecl Read( _In_reads_(nElements) const VBElementData* elements, _In_ size_t nElements, _In_ size_t count ) const;
+            // Extracts several data elements in a single pass over the vertex buffer
+
         void __cdecl Release();
 
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
@@ -165,6 +314,9 @@ namespace DirectX
         HRESULT __cdecl Write( _In_reads_(count) const XMFLOAT4* buffer, _In_z_ const char* semanticName, _In_ unsigned int semanticIndex, _In_ size_t count, bool x2bias = false ) const;
             // Helpers for data insertion
 
+        HRESULT __cdecl Write( _In_reads_(nElements) const VBElementData* elements, _In_ size_t nElements, _In_ size_t count ) const;
+            // Inserts several data elements in a single pass over the vertex buffer
+
         void __cdecl Release();
 
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
@@ -187,6 +339,92 @@ namespace DirectX
         std::unique_ptr<Impl> pImpl;
     };
 
+    //---------------------------------------------------------------------------------
+    // Vertex Quantization
+
+    enum QUANTIZE_DATA
+    {
+        QUANTIZE_DATA_RANGE = 0,
+            // Arbitrary values such as positions or texture coordinates, stored relative to their bounds
+
+        QUANTIZE_DATA_UNIT_VECTOR,
+            // Unit-length xyz such as normals, tangents, or bi-tangents, with an optional w handedness sign
+    };
+
+    enum QUANTIZE_ENCODING
+    {
+        QUANTIZE_ENCODE_LINEAR = 0,
+            // value = stored * scale + bias
+
+        QUANTIZE_ENCODE_OCTAHEDRAL,
+            // xyz = the unit vector decoded from the octahedral map coordinates in stored.xy
+    };
+
+    enum QUANTIZE_FLAGS
+    {
+        QUANTIZE_DEFAULT                = 0x0,
+
+        QUANTIZE_NO_OCTAHEDRAL          = 0x1,
+            // Do not consider octahedral encoding for unit vectors
+
+        QUANTIZE_NO_SCALE_BIAS          = 0x2,
+            // Only choose formats that read back as the original values without a shader-side scale, bias, or decode
+
+        QUANTIZE_FLOAT_ONLY             = 0x4,
+            // Only choose 16-bit or 32-bit floating-point formats
+    };
+
+    struct VertexQuantization
+    {
+        DXGI_FORMAT         format;
+        QUANTIZE_ENCODING   encoding;
+            // Storage format and how to decode it
+
+        XMFLOAT4            scale;
+        XMFLOAT4            bias;
+            // Dequantization applied to the values read from the format; unused components read back as (0,0,0,1)
+
+        float               maxError;
+            // Largest error measured over the data, per component for ranges or in radians for unit vectors
+    };
+
+    HRESULT __cdecl ComputeQuantization( _In_reads_(nVerts) const XMVECTOR* data, _In_ size_t nVerts, _In_ size_t nComponents,
+                                         _In_ QUANTIZE_DATA type, _In_ float tolerance, _In_ DWORD flags,
+                                         _Out_ VertexQuantization& result );
+        // Chooses the smallest format that holds the first nComponents of the data within tolerance, measured by
+        // writing and reading back each candidate; falls back to 32-bit floats
+
+    HRESULT __cdecl QuantizeVertices( _In_reads_(nVerts) const XMVECTOR* data, _In_ size_t nVerts,
+                                      _In_ const VertexQuantization& quantization,
+                                      _Out_writes_(nVerts) XMVECTOR* quantized );
+        // Applies the inverse scale and bias (or octahedral encoding) so the result can be written with VBWriter
+
+    HRESULT __cdecl DequantizeVertices( _In_reads_(nVerts) const XMVECTOR* quantized, _In_ size_t nVerts,
+                                        _In_ const VertexQuantization& quantization,
+                                        _Out_writes_(nVerts) XMVECTOR* data );
+        // Recovers the values from data read with VBReader
+
+#if defined(__d3d11_h__) || defined(__d3d11_x_h__)
+    HRESULT __cdecl ComputeQuantizedLayout( _In_reads_(nDecl) const D3D11_INPUT_ELEMENT_DESC* vbDecl, _In_ size_t nDecl,
+                                            _In_ const VBReader& reader, _In_ size_t nVerts,
+                                            _In_ float positionTolerance, _In_ float normalTolerance, _In_ float texcoordTolerance,
+                                            _In_ DWORD flags,
+                                            _Out_writes_(nDecl) D3D11_INPUT_ELEMENT_DESC* quantizedDecl,
+                                            _Out_writes_(nDecl) VertexQuantization* quantization );
+#endif
+
+#if defined(__d3d12_h__) || defined(__d3d12_x_h__)
+    HRESULT __cdecl ComputeQuantizedLayout( const D3D12_INPUT_LAYOUT_DESC& vbDecl,
+                                            _In_ const VBReader& reader, _In_ size_t nVerts,
+                                            _In_ float positionTolerance, _In_ float normalTolerance, _In_ float texcoordTolerance,
+                                            _In_ DWORD flags,
+                                            _Out_writes_(vbDecl.NumElements) D3D12_INPUT_ELEMENT_DESC* quantizedDecl,
+                                            _Out_writes_(vbDecl.NumElements) VertexQuantization* quantization );
+#endif
+        // Chooses a format for each position, normal, tangent, bi-tangent, and texture coordinate element of the VB
+        // read by reader; other elements, and those given a negative tolerance, keep their format. The new decl uses
+        // appended offsets, so ComputeInputLayout gives its strides.
+
     //---------------------------------------------------------------------------------
     // Adjacency Computation
 
@@ -238,6 +476,10 @@ namespace DirectX
 
         CNORM_WIND_CW                   = 0x4,
             // Vertices are clock-wise (defaults to CCW)
+
+        CNORM_ACCUMULATE                = 0x8,
+            // Adds the weighted face normals to the values already in 'normals' and leaves them unnormalized, so the
+            // sums for the chunks of a partitioned mesh can be combined and normalized once (see PartitionMesh)
     };
 
     HRESULT __cdecl ComputeNormals( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
@@ -317,6 +559,44 @@ namespace DirectX
                               _In_ DWORD flags, _In_opt_ std::wstring* msgs = nullptr );
         // Checks the mesh for common problems, return 'S_OK' if no problems were found
 
+    enum VALIDATE_ERRORS
+    {
+        VALIDATE_ERROR_NONE             = 0x0,
+
+        VALIDATE_ERROR_INDEX            = 0x1,
+            // An index is out of range
+
+        VALIDATE_ERROR_NEIGHBOR         = 0x2,
+            // A neighbor is out of range
+
+        VALIDATE_ERROR_UNUSED           = 0x4,
+            // An unused face has 'valid' vertices or a neighbor (VALIDATE_UNUSED)
+
+        VALIDATE_ERROR_DEGENERATE       = 0x8,
+            // A point is used more than once by the face (VALIDATE_DEGENERATE)
+
+        VALIDATE_ERROR_ASYMMETRIC_ADJ   = 0x10,
+            // A neighbor does not reference back to the face (VALIDATE_ASYMMETRIC_ADJ)
+
+        VALIDATE_ERROR_BACKFACING       = 0x20,
+            // A neighbor is found more than once (VALIDATE_BACKFACING)
+
+        VALIDATE_ERROR_BOWTIE           = 0x40,
+            // The face reaches a vertex already used by another fan (VALIDATE_BOWTIES)
+    };
+
+    HRESULT __cdecl ValidateFaces( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                   _In_ size_t nVerts, _In_reads_opt_(nFaces*3) const uint32_t* adjacency,
+                                   _In_ DWORD flags,
+                                   _Out_writes_opt_(nFaces) uint8_t* faceErrors = nullptr, _Out_opt_ DWORD* errors = nullptr );
+    HRESULT __cdecl ValidateFaces( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                   _In_ size_t nVerts, _In_reads_opt_(nFaces*3) const uint32_t* adjacency,
+                                   _In_ DWORD flags,
+                                   _Out_writes_opt_(nFaces) uint8_t* faceErrors = nullptr, _Out_opt_ DWORD* errors = nullptr );
+        // Makes the Validate checks across threads, returning the VALIDATE_ERROR bits of each face and/or of the whole
+        // mesh instead of messages. With neither, it stops at the first problem found. Bowties are only checked when the
+        // indices and neighbors are valid.
+
     HRESULT __cdecl Clean( _Inout_updates_all_(nFaces*3) uint16_t* indices, _In_ size_t nFaces,
                            _In_ size_t nVerts, _Inout_updates_all_opt_(nFaces*3) uint32_t* adjacency,
                            _In_reads_opt_(nFaces) const uint32_t* attributes,
@@ -327,12 +607,34 @@ namespace DirectX
                            _Inout_ std::vector<uint32_t>& dupVerts, _In_ bool breakBowties=false );
         // Cleans the mesh, splitting vertices if needed
 
+    struct WeldElement
+    {
+        const char*     semanticName;
+        unsigned int    semanticIndex;
+        float           tolerance;
+            // Largest difference in any component for two vertices to weld; 0 welds only equal values
+    };
+
+    HRESULT __cdecl WeldVertices( _In_ const VBReader& reader, _In_ size_t nVerts,
+                                  _In_reads_(nElements) const WeldElement* elements, _In_ size_t nElements,
+                                  _Out_writes_(nVerts) uint32_t* vertexRemap, _Out_ size_t& nWeldedVerts,
+                                  _Out_writes_opt_(nVerts) uint32_t* vbRemap = nullptr );
+        // Merges vertices whose listed elements are all within tolerance, numbering the groups in order of their first
+        // vertex; elements that are not listed are ignored. The first element (normally SV_Position) is hashed on its xyz.
+        // vertexRemap is for FinalizeIB. vbRemap is the same remap with every vertex but the first of each group set to -1,
+        // for the out-of-place FinalizeVB, which then writes the first vertex of each group as the nWeldedVerts welded VB
+        // (given vertexRemap instead, the last vertex of each group is written).
+
     //---------------------------------------------------------------------------------
     // Mesh Optimization
 
     HRESULT __cdecl AttributeSort( _In_ size_t nFaces, _Inout_updates_all_(nFaces) uint32_t* attributes,
                                    _Out_writes_(nFaces) uint32_t* faceRemap );
-        // Reorders faces by attribute id
+    HRESULT __cdecl AttributeSort( _In_ size_t nFaces, _Inout_updates_all_(nFaces) uint32_t* attributes,
+                                   _Out_writes_(nFaces) uint32_t* faceRemap,
+                                   _Inout_ std::vector<std::pair<size_t,size_t>>& subsets );
+        // Reorders faces by attribute id, keeping faces with the same id in order; the subsets version also
+        // returns the face offset,counts of the sorted attribute groups, as ComputeSubsets would
 
     enum OPTFACES
     {
@@ -387,15 +689,147 @@ namespace DirectX
                                         _In_ uint32_t lruCacheSize = OPTFACES_LRU_DEFAULT );
         // Attribute group version of OptimizeFaces
 
+    HRESULT __cdecl OptimizeFacesLRUFast( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                          _Out_writes_(nFaces) uint32_t* faceRemap,
+                                          _In_ uint32_t lruCacheSize = OPTFACES_LRU_DEFAULT );
+    HRESULT __cdecl OptimizeFacesLRUFast( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                          _Out_writes_(nFaces) uint32_t* faceRemap,
+                                          _In_ uint32_t lruCacheSize = OPTFACES_LRU_DEFAULT );
+    HRESULT __cdecl OptimizeFacesLRUFastEx( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                            _In_reads_(nFaces) const uint32_t* attributes,
+                                            _Out_writes_(nFaces) uint32_t* faceRemap,
+                                            _In_ uint32_t lruCacheSize = OPTFACES_LRU_DEFAULT );
+    HRESULT __cdecl OptimizeFacesLRUFastEx( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                            _In_reads_(nFaces) const uint32_t* attributes,
+                                            _Out_writes_(nFaces) uint32_t* faceRemap,
+                                            _In_ uint32_t lruCacheSize = OPTFACES_LRU_DEFAULT );
+        // Lower-overhead version of OptimizeFacesLRU using fixed-point scores; results are close to but not
+        // always identical to OptimizeFacesLRU
+
+    enum OPTOVERDRAW_FLAGS
+    {
+        OPTOVERDRAW_DEFAULT     = 0x0,
+
+        OPTOVERDRAW_WIND_CW     = 0x1,
+            // Vertices are clock-wise (defaults to CCW)
+    };
+
+    HRESULT __cdecl OptimizeFacesOverdraw( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                           _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                           _In_reads_opt_(nFaces) const uint32_t* attributes,
+                                           _Inout_updates_all_(nFaces) uint32_t* faceRemap,
+                                           _In_ uint32_t vertexCache = OPTFACES_V_DEFAULT,
+                                           _In_ DWORD flags = OPTOVERDRAW_DEFAULT, _In_ float threshold = 1.05f );
+    HRESULT __cdecl OptimizeFacesOverdraw( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                           _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                           _In_reads_opt_(nFaces) const uint32_t* attributes,
+                                           _Inout_updates_all_(nFaces) uint32_t* faceRemap,
+                                           _In_ uint32_t vertexCache = OPTFACES_V_DEFAULT,
+                                           _In_ DWORD flags = OPTOVERDRAW_DEFAULT, _In_ float threshold = 1.05f );
+        // Reorders a vertex cache optimized faceRemap (from OptimizeFaces* or their Ex versions) to reduce overdraw.
+        // Each attribute group is split into clusters where the FIFO cache of vertexCache entries flushes, and
+        // again wherever a cluster's ACMR has fallen to threshold (>= 1) times that of the run it splits; clusters
+        // facing away from the group's centroid are drawn first.
+
     HRESULT __cdecl OptimizeVertices( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
                                       _Out_writes_(nVerts) uint32_t* vertexRemap );
     HRESULT __cdecl OptimizeVertices( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
                                       _Out_writes_(nVerts) uint32_t* vertexRemap );
         // Reorders vertices in order of use
 
+    enum OPTMESH_FLAGS
+    {
+        OPTMESH_DEFAULT         = 0x0,
+            // Optimizes faces with OptimizeFaces, which requires adjacency
+
+        OPTMESH_LRU             = 0x1,
+            // Optimizes faces with OptimizeFacesLRU
+
+        OPTMESH_LRU_FAST        = 0x2,
+            // Optimizes faces with OptimizeFacesLRUFast
+
+        OPTMESH_OVERDRAW        = 0x4,
+            // Also reorders the optimized faces with OptimizeFacesOverdraw, which requires positions
+
+        OPTMESH_WIND_CW         = 0x8,
+            // Vertices are clock-wise for OPTMESH_OVERDRAW (defaults to CCW)
+    };
+
+    struct MeshVertexStream
+    {
+        void*   vb;
+        size_t  stride;
+    };
+
+    HRESULT __cdecl OptimizeMesh( _Inout_updates_all_(nFaces*3) uint16_t* indices, _In_ size_t nFaces,
+                                  _Inout_updates_all_opt_(nFaces*3) uint32_t* adjacency,
+                                  _Inout_updates_all_opt_(nFaces) uint32_t* attributes, _In_ size_t nVerts,
+                                  _In_reads_opt_(nStreams) const MeshVertexStream* streams, _In_ size_t nStreams,
+                                  _In_ DWORD flags = OPTMESH_DEFAULT,
+                                  _In_ uint32_t vertexCache = 0, _In_ uint32_t restart = 0,
+                                  _In_reads_opt_(nVerts) const XMFLOAT3* positions = nullptr );
+    HRESULT __cdecl OptimizeMesh( _Inout_updates_all_(nFaces*3) uint32_t* indices, _In_ size_t nFaces,
+                                  _Inout_updates_all_opt_(nFaces*3) uint32_t* adjacency,
+                                  _Inout_updates_all_opt_(nFaces) uint32_t* attributes, _In_ size_t nVerts,
+                                  _In_reads_opt_(nStreams) const MeshVertexStream* streams, _In_ size_t nStreams,
+                                  _In_ DWORD flags = OPTMESH_DEFAULT,
+                                  _In_ uint32_t vertexCache = 0, _In_ uint32_t restart = 0,
+                                  _In_reads_opt_(nVerts) const XMFLOAT3* positions = nullptr );
+        // Sorts faces by attribute, optimizes them for the vertex cache, and reorders vertices in order of use,
+        // applying the result in place to the IB, adjacency, attributes, and each vertex buffer (every VB is written
+        // once). A vertexCache or restart of 0 uses the defaults for the face optimizer chosen by flags. positions are
+        // only read, before any VB is written, for OPTMESH_OVERDRAW and may be one of the streams.
+
+    HRESULT __cdecl GeneratePositionStream( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                            _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                            _In_reads_(nVerts) const uint32_t* pointRep,
+                                            _Out_writes_(nFaces*3) uint16_t* depthIndices, _Out_ size_t& nDepthFaces,
+                                            _Out_writes_(nVerts) XMFLOAT3* depthPositions, _Out_ size_t& nDepthVerts,
+                                            _In_ DWORD flags = OPTMESH_DEFAULT );
+    HRESULT __cdecl GeneratePositionStream( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                            _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                            _In_reads_(nVerts) const uint32_t* pointRep,
+                                            _Out_writes_(nFaces*3) uint32_t* depthIndices, _Out_ size_t& nDepthFaces,
+                                            _Out_writes_(nVerts) XMFLOAT3* depthPositions, _Out_ size_t& nDepthVerts,
+                                            _In_ DWORD flags = OPTMESH_DEFAULT );
+        // Builds a position-only IB and VB for depth and shadow passes: vertices are welded to their pointRep (such as
+        // from GenerateAdjacencyAndPointReps), faces that are unused or degenerate once welded are dropped, and the
+        // result is optimized with OptimizeMesh as a single group. The first nDepthFaces and nDepthVerts are valid.
+
+    HRESULT __cdecl SimplifyMesh( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                  _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                  _In_reads_(nVerts) const uint32_t* pointRep, _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                  _In_reads_opt_(nFaces) const uint32_t* attributes,
+                                  _In_ size_t targetFaces, _In_ float maxError,
+                                  _Out_writes_(nFaces*3) uint16_t* simplifiedIndices, _Out_ size_t& nSimplifiedFaces,
+                                  _Out_opt_ float* resultError = nullptr );
+    HRESULT __cdecl SimplifyMesh( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                  _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                  _In_reads_(nVerts) const uint32_t* pointRep, _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                  _In_reads_opt_(nFaces) const uint32_t* attributes,
+                                  _In_ size_t targetFaces, _In_ float maxError,
+                                  _Out_writes_(nFaces*3) uint32_t* simplifiedIndices, _Out_ size_t& nSimplifiedFaces,
+                                  _Out_opt_ float* resultError = nullptr );
+        // Collapses vertices onto neighbors in order of quadric error until at most targetFaces remain or no collapse
+        // is within maxError (a distance). Vertices are removed but never moved, so the result indexes the same VB; each
+        // face either keeps its vertices as they are now or is unused, so attributes still apply. Vertices on seams
+        // (sharing a pointRep), open borders, attribute boundaries, and non-manifold edges are always kept. Unused and
+        // degenerate faces are dropped. resultError is the largest error of any collapse made.
+
     //---------------------------------------------------------------------------------
     // Remap functions
 
+    enum FINALIZE_FLAGS
+    {
+        FINALIZE_DEFAULT        = 0x0,
+
+        FINALIZE_STREAMING      = 0x1,
+            // Writes out-of-place vertex data with non-temporal stores, for output that is not read again soon
+
+        FINALIZE_CYCLES         = 0x2,
+            // In-place FinalizeVB finds the cycles of the remap up front and then rotates them concurrently
+    };
+
     HRESULT __cdecl ReorderIB( _In_reads_(nFaces*3) const uint16_t* ibin, _In_ size_t nFaces,
                                _In_reads_(nFaces) const uint32_t* faceRemap,
                                _Out_writes_(nFaces*3) uint16_t* ibout );
@@ -435,9 +869,11 @@ namespace DirectX
     HRESULT __cdecl FinalizeVB( _In_reads_bytes_(nVerts*stride) const void* vbin, _In_ size_t stride, _In_ size_t nVerts,
                                 _In_reads_opt_(nDupVerts) const uint32_t* dupVerts, _In_ size_t nDupVerts,
                                 _In_reads_opt_(nVerts+nDupVerts) const uint32_t* vertexRemap, 
-                                _Out_writes_bytes_((nVerts+nDupVerts)*stride) void* vbout );
+                                _Out_writes_bytes_((nVerts+nDupVerts)*stride) void* vbout,
+                                _In_ DWORD flags = FINALIZE_DEFAULT );
     HRESULT __cdecl FinalizeVB( _Inout_updates_bytes_all_(nVerts*stride) void* vb, _In_ size_t stride, _In_ size_t nVerts,
-                                _In_reads_(nVerts) const uint32_t* vertexRemap );
+                                _In_reads_(nVerts) const uint32_t* vertexRemap,
+                                _In_ DWORD flags = FINALIZE_DEFAULT );
         // Applies a vertex remap and/or a vertex duplication set to a vertex buffer
 
     HRESULT __cdecl FinalizeVBAndPointReps( _In_reads_bytes_(nVerts*stride) const void* vbin, _In_ size_t stride, _In_ size_t nVerts,
@@ -445,12 +881,227 @@ namespace DirectX
                                             _In_reads_opt_(nDupVerts) const uint32_t* dupVerts, _In_ size_t nDupVerts,
                                             _In_reads_opt_(nVerts+nDupVerts) const uint32_t* vertexRemap, 
                                             _Out_writes_bytes_((nVerts+nDupVerts)*stride) void* vbout,
-                                            _Out_writes_(nVerts+nDupVerts) uint32_t* prout );
+                                            _Out_writes_(nVerts+nDupVerts) uint32_t* prout,
+                                            _In_ DWORD flags = FINALIZE_DEFAULT );
     HRESULT __cdecl FinalizeVBAndPointReps( _Inout_updates_bytes_all_(nVerts*stride) void* vb, _In_ size_t stride, _In_ size_t nVerts,
                                             _Inout_updates_all_(nVerts) uint32_t* pointRep,
                                             _In_reads_(nVerts) const uint32_t* vertexRemap );
         // Applies a vertex remap and/or a vertex duplication set to a vertex buffer and point representatives
 
+    //---------------------------------------------------------------------------------
+    // Chunked Processing
+
+    HRESULT __cdecl PartitionMesh( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                   _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                   _In_reads_opt_(nFaces) const uint32_t* attributes, _In_ size_t maxChunkFaces,
+                                   _Out_writes_(nFaces) uint32_t* faceRemap,
+                                   _Inout_ std::vector<std::pair<size_t,size_t>>& chunks );
+    HRESULT __cdecl PartitionMesh( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                   _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                   _In_reads_opt_(nFaces) const uint32_t* attributes, _In_ size_t maxChunkFaces,
+                                   _Out_writes_(nFaces) uint32_t* faceRemap,
+                                   _Inout_ std::vector<std::pair<size_t,size_t>>& chunks );
+        // Groups faces into spatially coherent chunks of at most maxChunkFaces that never span attribute groups.
+        // faceRemap orders the faces chunk by chunk, and chunks returns the face offset,count of each chunk in that order.
+        // Faces are binned by their centroid into at most 2^18 cells, so working memory does not grow with the mesh.
+
+    HRESULT __cdecl ExtractChunk( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
+                                  _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                  _In_ size_t chunkOffset, _In_ size_t chunkFaces,
+                                  _Out_writes_(chunkFaces*3) uint16_t* chunkIndices,
+                                  _Inout_ std::vector<uint32_t>& chunkVerts );
+    HRESULT __cdecl ExtractChunk( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces, _In_ size_t nVerts,
+                                  _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                  _In_ size_t chunkOffset, _In_ size_t chunkFaces,
+                                  _Out_writes_(chunkFaces*3) uint32_t* chunkIndices,
+                                  _Inout_ std::vector<uint32_t>& chunkVerts );
+        // Copies faces chunkOffset..chunkOffset+chunkFaces-1 of the faceRemap order (or of the IB when faceRemap is null)
+        // into a standalone IB with chunk-local vertex indices; chunkVerts returns the mesh vertex of each local vertex in
+        // order of first use. Working memory depends only on the chunk size, so the adjacency, normal (CNORM_ACCUMULATE),
+        // and face optimization functions can process a large mesh one chunk at a time. Edges shared with other chunks
+        // are boundaries in the chunk adjacency; the chunked functions below take care of them.
+
+    HRESULT __cdecl GenerateAdjacencyChunked( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                              _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                              _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                              _In_ const std::vector<std::pair<size_t,size_t>>& chunks,
+                                              _Out_writes_(nFaces*3) uint32_t* adjacency );
+    HRESULT __cdecl GenerateAdjacencyChunked( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                              _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                              _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                              _In_ const std::vector<std::pair<size_t,size_t>>& chunks,
+                                              _Out_writes_(nFaces*3) uint32_t* adjacency );
+        // Computes topological adjacency (epsilon 0) one chunk of PartitionMesh at a time, then stitches the edges left
+        // open in each chunk to the matching open edges of the other chunks. adjacency is in mesh face order. Working
+        // memory depends on the chunk size and the number of edges on chunk boundaries; for manifold meshes the result is
+        // the same as GenerateAdjacencyAndPointReps with an epsilon of 0.
+
+    HRESULT __cdecl ComputeNormalsChunked( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                           _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                           _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                           _In_ const std::vector<std::pair<size_t,size_t>>& chunks,
+                                           _In_ DWORD flags,
+                                           _Inout_updates_all_(nVerts) XMFLOAT3* normals );
+    HRESULT __cdecl ComputeNormalsChunked( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                           _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                           _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+                                           _In_ const std::vector<std::pair<size_t,size_t>>& chunks,
+                                           _In_ DWORD flags,
+                                           _Inout_updates_all_(nVerts) XMFLOAT3* normals );
+        // Computes normals (CNORM_FLAGS) one chunk of PartitionMesh at a time, summing the chunks into normals before
+        // normalizing them once, so vertices on chunk boundaries get the same normals as from ComputeNormals up to
+        // rounding. Working memory depends only on the chunk size.
+
+    HRESULT __cdecl OptimizeMeshChunked( _Inout_updates_all_(nFaces*3) uint16_t* indices, _In_ size_t nFaces,
+                                         _Inout_updates_all_opt_(nFaces*3) uint32_t* adjacency,
+                                         _Inout_updates_all_opt_(nFaces) uint32_t* attributes,
+                                         _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                         _In_ size_t maxChunkFaces,
+                                         _In_reads_opt_(nStreams) const MeshVertexStream* streams, _In_ size_t nStreams,
+                                         _In_ DWORD flags = OPTMESH_DEFAULT,
+                                         _In_ uint32_t vertexCache = 0, _In_ uint32_t restart = 0 );
+    HRESULT __cdecl OptimizeMeshChunked( _Inout_updates_all_(nFaces*3) uint32_t* indices, _In_ size_t nFaces,
+                                         _Inout_updates_all_opt_(nFaces*3) uint32_t* adjacency,
+                                         _Inout_updates_all_opt_(nFaces) uint32_t* attributes,
+                                         _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                         _In_ size_t maxChunkFaces,
+                                         _In_reads_opt_(nStreams) const MeshVertexStream* streams, _In_ size_t nStreams,
+                                         _In_ DWORD flags = OPTMESH_DEFAULT,
+                                         _In_ uint32_t vertexCache = 0, _In_ uint32_t restart = 0 );
+        // OptimizeMesh with the faces of each attribute group partitioned into chunks of at most maxChunkFaces that
+        // are optimized one at a time, in PartitionMesh order, so the face optimizers only work on a chunk. Strips are
+        // built from the adjacency within each chunk, so adjacency is not required and is only reordered when given.
+        // The attribute sort, overdraw pass, and vertex reorder still cover the whole mesh. positions are only read,
+        // before any VB is written, and may be one of the streams.
+
+    //---------------------------------------------------------------------------------
+    // Meshlet Generation
+
+    enum MESHLET_LIMITS
+    {
+        MESHLET_DEFAULT_MAX_VERTS       = 128,
+        MESHLET_DEFAULT_MAX_PRIMS       = 128,
+
+        MESHLET_MINIMUM_SIZE            = 32,
+        MESHLET_MAXIMUM_SIZE            = 256,
+            // Range of vertex and primitive limits accepted by ComputeMeshlets
+    };
+
+    enum MESHLET_FLAGS
+    {
+        MESHLET_DEFAULT                 = 0x0,
+
+        MESHLET_WIND_CW                 = 0x1,
+            // Vertices are clock-wise (defaults to CCW)
+    };
+
+    struct Meshlet
+    {
+        uint32_t    VertCount;
+        uint32_t    VertOffset;
+            // Range of the meshlet's entries in the unique vertex index buffer
+
+        uint32_t    PrimCount;
+        uint32_t    PrimOffset;
+            // Range of the meshlet's entries in the primitive index buffer
+    };
+
+    struct MeshletTriangle
+    {
+        uint32_t    i0 : 10;
+        uint32_t    i1 : 10;
+        uint32_t    i2 : 10;
+            // Corners as indices into the meshlet's unique vertex indices
+    };
+
+    struct CullData
+    {
+        DirectX::BoundingSphere     BoundingSphere;
+            // Bounds of the meshlet's vertices
+
+        PackedVector::XMUBYTEN4     NormalCone;
+            // xyz holds the cone axis biased into 0..1, w the sine of the cone half-angle (1 disables cone culling)
+
+        float                       ApexOffset;
+            // Distance of the cone apex from the sphere center along -axis; a meshlet is back-facing for a viewer
+            // at 'eye' when dot(normalize(center - axis * ApexOffset - eye), axis) >= w
+    };
+
+    HRESULT __cdecl ComputeMeshlets( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                     _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                     _Inout_ std::vector<Meshlet>& meshlets,
+                                     _Inout_ std::vector<uint8_t>& uniqueVertexIB,
+                                     _Inout_ std::vector<MeshletTriangle>& primitiveIndices,
+                                     _In_ size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS, _In_ size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS );
+    HRESULT __cdecl ComputeMeshlets( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                     _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                     _Inout_ std::vector<Meshlet>& meshlets,
+                                     _Inout_ std::vector<uint8_t>& uniqueVertexIB,
+                                     _Inout_ std::vector<MeshletTriangle>& primitiveIndices,
+                                     _In_ size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS, _In_ size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS );
+    HRESULT __cdecl ComputeMeshlets( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                     _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nSubsets) const std::pair<size_t, size_t>* subsets, _In_ size_t nSubsets,
+                                     _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                     _Inout_ std::vector<Meshlet>& meshlets,
+                                     _Inout_ std::vector<uint8_t>& uniqueVertexIB,
+                                     _Inout_ std::vector<MeshletTriangle>& primitiveIndices,
+                                     _Out_writes_(nSubsets) std::pair<size_t, size_t>* meshletSubsets,
+                                     _In_ size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS, _In_ size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS );
+    HRESULT __cdecl ComputeMeshlets( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                     _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nSubsets) const std::pair<size_t, size_t>* subsets, _In_ size_t nSubsets,
+                                     _In_reads_(nFaces*3) const uint32_t* adjacency,
+                                     _Inout_ std::vector<Meshlet>& meshlets,
+                                     _Inout_ std::vector<uint8_t>& uniqueVertexIB,
+                                     _Inout_ std::vector<MeshletTriangle>& primitiveIndices,
+                                     _Out_writes_(nSubsets) std::pair<size_t, size_t>* meshletSubsets,
+                                     _In_ size_t maxVerts = MESHLET_DEFAULT_MAX_VERTS, _In_ size_t maxPrims = MESHLET_DEFAULT_MAX_PRIMS );
+        // Splits the mesh (or each face offset,count subset, such as from ComputeSubsets) into meshlets, growing each
+        // one across adjacency from a seed face while preferring faces that add the fewest new vertices. uniqueVertexIB
+        // holds 16-bit or 32-bit mesh vertex indices to match the IB, and meshletSubsets returns the meshlet offset,count
+        // of each subset. Unused faces are skipped.
+
+    HRESULT __cdecl ComputeCullData( _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nMeshlets) const Meshlet* meshlets, _In_ size_t nMeshlets,
+                                     _In_reads_(nVertIndices) const uint16_t* uniqueVertexIndices, _In_ size_t nVertIndices,
+                                     _In_reads_(nPrimIndices) const MeshletTriangle* primitiveIndices, _In_ size_t nPrimIndices,
+                                     _Out_writes_(nMeshlets) CullData* cullData,
+                                     _In_ DWORD flags = MESHLET_DEFAULT );
+    HRESULT __cdecl ComputeCullData( _In_reads_(nVerts) const XMFLOAT3* positions, _In_ size_t nVerts,
+                                     _In_reads_(nMeshlets) const Meshlet* meshlets, _In_ size_t nMeshlets,
+                                     _In_reads_(nVertIndices) const uint32_t* uniqueVertexIndices, _In_ size_t nVertIndices,
+                                     _In_reads_(nPrimIndices) const MeshletTriangle* primitiveIndices, _In_ size_t nPrimIndices,
+                                     _Out_writes_(nMeshlets) CullData* cullData,
+                                     _In_ DWORD flags = MESHLET_DEFAULT );
+        // Computes a bounding sphere and back-face culling normal cone for each meshlet
+
+    //---------------------------------------------------------------------------------
+    // Buffer Compression
+
+    HRESULT __cdecl EncodeIndexBuffer( _In_reads_(nFaces*3) const uint16_t* indices, _In_ size_t nFaces,
+                                       _Inout_ std::vector<uint8_t>& encoded );
+    HRESULT __cdecl EncodeIndexBuffer( _In_reads_(nFaces*3) const uint32_t* indices, _In_ size_t nFaces,
+                                       _Inout_ std::vector<uint8_t>& encoded );
+        // Losslessly compresses an IB by coding each face against recently shared edges and vertices, which is most
+        // effective after OptimizeFaces and OptimizeVertices. Faces are not rotated, so decoding reproduces the IB exactly.
+
+    HRESULT __cdecl DecodeIndexBuffer( _In_reads_bytes_(size) const uint8_t* encoded, _In_ size_t size, _In_ size_t nFaces,
+                                       _Out_writes_(nFaces*3) uint16_t* indices );
+    HRESULT __cdecl DecodeIndexBuffer( _In_reads_bytes_(size) const uint8_t* encoded, _In_ size_t size, _In_ size_t nFaces,
+                                       _Out_writes_(nFaces*3) uint32_t* indices );
+
+    HRESULT __cdecl EncodeVertexBuffer( _In_reads_bytes_(nVerts*stride) const void* vertices, _In_ size_t nVerts, _In_ size_t stride,
+                                        _Inout_ std::vector<uint8_t>& encoded );
+        // Losslessly compresses a VB as bit-packed byte deltas between consecutive vertices, which is most effective
+        // after OptimizeVertices. The output also compresses well with a general-purpose compressor.
+
+    HRESULT __cdecl DecodeVertexBuffer( _In_reads_bytes_(size) const uint8_t* encoded, _In_ size_t size,
+                                        _In_ size_t nVerts, _In_ size_t stride,
+                                        _Out_writes_bytes_(nVerts*stride) void* vertices );
+
 #include "DirectXMesh.inl"
 
 }; // namespace
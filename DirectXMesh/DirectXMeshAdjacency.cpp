@@ -29,15 +29,19 @@ namespace
         vertexHashEntry *   next;
     };
 
+    // Edges live in a flat open-addressing table (linear probing) keyed by the packed
+    // (v1, v2) pair, so a lookup touches consecutive entries rather than chasing pointers
     struct edgeHashEntry
     {
-        uint32_t        v1;
-        uint32_t        v2;
+        uint64_t        key;
+        uint32_t        face;       // UNUSED32 once the edge has been matched
         uint32_t        vOther;
-        uint32_t        face;
-        edgeHashEntry * next;
     };
 
+    static_assert(sizeof(edgeHashEntry) == 16, "edgeHashEntry should pack four to a cache line");
+
+    const uint64_t c_EmptyEdgeKey = uint64_t(-1);
+
     // <algorithm> std::make_heap doesn't match D3DX10 so we use the same algorithm here
     void MakeXHeap(
         _Out_writes_(nVerts) uint32_t *index,
@@ -125,6 +129,157 @@ namespace
     }
 
 
+    //---------------------------------------------------------------------------------
+    inline uint32_t PositionHashKey(const XMFLOAT3& position, size_t hashSize)
+    {
+        return uint32_t((*reinterpret_cast<const uint32_t*>(&position.x)
+            + *reinterpret_cast<const uint32_t*>(&position.y)
+            + *reinterpret_cast<const uint32_t*>(&position.z)) % hashSize);
+    }
+
+    // Returns true if 'other' is used by any of the faces that reference 'vert'
+    template<class index_t>
+    bool IsInSameFace(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_ const uint32_t* vertexToCorner,
+        _In_reads_(nFaces * 3) const uint32_t* vertexCornerList,
+        uint32_t vert, uint32_t other)
+    {
+        uint32_t head = vertexToCorner[vert];
+
+        while (head != UNUSED32)
+        {
+            uint32_t face = head / 3;
+            assert(face < nFaces);
+            _Analysis_assume_(face < nFaces);
+
+            assert((indices[face * 3] == vert) || (indices[face * 3 + 1] == vert) || (indices[face * 3 + 2] == vert));
+
+            if ((indices[face * 3] == other) || (indices[face * 3 + 1] == other) || (indices[face * 3 + 2] == other))
+                return true;
+
+            head = vertexCornerList[head];
+        }
+
+        return false;
+    }
+
+    template<class index_t>
+    uint32_t FindCoincidentVertex(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_ const uint32_t* vertexToCorner,
+        _In_reads_(nFaces * 3) const uint32_t* vertexCornerList,
+        _In_opt_ const vertexHashEntry* bucket,
+        const XMFLOAT3& position, uint32_t vert)
+    {
+        for (auto current = bucket; current != 0; current = current->next)
+        {
+            if (current->v.x == position.x
+                && current->v.y == position.y
+                && current->v.z == position.z)
+            {
+                if (!IsInSameFace(indices, nFaces, vertexToCorner, vertexCornerList, vert, current->index))
+                    return current->index;
+            }
+        }
+
+        return UNUSED32;
+    }
+
+
+#ifdef _OPENMP
+    //---------------------------------------------------------------------------------
+    // Parallel support
+    //---------------------------------------------------------------------------------
+
+    // Smaller meshes are always processed serially
+    const size_t c_MinParallelCount = 65536;
+
+    //---------------------------------------------------------------------------------
+    // A hash bucket is only ever searched by the vertices that hash into it, so the buckets
+    // are split across threads and each partition is walked in vertex order. This produces
+    // exactly the same point reps as the serial loop.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT GeneratePointRepsParallel(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* vertexToCorner,
+        _In_reads_(nFaces * 3) const uint32_t* vertexCornerList,
+        _Out_writes_(nVerts) uint32_t* pointRep)
+    {
+        size_t hashSize = nVerts / 3;
+
+        auto nBlocks = uint32_t(omp_get_max_threads());
+        uint32_t nParts = nBlocks * 4;
+
+        auto temp = make_scratch<uint32_t>(nVerts * 2);
+        auto counts = make_scratch<size_t>(nBlocks * nParts + nParts + 1);
+        if (!temp || !counts)
+            return E_OUTOFMEMORY;
+
+        auto hashTable = make_scratch<vertexHashEntry*>(hashSize);
+        if (!hashTable)
+            return E_OUTOFMEMORY;
+
+        memset(hashTable.get(), 0, sizeof(vertexHashEntry*) * hashSize);
+
+        auto hashEntries = make_scratch<vertexHashEntry>(nVerts);
+        if (!hashEntries)
+            return E_OUTOFMEMORY;
+
+        uint32_t* partKeys = temp.get();
+        uint32_t* order = temp.get() + nVerts;
+        size_t* partOffsets = counts.get() + nBlocks * nParts;
+
+        size_t blockSize = (nVerts + nBlocks - 1) / nBlocks;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t end = std::min<size_t>(nVerts, size_t(block + 1) * blockSize);
+            for (size_t vert = size_t(block) * blockSize; vert < end; ++vert)
+            {
+                partKeys[vert] = PositionHashKey(positions[vert], hashSize) % nParts;
+            }
+        }
+
+        PartitionItems(partKeys, nVerts, nParts, nBlocks, counts.get(), order, partOffsets);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int part = 0; part < int(nParts); ++part)
+        {
+            for (size_t j = partOffsets[part]; j < partOffsets[part + 1]; ++j)
+            {
+                uint32_t vert = order[j];
+                uint32_t hashKey = PositionHashKey(positions[vert], hashSize);
+
+                uint32_t found = FindCoincidentVertex(indices, nFaces, vertexToCorner, vertexCornerList,
+                                                      hashTable[hashKey], positions[vert], vert);
+
+                if (found != UNUSED32)
+                {
+                    pointRep[vert] = found;
+                }
+                else
+                {
+                    auto newEntry = &hashEntries[vert];
+
+                    newEntry->v = positions[vert];
+                    newEntry->index = vert;
+                    newEntry->next = hashTable[hashKey];
+                    hashTable[hashKey] = newEntry;
+
+                    pointRep[vert] = vert;
+                }
+            }
+        }
+
+        return S_OK;
+    }
+#endif
+
+
     //---------------------------------------------------------------------------------
     // PointRep computation
     //---------------------------------------------------------------------------------
@@ -135,7 +290,7 @@ namespace
         float epsilon,
         _Out_writes_(nVerts) uint32_t* pointRep)
     {
-        std::unique_ptr<uint32_t[]> temp(new (std::nothrow) uint32_t[nVerts + nFaces * 3]);
+        auto temp = make_scratch<uint32_t>(nVerts + nFaces * 3);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -161,15 +316,22 @@ namespace
 
         if (epsilon == 0.f)
         {
+#ifdef _OPENMP
+            if (nVerts >= c_MinParallelCount && omp_get_max_threads() > 1)
+            {
+                return GeneratePointRepsParallel(indices, nFaces, positions, nVerts, vertexToCorner, vertexCornerList, pointRep);
+            }
+#endif
+
             size_t hashSize = nVerts / 3;
 
-            std::unique_ptr<vertexHashEntry*[]> hashTable(new (std::nothrow) vertexHashEntry*[hashSize]);
+            auto hashTable = make_scratch<vertexHashEntry*>(hashSize);
             if (!hashTable)
                 return E_OUTOFMEMORY;
 
             memset(hashTable.get(), 0, sizeof(vertexHashEntry*) * hashSize);
 
-            std::unique_ptr<vertexHashEntry[]> hashEntries(new (std::nothrow) vertexHashEntry[nVerts]);
+            auto hashEntries = make_scratch<vertexHashEntry>(nVerts);
             if (!hashEntries)
                 return E_OUTOFMEMORY;
 
@@ -177,46 +339,10 @@ namespace
 
             for (size_t vert = 0; vert < nVerts; ++vert)
             {
-                uint32_t hashKey = (*reinterpret_cast<const uint32_t*>(&positions[vert].x)
-                    + *reinterpret_cast<const uint32_t*>(&positions[vert].y)
-                    + *reinterpret_cast<const uint32_t*>(&positions[vert].z)) % hashSize;
+                uint32_t hashKey = PositionHashKey(positions[vert], hashSize);
 
-                uint32_t found = UNUSED32;
-
-                for (auto current = hashTable[hashKey]; current != 0; current = current->next)
-                {
-                    if (current->v.x == positions[vert].x
-                        && current->v.y == positions[vert].y
-                        && current->v.z == positions[vert].z)
-                    {
-                        uint32_t head = vertexToCorner[vert];
-
-                        bool ispresent = false;
-
-                        while (head != UNUSED32)
-                        {
-                            uint32_t face = head / 3;
-                            assert(face < nFaces);
-                            _Analysis_assume_(face < nFaces);
-
-                            assert((indices[face * 3] == vert) || (indices[face * 3 + 1] == vert) || (indices[face * 3 + 2] == vert));
-
-                            if ((indices[face * 3] == current->index) || (indices[face * 3 + 1] == current->index) || (indices[face * 3 + 2] == current->index))
-                            {
-                                ispresent = true;
-                                break;
-                            }
-
-                            head = vertexCornerList[head];
-                        }
-
-                        if (!ispresent)
-                        {
-                            found = current->index;
-                            break;
-                        }
-                    }
-                }
+                uint32_t found = FindCoincidentVertex(indices, nFaces, vertexToCorner, vertexCornerList,
+                                                      hashTable[hashKey], positions[vert], uint32_t(vert));
 
                 if (found != UNUSED32)
                 {
@@ -245,7 +371,10 @@ namespace
         }
         else
         {
-            std::unique_ptr<uint32_t[]> xorder(new uint32_t[nVerts]);
+            // The sweep below assigns point reps greedily in x-order, so it stays serial
+            auto xorder = make_scratch<uint32_t>(nVerts);
+            if (!xorder)
+                return E_OUTOFMEMORY;
 
             // order in descending order
             MakeXHeap(xorder.get(), positions, nVerts);
@@ -291,28 +420,7 @@ namespace
 
                             if (XMVector2Less(diff, vepsilon))
                             {
-                                uint32_t headvc = vertexToCorner[tailIndex];
-
-                                bool ispresent = false;
-
-                                while (headvc != UNUSED32)
-                                {
-                                    uint32_t face = headvc / 3;
-                                    assert(face < nFaces);
-                                    _Analysis_assume_(face < nFaces);
-
-                                    assert((indices[face * 3] == tailIndex) || (indices[face * 3 + 1] == tailIndex) || (indices[face * 3 + 2] == tailIndex));
-
-                                    if ((indices[face * 3] == curIndex) || (indices[face * 3 + 1] == curIndex) || (indices[face * 3 + 2] == curIndex))
-                                    {
-                                        ispresent = true;
-                                        break;
-                                    }
-
-                                    headvc = vertexCornerList[headvc];
-                                }
-
-                                if (!ispresent)
+                                if (!IsInSameFace(indices, nFaces, vertexToCorner, vertexCornerList, tailIndex, curIndex))
                                 {
                                     pointRep[curIndex] = tailIndex;
                                 }
@@ -329,6 +437,421 @@ namespace
     }
 
 
+    //---------------------------------------------------------------------------------
+    // Edge matching
+    //---------------------------------------------------------------------------------
+
+    inline uint64_t EdgeKey(uint32_t v1, uint32_t v2)
+    {
+        return (uint64_t(v1) << 32) | v2;
+    }
+
+    inline size_t EdgeHashSlot(uint64_t key, size_t mask)
+    {
+        // 64-bit finalizer from MurmurHash3
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+        return size_t(key) & mask;
+    }
+
+    // Power-of-2 table size that keeps the load factor at or below 2/3
+    inline size_t EdgeHashSize(size_t nEntries)
+    {
+        size_t minSize = nEntries + (nEntries >> 1) + 1;
+
+        size_t size = 16;
+        while (size < minSize)
+        {
+            if (size > (SIZE_MAX / (sizeof(edgeHashEntry) * 2)))
+                return 0;
+
+            size <<= 1;
+        }
+
+        return size;
+    }
+
+    inline void InsertEdge(
+        _Inout_ edgeHashEntry* hashTable, size_t mask,
+        uint64_t key, uint32_t face, uint32_t vOther)
+    {
+        size_t j = EdgeHashSlot(key, mask);
+        while (hashTable[j].key != c_EmptyEdgeKey)
+        {
+            j = (j + 1) & mask;
+        }
+
+        hashTable[j].key = key;
+        hashTable[j].face = face;
+        hashTable[j].vOther = vOther;
+    }
+
+    // Issues prefetches for the table slots the edges of a face will probe
+    template<class index_t>
+    inline void PrefetchEdges(
+        _In_reads_(3) const index_t* face, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* pointRep,
+        _In_ const edgeHashEntry* hashTable, size_t mask,
+        bool reversed)
+    {
+#if defined(_XM_SSE_INTRINSICS_)
+        if (face[0] >= nVerts || face[1] >= nVerts || face[2] >= nVerts)
+            return;
+
+        for (uint32_t point = 0; point < 3; ++point)
+        {
+            uint32_t va = pointRep[face[point]];
+            uint32_t vb = pointRep[face[(point + 1) % 3]];
+
+            uint64_t key = reversed ? EdgeKey(vb, va) : EdgeKey(va, vb);
+
+            _mm_prefetch(reinterpret_cast<const char*>(&hashTable[EdgeHashSlot(key, mask)]), _MM_HINT_T0);
+        }
+#else
+        UNREFERENCED_PARAMETER(face);
+        UNREFERENCED_PARAMETER(nVerts);
+        UNREFERENCED_PARAMETER(pointRep);
+        UNREFERENCED_PARAMETER(hashTable);
+        UNREFERENCED_PARAMETER(mask);
+        UNREFERENCED_PARAMETER(reversed);
+#endif
+    }
+
+    // How far ahead (in faces) the table slots are prefetched
+    const size_t c_EdgePrefetchDistance = 8;
+
+    inline XMVECTOR XM_CALLCONV FaceNormal(FXMVECTOR p1, FXMVECTOR p2, FXMVECTOR p3)
+    {
+        XMVECTOR v12 = XMVectorSubtract(p1, p2);
+        XMVECTOR v13 = XMVectorSubtract(p1, p3);
+
+        return XMVector3Normalize(XMVector3Cross(v12, v13));
+    }
+
+    // Keeps the candidate with the closest normal, letting later candidates win ties
+    inline bool XM_CALLCONV ScoreEdge(FXMVECTOR anormal, FXMVECTOR bnormal, size_t candidate, size_t& found, float& bestDiff)
+    {
+        XMVECTOR diff = XMVector3Dot(anormal, bnormal);
+        if (XMVector3IsNaN(diff))
+            return false;
+
+        if (found == SIZE_MAX || XMVectorGetX(diff) >= bestDiff)
+        {
+            found = candidate;
+            bestDiff = XMVectorGetX(diff);
+        }
+
+        return true;
+    }
+
+    // Finds the face that shares the edge (va, vb), preferring the one whose normal is
+    // closest to this face if there are several, and removes both sides of the edge.
+    //
+    // Linear probing without deletion keeps equal keys oldest first, while the original
+    // chained table visited them newest first and only switched on a strictly closer normal.
+    // Scanning oldest first and letting a later entry win ties picks the same face.
+    uint32_t MatchEdge(
+        _Inout_ edgeHashEntry* hashTable, size_t mask,
+        _In_ const XMFLOAT3* positions,
+        uint32_t face, uint32_t va, uint32_t vb, uint32_t vOther)
+    {
+        uint64_t key = EdgeKey(va, vb);
+
+        XMVECTOR pA1 = XMLoadFloat3(&positions[va]);
+        XMVECTOR pA2 = XMLoadFloat3(&positions[vb]);
+        XMVECTOR bnormal = XMVectorZero();
+
+        size_t nMatches = 0;
+        size_t newest = SIZE_MAX;
+        bool newestValid = true;
+
+        size_t found = SIZE_MAX;
+        float bestDiff = 0.f;
+
+        for (size_t j = EdgeHashSlot(key, mask); hashTable[j].key != c_EmptyEdgeKey; j = (j + 1) & mask)
+        {
+            if (hashTable[j].key != key || hashTable[j].face == UNUSED32)
+                continue;
+
+            ++nMatches;
+
+            if (nMatches == 2)
+            {
+                // normals are only needed if there is more than one match
+                bnormal = FaceNormal(pA2, pA1, XMLoadFloat3(&positions[vOther]));
+
+                XMVECTOR anormal = FaceNormal(pA1, pA2, XMLoadFloat3(&positions[hashTable[newest].vOther]));
+                ScoreEdge(anormal, bnormal, newest, found, bestDiff);
+            }
+
+            if (nMatches >= 2)
+            {
+                XMVECTOR anormal = FaceNormal(pA1, pA2, XMLoadFloat3(&positions[hashTable[j].vOther]));
+                newestValid = ScoreEdge(anormal, bnormal, j, found, bestDiff);
+            }
+
+            newest = j;
+        }
+
+        if (!nMatches)
+            return UNUSED32;
+
+        // a match with no usable normal is kept only if it is the newest
+        if (found == SIZE_MAX || !newestValid)
+        {
+            found = newest;
+        }
+
+        uint32_t foundFace = hashTable[found].face;
+
+        // remove found face from hash table
+        hashTable[found].face = UNUSED32;
+
+        // Check for other edge
+        uint64_t key2 = EdgeKey(vb, va);
+
+        for (size_t j = EdgeHashSlot(key2, mask); hashTable[j].key != c_EmptyEdgeKey; j = (j + 1) & mask)
+        {
+            if (hashTable[j].key == key2 && hashTable[j].face == face)
+            {
+                // trim edge from hash table
+                hashTable[j].face = UNUSED32;
+                break;
+            }
+        }
+
+        return foundFace;
+    }
+
+    // Points the matching edge of the neighbor back to this face
+    template<class index_t>
+    void LinkNeighbor(
+        _In_ const index_t* indices, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* pointRep,
+        _Inout_ uint32_t* adjacency,
+        uint32_t face, uint32_t foundFace, uint32_t va, uint32_t vb)
+    {
+        UNREFERENCED_PARAMETER(vb);
+
+        uint32_t point2 = 0;
+        for (; point2 < 3; ++point2)
+        {
+            index_t k = indices[foundFace * 3 + point2];
+            if (k == index_t(-1))
+                continue;
+
+            assert(k < nVerts);
+            _Analysis_assume_(k < nVerts);
+
+            if (pointRep[k] == va)
+                break;
+        }
+
+        if (point2 < 3)
+        {
+#ifndef NDEBUG
+            uint32_t testPoint = indices[foundFace * 3 + ((point2 + 1) % 3)];
+            testPoint = pointRep[testPoint];
+            assert(testPoint == vb);
+#endif
+            assert(adjacency[foundFace * 3 + point2] == UNUSED32);
+
+            // update neighbor to point back to this face match edge
+            adjacency[foundFace * 3 + point2] = face;
+        }
+    }
+
+
+#ifdef _OPENMP
+    //---------------------------------------------------------------------------------
+    // Edges are partitioned by their unordered pair of point reps, so an edge and its
+    // reverse always land in the same partition. Each partition then replays the serial
+    // algorithm over just its own edges in face order, which finds the same matches.
+    //
+    // The only interaction between different edges in the serial code is when two edges of
+    // one face match the same neighbor. In that case 'tied' is set and the caller must
+    // redo the conversion serially to get identical results.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ConvertPointRepsToAdjacencyParallel(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* pointRep,
+        _Out_writes_(nFaces * 3) uint32_t* adjacency,
+        bool& tied)
+    {
+        tied = false;
+
+        size_t nEdges = nFaces * 3;
+
+        auto nBlocks = uint32_t(omp_get_max_threads());
+        uint32_t nParts = nBlocks * 4;
+
+        auto temp = make_scratch<uint32_t>(nEdges * 2);
+        auto counts = make_scratch<size_t>(nBlocks * nParts + nParts + 1);
+        if (!temp || !counts)
+            return E_OUTOFMEMORY;
+
+        uint32_t* partKeys = temp.get();
+        uint32_t* order = temp.get() + nEdges;
+        size_t* partOffsets = counts.get() + nBlocks * nParts;
+
+        size_t blockSize = (nFaces + nBlocks - 1) / nBlocks;
+
+        // assign face edges to partitions and validate indices
+        bool badIndex = false;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t end = std::min<size_t>(nFaces, size_t(block + 1) * blockSize);
+            for (size_t face = size_t(block) * blockSize; face < end; ++face)
+            {
+                uint32_t* keys = &partKeys[face * 3];
+                keys[0] = keys[1] = keys[2] = UNUSED32;
+
+                index_t i0 = indices[face * 3];
+                index_t i1 = indices[face * 3 + 1];
+                index_t i2 = indices[face * 3 + 2];
+
+                if (i0 == index_t(-1)
+                    || i1 == index_t(-1)
+                    || i2 == index_t(-1))
+                    continue;
+
+                if (i0 >= nVerts
+                    || i1 >= nVerts
+                    || i2 >= nVerts)
+                {
+                    badIndex = true;
+                    continue;
+                }
+
+                uint32_t v1 = pointRep[i0];
+                uint32_t v2 = pointRep[i1];
+                uint32_t v3 = pointRep[i2];
+
+                // filter out degenerate triangles
+                if (v1 == v2 || v1 == v3 || v2 == v3)
+                    continue;
+
+                for (uint32_t point = 0; point < 3; ++point)
+                {
+                    uint32_t va = pointRep[indices[face * 3 + point]];
+                    uint32_t vb = pointRep[indices[face * 3 + ((point + 1) % 3)]];
+
+                    uint32_t vmin = std::min<uint32_t>(va, vb);
+                    uint32_t vmax = std::max<uint32_t>(va, vb);
+
+                    keys[point] = ((vmin * 2654435761u) ^ vmax) % nParts;
+                }
+            }
+        }
+
+        if (badIndex)
+            return E_UNEXPECTED;
+
+        PartitionItems(partKeys, nEdges, nParts, nBlocks, counts.get(), order, partOffsets);
+
+        // each partition works in its own slice of the edge table
+        auto tableOffsets = make_scratch<size_t>(nParts + 1);
+        if (!tableOffsets)
+            return E_OUTOFMEMORY;
+
+        tableOffsets[0] = 0;
+        for (uint32_t part = 0; part < nParts; ++part)
+        {
+            size_t count = partOffsets[part + 1] - partOffsets[part];
+            size_t tableSize = (count > 0) ? EdgeHashSize(count) : 0;
+            if (count > 0 && !tableSize)
+                return E_OUTOFMEMORY;
+
+            tableOffsets[part + 1] = tableOffsets[part] + tableSize;
+        }
+
+        auto hashTable = make_scratch<edgeHashEntry>(tableOffsets[nParts]);
+        if (!hashTable)
+            return E_OUTOFMEMORY;
+
+        memset(adjacency, 0xff, sizeof(uint32_t) * nEdges);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int part = 0; part < int(nParts); ++part)
+        {
+            size_t start = partOffsets[part];
+            size_t count = partOffsets[part + 1] - start;
+            if (!count)
+                continue;
+
+            edgeHashEntry* partTable = hashTable.get() + tableOffsets[part];
+            size_t mask = tableOffsets[part + 1] - tableOffsets[part] - 1;
+            memset(partTable, 0xff, sizeof(edgeHashEntry) * (mask + 1));
+
+            for (size_t j = start; j < (start + count); ++j)
+            {
+                uint32_t face = order[j] / 3;
+                uint32_t point = order[j] % 3;
+
+                uint32_t va = pointRep[indices[face * 3 + point]];
+                uint32_t vb = pointRep[indices[face * 3 + ((point + 1) % 3)]];
+                uint32_t vOther = pointRep[indices[face * 3 + ((point + 2) % 3)]];
+
+                InsertEdge(partTable, mask, EdgeKey(va, vb), face, vOther);
+            }
+
+            for (size_t j = start; j < (start + count); ++j)
+            {
+                if (adjacency[order[j]] != UNUSED32)
+                    continue;
+
+                uint32_t face = order[j] / 3;
+                uint32_t point = order[j] % 3;
+
+                // see if edge already entered
+                uint32_t va = pointRep[indices[face * 3 + ((point + 1) % 3)]];
+                uint32_t vb = pointRep[indices[face * 3 + point]];
+                uint32_t vOther = pointRep[indices[face * 3 + ((point + 2) % 3)]];
+
+                uint32_t foundFace = MatchEdge(partTable, mask, positions, face, va, vb, vOther);
+
+                if (foundFace != UNUSED32)
+                {
+                    adjacency[order[j]] = foundFace;
+
+                    LinkNeighbor(indices, nVerts, pointRep, adjacency, face, foundFace, va, vb);
+                }
+            }
+        }
+
+        // look for any face that links to the same neighbor more than once
+        bool duplicate = false;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t end = std::min<size_t>(nFaces, size_t(block + 1) * blockSize);
+            for (size_t face = size_t(block) * blockSize; face < end; ++face)
+            {
+                const uint32_t* adj = &adjacency[face * 3];
+
+                if ((adj[0] != UNUSED32 && (adj[0] == adj[1] || adj[0] == adj[2]))
+                    || (adj[1] != UNUSED32 && adj[1] == adj[2]))
+                {
+                    duplicate = true;
+                }
+            }
+        }
+
+        tied = duplicate;
+
+        return S_OK;
+    }
+#endif
+
+
     //---------------------------------------------------------------------------------
     // Convert PointRep to Adjacency
     //---------------------------------------------------------------------------------
@@ -339,23 +862,36 @@ namespace
         _In_reads_(nVerts) const uint32_t* pointRep,
         _Out_writes_(nFaces * 3) uint32_t* adjacency)
     {
-        size_t hashSize = nVerts / 3;
+#ifdef _OPENMP
+        if (nFaces >= c_MinParallelCount && omp_get_max_threads() > 1)
+        {
+            bool tied = false;
+            HRESULT hr = ConvertPointRepsToAdjacencyParallel(indices, nFaces, positions, nVerts, pointRep, adjacency, tied);
+            if (FAILED(hr) || !tied)
+                return hr;
+        }
+#endif
 
-        std::unique_ptr<edgeHashEntry*[]> hashTable(new (std::nothrow) edgeHashEntry*[hashSize]);
-        if (!hashTable)
+        size_t hashSize = EdgeHashSize(3 * nFaces);
+        if (!hashSize)
             return E_OUTOFMEMORY;
 
-        memset(hashTable.get(), 0, sizeof(edgeHashEntry*) * hashSize);
-
-        std::unique_ptr<edgeHashEntry[]> hashEntries(new (std::nothrow) edgeHashEntry[3 * nFaces]);
-        if (!hashEntries)
+        auto hashTable = make_scratch<edgeHashEntry>(hashSize);
+        if (!hashTable)
             return E_OUTOFMEMORY;
 
-        uint32_t freeEntry = 0;
+        memset(hashTable.get(), 0xff, sizeof(edgeHashEntry) * hashSize);
+
+        size_t mask = hashSize - 1;
 
         // add face edges to hash table and validate indices
         for (size_t face = 0; face < nFaces; ++face)
         {
+            if (face + c_EdgePrefetchDistance < nFaces)
+            {
+                PrefetchEdges(&indices[(face + c_EdgePrefetchDistance) * 3], nVerts, pointRep, hashTable.get(), mask, false);
+            }
+
             index_t i0 = indices[face * 3];
             index_t i1 = indices[face * 3 + 1];
             index_t i2 = indices[face * 3 + 2];
@@ -384,29 +920,19 @@ namespace
                 uint32_t vb = pointRep[indices[face * 3 + ((point + 1) % 3)]];
                 uint32_t vOther = pointRep[indices[face * 3 + ((point + 2) % 3)]];
 
-                uint32_t hashKey = va % hashSize;
-
-                assert(freeEntry < (3 * nFaces));
-                _Analysis_assume_(freeEntry < (3 * nFaces));
-
-                auto newEntry = &hashEntries[freeEntry];
-                ++freeEntry;
-
-                newEntry->v1 = va;
-                newEntry->v2 = vb;
-                newEntry->vOther = vOther;
-                newEntry->face = uint32_t(face);
-                newEntry->next = hashTable[hashKey];
-                hashTable[hashKey] = newEntry;
+                InsertEdge(hashTable.get(), mask, EdgeKey(va, vb), uint32_t(face), vOther);
             }
         }
 
-        assert(freeEntry <= (3 * nFaces));
-
         memset(adjacency, 0xff, sizeof(uint32_t) * nFaces * 3);
 
         for (size_t face = 0; face < nFaces; ++face)
         {
+            if (face + c_EdgePrefetchDistance < nFaces)
+            {
+                PrefetchEdges(&indices[(face + c_EdgePrefetchDistance) * 3], nVerts, pointRep, hashTable.get(), mask, true);
+            }
+
             index_t i0 = indices[face * 3];
             index_t i1 = indices[face * 3 + 1];
             index_t i2 = indices[face * 3 + 2];
@@ -443,133 +969,13 @@ namespace
                 uint32_t vb = pointRep[indices[face * 3 + point]];
                 uint32_t vOther = pointRep[indices[face * 3 + ((point + 2) % 3)]];
 
-                uint32_t hashKey = va % hashSize;
-
-                edgeHashEntry* current = hashTable[hashKey];
-                edgeHashEntry* prev = nullptr;
-
-                uint32_t foundFace = UNUSED32;
-
-                while (current != 0)
-                {
-                    if ((current->v2 == vb) && (current->v1 == va))
-                    {
-                        foundFace = current->face;
-                        break;
-                    }
-
-                    prev = current;
-                    current = current->next;
-                }
-
-                edgeHashEntry* found = current;
-                edgeHashEntry* foundPrev = prev;
-
-                float bestDiff = -2.f;
-
-                // Scan for additional matches
-                if (current != 0)
-                {
-                    prev = current;
-                    current = current->next;
-
-                    // find 'better' match
-                    while (current != 0)
-                    {
-                        if ((current->v2 == vb) && (current->v1 == va))
-                        {
-                            XMVECTOR pB1 = XMLoadFloat3(&positions[vb]);
-                            XMVECTOR pB2 = XMLoadFloat3(&positions[va]);
-                            XMVECTOR pB3 = XMLoadFloat3(&positions[vOther]);
-
-                            XMVECTOR v12 = XMVectorSubtract(pB1, pB2);
-                            XMVECTOR v13 = XMVectorSubtract(pB1, pB3);
-
-                            XMVECTOR bnormal = XMVector3Normalize(XMVector3Cross(v12, v13));
-
-                            if (bestDiff == -2.f)
-                            {
-                                XMVECTOR pA1 = XMLoadFloat3(&positions[found->v1]);
-                                XMVECTOR pA2 = XMLoadFloat3(&positions[found->v2]);
-                                XMVECTOR pA3 = XMLoadFloat3(&positions[found->vOther]);
-
-                                v12 = XMVectorSubtract(pA1, pA2);
-                                v13 = XMVectorSubtract(pA1, pA3);
-
-                                XMVECTOR anormal = XMVector3Normalize(XMVector3Cross(v12, v13));
-
-                                bestDiff = XMVectorGetX(XMVector3Dot(anormal, bnormal));
-                            }
-
-                            XMVECTOR pA1 = XMLoadFloat3(&positions[current->v1]);
-                            XMVECTOR pA2 = XMLoadFloat3(&positions[current->v2]);
-                            XMVECTOR pA3 = XMLoadFloat3(&positions[current->vOther]);
-
-                            v12 = XMVectorSubtract(pA1, pA2);
-                            v13 = XMVectorSubtract(pA1, pA3);
-
-                            XMVECTOR anormal = XMVector3Normalize(XMVector3Cross(v12, v13));
-
-                            float diff = XMVectorGetX(XMVector3Dot(anormal, bnormal));
-
-                            // if face normals are closer, use new match
-                            if (diff > bestDiff)
-                            {
-                                found = current;
-                                foundPrev = prev;
-                                foundFace = current->face;
-                                bestDiff = diff;
-                            }
-                        }
-
-                        prev = current;
-                        current = current->next;
-                    }
-                }
+                uint32_t foundFace = MatchEdge(hashTable.get(), mask, positions, uint32_t(face), va, vb, vOther);
 
                 if (foundFace != UNUSED32)
                 {
-                    assert(found != 0);
-
-                    // remove found face from hash table
-                    if (foundPrev != 0)
-                    {
-                        foundPrev->next = found->next;
-                    }
-                    else
-                    {
-                        hashTable[hashKey] = found->next;
-                    }
-
                     assert(adjacency[face * 3 + point] == UNUSED32);
                     adjacency[face * 3 + point] = foundFace;
 
-                    // Check for other edge
-                    uint32_t hashKey2 = vb % hashSize;
-
-                    current = hashTable[hashKey2];
-                    prev = nullptr;
-
-                    while (current != 0)
-                    {
-                        if ((current->face == uint32_t(face)) && (current->v2 == va) && (current->v1 == vb))
-                        {
-                            // trim edge from hash table
-                            if (prev != 0)
-                            {
-                                prev->next = current->next;
-                            }
-                            else
-                            {
-                                hashTable[hashKey2] = current->next;
-                            }
-                            break;
-                        }
-
-                        prev = current;
-                        current = current->next;
-                    }
-
                     // mark neighbor to point back
                     bool linked = false;
 
@@ -585,32 +991,7 @@ namespace
 
                     if (!linked)
                     {
-                        uint32_t point2 = 0;
-                        for (; point2 < 3; ++point2)
-                        {
-                            index_t k = indices[foundFace * 3 + point2];
-                            if (k == index_t(-1))
-                                continue;
-
-                            assert(k < nVerts);
-                            _Analysis_assume_(k < nVerts);
-
-                            if (pointRep[k] == va)
-                                break;
-                        }
-
-                        if (point2 < 3)
-                        {
-#ifndef NDEBUG
-                            uint32_t testPoint = indices[foundFace * 3 + ((point2 + 1) % 3)];
-                            testPoint = pointRep[testPoint];
-                            assert(testPoint == vb);
-#endif
-                            assert(adjacency[foundFace * 3 + point2] == UNUSED32);
-
-                            // update neighbor to point back to this face match edge
-                            adjacency[foundFace * 3 + point2] = uint32_t(face);
-                        }
+                        LinkNeighbor(indices, nVerts, pointRep, adjacency, uint32_t(face), foundFace, va, vb);
                     }
                 }
             }
@@ -620,6 +1001,41 @@ namespace
     }
 }
 
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeAdjacency(size_t nFaces, size_t nVerts)
+{
+    size_t nEdges = nFaces * 3;
+    size_t hashSize = nVerts / 3;
+
+    size_t pointReps = ScratchBytes<uint32_t>(nVerts + nEdges)
+        + std::max(ScratchBytes<vertexHashEntry*>(hashSize) + ScratchBytes<vertexHashEntry>(nVerts),
+                   ScratchBytes<uint32_t>(nVerts));
+
+    size_t adjacency = ScratchBytes<edgeHashEntry>(EdgeHashSize(nEdges));
+
+#ifdef _OPENMP
+    size_t nBlocks = size_t(omp_get_max_threads());
+    size_t nParts = nBlocks * 4;
+    size_t partitions = ScratchBytes<size_t>(nBlocks * nParts + nParts + 1);
+
+    pointReps = std::max(pointReps,
+        ScratchBytes<uint32_t>(nVerts + nEdges) + ScratchBytes<uint32_t>(nVerts * 2) + partitions
+        + ScratchBytes<vertexHashEntry*>(hashSize) + ScratchBytes<vertexHashEntry>(nVerts));
+
+    // each partition table is under three entries per edge, at least 16
+    adjacency = std::max(adjacency,
+        ScratchBytes<uint32_t>(nEdges * 2) + partitions + ScratchBytes<size_t>(nParts + 1)
+        + ScratchBytes<edgeHashEntry>(nEdges * 3 + nParts * 18));
+#endif
+
+    // point reps the caller did not provide
+    return ScratchBytes<uint32_t>(nVerts) + std::max(pointReps, adjacency);
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -632,6 +1048,8 @@ HRESULT DirectX::GenerateAdjacencyAndPointReps(
     float epsilon,
     uint32_t* pointRep, uint32_t* adjacency)
 {
+    stage_stats stats("GenerateAdjacencyAndPointReps", nFaces, nVerts);
+
     if (!indices || !nFaces || !positions || !nVerts)
         return E_INVALIDARG;
 
@@ -644,10 +1062,10 @@ HRESULT DirectX::GenerateAdjacencyAndPointReps(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    std::unique_ptr<uint32_t[]> temp;
+    scratch_array<uint32_t> temp;
     if (!pointRep)
     {
-        temp.reset(new (std::nothrow) uint32_t[nVerts]);
+        temp = make_scratch<uint32_t>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -671,6 +1089,8 @@ HRESULT DirectX::GenerateAdjacencyAndPointReps(
     float epsilon,
     uint32_t* pointRep, uint32_t* adjacency)
 {
+    stage_stats stats("GenerateAdjacencyAndPointReps", nFaces, nVerts);
+
     if (!indices || !nFaces || !positions || !nVerts)
         return E_INVALIDARG;
 
@@ -683,10 +1103,10 @@ HRESULT DirectX::GenerateAdjacencyAndPointReps(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    std::unique_ptr<uint32_t[]> temp;
+    scratch_array<uint32_t> temp;
     if (!pointRep)
     {
-        temp.reset(new (std::nothrow) uint32_t[nVerts]);
+        temp = make_scratch<uint32_t>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -721,10 +1141,10 @@ HRESULT DirectX::ConvertPointRepsToAdjacency(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    std::unique_ptr<uint32_t[]> temp;
+    scratch_array<uint32_t> temp;
     if (!pointRep)
     {
-        temp.reset(new (std::nothrow) uint32_t[nVerts]);
+        temp = make_scratch<uint32_t>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -755,10 +1175,10 @@ HRESULT DirectX::ConvertPointRepsToAdjacency(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-    std::unique_ptr<uint32_t[]> temp;
+    scratch_array<uint32_t> temp;
     if (!pointRep)
     {
-        temp.reset(new (std::nothrow) uint32_t[nVerts]);
+        temp = make_scratch<uint32_t>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -37,7 +37,7 @@ namespace
         size_t curNewVert = nVerts;
 
         size_t tsize = (sizeof(bool) * nFaces * 3) + (sizeof(uint32_t) * nVerts) + (sizeof(index_t) * nFaces * 3);
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[tsize]);
+        auto temp = make_scratch<uint8_t>(tsize);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -327,6 +327,7 @@ namespace
 
             std::vector<uint32_t> dupAttr;
             dupAttr.reserve(dupVerts.size());
+            TrackTempBytes(sizeof(uint32_t) * dupVerts.size());
             for (size_t j = 0; j < dupVerts.size(); ++j)
             {
                 dupAttr.push_back(UNUSED32);
@@ -413,6 +414,17 @@ namespace
     }
 }
 
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeClean(size_t nFaces, size_t nVerts)
+{
+    size_t tsize = (sizeof(bool) * nFaces * 3) + (sizeof(uint32_t) * nVerts) + (sizeof(uint32_t) * nFaces * 3);
+
+    return std::max(ScratchBytes(tsize), ScratchSizeValidate(nFaces, nVerts));
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -425,6 +437,8 @@ HRESULT DirectX::Clean(
     uint32_t* adjacency, const uint32_t* attributes,
     std::vector<uint32_t>& dupVerts, bool breakBowties)
 {
+    stage_stats stats("Clean", nFaces, nVerts);
+
     HRESULT hr = Validate(indices, nFaces, nVerts, adjacency, VALIDATE_DEFAULT);
     if (FAILED(hr))
         return hr;
@@ -441,6 +455,8 @@ HRESULT DirectX::Clean(
     uint32_t* adjacency, const uint32_t* attributes,
     std::vector<uint32_t>& dupVerts, bool breakBowties)
 {
+    stage_stats stats("Clean", nFaces, nVerts);
+
     HRESULT hr = Validate(indices, nFaces, nVerts, adjacency, VALIDATE_DEFAULT);
     if (FAILED(hr))
         return hr;
@@ -0,0 +1,729 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshCodec.cpp
+//
+// DirectX Mesh Geometry Library - Index and vertex buffer compression
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    const uint8_t c_IndexCodecVersion = 1;
+    const uint8_t c_VertexCodecVersion = 1;
+
+    //---------------------------------------------------------------------------------
+    // Index codec
+    //
+    // Each face is one code byte, with any extra data in a second stream after the
+    // nFaces code bytes so the codes stay entropy-friendly:
+    //
+    //  bits 0-1    corner of the face that starts the shared edge (3 when no edge matched)
+    //  bits 2-3    edge FIFO slot
+    //  bits 4-7    remaining vertex: 0 next new vertex, 1-14 vertex FIFO slot 0-13,
+    //              15 explicit
+    //
+    // Faces with no shared edge use bits 2-7 as three 2-bit kinds, one per corner: 0
+    // next new vertex, 1 vertex FIFO slot (stored in the next data byte), 2 explicit.
+    // Explicit vertices are a zigzag varint of the delta from the next new vertex.
+    // Faces are never rotated, so decoding reproduces the IB exactly.
+    //---------------------------------------------------------------------------------
+    const uint32_t c_EdgeFIFOSize = 4;
+    const uint32_t c_VertexFIFOSize = 16;
+    const uint32_t c_VertexFIFOCodes = 14;
+
+    const uint32_t c_CodeNoEdge = 3;
+    const uint32_t c_CodeNext = 0;
+    const uint32_t c_CodeExplicit = 15;
+
+    const uint32_t c_KindNext = 0;
+    const uint32_t c_KindFIFO = 1;
+    const uint32_t c_KindExplicit = 2;
+
+    class IndexCodecState
+    {
+    public:
+        IndexCodecState() : m_edgeOffset(0), m_vertexOffset(0), m_next(0)
+        {
+            for (uint32_t j = 0; j < c_EdgeFIFOSize; ++j)
+            {
+                m_edges[j][0] = m_edges[j][1] = UNUSED32;
+            }
+
+            for (uint32_t j = 0; j < c_VertexFIFOSize; ++j)
+            {
+                m_vertices[j] = UNUSED32;
+            }
+        }
+
+        // Slot 0 is the most recently pushed entry
+        const uint32_t* Edge(uint32_t slot) const { return m_edges[(m_edgeOffset - 1 - slot) & (c_EdgeFIFOSize - 1)]; }
+        uint32_t Vertex(uint32_t slot) const { return m_vertices[(m_vertexOffset - 1 - slot) & (c_VertexFIFOSize - 1)]; }
+        uint32_t Next() const { return m_next; }
+
+        void PushEdge(uint32_t a, uint32_t b)
+        {
+            // Stored in the order the neighbouring face traverses it
+            uint32_t* edge = m_edges[m_edgeOffset & (c_EdgeFIFOSize - 1)];
+            edge[0] = b;
+            edge[1] = a;
+            ++m_edgeOffset;
+        }
+
+        // Called for every vertex coded as next or explicit
+        void PushVertex(uint32_t v)
+        {
+            if (v == m_next)
+                ++m_next;
+
+            m_vertices[m_vertexOffset & (c_VertexFIFOSize - 1)] = v;
+            ++m_vertexOffset;
+        }
+
+        void PushFace(_In_reads_(3) const uint32_t* face, uint32_t sharedCorner)
+        {
+            for (uint32_t point = 0; point < 3; ++point)
+            {
+                if (point != sharedCorner)
+                    PushEdge(face[point], face[(point + 1) % 3]);
+            }
+        }
+
+        int FindVertex(uint32_t v, uint32_t count) const
+        {
+            for (uint32_t slot = 0; slot < count; ++slot)
+            {
+                if (Vertex(slot) == v)
+                    return int(slot);
+            }
+
+            return -1;
+        }
+
+    private:
+        uint32_t    m_edges[c_EdgeFIFOSize][2];
+        uint32_t    m_vertices[c_VertexFIFOSize];
+        uint32_t    m_edgeOffset;
+        uint32_t    m_vertexOffset;
+        uint32_t    m_next;
+    };
+
+    inline uint8_t* WriteVarint(_Out_writes_(5) uint8_t* dest, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            *(dest++) = uint8_t(value | 0x80);
+            value >>= 7;
+        }
+
+        *(dest++) = uint8_t(value);
+        return dest;
+    }
+
+    inline bool ReadVarint(const uint8_t*& src, _In_ const uint8_t* end, uint32_t& value)
+    {
+        value = 0;
+
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            if (src >= end)
+                return false;
+
+            uint8_t byte = *(src++);
+            value |= uint32_t(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    inline uint32_t ZigZag(uint32_t delta) { return (delta << 1) ^ (0u - (delta >> 31)); }
+    inline uint32_t UnZigZag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+    uint8_t* EncodeExplicit(_Out_writes_(5) uint8_t* data, const IndexCodecState& state, uint32_t v)
+    {
+        return WriteVarint(data, ZigZag(v - state.Next()));
+    }
+
+    bool DecodeExplicit(const uint8_t*& data, _In_ const uint8_t* end, const IndexCodecState& state, uint32_t& v)
+    {
+        uint32_t value;
+        if (!ReadVarint(data, end, value))
+            return false;
+
+        v = state.Next() + UnZigZag(value);
+        return true;
+    }
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT EncodeIndicesImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        std::vector<uint8_t>& encoded)
+    {
+        // Worst case is a version byte, a code per face, and a 5 byte varint per corner
+        encoded.resize(1 + nFaces + nFaces * 15);
+
+        uint8_t* codes = encoded.data();
+        *(codes++) = c_IndexCodecVersion;
+
+        uint8_t* data = codes + nFaces;
+
+        IndexCodecState state;
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            uint32_t f[3] = { indices[face * 3], indices[face * 3 + 1], indices[face * 3 + 2] };
+
+            uint32_t corner = c_CodeNoEdge;
+            uint32_t edgeSlot = 0;
+            for (uint32_t slot = 0; slot < c_EdgeFIFOSize && corner == c_CodeNoEdge; ++slot)
+            {
+                const uint32_t* edge = state.Edge(slot);
+
+                for (uint32_t point = 0; point < 3; ++point)
+                {
+                    if (f[point] == edge[0] && f[(point + 1) % 3] == edge[1])
+                    {
+                        corner = point;
+                        edgeSlot = slot;
+                        break;
+                    }
+                }
+            }
+
+            if (corner != c_CodeNoEdge)
+            {
+                uint32_t third = f[(corner + 2) % 3];
+
+                uint32_t kind;
+                int slot = state.FindVertex(third, c_VertexFIFOCodes);
+                if (slot >= 0)
+                {
+                    kind = 1 + uint32_t(slot);
+                }
+                else if (third == state.Next())
+                {
+                    kind = c_CodeNext;
+                    state.PushVertex(third);
+                }
+                else
+                {
+                    kind = c_CodeExplicit;
+                    data = EncodeExplicit(data, state, third);
+                    state.PushVertex(third);
+                }
+
+                *(codes++) = uint8_t(corner | (edgeSlot << 2) | (kind << 4));
+            }
+            else
+            {
+                uint32_t kinds = 0;
+                for (uint32_t point = 0; point < 3; ++point)
+                {
+                    uint32_t v = f[point];
+
+                    int slot = state.FindVertex(v, c_VertexFIFOSize);
+                    if (slot >= 0)
+                    {
+                        kinds |= c_KindFIFO << (point * 2);
+                        *(data++) = uint8_t(slot);
+                    }
+                    else if (v == state.Next())
+                    {
+                        kinds |= c_KindNext << (point * 2);
+                        state.PushVertex(v);
+                    }
+                    else
+                    {
+                        kinds |= c_KindExplicit << (point * 2);
+                        data = EncodeExplicit(data, state, v);
+                        state.PushVertex(v);
+                    }
+                }
+
+                *(codes++) = uint8_t(c_CodeNoEdge | (kinds << 2));
+            }
+
+            state.PushFace(f, corner);
+        }
+
+        encoded.resize(size_t(data - encoded.data()));
+        encoded.shrink_to_fit();
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT DecodeIndicesImpl(
+        _In_reads_bytes_(size) const uint8_t* encoded, size_t size,
+        size_t nFaces,
+        _Out_writes_(nFaces * 3) index_t* indices)
+    {
+        if (size < 1 + nFaces || encoded[0] != c_IndexCodecVersion)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        const uint8_t* codes = encoded + 1;
+        const uint8_t* data = codes + nFaces;
+        const uint8_t* end = encoded + size;
+
+        const uint32_t maxIndex = uint32_t(index_t(-1));
+
+        IndexCodecState state;
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            uint32_t code = *(codes++);
+            uint32_t corner = code & 0x3;
+
+            uint32_t f[3];
+
+            if (corner != c_CodeNoEdge)
+            {
+                const uint32_t* edge = state.Edge((code >> 2) & 0x3);
+                uint32_t kind = code >> 4;
+
+                uint32_t third;
+                if (kind == c_CodeNext)
+                {
+                    third = state.Next();
+                    state.PushVertex(third);
+                }
+                else if (kind == c_CodeExplicit)
+                {
+                    if (!DecodeExplicit(data, end, state, third))
+                        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                    state.PushVertex(third);
+                }
+                else
+                {
+                    third = state.Vertex(kind - 1);
+                }
+
+                f[corner] = edge[0];
+                f[(corner + 1) % 3] = edge[1];
+                f[(corner + 2) % 3] = third;
+            }
+            else
+            {
+                for (uint32_t point = 0; point < 3; ++point)
+                {
+                    uint32_t kind = (code >> (2 + point * 2)) & 0x3;
+
+                    uint32_t v;
+                    switch (kind)
+                    {
+                    case c_KindNext:
+                        v = state.Next();
+                        state.PushVertex(v);
+                        break;
+
+                    case c_KindFIFO:
+                        if (data >= end || *data >= c_VertexFIFOSize)
+                            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                        v = state.Vertex(*(data++));
+                        break;
+
+                    case c_KindExplicit:
+                        if (!DecodeExplicit(data, end, state, v))
+                            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                        state.PushVertex(v);
+                        break;
+
+                    default:
+                        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                    }
+
+                    f[point] = v;
+                }
+            }
+
+            for (uint32_t point = 0; point < 3; ++point)
+            {
+                if (f[point] > maxIndex)
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                indices[face * 3 + point] = index_t(f[point]);
+            }
+
+            state.PushFace(f, corner);
+        }
+
+        if (data != end)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Vertex codec
+    //
+    // Vertices are processed in blocks. Within a block each byte of the vertex is coded
+    // as its own channel: the zigzag byte deltas between consecutive vertices, split into
+    // groups of 16. A header holds a 2-bit mode per group (all zero, 2-bit, 4-bit, or
+    // raw bytes), followed by the packed groups. Vertices from OptimizeVertices change
+    // slowly in vertex order, so most groups pack into 0, 4, or 8 bytes.
+    //
+    // 2-bit value j of a group is in byte j % 4 at bit 2 * (j / 4), and 4-bit value j is
+    // in byte j % 8 at bit 4 * (j / 8), so unpacking only needs whole-register shifts.
+    //---------------------------------------------------------------------------------
+    const size_t c_VertexGroupSize = 16;
+    const size_t c_VertexBlockMaxVerts = 256;
+    const size_t c_VertexBlockMaxBytes = 8192;
+
+    enum VERTEX_GROUP_MODE
+    {
+        VGROUP_ZERO = 0,
+        VGROUP_BITS2,
+        VGROUP_BITS4,
+        VGROUP_BYTES,
+    };
+
+    const size_t c_GroupBytes[4] = { 0, 4, 8, 16 };
+
+    inline size_t VertexBlockSize(size_t stride)
+    {
+        size_t count = (c_VertexBlockMaxBytes / stride) & ~(c_VertexGroupSize - 1);
+        return std::min(std::max(count, c_VertexGroupSize), c_VertexBlockMaxVerts);
+    }
+
+    inline uint8_t ZigZag8(uint8_t delta) { return uint8_t((delta << 1) ^ (0u - (delta >> 7))); }
+
+    uint8_t* EncodeGroup(_Out_writes_(16) uint8_t* dest, _In_reads_(16) const uint8_t* values, uint32_t& mode)
+    {
+        uint8_t maxValue = 0;
+        for (size_t j = 0; j < c_VertexGroupSize; ++j)
+        {
+            maxValue = std::max(maxValue, values[j]);
+        }
+
+        if (!maxValue)
+        {
+            mode = VGROUP_ZERO;
+        }
+        else if (maxValue < 4)
+        {
+            mode = VGROUP_BITS2;
+            memset(dest, 0, 4);
+            for (size_t j = 0; j < c_VertexGroupSize; ++j)
+            {
+                dest[j & 3] |= uint8_t(values[j] << ((j >> 2) * 2));
+            }
+        }
+        else if (maxValue < 16)
+        {
+            mode = VGROUP_BITS4;
+            memset(dest, 0, 8);
+            for (size_t j = 0; j < c_VertexGroupSize; ++j)
+            {
+                dest[j & 7] |= uint8_t(values[j] << ((j >> 3) * 4));
+            }
+        }
+        else
+        {
+            mode = VGROUP_BYTES;
+            memcpy(dest, values, c_VertexGroupSize);
+        }
+
+        return dest + c_GroupBytes[mode];
+    }
+
+    // Unpacks a group, undoes the zigzag delta coding, and returns the last value
+    uint8_t DecodeGroup(_In_reads_(c_GroupBytes[mode]) const uint8_t* src, uint32_t mode, uint8_t last, _Out_writes_(16) uint8_t* dest)
+    {
+#if defined(_XM_SSE_INTRINSICS_)
+        __m128i v;
+        switch (mode)
+        {
+        case VGROUP_ZERO:
+            v = _mm_setzero_si128();
+            break;
+
+        case VGROUP_BITS2:
+            {
+                int bits;
+                memcpy(&bits, src, sizeof(int));
+                v = _mm_and_si128(
+                    _mm_set_epi32(int(unsigned(bits) >> 6), int(unsigned(bits) >> 4), int(unsigned(bits) >> 2), bits),
+                    _mm_set1_epi8(0x03));
+            }
+            break;
+
+        case VGROUP_BITS4:
+            {
+                __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+                v = _mm_and_si128(_mm_unpacklo_epi64(bits, _mm_srli_epi64(bits, 4)), _mm_set1_epi8(0x0f));
+            }
+            break;
+
+        default:
+            v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            break;
+        }
+
+        // (v >> 1) ^ -(v & 1); SSE2 has no byte shifts, so mask off what a 16-bit shift carries in
+        __m128i half = _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f));
+        __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+        v = _mm_xor_si128(half, sign);
+
+        // Prefix sum of the deltas
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi8(v, _mm_set1_epi8(char(last)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), v);
+
+        return uint8_t(_mm_extract_epi16(v, 7) >> 8);
+#else
+        for (size_t j = 0; j < c_VertexGroupSize; ++j)
+        {
+            uint8_t value;
+            switch (mode)
+            {
+            case VGROUP_ZERO:   value = 0; break;
+            case VGROUP_BITS2:  value = (src[j & 3] >> ((j >> 2) * 2)) & 0x3; break;
+            case VGROUP_BITS4:  value = (src[j & 7] >> ((j >> 3) * 4)) & 0xf; break;
+            default:            value = src[j]; break;
+            }
+
+            last = uint8_t(last + ((value >> 1) ^ (0u - (value & 1))));
+            dest[j] = last;
+        }
+
+        return last;
+#endif
+    }
+}
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::EncodeIndexBuffer(
+    const uint16_t* indices,
+    size_t nFaces,
+    std::vector<uint8_t>& encoded)
+{
+    if (!indices || !nFaces)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 16) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    return EncodeIndicesImpl<uint16_t>(indices, nFaces, encoded);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::EncodeIndexBuffer(
+    const uint32_t* indices,
+    size_t nFaces,
+    std::vector<uint8_t>& encoded)
+{
+    if (!indices || !nFaces)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 16) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    return EncodeIndicesImpl<uint32_t>(indices, nFaces, encoded);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::DecodeIndexBuffer(
+    const uint8_t* encoded,
+    size_t size,
+    size_t nFaces,
+    uint16_t* indices)
+{
+    if (!encoded || !size || !nFaces || !indices)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    return DecodeIndicesImpl<uint16_t>(encoded, size, nFaces, indices);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::DecodeIndexBuffer(
+    const uint8_t* encoded,
+    size_t size,
+    size_t nFaces,
+    uint32_t* indices)
+{
+    if (!encoded || !size || !nFaces || !indices)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    return DecodeIndicesImpl<uint32_t>(encoded, size, nFaces, indices);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::EncodeVertexBuffer(
+    const void* vertices,
+    size_t nVerts,
+    size_t stride,
+    std::vector<uint8_t>& encoded)
+{
+    if (!vertices || !nVerts || !stride)
+        return E_INVALIDARG;
+
+    if (stride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nVerts) * stride * 2) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    const size_t blockVerts = VertexBlockSize(stride);
+    const size_t blockGroups = blockVerts / c_VertexGroupSize;
+
+    // Worst case is every group stored as raw bytes, plus the headers
+    size_t nBlocks = (nVerts + blockVerts - 1) / blockVerts;
+    encoded.resize(1 + nBlocks * stride * (((blockGroups + 3) / 4) + blockGroups * c_VertexGroupSize));
+
+    uint8_t* dest = encoded.data();
+    *(dest++) = c_VertexCodecVersion;
+
+    auto vptr = static_cast<const uint8_t*>(vertices);
+
+    uint8_t prev[D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES] = {};
+    uint8_t deltas[c_VertexBlockMaxVerts];
+
+    for (size_t base = 0; base < nVerts; base += blockVerts)
+    {
+        size_t count = std::min(blockVerts, nVerts - base);
+        size_t groups = (count + c_VertexGroupSize - 1) / c_VertexGroupSize;
+        size_t headerBytes = (groups + 3) / 4;
+
+        for (size_t k = 0; k < stride; ++k)
+        {
+            const uint8_t* src = vptr + base * stride + k;
+
+            uint8_t last = prev[k];
+            for (size_t j = 0; j < count; ++j)
+            {
+                uint8_t value = src[j * stride];
+                deltas[j] = ZigZag8(uint8_t(value - last));
+                last = value;
+            }
+            prev[k] = last;
+
+            memset(deltas + count, 0, groups * c_VertexGroupSize - count);
+
+            uint8_t* header = dest;
+            memset(header, 0, headerBytes);
+            dest += headerBytes;
+
+            for (size_t g = 0; g < groups; ++g)
+            {
+                uint32_t mode;
+                dest = EncodeGroup(dest, deltas + g * c_VertexGroupSize, mode);
+                header[g >> 2] |= uint8_t(mode << ((g & 3) * 2));
+            }
+        }
+    }
+
+    encoded.resize(size_t(dest - encoded.data()));
+    encoded.shrink_to_fit();
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::DecodeVertexBuffer(
+    const uint8_t* encoded,
+    size_t size,
+    size_t nVerts,
+    size_t stride,
+    void* vertices)
+{
+    if (!encoded || !size || !nVerts || !stride || !vertices)
+        return E_INVALIDARG;
+
+    if (stride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nVerts) * stride * 2) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (encoded[0] != c_VertexCodecVersion)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    const uint8_t* src = encoded + 1;
+    const uint8_t* end = encoded + size;
+
+    const size_t blockVerts = VertexBlockSize(stride);
+
+    auto vptr = static_cast<uint8_t*>(vertices);
+
+    uint8_t prev[D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES] = {};
+    uint8_t values[c_VertexBlockMaxVerts];
+
+    for (size_t base = 0; base < nVerts; base += blockVerts)
+    {
+        size_t count = std::min(blockVerts, nVerts - base);
+        size_t groups = (count + c_VertexGroupSize - 1) / c_VertexGroupSize;
+        size_t headerBytes = (groups + 3) / 4;
+
+        for (size_t k = 0; k < stride; ++k)
+        {
+            if (size_t(end - src) < headerBytes)
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            const uint8_t* header = src;
+            src += headerBytes;
+
+            uint8_t last = prev[k];
+            for (size_t g = 0; g < groups; ++g)
+            {
+                uint32_t mode = (header[g >> 2] >> ((g & 3) * 2)) & 0x3;
+
+                if (size_t(end - src) < c_GroupBytes[mode])
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                last = DecodeGroup(src, mode, last, values + g * c_VertexGroupSize);
+                src += c_GroupBytes[mode];
+            }
+
+            uint8_t* dest = vptr + base * stride + k;
+            for (size_t j = 0; j < count; ++j)
+            {
+                dest[j * stride] = values[j];
+            }
+
+            prev[k] = values[count - 1];
+        }
+    }
+
+    if (src != end)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    return S_OK;
+}
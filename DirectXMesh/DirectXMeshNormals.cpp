@@ -19,6 +19,273 @@ using namespace DirectX;
 
 namespace
 {
+    //---------------------------------------------------------------------------------
+    // Per-face kernels, shared by the serial and parallel code paths so the results match
+    //---------------------------------------------------------------------------------
+    inline XMVECTOR XM_CALLCONV EqualWeightFace(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2)
+    {
+        XMVECTOR u = XMVectorSubtract(p1, p0);
+        XMVECTOR v = XMVectorSubtract(p2, p0);
+
+        return XMVector3Normalize(XMVector3Cross(u, v));
+    }
+
+    inline XMVECTOR XM_CALLCONV AngleWeightFace(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2,
+        _Out_ XMVECTOR& w0, _Out_ XMVECTOR& w1, _Out_ XMVECTOR& w2)
+    {
+        XMVECTOR u = XMVectorSubtract(p1, p0);
+        XMVECTOR v = XMVectorSubtract(p2, p0);
+
+        XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(u, v));
+
+        // Corner 0 -> 1 - 0, 2 - 0
+        XMVECTOR a = XMVector3Normalize(u);
+        XMVECTOR b = XMVector3Normalize(v);
+        w0 = XMVector3Dot(a, b);
+        w0 = XMVectorClamp(w0, g_XMNegativeOne, g_XMOne);
+        w0 = XMVectorACos(w0);
+
+        // Corner 1 -> 2 - 1, 0 - 1
+        XMVECTOR c = XMVector3Normalize(XMVectorSubtract(p2, p1));
+        XMVECTOR d = XMVector3Normalize(XMVectorSubtract(p0, p1));
+        w1 = XMVector3Dot(c, d);
+        w1 = XMVectorClamp(w1, g_XMNegativeOne, g_XMOne);
+        w1 = XMVectorACos(w1);
+
+        // Corner 2 -> 0 - 2, 1 - 2
+        XMVECTOR e = XMVector3Normalize(XMVectorSubtract(p0, p2));
+        XMVECTOR f = XMVector3Normalize(XMVectorSubtract(p1, p2));
+        w2 = XMVector3Dot(e, f);
+        w2 = XMVectorClamp(w2, g_XMNegativeOne, g_XMOne);
+        w2 = XMVectorACos(w2);
+
+        return faceNormal;
+    }
+
+    inline XMVECTOR XM_CALLCONV AreaWeightFace(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2,
+        _Out_ XMVECTOR& w0, _Out_ XMVECTOR& w1, _Out_ XMVECTOR& w2)
+    {
+        XMVECTOR u = XMVectorSubtract(p1, p0);
+        XMVECTOR v = XMVectorSubtract(p2, p0);
+
+        XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(u, v));
+
+        // Corner 0 -> 1 - 0, 2 - 0
+        w0 = XMVector3Cross(u, v);
+        w0 = XMVector3Length(w0);
+
+        // Corner 1 -> 2 - 1, 0 - 1
+        XMVECTOR c = XMVectorSubtract(p2, p1);
+        XMVECTOR d = XMVectorSubtract(p0, p1);
+        w1 = XMVector3Cross(c, d);
+        w1 = XMVector3Length(w1);
+
+        // Corner 2 -> 0 - 2, 1 - 2
+        XMVECTOR e = XMVectorSubtract(p0, p2);
+        XMVECTOR f = XMVectorSubtract(p1, p2);
+        w2 = XMVector3Cross(e, f);
+        w2 = XMVector3Length(w2);
+
+        return faceNormal;
+    }
+
+    void LoadNormals(
+        _Out_writes_(nVerts) XMVECTOR* vertNormals, size_t nVerts,
+        bool cw, bool accumulate, _In_reads_(nVerts) const XMFLOAT3* normals)
+    {
+        if (!accumulate)
+        {
+            memset(vertNormals, 0, sizeof(XMVECTOR) * nVerts);
+            return;
+        }
+
+        // partial sums are kept in the output winding, so undo the negation StoreNormals applies
+        for (size_t vert = 0; vert < nVerts; ++vert)
+        {
+            XMVECTOR n = XMLoadFloat3(&normals[vert]);
+            vertNormals[vert] = (cw) ? XMVectorNegate(n) : n;
+        }
+    }
+
+    void StoreNormals(
+        _In_reads_(nVerts) const XMVECTOR* vertNormals, size_t nVerts,
+        bool cw, bool accumulate, _Out_writes_(nVerts) XMFLOAT3* normals)
+    {
+        if (accumulate)
+        {
+            for (size_t vert = 0; vert < nVerts; ++vert)
+            {
+                XMVECTOR n = (cw) ? XMVectorNegate(vertNormals[vert]) : vertNormals[vert];
+                XMStoreFloat3(&normals[vert], n);
+            }
+        }
+        else if (cw)
+        {
+            for (size_t vert = 0; vert < nVerts; ++vert)
+            {
+                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
+                n = XMVectorNegate(n);
+                XMStoreFloat3(&normals[vert], n);
+            }
+        }
+        else
+        {
+            for (size_t vert = 0; vert < nVerts; ++vert)
+            {
+                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
+                XMStoreFloat3(&normals[vert], n);
+            }
+        }
+    }
+
+
+#ifdef _OPENMP
+    //---------------------------------------------------------------------------------
+    // Parallel support
+    //---------------------------------------------------------------------------------
+
+    // Smaller meshes are always processed serially
+    const size_t c_MinParallelFaces = 16384;
+
+    //---------------------------------------------------------------------------------
+    // The face kernels run in parallel first, keeping the normal and corner weights of
+    // each face. The corners are then bucketed by vertex range, and each thread sums its
+    // own bucket in face order, so every vertex sees the same sequence of operations as
+    // the serial code.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeNormalsParallel(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        DWORD flags, _Inout_updates_all_(nVerts) XMFLOAT3* normals)
+    {
+        auto nBlocks = uint32_t(omp_get_max_threads());
+
+        auto temp = make_scratch<XMVECTOR>(nVerts + nFaces * 2);
+        auto cornerTemp = make_scratch<uint32_t>(nFaces * 6);
+        auto counts = make_scratch<size_t>(nBlocks * nBlocks + nBlocks + 1);
+        if (!temp || !cornerTemp || !counts)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* vertNormals = temp.get();
+        XMVECTOR* faceData = temp.get() + nVerts;
+
+        uint32_t* cornerKeys = cornerTemp.get();
+        uint32_t* cornerOrder = cornerTemp.get() + nFaces * 3;
+        size_t* blockOffsets = counts.get() + nBlocks * nBlocks;
+
+        bool byArea = (flags & CNORM_WEIGHT_BY_AREA) != 0;
+        bool equal = !byArea && (flags & CNORM_WEIGHT_EQUAL) != 0;
+        bool cw = (flags & CNORM_WIND_CW) != 0;
+        bool accumulate = (flags & CNORM_ACCUMULATE) != 0;
+
+        size_t faceBlockSize = (nFaces + nBlocks - 1) / nBlocks;
+        size_t vertBlockSize = (nVerts + nBlocks - 1) / nBlocks;
+
+        // face normal and per-corner weights
+        bool badIndex = false;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t end = std::min<size_t>(nFaces, size_t(block + 1) * faceBlockSize);
+            for (size_t face = size_t(block) * faceBlockSize; face < end; ++face)
+            {
+                index_t i0 = indices[face * 3];
+                index_t i1 = indices[face * 3 + 1];
+                index_t i2 = indices[face * 3 + 2];
+
+                if (i0 == index_t(-1)
+                    || i1 == index_t(-1)
+                    || i2 == index_t(-1))
+                {
+                    cornerKeys[face * 3] = cornerKeys[face * 3 + 1] = cornerKeys[face * 3 + 2] = UNUSED32;
+                    continue;
+                }
+
+                if (i0 >= nVerts
+                    || i1 >= nVerts
+                    || i2 >= nVerts)
+                {
+                    badIndex = true;
+                    continue;
+                }
+
+                cornerKeys[face * 3] = uint32_t(i0 / vertBlockSize);
+                cornerKeys[face * 3 + 1] = uint32_t(i1 / vertBlockSize);
+                cornerKeys[face * 3 + 2] = uint32_t(i2 / vertBlockSize);
+
+                XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+                XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+                XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
+
+                if (equal)
+                {
+                    faceData[face * 2] = EqualWeightFace(p0, p1, p2);
+                }
+                else
+                {
+                    // the corner weights are replicated in each vector, so keep one lane of each
+                    XMVECTOR w0, w1, w2;
+                    faceData[face * 2] = (byArea) ? AreaWeightFace(p0, p1, p2, w0, w1, w2) : AngleWeightFace(p0, p1, p2, w0, w1, w2);
+                    faceData[face * 2 + 1] = XMVectorSet(XMVectorGetX(w0), XMVectorGetX(w1), XMVectorGetX(w2), 0.f);
+                }
+            }
+        }
+
+        if (badIndex)
+            return E_UNEXPECTED;
+
+        // sum into vertices, each block owning a range of them and walking only its corners
+        PartitionItems(cornerKeys, nFaces * 3, nBlocks, nBlocks, counts.get(), cornerOrder, blockOffsets);
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t vbegin = std::min<size_t>(nVerts, size_t(block) * vertBlockSize);
+            size_t vend = std::min<size_t>(nVerts, size_t(block + 1) * vertBlockSize);
+            if (vbegin >= vend)
+                continue;
+
+            LoadNormals(&vertNormals[vbegin], vend - vbegin, cw, accumulate, &normals[vbegin]);
+
+            for (size_t j = blockOffsets[block]; j < blockOffsets[block + 1]; ++j)
+            {
+                uint32_t corner = cornerOrder[j];
+                size_t face = corner / 3;
+                size_t point = corner % 3;
+
+                size_t i = indices[corner];
+                assert(i >= vbegin && i < vend);
+
+                XMVECTOR faceNormal = faceData[face * 2];
+
+                if (equal)
+                {
+                    vertNormals[i] = XMVectorAdd(vertNormals[i], faceNormal);
+                }
+                else
+                {
+                    XMVECTOR w;
+                    switch (point)
+                    {
+                    case 0: w = XMVectorSplatX(faceData[face * 2 + 1]); break;
+                    case 1: w = XMVectorSplatY(faceData[face * 2 + 1]); break;
+                    default: w = XMVectorSplatZ(faceData[face * 2 + 1]); break;
+                    }
+
+                    vertNormals[i] = XMVectorMultiplyAdd(faceNormal, w, vertNormals[i]);
+                }
+            }
+
+            StoreNormals(&vertNormals[vbegin], vend - vbegin, cw, accumulate, &normals[vbegin]);
+        }
+
+        return S_OK;
+    }
+#endif
+
+
     //---------------------------------------------------------------------------------
     // Compute normals with equal weighting
     //---------------------------------------------------------------------------------
@@ -26,14 +293,14 @@ namespace
     HRESULT ComputeNormalsEqualWeight(
         _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
         _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
-        bool cw, _Out_writes_(nVerts) XMFLOAT3* normals)
+        bool cw, bool accumulate, _Inout_updates_all_(nVerts) XMFLOAT3* normals)
     {
-        ScopedAlignedArrayXMVECTOR temp(reinterpret_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nVerts, 16)));
+        auto temp = make_scratch<XMVECTOR>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
         XMVECTOR* vertNormals = temp.get();
-        memset(vertNormals, 0, sizeof(XMVECTOR) * nVerts);
+        LoadNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         for (size_t face = 0; face < nFaces; ++face)
         {
@@ -51,38 +318,18 @@ namespace
                 || i2 >= nVerts)
                 return E_UNEXPECTED;
 
-            XMVECTOR p1 = XMLoadFloat3(&positions[i0]);
-            XMVECTOR p2 = XMLoadFloat3(&positions[i1]);
-            XMVECTOR p3 = XMLoadFloat3(&positions[i2]);
-
-            XMVECTOR u = XMVectorSubtract(p2, p1);
-            XMVECTOR v = XMVectorSubtract(p3, p1);
+            XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+            XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+            XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 
-            XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(u, v));
+            XMVECTOR faceNormal = EqualWeightFace(p0, p1, p2);
 
             vertNormals[i0] = XMVectorAdd(vertNormals[i0], faceNormal);
             vertNormals[i1] = XMVectorAdd(vertNormals[i1], faceNormal);
             vertNormals[i2] = XMVectorAdd(vertNormals[i2], faceNormal);
         }
 
-        // Store results
-        if (cw)
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                n = XMVectorNegate(n);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
-        else
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
+        StoreNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         return S_OK;
     }
@@ -95,14 +342,14 @@ namespace
     HRESULT ComputeNormalsWeightedByAngle(
         _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
         _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
-        bool cw, _Out_writes_(nVerts) XMFLOAT3* normals)
+        bool cw, bool accumulate, _Inout_updates_all_(nVerts) XMFLOAT3* normals)
     {
-        ScopedAlignedArrayXMVECTOR temp(reinterpret_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nVerts, 16)));
+        auto temp = make_scratch<XMVECTOR>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
         XMVECTOR* vertNormals = temp.get();
-        memset(vertNormals, 0, sizeof(XMVECTOR) * nVerts);
+        LoadNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         for (size_t face = 0; face < nFaces; ++face)
         {
@@ -124,55 +371,15 @@ namespace
             XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
             XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 
-            XMVECTOR u = XMVectorSubtract(p1, p0);
-            XMVECTOR v = XMVectorSubtract(p2, p0);
-
-            XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(u, v));
-
-            // Corner 0 -> 1 - 0, 2 - 0
-            XMVECTOR a = XMVector3Normalize(u);
-            XMVECTOR b = XMVector3Normalize(v);
-            XMVECTOR w0 = XMVector3Dot(a, b);
-            w0 = XMVectorClamp(w0, g_XMNegativeOne, g_XMOne);
-            w0 = XMVectorACos(w0);
-
-            // Corner 1 -> 2 - 1, 0 - 1
-            XMVECTOR c = XMVector3Normalize(XMVectorSubtract(p2, p1));
-            XMVECTOR d = XMVector3Normalize(XMVectorSubtract(p0, p1));
-            XMVECTOR w1 = XMVector3Dot(c, d);
-            w1 = XMVectorClamp(w1, g_XMNegativeOne, g_XMOne);
-            w1 = XMVectorACos(w1);
-
-            // Corner 2 -> 0 - 2, 1 - 2
-            XMVECTOR e = XMVector3Normalize(XMVectorSubtract(p0, p2));
-            XMVECTOR f = XMVector3Normalize(XMVectorSubtract(p1, p2));
-            XMVECTOR w2 = XMVector3Dot(e, f);
-            w2 = XMVectorClamp(w2, g_XMNegativeOne, g_XMOne);
-            w2 = XMVectorACos(w2);
+            XMVECTOR w0, w1, w2;
+            XMVECTOR faceNormal = AngleWeightFace(p0, p1, p2, w0, w1, w2);
 
             vertNormals[i0] = XMVectorMultiplyAdd(faceNormal, w0, vertNormals[i0]);
             vertNormals[i1] = XMVectorMultiplyAdd(faceNormal, w1, vertNormals[i1]);
             vertNormals[i2] = XMVectorMultiplyAdd(faceNormal, w2, vertNormals[i2]);
         }
 
-        // Store results
-        if (cw)
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                n = XMVectorNegate(n);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
-        else
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
+        StoreNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         return S_OK;
     }
@@ -185,14 +392,14 @@ namespace
     HRESULT ComputeNormalsWeightedByArea(
         _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
         _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
-        bool cw, _Out_writes_(nVerts) XMFLOAT3* normals)
+        bool cw, bool accumulate, _Inout_updates_all_(nVerts) XMFLOAT3* normals)
     {
-        ScopedAlignedArrayXMVECTOR temp(reinterpret_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nVerts, 16)));
+        auto temp = make_scratch<XMVECTOR>(nVerts);
         if (!temp)
             return E_OUTOFMEMORY;
 
         XMVECTOR* vertNormals = temp.get();
-        memset(vertNormals, 0, sizeof(XMVECTOR) * nVerts);
+        LoadNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         for (size_t face = 0; face < nFaces; ++face)
         {
@@ -214,55 +421,38 @@ namespace
             XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
             XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 
-            XMVECTOR u = XMVectorSubtract(p1, p0);
-            XMVECTOR v = XMVectorSubtract(p2, p0);
-
-            XMVECTOR faceNormal = XMVector3Normalize(XMVector3Cross(u, v));
-
-            // Corner 0 -> 1 - 0, 2 - 0
-            XMVECTOR w0 = XMVector3Cross(u, v);
-            w0 = XMVector3Length(w0);
-
-            // Corner 1 -> 2 - 1, 0 - 1
-            XMVECTOR c = XMVectorSubtract(p2, p1);
-            XMVECTOR d = XMVectorSubtract(p0, p1);
-            XMVECTOR w1 = XMVector3Cross(c, d);
-            w1 = XMVector3Length(w1);
-
-            // Corner 2 -> 0 - 2, 1 - 2
-            XMVECTOR e = XMVectorSubtract(p0, p2);
-            XMVECTOR f = XMVectorSubtract(p1, p2);
-            XMVECTOR w2 = XMVector3Cross(e, f);
-            w2 = XMVector3Length(w2);
+            XMVECTOR w0, w1, w2;
+            XMVECTOR faceNormal = AreaWeightFace(p0, p1, p2, w0, w1, w2);
 
             vertNormals[i0] = XMVectorMultiplyAdd(faceNormal, w0, vertNormals[i0]);
             vertNormals[i1] = XMVectorMultiplyAdd(faceNormal, w1, vertNormals[i1]);
             vertNormals[i2] = XMVectorMultiplyAdd(faceNormal, w2, vertNormals[i2]);
         }
 
-        // Store results
-        if (cw)
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                n = XMVectorNegate(n);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
-        else
-        {
-            for (size_t vert = 0; vert < nVerts; ++vert)
-            {
-                XMVECTOR n = XMVector3Normalize(vertNormals[vert]);
-                XMStoreFloat3(&normals[vert], n);
-            }
-        }
+        StoreNormals(vertNormals, nVerts, cw, accumulate, normals);
 
         return S_OK;
     }
 }
 
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeNormals(size_t nFaces, size_t nVerts)
+{
+    // the parallel path also keeps per-face data
+    size_t bytes = ScratchBytes<XMVECTOR>(nVerts + nFaces * 2);
+
+#ifdef _OPENMP
+    size_t nBlocks = size_t(omp_get_max_threads());
+
+    bytes += ScratchBytes<uint32_t>(nFaces * 6) + ScratchBytes<size_t>(nBlocks * nBlocks + nBlocks + 1);
+#endif
+
+    return bytes;
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -275,6 +465,8 @@ HRESULT DirectX::ComputeNormals(
     DWORD flags,
     XMFLOAT3* normals)
 {
+    stage_stats stats("ComputeNormals", nFaces, nVerts);
+
     if (!indices || !positions || !nFaces || !nVerts || !normals)
         return E_INVALIDARG;
 
@@ -284,19 +476,25 @@ HRESULT DirectX::ComputeNormals(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
+#ifdef _OPENMP
+    if (nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
+        return ComputeNormalsParallel<uint16_t>(indices, nFaces, positions, nVerts, flags, normals);
+#endif
+
     bool cw = (flags & CNORM_WIND_CW) ? true : false;
+    bool accumulate = (flags & CNORM_ACCUMULATE) ? true : false;
 
     if (flags & CNORM_WEIGHT_BY_AREA)
     {
-        return ComputeNormalsWeightedByArea<uint16_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsWeightedByArea<uint16_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
     else if (flags & CNORM_WEIGHT_EQUAL)
     {
-        return ComputeNormalsEqualWeight<uint16_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsEqualWeight<uint16_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
     else
     {
-        return ComputeNormalsWeightedByAngle<uint16_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsWeightedByAngle<uint16_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
 }
 
@@ -307,6 +505,8 @@ HRESULT DirectX::ComputeNormals(
     DWORD flags,
     XMFLOAT3* normals)
 {
+    stage_stats stats("ComputeNormals", nFaces, nVerts);
+
     if (!indices || !positions || !nFaces || !nVerts || !normals)
         return E_INVALIDARG;
 
@@ -316,18 +516,24 @@ HRESULT DirectX::ComputeNormals(
     if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
+#ifdef _OPENMP
+    if (nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
+        return ComputeNormalsParallel<uint32_t>(indices, nFaces, positions, nVerts, flags, normals);
+#endif
+
     bool cw = (flags & CNORM_WIND_CW) ? true : false;
+    bool accumulate = (flags & CNORM_ACCUMULATE) ? true : false;
 
     if (flags & CNORM_WEIGHT_BY_AREA)
     {
-        return ComputeNormalsWeightedByArea<uint32_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsWeightedByArea<uint32_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
     else if (flags & CNORM_WEIGHT_EQUAL)
     {
-        return ComputeNormalsEqualWeight<uint32_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsEqualWeight<uint32_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
     else
     {
-        return ComputeNormalsWeightedByAngle<uint32_t>(indices, nFaces, positions, nVerts, cw, normals);
+        return ComputeNormalsWeightedByAngle<uint32_t>(indices, nFaces, positions, nVerts, cw, accumulate, normals);
     }
 }
\ No newline at end of file
@@ -33,7 +33,7 @@ namespace
         if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
             return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
-        std::unique_ptr<uint32_t[]> tempRemap(new (std::nothrow) uint32_t[nVerts]);
+        auto tempRemap = make_scratch<uint32_t>(nVerts);
         if (!tempRemap)
             return E_OUTOFMEMORY;
 
@@ -73,44 +73,740 @@ namespace
 
         return S_OK;
     }
-}
 
-//=====================================================================================
-// Entry-points
-//=====================================================================================
 
-_Use_decl_annotations_
-HRESULT DirectX::AttributeSort(
-    size_t nFaces, uint32_t* attributes, uint32_t* faceRemap)
-{
-    if (!nFaces || !attributes || !faceRemap)
-        return E_INVALIDARG;
+    //---------------------------------------------------------------------------------
+    // Gathers faces into their new order in one pass, renumbering adjacency to match.
+    // When vertexRemap is given (initialized to UNUSED32) vertices are also assigned
+    // in order of first use and the gathered indices refer to the new vertices.
+    template<class index_t>
+    HRESULT GatherFaces(
+        _Inout_updates_all_(nFaces * 3) index_t* indices, size_t nFaces,
+        _Inout_updates_all_opt_(nFaces * 3) uint32_t* adjacency,
+        _In_reads_(nFaces) const uint32_t* faceRemap,
+        _Inout_updates_all_opt_(nVerts) uint32_t* vertexRemap, size_t nVerts,
+        _Out_opt_ uint32_t* usedVerts)
+    {
+        auto ib = make_scratch<index_t>(nFaces * 3);
+        if (!ib)
+            return E_OUTOFMEMORY;
+
+        scratch_array<uint32_t> adj;
+        scratch_array<uint32_t> faceRemapInverse;
+        if (adjacency)
+        {
+            adj = make_scratch<uint32_t>(nFaces * 3);
+            faceRemapInverse = make_scratch<uint32_t>(nFaces);
+            if (!adj || !faceRemapInverse)
+                return E_OUTOFMEMORY;
+
+            memset(faceRemapInverse.get(), 0xff, sizeof(uint32_t) * nFaces);
+
+            for (uint32_t j = 0; j < nFaces; ++j)
+            {
+                uint32_t src = faceRemap[j];
+                if (src == UNUSED32)
+                    continue;
+
+                if (src >= nFaces)
+                    return E_FAIL;
+
+                faceRemapInverse[src] = j;
+            }
+        }
+
+        uint32_t curvertex = 0;
+        for (size_t j = 0; j < nFaces; ++j)
+        {
+            uint32_t src = faceRemap[j];
+
+            if (src == UNUSED32)
+            {
+                // faces dropped by the optimizer are left unused
+                ib[j * 3] = ib[j * 3 + 1] = ib[j * 3 + 2] = index_t(-1);
+
+                if (adjacency)
+                {
+                    adj[j * 3] = adj[j * 3 + 1] = adj[j * 3 + 2] = UNUSED32;
+                }
+                continue;
+            }
 
-    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+            if (src >= nFaces)
+                return E_FAIL;
 
-    typedef std::pair<uint32_t, uint32_t> intpair_t;
+            for (size_t point = 0; point < 3; ++point)
+            {
+                index_t i = indices[src * 3 + point];
+
+                if (vertexRemap && i != index_t(-1))
+                {
+                    if (i >= nVerts)
+                        return E_UNEXPECTED;
+
+                    if (vertexRemap[i] == UNUSED32)
+                    {
+                        vertexRemap[i] = curvertex;
+                        ++curvertex;
+                    }
 
-    std::vector<intpair_t> list;
-    list.reserve(nFaces);
-    for (uint32_t j = 0; j < nFaces; ++j)
+                    i = index_t(vertexRemap[i]);
+                }
+
+                ib[j * 3 + point] = i;
+
+                if (adjacency)
+                {
+                    uint32_t neighbor = adjacency[src * 3 + point];
+                    adj[j * 3 + point] = (neighbor < nFaces) ? faceRemapInverse[neighbor] : UNUSED32;
+                }
+            }
+        }
+
+        memcpy(indices, ib.get(), sizeof(index_t) * nFaces * 3);
+
+        if (adjacency)
+        {
+            memcpy(adjacency, adj.get(), sizeof(uint32_t) * nFaces * 3);
+        }
+
+        if (usedVerts)
+        {
+            *usedVerts = curvertex;
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Moves each vertex to vertexRemap[old] by following the permutation cycles, so
+    // every vertex is written exactly once
+    void PermuteVertices(
+        _Inout_updates_bytes_all_(nVerts*stride) void* vb, size_t stride, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* vertexRemap,
+        _Out_writes_(nVerts) bool* moved, _Out_writes_bytes_(stride * 2) uint8_t* vbtemp)
     {
-        list.emplace_back(intpair_t(attributes[j], j));
+        memset(moved, 0, sizeof(bool) * nVerts);
+
+        auto ptr = reinterpret_cast<uint8_t*>(vb);
+
+        uint8_t* carry = vbtemp;
+        uint8_t* save = vbtemp + stride;
+
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            if (moved[j])
+                continue;
+
+            moved[j] = true;
+
+            uint32_t dest = vertexRemap[j];
+            if (dest == j)
+                continue;
+
+            memcpy(carry, ptr + j * stride, stride);
+
+            while (dest != j)
+            {
+                memcpy(save, ptr + dest * stride, stride);
+                memcpy(ptr + dest * stride, carry, stride);
+                std::swap(carry, save);
+
+                moved[dest] = true;
+                dest = vertexRemap[dest];
+            }
+
+            memcpy(ptr + j * stride, carry, stride);
+        }
     }
 
-    std::stable_sort(list.begin(), list.end(), [](const intpair_t& a, const intpair_t& b) -> bool
+
+    //---------------------------------------------------------------------------------
+    // Optimizes the faces of each spatial chunk on its own, so the face optimizers only
+    // ever see one chunk; faceRemap is written in chunk order
+    template<class index_t>
+    HRESULT OptimizeChunks(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_opt_(nFaces) const uint32_t* attributes,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        size_t maxChunkFaces, DWORD flags, uint32_t vertexCache, uint32_t restart,
+        _Out_writes_(nFaces) uint32_t* faceRemap)
     {
-        return (a.first < b.first);
-    });
+        std::vector<std::pair<size_t, size_t>> chunks;
+        HRESULT hr = PartitionMesh(indices, nFaces, positions, nVerts, attributes, maxChunkFaces, faceRemap, chunks);
+        if (FAILED(hr))
+            return hr;
+
+        size_t maxFaces = 0;
+        for (auto it = chunks.cbegin(); it != chunks.cend(); ++it)
+        {
+            maxFaces = std::max(maxFaces, it->second);
+        }
 
-    auto it = list.begin();
-    for (uint32_t j = 0; j < nFaces; ++j, ++it)
+        bool lru = (flags & (OPTMESH_LRU | OPTMESH_LRU_FAST)) != 0;
+
+        auto chunkIndices = make_scratch<index_t>(maxFaces * 3);
+        auto chunkFaces = make_scratch<uint32_t>(maxFaces * 2);
+        if (!chunkIndices || !chunkFaces)
+            return E_OUTOFMEMORY;
+
+        uint32_t* chunkRemap = chunkFaces.get();
+        uint32_t* chunkOrder = chunkFaces.get() + maxFaces;
+
+        scratch_array<uint32_t> chunkAdjacency;
+        scratch_array<XMFLOAT3> chunkPositions;
+        if (!lru)
+        {
+            chunkAdjacency = make_scratch<uint32_t>(maxFaces * 3);
+            chunkPositions = make_scratch<XMFLOAT3>(std::min(maxFaces * 3, nVerts));
+            if (!chunkAdjacency || !chunkPositions)
+                return E_OUTOFMEMORY;
+        }
+
+        uint32_t lruCacheSize = (vertexCache) ? vertexCache : uint32_t(OPTFACES_LRU_DEFAULT);
+
+        std::vector<uint32_t> chunkVerts;
+
+        for (auto it = chunks.cbegin(); it != chunks.cend(); ++it)
+        {
+            hr = ExtractChunk(indices, nFaces, nVerts, faceRemap, it->first, it->second, chunkIndices.get(), chunkVerts);
+            if (FAILED(hr))
+                return hr;
+
+            if (flags & OPTMESH_LRU_FAST)
+            {
+                hr = OptimizeFacesLRUFast(chunkIndices.get(), it->second, chunkRemap, lruCacheSize);
+            }
+            else if (flags & OPTMESH_LRU)
+            {
+                hr = OptimizeFacesLRU(chunkIndices.get(), it->second, chunkRemap, lruCacheSize);
+            }
+            else
+            {
+                // strips only follow edges within the chunk
+                for (size_t j = 0; j < chunkVerts.size(); ++j)
+                {
+                    chunkPositions[j] = positions[chunkVerts[j]];
+                }
+
+                hr = GenerateAdjacencyAndPointReps(chunkIndices.get(), it->second, chunkPositions.get(), chunkVerts.size(), 0.f,
+                                                   nullptr, chunkAdjacency.get());
+                if (FAILED(hr))
+                    return hr;
+
+                hr = OptimizeFaces(chunkIndices.get(), it->second, chunkAdjacency.get(), chunkRemap, vertexCache, restart);
+            }
+            if (FAILED(hr))
+                return hr;
+
+            // chunk faces are numbered from the start of the chunk, and dropped faces stay dropped
+            memcpy(chunkOrder, &faceRemap[it->first], sizeof(uint32_t) * it->second);
+
+            for (size_t j = 0; j < it->second; ++j)
+            {
+                uint32_t src = chunkRemap[j];
+                if (src != UNUSED32 && src >= it->second)
+                    return E_UNEXPECTED;
+
+                faceRemap[it->first + j] = (src == UNUSED32) ? UNUSED32 : chunkOrder[src];
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // maxChunkFaces of 0 optimizes the faces of the whole mesh at once
+    template<class index_t>
+    HRESULT OptimizeMeshImpl(
+        _Inout_updates_all_(nFaces * 3) index_t* indices, size_t nFaces,
+        _Inout_updates_all_opt_(nFaces * 3) uint32_t* adjacency,
+        _Inout_updates_all_opt_(nFaces) uint32_t* attributes, size_t nVerts,
+        _In_reads_opt_(nStreams) const MeshVertexStream* streams, size_t nStreams,
+        DWORD flags, uint32_t vertexCache, uint32_t restart,
+        _In_reads_opt_(nVerts) const XMFLOAT3* positions, size_t maxChunkFaces)
     {
-        attributes[j] = it->first;
-        faceRemap[j] = it->second;
+        if (!indices || !nFaces || !nVerts)
+            return E_INVALIDARG;
+
+        if (!streams && nStreams > 0)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        bool lru = (flags & (OPTMESH_LRU | OPTMESH_LRU_FAST)) != 0;
+        if (!lru && !adjacency && !maxChunkFaces)
+            return E_INVALIDARG;
+
+        if (((flags & OPTMESH_OVERDRAW) || maxChunkFaces) && !positions)
+            return E_INVALIDARG;
+
+        size_t maxStride = 0;
+        for (size_t j = 0; j < nStreams; ++j)
+        {
+            if (!streams[j].vb || !streams[j].stride)
+                return E_INVALIDARG;
+
+            if (streams[j].stride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+                return E_INVALIDARG;
+
+            maxStride = std::max(maxStride, streams[j].stride);
+        }
+
+        auto faceRemap = make_scratch<uint32_t>(nFaces);
+        if (!faceRemap)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = S_OK;
+
+        // Sort faces by attribute, moving them only when the order changes
+        if (attributes)
+        {
+            hr = AttributeSort(nFaces, attributes, faceRemap.get());
+            if (FAILED(hr))
+                return hr;
+
+            bool sorted = true;
+            for (uint32_t j = 0; j < nFaces; ++j)
+            {
+                if (faceRemap[j] != j)
+                {
+                    sorted = false;
+                    break;
+                }
+            }
+
+            if (!sorted)
+            {
+                hr = GatherFaces<index_t>(indices, nFaces, adjacency, faceRemap.get(), nullptr, nVerts, nullptr);
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
+
+        // Optimize faces for the pre-transform vertex cache
+        if (maxChunkFaces)
+        {
+            if (!lru)
+            {
+                if (!vertexCache)
+                {
+                    vertexCache = OPTFACES_V_DEFAULT;
+                }
+
+                if (!restart)
+                {
+                    restart = std::min<uint32_t>(OPTFACES_R_DEFAULT, vertexCache);
+                }
+            }
+
+            hr = OptimizeChunks<index_t>(indices, nFaces, attributes, positions, nVerts, maxChunkFaces, flags, vertexCache, restart,
+                                         faceRemap.get());
+        }
+        else if (flags & OPTMESH_LRU_FAST)
+        {
+            uint32_t lruCacheSize = (vertexCache) ? vertexCache : uint32_t(OPTFACES_LRU_DEFAULT);
+
+            hr = (attributes)
+                ? OptimizeFacesLRUFastEx(indices, nFaces, attributes, faceRemap.get(), lruCacheSize)
+                : OptimizeFacesLRUFast(indices, nFaces, faceRemap.get(), lruCacheSize);
+        }
+        else if (flags & OPTMESH_LRU)
+        {
+            uint32_t lruCacheSize = (vertexCache) ? vertexCache : uint32_t(OPTFACES_LRU_DEFAULT);
+
+            hr = (attributes)
+                ? OptimizeFacesLRUEx(indices, nFaces, attributes, faceRemap.get(), lruCacheSize)
+                : OptimizeFacesLRU(indices, nFaces, faceRemap.get(), lruCacheSize);
+        }
+        else
+        {
+            if (!vertexCache)
+            {
+                vertexCache = OPTFACES_V_DEFAULT;
+            }
+
+            if (!restart)
+            {
+                restart = std::min<uint32_t>(OPTFACES_R_DEFAULT, vertexCache);
+            }
+
+            hr = (attributes)
+                ? OptimizeFacesEx(indices, nFaces, adjacency, attributes, faceRemap.get(), vertexCache, restart)
+                : OptimizeFaces(indices, nFaces, adjacency, faceRemap.get(), vertexCache, restart);
+        }
+        if (FAILED(hr))
+            return hr;
+
+        // Reorder clusters of the optimized faces to reduce overdraw
+        if (flags & OPTMESH_OVERDRAW)
+        {
+            uint32_t cacheSize = (vertexCache) ? vertexCache : uint32_t(OPTFACES_LRU_DEFAULT);
+
+            hr = OptimizeFacesOverdraw(indices, nFaces, positions, nVerts, attributes, faceRemap.get(), cacheSize,
+                                       (flags & OPTMESH_WIND_CW) ? OPTOVERDRAW_WIND_CW : OPTOVERDRAW_DEFAULT);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        // Reorder faces, optimize vertices for the post-transform vertex cache, and finalize the IB in one pass
+        auto vertexRemap = make_scratch<uint32_t>(nVerts);
+        if (!vertexRemap)
+            return E_OUTOFMEMORY;
+
+        memset(vertexRemap.get(), 0xff, sizeof(uint32_t) * nVerts);
+
+        uint32_t curvertex = 0;
+        hr = GatherFaces<index_t>(indices, nFaces, adjacency, faceRemap.get(), vertexRemap.get(), nVerts, &curvertex);
+        if (FAILED(hr))
+            return hr;
+
+        // unused vertices keep their relative order at the end
+        for (uint32_t j = 0; j < nVerts; ++j)
+        {
+            if (vertexRemap[j] == UNUSED32)
+            {
+                vertexRemap[j] = curvertex;
+                ++curvertex;
+            }
+        }
+
+        assert(curvertex == nVerts);
+
+        // Finalize each vertex buffer
+        if (nStreams > 0)
+        {
+            auto temp = make_scratch<uint8_t>(sizeof(bool) * nVerts + maxStride * 2);
+            if (!temp)
+                return E_OUTOFMEMORY;
+
+            auto moved = reinterpret_cast<bool*>(temp.get());
+            auto vbtemp = temp.get() + sizeof(bool) * nVerts;
+
+            for (size_t j = 0; j < nStreams; ++j)
+            {
+                PermuteVertices(streams[j].vb, streams[j].stride, nVerts, vertexRemap.get(), moved, vbtemp);
+            }
+        }
+
+        return S_OK;
     }
 
-    return S_OK;
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT GeneratePositionStreamImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* pointRep,
+        _Out_writes_(nFaces * 3) index_t* depthIndices, size_t& nDepthFaces,
+        _Out_writes_(nVerts) XMFLOAT3* depthPositions, size_t& nDepthVerts,
+        DWORD flags)
+    {
+        nDepthFaces = nDepthVerts = 0;
+
+        if (!indices || !nFaces || !positions || !nVerts || !pointRep || !depthIndices || !depthPositions)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        // Weld each corner to its point rep, dropping faces that are unused or collapse once welded
+        size_t nUsed = 0;
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            index_t welded[3];
+            bool keep = true;
+            for (size_t point = 0; point < 3; ++point)
+            {
+                index_t i = indices[face * 3 + point];
+                if (i == index_t(-1))
+                {
+                    keep = false;
+                    break;
+                }
+
+                if (i >= nVerts)
+                    return E_UNEXPECTED;
+
+                uint32_t rep = pointRep[i];
+                if (rep == UNUSED32)
+                {
+                    rep = uint32_t(i);
+                }
+                else if (rep >= nVerts)
+                    return E_UNEXPECTED;
+
+                welded[point] = index_t(rep);
+            }
+
+            if (!keep || welded[0] == welded[1] || welded[1] == welded[2] || welded[0] == welded[2])
+                continue;
+
+            memcpy(&depthIndices[nUsed * 3], welded, sizeof(welded));
+            ++nUsed;
+        }
+
+        if (!nUsed)
+            return S_OK;
+
+        // Vertices that are not point reps go unused, so OptimizeMesh moves them past the end
+        if (depthPositions != positions)
+        {
+            memcpy(depthPositions, positions, sizeof(XMFLOAT3) * nVerts);
+        }
+
+        scratch_array<uint32_t> adjacency;
+        if (!(flags & (OPTMESH_LRU | OPTMESH_LRU_FAST)))
+        {
+            adjacency = make_scratch<uint32_t>(nUsed * 3);
+            if (!adjacency)
+                return E_OUTOFMEMORY;
+
+            HRESULT hr = ConvertPointRepsToAdjacency(depthIndices, nUsed, depthPositions, nVerts, nullptr, adjacency.get());
+            if (FAILED(hr))
+                return hr;
+        }
+
+        MeshVertexStream stream = { depthPositions, sizeof(XMFLOAT3) };
+
+        HRESULT hr = OptimizeMesh(depthIndices, nUsed, adjacency.get(), nullptr, nVerts, &stream, 1, flags, 0, 0, depthPositions);
+        if (FAILED(hr))
+            return hr;
+
+        // Used vertices are now first, in order of first use
+        size_t nUsedVerts = 0;
+        for (size_t j = 0; j < nUsed * 3; ++j)
+        {
+            nUsedVerts = std::max<size_t>(nUsedVerts, size_t(depthIndices[j]) + 1);
+        }
+
+        nDepthFaces = nUsed;
+        nDepthVerts = nUsedVerts;
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Attribute sort
+    //---------------------------------------------------------------------------------
+
+    // Larger meshes count and scatter each block of faces on its own thread
+    const size_t c_MinParallelSortCount = 65536;
+
+    // Ids up to this are sorted with a single counting pass, otherwise by 8-bit digits
+    const uint32_t c_MaxCountingKeys = 65536;
+    const uint32_t c_RadixBits = 8;
+    const uint32_t c_RadixKeys = 1u << c_RadixBits;
+
+    inline uint32_t SortBlocks(size_t nFaces)
+    {
+#ifdef _OPENMP
+        if (nFaces >= c_MinParallelSortCount)
+            return uint32_t(omp_get_max_threads());
+#else
+        UNREFERENCED_PARAMETER(nFaces);
+#endif
+        return 1;
+    }
+
+    inline uint32_t CountingKeys(size_t nFaces)
+    {
+        return uint32_t(std::max<size_t>(c_RadixKeys, std::min<size_t>(nFaces, c_MaxCountingKeys)));
+    }
+
+    HRESULT AttributeSortImpl(
+        size_t nFaces,
+        _Inout_updates_all_(nFaces) uint32_t* attributes,
+        _Out_writes_(nFaces) uint32_t* faceRemap,
+        _Inout_opt_ std::vector<std::pair<size_t, size_t>>* subsets)
+    {
+        if (!nFaces || !attributes || !faceRemap)
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        uint32_t maxAttr = 0;
+        for (size_t j = 0; j < nFaces; ++j)
+        {
+            maxAttr = std::max(maxAttr, attributes[j]);
+        }
+
+        uint32_t nBlocks = SortBlocks(nFaces);
+        size_t blockSize = (nFaces + nBlocks - 1) / nBlocks;
+
+        if (maxAttr < CountingKeys(nFaces))
+        {
+            // Attribute ids are the partition keys, so the groups come straight from the offsets
+            uint32_t nParts = maxAttr + 1;
+
+            auto counts = make_scratch<size_t>(size_t(nBlocks) * nParts + nParts + 1);
+            if (!counts)
+                return E_OUTOFMEMORY;
+
+            size_t* partOffsets = counts.get() + size_t(nBlocks) * nParts;
+
+            PartitionItems(attributes, nFaces, nParts, nBlocks, counts.get(), faceRemap, partOffsets);
+
+            if (subsets)
+                subsets->clear();
+
+            for (uint32_t part = 0; part < nParts; ++part)
+            {
+                size_t offset = partOffsets[part];
+                size_t count = partOffsets[part + 1] - offset;
+                if (!count)
+                    continue;
+
+                std::fill(attributes + offset, attributes + offset + count, part);
+
+                if (subsets)
+                    subsets->emplace_back(std::pair<size_t, size_t>(offset, count));
+            }
+
+            return S_OK;
+        }
+
+        // Least significant digit first, each pass a stable counting sort of the previous order
+        auto temp = make_scratch<uint32_t>(nFaces * 2);
+        auto counts = make_scratch<size_t>(size_t(nBlocks) * c_RadixKeys + c_RadixKeys + 1);
+        if (!temp || !counts)
+            return E_OUTOFMEMORY;
+
+        uint32_t* digits = temp.get();
+        uint32_t* order = temp.get() + nFaces;
+        size_t* partOffsets = counts.get() + size_t(nBlocks) * c_RadixKeys;
+
+        uint32_t nPasses = 0;
+        for (uint32_t bits = maxAttr; bits; bits >>= c_RadixBits)
+        {
+            ++nPasses;
+        }
+
+        // Alternate between the two orders so the last pass lands in faceRemap
+        uint32_t* src = nullptr;
+        uint32_t* dst = (nPasses & 1) ? faceRemap : order;
+
+        for (uint32_t pass = 0; pass < nPasses; ++pass)
+        {
+            uint32_t shift = pass * c_RadixBits;
+
+            #pragma omp parallel for
+            for (int block = 0; block < int(nBlocks); ++block)
+            {
+                size_t end = std::min<size_t>(nFaces, size_t(block + 1) * blockSize);
+                for (size_t j = size_t(block) * blockSize; j < end; ++j)
+                {
+                    uint32_t face = (src) ? src[j] : uint32_t(j);
+                    digits[j] = (attributes[face] >> shift) & (c_RadixKeys - 1);
+                }
+            }
+
+            PartitionItems(digits, nFaces, c_RadixKeys, nBlocks, counts.get(), dst, partOffsets);
+
+            if (src)
+            {
+                #pragma omp parallel for
+                for (int block = 0; block < int(nBlocks); ++block)
+                {
+                    size_t end = std::min<size_t>(nFaces, size_t(block + 1) * blockSize);
+                    for (size_t j = size_t(block) * blockSize; j < end; ++j)
+                    {
+                        dst[j] = src[dst[j]];
+                    }
+                }
+            }
+
+            src = dst;
+            dst = (dst == order) ? faceRemap : order;
+        }
+
+        assert(src == faceRemap);
+
+        memcpy(digits, attributes, sizeof(uint32_t) * nFaces);
+
+        for (size_t j = 0; j < nFaces; ++j)
+        {
+            attributes[j] = digits[faceRemap[j]];
+        }
+
+        if (subsets)
+            *subsets = ComputeSubsets(attributes, nFaces);
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeOptimizeVertices(size_t nVerts)
+{
+    return ScratchBytes<uint32_t>(nVerts);
+}
+
+size_t DirectX::ScratchSizeAttributeSort(size_t nFaces)
+{
+    size_t nBlocks = SortBlocks(nFaces);
+    size_t nKeys = CountingKeys(nFaces);
+
+    return std::max(ScratchBytes<size_t>(nBlocks * nKeys + nKeys + 1),
+                    ScratchBytes<uint32_t>(nFaces * 2) + ScratchBytes<size_t>(nBlocks * c_RadixKeys + c_RadixKeys + 1));
+}
+
+size_t DirectX::ScratchSizeOptimizeMesh(size_t nFaces, size_t nVerts, size_t vertexCache)
+{
+    size_t gather = ScratchBytes<uint32_t>(nFaces * 3) * 2 + ScratchBytes<uint32_t>(nFaces);
+
+    size_t optimize = std::max(ScratchSizeOptimizeFaces(nFaces, vertexCache), ScratchSizeOptimizeFacesLRU(nFaces));
+    optimize = std::max(optimize, std::max(ScratchSizeAttributeSort(nFaces), ScratchSizeOptimizeFacesOverdraw(nFaces, nVerts)));
+
+    size_t finalize = ScratchBytes((sizeof(bool) * nVerts) + D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES * 2);
+
+    return ScratchBytes<uint32_t>(nFaces)
+        + std::max(optimize, ScratchBytes<uint32_t>(nVerts) + std::max(gather, finalize));
+}
+
+size_t DirectX::ScratchSizePositionStream(size_t nFaces, size_t nVerts, size_t vertexCache)
+{
+    size_t adjacency = ScratchBytes<uint32_t>(nVerts) + ScratchSizeAdjacency(nFaces, nVerts);
+
+    return ScratchBytes<uint32_t>(nFaces * 3) + std::max(adjacency, ScratchSizeOptimizeMesh(nFaces, nVerts, vertexCache));
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::AttributeSort(
+    size_t nFaces, uint32_t* attributes, uint32_t* faceRemap)
+{
+    stage_stats stats("AttributeSort", nFaces, 0);
+
+    return AttributeSortImpl(nFaces, attributes, faceRemap, nullptr);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::AttributeSort(
+    size_t nFaces, uint32_t* attributes, uint32_t* faceRemap,
+    std::vector<std::pair<size_t, size_t>>& subsets)
+{
+    stage_stats stats("AttributeSort", nFaces, 0);
+
+    return AttributeSortImpl(nFaces, attributes, faceRemap, &subsets);
 }
 
 
@@ -120,6 +816,8 @@ HRESULT DirectX::OptimizeVertices(
     const uint16_t* indices, size_t nFaces,
     size_t nVerts, uint32_t* vertexRemap)
 {
+    stage_stats stats("OptimizeVertices", nFaces, nVerts);
+
     return OptimizeVerticesImpl<uint16_t>(indices, nFaces, nVerts, vertexRemap);
 }
 
@@ -128,5 +826,101 @@ HRESULT DirectX::OptimizeVertices(
     const uint32_t* indices, size_t nFaces,
     size_t nVerts, uint32_t* vertexRemap)
 {
+    stage_stats stats("OptimizeVertices", nFaces, nVerts);
+
     return OptimizeVerticesImpl<uint32_t>(indices, nFaces, nVerts, vertexRemap);
 }
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeMesh(
+    uint16_t* indices, size_t nFaces,
+    uint32_t* adjacency, uint32_t* attributes, size_t nVerts,
+    const MeshVertexStream* streams, size_t nStreams,
+    DWORD flags, uint32_t vertexCache, uint32_t restart,
+    const XMFLOAT3* positions)
+{
+    stage_stats stats("OptimizeMesh", nFaces, nVerts);
+
+    return OptimizeMeshImpl<uint16_t>(indices, nFaces, adjacency, attributes, nVerts, streams, nStreams, flags, vertexCache, restart, positions, 0);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeMesh(
+    uint32_t* indices, size_t nFaces,
+    uint32_t* adjacency, uint32_t* attributes, size_t nVerts,
+    const MeshVertexStream* streams, size_t nStreams,
+    DWORD flags, uint32_t vertexCache, uint32_t restart,
+    const XMFLOAT3* positions)
+{
+    stage_stats stats("OptimizeMesh", nFaces, nVerts);
+
+    return OptimizeMeshImpl<uint32_t>(indices, nFaces, adjacency, attributes, nVerts, streams, nStreams, flags, vertexCache, restart, positions, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeMeshChunked(
+    uint16_t* indices, size_t nFaces,
+    uint32_t* adjacency, uint32_t* attributes,
+    const XMFLOAT3* positions, size_t nVerts, size_t maxChunkFaces,
+    const MeshVertexStream* streams, size_t nStreams,
+    DWORD flags, uint32_t vertexCache, uint32_t restart)
+{
+    stage_stats stats("OptimizeMeshChunked", nFaces, nVerts);
+
+    if (!maxChunkFaces)
+        return E_INVALIDARG;
+
+    return OptimizeMeshImpl<uint16_t>(indices, nFaces, adjacency, attributes, nVerts, streams, nStreams, flags, vertexCache, restart, positions, maxChunkFaces);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeMeshChunked(
+    uint32_t* indices, size_t nFaces,
+    uint32_t* adjacency, uint32_t* attributes,
+    const XMFLOAT3* positions, size_t nVerts, size_t maxChunkFaces,
+    const MeshVertexStream* streams, size_t nStreams,
+    DWORD flags, uint32_t vertexCache, uint32_t restart)
+{
+    stage_stats stats("OptimizeMeshChunked", nFaces, nVerts);
+
+    if (!maxChunkFaces)
+        return E_INVALIDARG;
+
+    return OptimizeMeshImpl<uint32_t>(indices, nFaces, adjacency, attributes, nVerts, streams, nStreams, flags, vertexCache, restart, positions, maxChunkFaces);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GeneratePositionStream(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* pointRep,
+    uint16_t* depthIndices, size_t& nDepthFaces,
+    XMFLOAT3* depthPositions, size_t& nDepthVerts,
+    DWORD flags)
+{
+    stage_stats stats("GeneratePositionStream", nFaces, nVerts);
+
+    return GeneratePositionStreamImpl<uint16_t>(indices, nFaces, positions, nVerts, pointRep,
+                                                depthIndices, nDepthFaces, depthPositions, nDepthVerts, flags);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::GeneratePositionStream(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* pointRep,
+    uint32_t* depthIndices, size_t& nDepthFaces,
+    XMFLOAT3* depthPositions, size_t& nDepthVerts,
+    DWORD flags)
+{
+    stage_stats stats("GeneratePositionStream", nFaces, nVerts);
+
+    return GeneratePositionStreamImpl<uint32_t>(indices, nFaces, positions, nVerts, pointRep,
+                                                depthIndices, nDepthFaces, depthPositions, nDepthVerts, flags);
+}
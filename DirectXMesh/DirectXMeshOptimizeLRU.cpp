@@ -84,6 +84,19 @@ namespace
     float s_vertexCacheScores[kMaxVertexCacheSize + 1][kMaxVertexCacheSize];
     float s_vertexValenceScores[kMaxPrecomputedVertexValenceScores];
 
+    // Fixed-point (4.12) copies of the score tables for the fast variant
+    enum { kFixedScoreShift = 12 };
+    enum { kMaxFixedVertexValenceScores = 256 };
+
+    uint16_t s_fixedCacheScores[kMaxVertexCacheSize + 1][kMaxVertexCacheSize];
+    uint16_t s_fixedValenceScores[kMaxFixedVertexValenceScores];
+
+    inline uint16_t ToFixedScore(float score)
+    {
+        assert(score >= 0.f && score < float(UINT16_MAX >> kFixedScoreShift));
+        return static_cast<uint16_t>(score * float(1 << kFixedScoreShift) + 0.5f);
+    }
+
     static INIT_ONCE s_initOnce = INIT_ONCE_STATIC_INIT;
 
     BOOL WINAPI ComputeVertexScores(PINIT_ONCE, PVOID, PVOID*)
@@ -101,6 +114,22 @@ namespace
             s_vertexValenceScores[valence] = ComputeVertexValenceScore(valence);
         }
 
+        for (uint32_t cacheSize = 0; cacheSize <= kMaxVertexCacheSize; ++cacheSize)
+        {
+            for (uint32_t cachePos = 0; cachePos < cacheSize; ++cachePos)
+            {
+                s_fixedCacheScores[cacheSize][cachePos] = ToFixedScore(s_vertexCacheScores[cacheSize][cachePos]);
+            }
+        }
+
+        // A vertex with no active faces is never scored
+        s_fixedValenceScores[0] = 0;
+
+        for (uint32_t valence = 1; valence < kMaxFixedVertexValenceScores; ++valence)
+        {
+            s_fixedValenceScores[valence] = ToFixedScore(ComputeVertexValenceScore(valence));
+        }
+
         return TRUE;
     }
 
@@ -205,20 +234,20 @@ namespace
         _In_reads_(indexCount) const IndexType* indexList, uint32_t indexCount,
         _Out_writes_(indexCount / 3) uint32_t* faceRemap, uint32_t lruCacheSize, uint32_t offset)
     {
-        std::unique_ptr<OptimizeVertexData<IndexType>[]> vertexDataList(new (std::nothrow) OptimizeVertexData<IndexType>[indexCount]);
+        auto vertexDataList = make_scratch<OptimizeVertexData<IndexType>>(indexCount);
         if (!vertexDataList)
             return E_OUTOFMEMORY;
 
-        std::unique_ptr<uint32_t[]> vertexRemap(new (std::nothrow) uint32_t[indexCount]);
-        std::unique_ptr<uint32_t[]> activeFaceList(new (std::nothrow) uint32_t[indexCount]);
+        auto vertexRemap = make_scratch<uint32_t>(indexCount);
+        auto activeFaceList = make_scratch<uint32_t>(indexCount);
         if (!vertexRemap || !activeFaceList)
             return E_OUTOFMEMORY;
 
         const uint32_t faceCount = indexCount / 3;
 
-        std::unique_ptr<uint8_t[]> processedFaceList(new (std::nothrow) uint8_t[faceCount]);
-        std::unique_ptr<uint32_t[]> faceSorted(new (std::nothrow) uint32_t[faceCount]);
-        std::unique_ptr<uint32_t[]> faceReverseLookup(new (std::nothrow) uint32_t[faceCount]);
+        auto processedFaceList = make_scratch<uint8_t>(faceCount);
+        auto faceSorted = make_scratch<uint32_t>(faceCount);
+        auto faceReverseLookup = make_scratch<uint32_t>(faceCount);
         if (!processedFaceList || !faceSorted || !faceReverseLookup)
             return E_OUTOFMEMORY;
 
@@ -230,7 +259,7 @@ namespace
         {
             typedef IndexSortCompareIndexed<uint32_t, IndexType> indexSorter;
 
-            std::unique_ptr<uint32_t[]> indexSorted(new (std::nothrow) uint32_t[indexCount]);
+            auto indexSorted = make_scratch<uint32_t>(indexCount);
             if (!indexSorted)
                 return E_OUTOFMEMORY;
 
@@ -505,8 +534,436 @@ namespace
 
         return S_OK;
     }
+
+
+    //---------------------------------------------------------------------------------
+    // Lower-overhead variant of the above using the fixed-point score tables. Restart
+    // faces come from buckets keyed by their total valence instead of a sorted list
+    // that is bubbled on every change, so the running time is close to linear.
+    //---------------------------------------------------------------------------------
+    enum { kMaxValenceBuckets = 256 };
+
+    inline uint32_t FindFixedVertexScore(uint32_t numActiveFaces, uint32_t cachePosition, uint32_t vertexCacheSize)
+    {
+        if (!numActiveFaces)
+            return 0;
+
+        uint32_t score = s_fixedValenceScores[std::min<uint32_t>(numActiveFaces, kMaxFixedVertexValenceScores - 1)];
+
+        if (cachePosition < vertexCacheSize)
+        {
+            score += s_fixedCacheScores[vertexCacheSize][cachePosition];
+        }
+
+        return score;
+    }
+
+    class valence_buckets
+    {
+    public:
+        valence_buckets(_Inout_updates_(faceCount) uint32_t* next, _Inout_updates_(faceCount) uint32_t* prev, _Inout_updates_(faceCount) uint32_t* valence) :
+            mNext(next), mPrev(prev), mValence(valence), mMinBucket(kMaxValenceBuckets)
+        {
+            memset(mHead, 0xff, sizeof(mHead));
+        }
+
+        void insert(uint32_t face, uint32_t valence)
+        {
+            mValence[face] = valence;
+
+            uint32_t bucket = std::min<uint32_t>(valence, kMaxValenceBuckets - 1);
+            mPrev[face] = UNUSED32;
+            mNext[face] = mHead[bucket];
+            if (mHead[bucket] != UNUSED32)
+                mPrev[mHead[bucket]] = face;
+            mHead[bucket] = face;
+
+            mMinBucket = std::min<uint32_t>(mMinBucket, bucket);
+        }
+
+        void remove(uint32_t face)
+        {
+            uint32_t bucket = std::min<uint32_t>(mValence[face], kMaxValenceBuckets - 1);
+            if (mPrev[face] != UNUSED32)
+                mNext[mPrev[face]] = mNext[face];
+            else
+                mHead[bucket] = mNext[face];
+
+            if (mNext[face] != UNUSED32)
+                mPrev[mNext[face]] = mPrev[face];
+        }
+
+        void decrement(uint32_t face)
+        {
+            assert(mValence[face] > 0);
+
+            uint32_t valence = mValence[face] - 1;
+            if (valence >= kMaxValenceBuckets - 1)
+            {
+                // still in the last bucket
+                mValence[face] = valence;
+            }
+            else
+            {
+                remove(face);
+                insert(face, valence);
+            }
+        }
+
+        // Returns the face with the lowest total valence
+        uint32_t top()
+        {
+            while (mMinBucket < kMaxValenceBuckets && mHead[mMinBucket] == UNUSED32)
+            {
+                ++mMinBucket;
+            }
+
+            return (mMinBucket < kMaxValenceBuckets) ? mHead[mMinBucket] : UNUSED32;
+        }
+
+    private:
+        uint32_t*   mNext;
+        uint32_t*   mPrev;
+        uint32_t*   mValence;
+        uint32_t    mMinBucket;
+        uint32_t    mHead[kMaxValenceBuckets];
+    };
+
+    template <typename IndexType>
+    HRESULT OptimizeFacesFastImpl(
+        _In_reads_(indexCount) const IndexType* indexList, uint32_t indexCount,
+        _Out_writes_(indexCount / 3) uint32_t* faceRemap, uint32_t lruCacheSize, uint32_t offset)
+    {
+        const uint32_t faceCount = indexCount / 3;
+
+        // faces using the strip-cut index are skipped entirely
+        uint32_t maxIndex = 0;
+        uint32_t validFaces = 0;
+        for (uint32_t face = 0; face < faceCount; ++face)
+        {
+            IndexType i0 = indexList[face * 3];
+            IndexType i1 = indexList[face * 3 + 1];
+            IndexType i2 = indexList[face * 3 + 2];
+
+            if (i0 == IndexType(-1)
+                || i1 == IndexType(-1)
+                || i2 == IndexType(-1))
+                continue;
+
+            maxIndex = std::max<uint32_t>(maxIndex, std::max<uint32_t>(i0, std::max<uint32_t>(i1, i2)));
+            ++validFaces;
+        }
+
+        if (!validFaces)
+        {
+            for (uint32_t face = 0; face < faceCount; ++face)
+            {
+                faceRemap[face] = UNUSED32;
+            }
+
+            return S_OK;
+        }
+
+        // vertex ids are the indices themselves unless they are very sparse
+        auto corners = make_scratch<uint32_t>(indexCount);
+        if (!corners)
+            return E_OUTOFMEMORY;
+
+        uint32_t vertexCount = 0;
+        if (uint64_t(maxIndex) < uint64_t(indexCount) * 2)
+        {
+            for (uint32_t i = 0; i < indexCount; ++i)
+            {
+                corners[i] = (indexList[i] == IndexType(-1)) ? UNUSED32 : uint32_t(indexList[i]);
+            }
+
+            vertexCount = maxIndex + 1;
+        }
+        else
+        {
+            auto unique = make_scratch<uint32_t>(validFaces * 3);
+            if (!unique)
+                return E_OUTOFMEMORY;
+
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < indexCount; ++i)
+            {
+                if (indexList[i] != IndexType(-1))
+                    unique[count++] = uint32_t(indexList[i]);
+            }
+
+            std::sort(unique.get(), unique.get() + count);
+            vertexCount = uint32_t(std::unique(unique.get(), unique.get() + count) - unique.get());
+
+            for (uint32_t i = 0; i < indexCount; ++i)
+            {
+                corners[i] = (indexList[i] == IndexType(-1))
+                    ? UNUSED32
+                    : uint32_t(std::lower_bound(unique.get(), unique.get() + vertexCount, uint32_t(indexList[i])) - unique.get());
+            }
+        }
+
+        for (uint32_t face = 0; face < faceCount; ++face)
+        {
+            if (corners[face * 3] == UNUSED32
+                || corners[face * 3 + 1] == UNUSED32
+                || corners[face * 3 + 2] == UNUSED32)
+            {
+                corners[face * 3] = corners[face * 3 + 1] = corners[face * 3 + 2] = UNUSED32;
+            }
+        }
+
+        auto vertexData = make_scratch<uint32_t>(size_t(vertexCount) * 3 + 1);
+        auto vertexScores = make_scratch<uint16_t>(vertexCount);
+        auto activeFaceList = make_scratch<uint32_t>(validFaces * 3);
+        auto faceData = make_scratch<uint32_t>(size_t(faceCount) * 3);
+        if (!vertexData || !vertexScores || !activeFaceList || !faceData)
+            return E_OUTOFMEMORY;
+
+        uint32_t* activeFaceStart = vertexData.get();
+        uint32_t* activeFaceCount = activeFaceStart + vertexCount + 1;
+        uint32_t* cacheStamp = activeFaceCount + vertexCount;
+
+        memset(activeFaceCount, 0, sizeof(uint32_t) * vertexCount);
+        memset(cacheStamp, 0xff, sizeof(uint32_t) * vertexCount);
+
+        // build the face list per vertex
+        for (uint32_t i = 0; i < indexCount; ++i)
+        {
+            if (corners[i] != UNUSED32)
+                ++activeFaceCount[corners[i]];
+        }
+
+        activeFaceStart[0] = 0;
+        for (uint32_t vert = 0; vert < vertexCount; ++vert)
+        {
+            activeFaceStart[vert + 1] = activeFaceStart[vert] + activeFaceCount[vert];
+            vertexScores[vert] = static_cast<uint16_t>(FindFixedVertexScore(activeFaceCount[vert], UNUSED32, lruCacheSize));
+            activeFaceCount[vert] = 0;
+        }
+
+        for (uint32_t i = 0; i < indexCount; ++i)
+        {
+            uint32_t vert = corners[i];
+            if (vert != UNUSED32)
+            {
+                activeFaceList[activeFaceStart[vert] + activeFaceCount[vert]] = i / 3;
+                ++activeFaceCount[vert];
+            }
+        }
+
+        // faces with the lowest total valence are the best starting points
+        valence_buckets buckets(faceData.get(), faceData.get() + faceCount, faceData.get() + faceCount * 2);
+
+        for (uint32_t face = faceCount; face-- > 0; )
+        {
+            if (corners[face * 3] == UNUSED32)
+                continue;
+
+            buckets.insert(face, activeFaceCount[corners[face * 3]]
+                + activeFaceCount[corners[face * 3 + 1]]
+                + activeFaceCount[corners[face * 3 + 2]]);
+        }
+
+        uint32_t vertexCacheBuffer[(kMaxVertexCacheSize + 3) * 2];
+        uint32_t *cache0 = vertexCacheBuffer;
+        uint32_t *cache1 = vertexCacheBuffer + (kMaxVertexCacheSize + 3);
+        uint32_t entriesInCache0 = 0;
+
+        uint32_t bestFace = UNUSED32;
+
+        for (uint32_t curFace = 0; curFace < validFaces; ++curFace)
+        {
+            if (bestFace == UNUSED32)
+            {
+                // no verts in the cache are used by any unprocessed faces
+                bestFace = buckets.top();
+                assert(bestFace != UNUSED32);
+            }
+
+            faceRemap[curFace] = bestFace + offset;
+
+            buckets.remove(bestFace);
+
+            uint32_t entriesInCache1 = 0;
+
+            // add bestFace to LRU cache
+            for (uint32_t v = 0; v < 3; ++v)
+            {
+                uint32_t vert = corners[bestFace * 3 + v];
+                assert(vert != UNUSED32);
+
+                if (cacheStamp[vert] != curFace)
+                {
+                    cacheStamp[vert] = curFace;
+                    cache1[entriesInCache1++] = vert;
+                }
+
+                assert(activeFaceCount[vert] > 0);
+                uint32_t* begin = activeFaceList.get() + activeFaceStart[vert];
+                uint32_t* end = begin + activeFaceCount[vert];
+                uint32_t* it = std::find(begin, end, bestFace);
+
+                assert(it != end);
+
+                std::swap(*it, *(end - 1));
+
+                --activeFaceCount[vert];
+
+                // the other faces using this vertex now have a lower valence
+                for (const uint32_t *fi = begin; fi != end - 1; ++fi)
+                {
+                    // a degenerate bestFace can still be listed once more for this vertex
+                    if (*fi != bestFace)
+                    {
+                        buckets.decrement(*fi);
+                    }
+                }
+            }
+
+            // move the rest of the old verts in the cache down
+            for (uint32_t c0 = 0; c0 < entriesInCache0; ++c0)
+            {
+                uint32_t vert = cache0[c0];
+                if (cacheStamp[vert] != curFace)
+                {
+                    cacheStamp[vert] = curFace;
+                    cache1[entriesInCache1++] = vert;
+                }
+            }
+
+            // update scores, including the up to 3 that were just evicted which only keep their valence score
+            for (uint32_t c1 = 0; c1 < entriesInCache1; ++c1)
+            {
+                uint32_t vert = cache1[c1];
+                vertexScores[vert] = static_cast<uint16_t>(FindFixedVertexScore(activeFaceCount[vert], c1, lruCacheSize));
+            }
+
+            // find the best scoring triangle in the current cache
+            uint32_t bestScore = 0;
+            bestFace = UNUSED32;
+
+            for (uint32_t c1 = 0; c1 < entriesInCache1; ++c1)
+            {
+                uint32_t vert = cache1[c1];
+
+                const uint32_t* faces = activeFaceList.get() + activeFaceStart[vert];
+                for (uint32_t j = 0; j < activeFaceCount[vert]; ++j)
+                {
+                    uint32_t face = faces[j];
+
+                    uint32_t faceScore = uint32_t(vertexScores[corners[face * 3]])
+                        + vertexScores[corners[face * 3 + 1]]
+                        + vertexScores[corners[face * 3 + 2]];
+
+                    if (bestFace == UNUSED32 || faceScore > bestScore)
+                    {
+                        bestScore = faceScore;
+                        bestFace = face;
+                    }
+                }
+            }
+
+            std::swap(cache0, cache1);
+
+            entriesInCache0 = std::min<uint32_t>(entriesInCache1, lruCacheSize);
+        }
+
+        for (uint32_t curFace = validFaces; curFace < faceCount; ++curFace)
+        {
+            faceRemap[curFace] = UNUSED32;
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Attribute subsets share no faces and each writes only its own range of faceRemap,
+    // so they can be optimized concurrently with the same result as the serial loop
+    //---------------------------------------------------------------------------------
+#ifdef _OPENMP
+    const size_t c_MinParallelFaces = 4096;
+#endif
+
+    template <typename IndexType>
+    HRESULT OptimizeSubsetsImpl(
+        _In_reads_(nFaces * 3) const IndexType* indices, size_t nFaces,
+        const std::vector<std::pair<size_t, size_t>>& subsets,
+        _Out_writes_(nFaces) uint32_t* faceRemap, uint32_t lruCacheSize,
+        HRESULT(*optimize)(const IndexType*, uint32_t, uint32_t*, uint32_t, uint32_t))
+    {
+        assert(!subsets.empty());
+
+#ifdef _OPENMP
+        if (subsets.size() > 1 && nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
+        {
+            auto order = ScheduleSubsets(subsets);
+
+            std::vector<HRESULT> results(subsets.size(), S_OK);
+
+            stage_stats* owner = stage_stats::current();
+
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int j = 0; j < int(order.size()); ++j)
+            {
+                stage_stats::worker bind(owner);
+
+                const auto& subset = subsets[order[size_t(j)]];
+
+                results[order[size_t(j)]] = optimize(
+                    &indices[subset.first * 3], static_cast<uint32_t>(subset.second * 3),
+                    &faceRemap[subset.first], lruCacheSize, uint32_t(subset.first));
+            }
+
+            // report the first failure in subset order
+            for (auto it = results.cbegin(); it != results.cend(); ++it)
+            {
+                if (FAILED(*it))
+                    return *it;
+            }
+
+            return S_OK;
+        }
+#else
+        UNREFERENCED_PARAMETER(nFaces);
+#endif
+
+        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        {
+            HRESULT hr = optimize(
+                &indices[it->first * 3], static_cast<uint32_t>(it->second * 3),
+                &faceRemap[it->first], lruCacheSize, uint32_t(it->first));
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeOptimizeFacesLRU(size_t nFaces)
+{
+    size_t indexCount = nFaces * 3;
+
+    size_t standard = ScratchBytes<OptimizeVertexData<uint32_t>>(indexCount)
+        + ScratchBytes<uint32_t>(indexCount) * 3
+        + ScratchBytes<uint8_t>(nFaces) + ScratchBytes<uint32_t>(nFaces) * 2;
+
+    // the fast path has at most two vertices per index
+    size_t vertexCount = indexCount * 2;
+    size_t fast = ScratchBytes<uint32_t>(indexCount)
+        + std::max(ScratchBytes<uint32_t>(indexCount),
+                   ScratchBytes<uint32_t>(vertexCount * 3 + 1) + ScratchBytes<uint16_t>(vertexCount)
+                   + ScratchBytes<uint32_t>(indexCount) * 2);
+
+    return std::max(standard, fast);
 }
 
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -516,6 +973,8 @@ HRESULT DirectX::OptimizeFacesLRU(
     const uint16_t* indices, size_t nFaces,
     uint32_t* faceRemap, uint32_t lruCacheSize)
 {
+    stage_stats stats("OptimizeFacesLRU", nFaces, 0);
+
     if (!indices || !nFaces || !faceRemap)
         return E_INVALIDARG;
 
@@ -535,6 +994,8 @@ HRESULT DirectX::OptimizeFacesLRU(
     const uint32_t* indices, size_t nFaces,
     uint32_t* faceRemap, uint32_t lruCacheSize)
 {
+    stage_stats stats("OptimizeFacesLRU", nFaces, 0);
+
     if (!indices || !nFaces || !faceRemap)
         return E_INVALIDARG;
 
@@ -556,6 +1017,8 @@ HRESULT DirectX::OptimizeFacesLRUEx(
     const uint16_t* indices, size_t nFaces, const uint32_t* attributes,
     uint32_t* faceRemap, uint32_t lruCacheSize)
 {
+    stage_stats stats("OptimizeFacesLRUEx", nFaces, 0);
+
     if (!indices || !nFaces || !attributes || !faceRemap)
         return E_INVALIDARG;
 
@@ -569,18 +1032,7 @@ HRESULT DirectX::OptimizeFacesLRUEx(
 
     auto subsets = ComputeSubsets(attributes, nFaces);
 
-    assert(!subsets.empty());
-
-    for( auto it = subsets.cbegin(); it != subsets.cend(); ++it)
-    {
-        HRESULT hr = OptimizeFacesImpl<uint16_t>(
-            &indices[it->first * 3], static_cast<uint32_t>(it->second * 3),
-            &faceRemap[it->first], lruCacheSize, uint32_t(it->first));
-        if (FAILED(hr))
-            return hr;
-    }
-
-    return S_OK;
+    return OptimizeSubsetsImpl<uint16_t>(indices, nFaces, subsets, faceRemap, lruCacheSize, OptimizeFacesImpl<uint16_t>);
 }
 
 _Use_decl_annotations_
@@ -588,6 +1040,77 @@ HRESULT DirectX::OptimizeFacesLRUEx(
     const uint32_t* indices, size_t nFaces, const uint32_t* attributes,
     uint32_t* faceRemap, uint32_t lruCacheSize)
 {
+    stage_stats stats("OptimizeFacesLRUEx", nFaces, 0);
+
+    if (!indices || !nFaces || !attributes || !faceRemap)
+        return E_INVALIDARG;
+
+    if (!lruCacheSize || lruCacheSize > kMaxVertexCacheSize)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    InitOnceExecuteOnce(&s_initOnce, ComputeVertexScores, nullptr, nullptr);
+
+    auto subsets = ComputeSubsets(attributes, nFaces);
+
+    return OptimizeSubsetsImpl<uint32_t>(indices, nFaces, subsets, faceRemap, lruCacheSize, OptimizeFacesImpl<uint32_t>);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesLRUFast(
+    const uint16_t* indices, size_t nFaces,
+    uint32_t* faceRemap, uint32_t lruCacheSize)
+{
+    stage_stats stats("OptimizeFacesLRUFast", nFaces, 0);
+
+    if (!indices || !nFaces || !faceRemap)
+        return E_INVALIDARG;
+
+    if (!lruCacheSize || lruCacheSize > kMaxVertexCacheSize)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    InitOnceExecuteOnce(&s_initOnce, ComputeVertexScores, nullptr, nullptr);
+
+    return OptimizeFacesFastImpl<uint16_t>(indices, static_cast<uint32_t>(nFaces * 3), faceRemap, lruCacheSize, 0);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesLRUFast(
+    const uint32_t* indices, size_t nFaces,
+    uint32_t* faceRemap, uint32_t lruCacheSize)
+{
+    stage_stats stats("OptimizeFacesLRUFast", nFaces, 0);
+
+    if (!indices || !nFaces || !faceRemap)
+        return E_INVALIDARG;
+
+    if (!lruCacheSize || lruCacheSize > kMaxVertexCacheSize)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    InitOnceExecuteOnce(&s_initOnce, ComputeVertexScores, nullptr, nullptr);
+
+    return OptimizeFacesFastImpl<uint32_t>(indices, static_cast<uint32_t>(nFaces * 3), faceRemap, lruCacheSize, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesLRUFastEx(
+    const uint16_t* indices, size_t nFaces, const uint32_t* attributes,
+    uint32_t* faceRemap, uint32_t lruCacheSize)
+{
+    stage_stats stats("OptimizeFacesLRUFastEx", nFaces, 0);
+
     if (!indices || !nFaces || !attributes || !faceRemap)
         return E_INVALIDARG;
 
@@ -601,16 +1124,28 @@ HRESULT DirectX::OptimizeFacesLRUEx(
 
     auto subsets = ComputeSubsets(attributes, nFaces);
 
-    assert(!subsets.empty());
+    return OptimizeSubsetsImpl<uint16_t>(indices, nFaces, subsets, faceRemap, lruCacheSize, OptimizeFacesFastImpl<uint16_t>);
+}
 
-    for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
-    {
-        HRESULT hr = OptimizeFacesImpl<uint32_t>(
-            &indices[it->first * 3], static_cast<uint32_t>(it->second * 3),
-            &faceRemap[it->first], lruCacheSize, uint32_t(it->first));
-        if (FAILED(hr))
-            return hr;
-    }
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesLRUFastEx(
+    const uint32_t* indices, size_t nFaces, const uint32_t* attributes,
+    uint32_t* faceRemap, uint32_t lruCacheSize)
+{
+    stage_stats stats("OptimizeFacesLRUFastEx", nFaces, 0);
+
+    if (!indices || !nFaces || !attributes || !faceRemap)
+        return E_INVALIDARG;
+
+    if (!lruCacheSize || lruCacheSize > kMaxVertexCacheSize)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    InitOnceExecuteOnce(&s_initOnce, ComputeVertexScores, nullptr, nullptr);
+
+    auto subsets = ComputeSubsets(attributes, nFaces);
 
-    return S_OK;
+    return OptimizeSubsetsImpl<uint32_t>(indices, nFaces, subsets, faceRemap, lruCacheSize, OptimizeFacesFastImpl<uint32_t>);
 }
@@ -0,0 +1,327 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshOptimizeOverdraw.cpp
+//  
+// DirectX Mesh Geometry Library - Mesh optimization for overdraw
+//
+// Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// ACM SIGGRAPH 2007
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    //---------------------------------------------------------------------------------
+    // FIFO vertex cache that misses exactly where ComputeVertexCacheMissRate does. Each
+    // miss stamps the vertex with the insertion count, so a vertex is still cached while
+    // fewer than cacheSize vertices have been inserted after it.
+    //---------------------------------------------------------------------------------
+    class fifo_vcache
+    {
+    public:
+        fifo_vcache(_Inout_updates_all_(nVerts) uint32_t* stamps, size_t nVerts, uint32_t cacheSize) :
+            mStamps(stamps),
+            mNVerts(nVerts),
+            mCacheSize(cacheSize),
+            mTime(0)
+        {
+            reset();
+        }
+
+        void flush()
+        {
+            if (mTime > UINT32_MAX - mCacheSize - 4)
+                reset();
+            else
+                mTime += mCacheSize + 1;
+        }
+
+        template<class index_t>
+        uint32_t access(_In_reads_(3) const index_t* face)
+        {
+            if (mTime > UINT32_MAX - 4)
+                reset();
+
+            uint32_t misses = 0;
+            for (size_t point = 0; point < 3; ++point)
+            {
+                index_t v = face[point];
+                if (v == index_t(-1))
+                    continue;
+
+                if ((mTime - mStamps[v]) > mCacheSize)
+                {
+                    mStamps[v] = mTime++;
+                    ++misses;
+                }
+            }
+
+            return misses;
+        }
+
+    private:
+        void reset()
+        {
+            memset(mStamps, 0, sizeof(uint32_t) * mNVerts);
+            mTime = mCacheSize + 1;
+        }
+
+        uint32_t*   mStamps;
+        size_t      mNVerts;
+        uint32_t    mCacheSize;
+        uint32_t    mTime;
+    };
+
+
+    //---------------------------------------------------------------------------------
+    // Accumulates the area-weighted centroid (times 3) and the area-weighted normal of faces
+    template<class index_t>
+    void AddFaceGeometry(
+        _In_reads_(3) const index_t* face,
+        _In_ const XMFLOAT3* positions,
+        XMVECTOR& centroid, XMVECTOR& normal, float& area)
+    {
+        if (face[0] == index_t(-1) || face[1] == index_t(-1) || face[2] == index_t(-1))
+            return;
+
+        XMVECTOR p0 = XMLoadFloat3(&positions[face[0]]);
+        XMVECTOR p1 = XMLoadFloat3(&positions[face[1]]);
+        XMVECTOR p2 = XMLoadFloat3(&positions[face[2]]);
+
+        XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+        XMVECTOR a = XMVector3Length(n);
+
+        centroid = XMVectorMultiplyAdd(XMVectorAdd(XMVectorAdd(p0, p1), p2), a, centroid);
+        normal = XMVectorAdd(normal, n);
+        area += XMVectorGetX(a);
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT OptimizeFacesOverdrawImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_opt_(nFaces) const uint32_t* attributes,
+        _Inout_updates_all_(nFaces) uint32_t* faceRemap,
+        uint32_t vertexCache, DWORD flags, float threshold)
+    {
+        if (!indices || !nFaces || !positions || !nVerts || !faceRemap)
+            return E_INVALIDARG;
+
+        if (!vertexCache || !(threshold >= 1.f))
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        auto subsets = ComputeSubsets(attributes, nFaces);
+
+        auto stamps = make_scratch<uint32_t>(nVerts);
+        auto temp = make_scratch<uint32_t>(nFaces * 4 + 2);
+        auto keys = make_scratch<float>(nFaces);
+        if (!stamps || !temp || !keys)
+            return E_OUTOFMEMORY;
+
+        uint32_t* faces = temp.get();
+        uint32_t* clusters = temp.get() + nFaces;
+        uint32_t* splits = temp.get() + nFaces * 2 + 1;
+        uint32_t* order = temp.get() + nFaces * 3 + 2;
+
+        fifo_vcache vcache(stamps.get(), nVerts, vertexCache);
+
+        const float sign = (flags & OPTOVERDRAW_WIND_CW) ? -1.f : 1.f;
+
+        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        {
+            // Used faces in their cache-optimized order; unused entries end up after them
+            uint32_t nUsed = 0;
+            for (size_t j = it->first; j < it->first + it->second; ++j)
+            {
+                uint32_t face = faceRemap[j];
+                if (face == UNUSED32)
+                    continue;
+
+                if (face >= nFaces)
+                    return E_UNEXPECTED;
+
+                for (size_t point = 0; point < 3; ++point)
+                {
+                    index_t v = indices[face * 3 + point];
+                    if (v != index_t(-1) && v >= nVerts)
+                        return E_UNEXPECTED;
+                }
+
+                faces[nUsed++] = face;
+            }
+
+            if (!nUsed)
+                continue;
+
+            // Hard boundaries where every corner misses, so the cache was effectively flushed
+            uint32_t nClusters = 0;
+
+            vcache.flush();
+
+            for (uint32_t j = 0; j < nUsed; ++j)
+            {
+                uint32_t misses = vcache.access(&indices[faces[j] * 3]);
+                if (!j || misses == 3)
+                    clusters[nClusters++] = j;
+            }
+
+            clusters[nClusters] = nUsed;
+
+            // Soft boundaries as soon as a prefix of a cluster is within threshold of the whole cluster's ACMR;
+            // each piece starts with a flushed cache, which is the worst case for any placement
+            uint32_t nSplits = 0;
+
+            for (uint32_t c = 0; c < nClusters; ++c)
+            {
+                uint32_t start = clusters[c];
+                uint32_t end = clusters[c + 1];
+
+                vcache.flush();
+
+                uint32_t total = 0;
+                for (uint32_t j = start; j < end; ++j)
+                {
+                    total += vcache.access(&indices[faces[j] * 3]);
+                }
+
+                float limit = threshold * float(total) / float(end - start);
+
+                vcache.flush();
+
+                splits[nSplits++] = start;
+
+                uint32_t misses = 0;
+                uint32_t first = start;
+                for (uint32_t j = start; j < end; ++j)
+                {
+                    misses += vcache.access(&indices[faces[j] * 3]);
+
+                    if ((j + 1 < end) && float(misses) <= limit * float(j + 1 - first))
+                    {
+                        splits[nSplits++] = j + 1;
+                        first = j + 1;
+                        misses = 0;
+
+                        vcache.flush();
+                    }
+                }
+            }
+
+            splits[nSplits] = nUsed;
+
+            // Occlusion potential of each cluster is how far it lies out along its own normal from the group's centroid
+            XMVECTOR meshCentroid = g_XMZero;
+            {
+                XMVECTOR normal = g_XMZero;
+                float area = 0.f;
+                for (uint32_t j = 0; j < nUsed; ++j)
+                {
+                    AddFaceGeometry(&indices[faces[j] * 3], positions, meshCentroid, normal, area);
+                }
+
+                meshCentroid = (area > 0.f) ? XMVectorScale(meshCentroid, 1.f / (area * 3.f)) : g_XMZero;
+            }
+
+            for (uint32_t c = 0; c < nSplits; ++c)
+            {
+                XMVECTOR centroid = g_XMZero;
+                XMVECTOR normal = g_XMZero;
+                float area = 0.f;
+                for (uint32_t j = splits[c]; j < splits[c + 1]; ++j)
+                {
+                    AddFaceGeometry(&indices[faces[j] * 3], positions, centroid, normal, area);
+                }
+
+                float key = 0.f;
+                if (area > 0.f)
+                {
+                    centroid = XMVectorScale(centroid, 1.f / (area * 3.f));
+                    normal = XMVector3Normalize(normal);
+
+                    key = sign * XMVectorGetX(XMVector3Dot(XMVectorSubtract(centroid, meshCentroid), normal));
+                }
+
+                keys[c] = key;
+                order[c] = c;
+            }
+
+            float* ckeys = keys.get();
+            std::sort(order, order + nSplits, [=](uint32_t a, uint32_t b) -> bool
+            {
+                return (ckeys[a] > ckeys[b]) || (ckeys[a] == ckeys[b] && a < b);
+            });
+
+            size_t dest = it->first;
+            for (uint32_t c = 0; c < nSplits; ++c)
+            {
+                for (uint32_t j = splits[order[c]]; j < splits[order[c] + 1]; ++j)
+                {
+                    faceRemap[dest++] = faces[j];
+                }
+            }
+
+            for (; dest < it->first + it->second; ++dest)
+            {
+                faceRemap[dest] = UNUSED32;
+            }
+        }
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeOptimizeFacesOverdraw(size_t nFaces, size_t nVerts)
+{
+    return ScratchBytes<uint32_t>(nVerts) + ScratchBytes<uint32_t>(nFaces * 4 + 2) + ScratchBytes<float>(nFaces);
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesOverdraw(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* attributes, uint32_t* faceRemap,
+    uint32_t vertexCache, DWORD flags, float threshold)
+{
+    stage_stats stats("OptimizeFacesOverdraw", nFaces, nVerts);
+
+    return OptimizeFacesOverdrawImpl<uint16_t>(indices, nFaces, positions, nVerts, attributes, faceRemap, vertexCache, flags, threshold);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::OptimizeFacesOverdraw(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* attributes, uint32_t* faceRemap,
+    uint32_t vertexCache, DWORD flags, float threshold)
+{
+    stage_stats stats("OptimizeFacesOverdraw", nFaces, nVerts);
+
+    return OptimizeFacesOverdrawImpl<uint32_t>(indices, nFaces, positions, nVerts, attributes, faceRemap, vertexCache, flags, threshold);
+}
@@ -22,7 +22,12 @@ using namespace DirectX;
 namespace
 {
     //---------------------------------------------------------------------------------
-    template<class index_t>
+    // Faces are linked by their index within the subset, so when no subset has more than
+    // c_MaxPackedSubset faces the links are stored as uint16_t with link_t(-1) as 'none'
+    //---------------------------------------------------------------------------------
+    const size_t c_MaxPackedSubset = UINT16_MAX;
+
+    template<class index_t, class link_t>
     class mesh_status
     {
     public:
@@ -31,7 +36,8 @@ namespace
             mFaceOffset(0),
             mFaceCount(0),
             mMaxSubset(0),
-            mTotalFaces(0)
+            mTotalFaces(0),
+            mNeighbors(nullptr)
         {
         }
 
@@ -44,7 +50,7 @@ namespace
                 return E_INVALIDARG;
 
             // Convert adjacency to 'physical' adjacency
-            mPhysicalNeighbors.reset(new (std::nothrow) neighborInfo[nFaces]);
+            mPhysicalNeighbors = make_scratch<neighborInfo>(nFaces);
             if (!mPhysicalNeighbors)
                 return E_OUTOFMEMORY;
 
@@ -67,6 +73,9 @@ namespace
                     mMaxSubset = it->second;
                 }
 
+                if (it->second > size_t(link_t(-1)))
+                    return E_UNEXPECTED;
+
                 uint32_t faceOffset = uint32_t(it->first);
                 uint32_t faceMax = uint32_t(it->first + it->second);
 
@@ -97,16 +106,16 @@ namespace
                                     return E_UNEXPECTED;
 
                                 if (adjacency[k * 3] == face)
-                                    mPhysicalNeighbors[k].neighbors[0] = UNUSED32;
+                                    mPhysicalNeighbors[k].neighbors[0] = link_t(-1);
 
                                 if (adjacency[k * 3 + 1] == face)
-                                    mPhysicalNeighbors[k].neighbors[1] = UNUSED32;
+                                    mPhysicalNeighbors[k].neighbors[1] = link_t(-1);
 
                                 if (adjacency[k * 3 + 2] == face)
-                                    mPhysicalNeighbors[k].neighbors[2] = UNUSED32;
+                                    mPhysicalNeighbors[k].neighbors[2] = link_t(-1);
                             }
 
-                            mPhysicalNeighbors[face].neighbors[point] = UNUSED32;
+                            mPhysicalNeighbors[face].neighbors[point] = link_t(-1);
                         }
                     }
                     else
@@ -148,7 +157,7 @@ namespace
                                 }
                             }
 
-                            mPhysicalNeighbors[face].neighbors[n] = neighbor;
+                            mPhysicalNeighbors[face].neighbors[n] = (neighbor == UNUSED32) ? link_t(-1) : link_t(neighbor - faceOffset);
                         }
                     }
                 }
@@ -157,13 +166,42 @@ namespace
             if (!mMaxSubset)
                 return E_FAIL;
 
-            mListElements.reset(new (std::nothrow) listElement[mMaxSubset]);
+            mListElements = make_scratch<listElement>(mMaxSubset);
+            if (!mListElements)
+                return E_OUTOFMEMORY;
+
+            mNeighbors = mPhysicalNeighbors.get();
+
+            return S_OK;
+        }
+
+        // Shares the physical adjacency of an initialized instance, with separate subset state
+        HRESULT initialize(const mesh_status<index_t, link_t>& source)
+        {
+            if (!source.mNeighbors || !source.mMaxSubset)
+                return E_INVALIDARG;
+
+            mFaceOffset = 0;
+            mFaceCount = 0;
+            mMaxSubset = source.mMaxSubset;
+            mTotalFaces = source.mTotalFaces;
+
+            mListElements = make_scratch<listElement>(mMaxSubset);
             if (!mListElements)
                 return E_OUTOFMEMORY;
 
+            mPhysicalNeighbors.reset();
+            mNeighbors = source.mNeighbors;
+
             return S_OK;
         }
 
+        // Scratch taken by initialize for a mesh of nFaces
+        static size_t scratch_size(size_t nFaces)
+        {
+            return ScratchBytes<neighborInfo>(nFaces) + ScratchBytes<listElement>(nFaces);
+        }
+
         HRESULT setSubset(
             _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
             size_t faceOffset, size_t faceCount)
@@ -207,16 +245,15 @@ namespace
                     continue;
                 }
 
-                uint32_t unprocessed = 0;
+                uint8_t unprocessed = 0;
 
                 for (uint32_t n = 0; n < 3; ++n)
                 {
-                    if (mPhysicalNeighbors[face].neighbors[n] != UNUSED32)
+                    if (mNeighbors[face].neighbors[n] != link_t(-1))
                     {
                         unprocessed += 1;
 
-                        assert(mPhysicalNeighbors[face].neighbors[n] >= mFaceOffset);
-                        assert(mPhysicalNeighbors[face].neighbors[n] < faceMax);
+                        assert(mNeighbors[face].neighbors[n] < mFaceCount);
                     }
                 }
 
@@ -269,7 +306,7 @@ namespace
 
             for (uint32_t n = 0; n < 3; ++n)
             {
-                uint32_t neighbor = mPhysicalNeighbors[face].neighbors[n];
+                uint32_t neighbor = get_neighbors(face, n);
                 if ((neighbor != UNUSED32) && !isprocessed(neighbor))
                 {
                     decrement(neighbor);
@@ -288,7 +325,7 @@ namespace
 
             for (uint32_t n = 0; n < 3; ++n)
             {
-                uint32_t neighbor = mPhysicalNeighbors[face].neighbors[n];
+                uint32_t neighbor = get_neighbors(face, n);
 
                 if ((neighbor == UNUSED32) || isprocessed(neighbor))
                     continue;
@@ -300,7 +337,7 @@ namespace
 
                 for (uint32_t nt = 0; nt < 3; ++nt)
                 {
-                    uint32_t neighborTemp = mPhysicalNeighbors[neighbor].neighbors[nt];
+                    uint32_t neighborTemp = get_neighbors(neighbor, nt);
 
                     if ((neighborTemp == UNUSED32) || isprocessed(neighborTemp))
                         continue;
@@ -329,22 +366,40 @@ namespace
             return iret;
         }
 
+        // Neighbors of a face in the current subset, as face indices of the mesh
         const uint32_t get_neighbors(uint32_t face, uint32_t n) const
         {
             assert(face < mTotalFaces);
             assert(n < 3);
             _Analysis_assume_(face < mTotalFaces);
             _Analysis_assume_(n < 3);
-            return mPhysicalNeighbors[face].neighbors[n];
+            return to_face(mNeighbors[face].neighbors[n]);
         }
 
-        const uint32_t* get_neighborsPtr(uint32_t face) const
+        // Edge of face that is shared with neighbor, or 3 if they are not adjacent
+        uint32_t find_neighbor_edge(uint32_t face, uint32_t neighbor) const
         {
             assert(face < mTotalFaces);
-            return &mPhysicalNeighbors[face].neighbors[0];
+            assert((neighbor >= mFaceOffset) && (neighbor < (mFaceOffset + mFaceCount)));
+            return find_edge<link_t>(&mNeighbors[face].neighbors[0], link_t(neighbor - mFaceOffset));
         }
 
     private:
+        uint32_t to_face(link_t link) const
+        {
+            return (link == link_t(-1)) ? UNUSED32 : uint32_t(link + mFaceOffset);
+        }
+
+        static uint32_t to_index(link_t link)
+        {
+            return (link == link_t(-1)) ? UNUSED32 : uint32_t(link);
+        }
+
+        static link_t to_link(uint32_t faceIndex)
+        {
+            return (faceIndex == UNUSED32) ? link_t(-1) : link_t(faceIndex);
+        }
+
         void push_front(uint32_t faceIndex)
         {
             assert(faceIndex < mFaceCount);
@@ -352,30 +407,30 @@ namespace
             uint32_t unprocessed = mListElements[faceIndex].unprocessed;
 
             uint32_t head = mUnprocessed[unprocessed];
-            mListElements[faceIndex].next = head;
+            mListElements[faceIndex].next = to_link(head);
 
             if (head != UNUSED32)
-                mListElements[head].prev = faceIndex;
+                mListElements[head].prev = link_t(faceIndex);
 
             mUnprocessed[unprocessed] = faceIndex;
 
-            mListElements[faceIndex].prev = UNUSED32;
+            mListElements[faceIndex].prev = link_t(-1);
         }
 
         void remove(uint32_t faceIndex)
         {
             assert(faceIndex < mFaceCount);
 
-            if (mListElements[faceIndex].prev != UNUSED32)
+            if (mListElements[faceIndex].prev != link_t(-1))
             {
                 assert(mUnprocessed[mListElements[faceIndex].unprocessed] != faceIndex);
 
-                uint32_t prev = mListElements[faceIndex].prev;
-                uint32_t next = mListElements[faceIndex].next;
+                link_t prev = mListElements[faceIndex].prev;
+                link_t next = mListElements[faceIndex].next;
 
                 mListElements[prev].next = next;
 
-                if (next != UNUSED32)
+                if (next != link_t(-1))
                 {
                     mListElements[next].prev = prev;
                 }
@@ -387,16 +442,16 @@ namespace
 
                 uint32_t unprocessed = mListElements[faceIndex].unprocessed;
 
-                mUnprocessed[unprocessed] = mListElements[faceIndex].next;
+                mUnprocessed[unprocessed] = to_index(mListElements[faceIndex].next);
 
                 if (mUnprocessed[unprocessed] != UNUSED32)
                 {
-                    mListElements[mUnprocessed[unprocessed]].prev = UNUSED32;
+                    mListElements[mUnprocessed[unprocessed]].prev = link_t(-1);
                 }
             }
 
             mListElements[faceIndex].prev =
-                mListElements[faceIndex].next = UNUSED32;
+                mListElements[faceIndex].next = link_t(-1);
         }
 
         void decrement(uint32_t face)
@@ -416,17 +471,18 @@ namespace
             push_front(faceIndex);
         }
 
+        // Neighbors are face indices within the subset
         struct neighborInfo
         {
-            uint32_t neighbors[3];
+            link_t      neighbors[3];
         };
 
         struct listElement
         {
+            link_t      prev;
+            link_t      next;
+            uint8_t     unprocessed;
             bool        processed;
-            uint32_t    unprocessed;
-            uint32_t    prev;
-            uint32_t    next;
         };
 
         uint32_t                        mUnprocessed[4];
@@ -434,26 +490,29 @@ namespace
         size_t                          mFaceCount;
         size_t                          mMaxSubset;
         size_t                          mTotalFaces;
-        std::unique_ptr<listElement[]>  mListElements;
-        std::unique_ptr<neighborInfo[]> mPhysicalNeighbors;
+        scratch_array<listElement>      mListElements;
+        scratch_array<neighborInfo>     mPhysicalNeighbors;
+        const neighborInfo*             mNeighbors;
     };
 
 
     //---------------------------------------------------------------------------------
     typedef std::pair<uint32_t, uint32_t> facecorner_t;
 
-    template<class index_t>
-    inline facecorner_t counterclockwise_corner(facecorner_t corner, mesh_status<index_t>& status)
+    template<class index_t, class link_t>
+    inline facecorner_t counterclockwise_corner(facecorner_t corner, mesh_status<index_t, link_t>& status)
     {
         assert(corner.second != UNUSED32);
         uint32_t edge = (corner.second + 2) % 3;
         uint32_t neighbor = status.get_neighbors(corner.first, edge);
-        uint32_t point = (neighbor == UNUSED32) ? UNUSED32 : find_edge(status.get_neighborsPtr(neighbor), corner.first);
+        uint32_t point = (neighbor == UNUSED32) ? UNUSED32 : status.find_neighbor_edge(neighbor, corner.first);
         return facecorner_t(neighbor, point);
     }
 
 
     //---------------------------------------------------------------------------------
+    // FIFO of the vertices in the simulated cache, which are never index_t(-1)
+    template<class index_t>
     class sim_vcache
     {
     public:
@@ -464,7 +523,7 @@ namespace
             if (!cacheSize)
                 return E_INVALIDARG;
 
-            mFIFO.reset(new (std::nothrow) uint32_t[cacheSize]);
+            mFIFO = make_scratch<index_t>(cacheSize);
             if (!mFIFO)
                 return E_OUTOFMEMORY;
 
@@ -479,12 +538,12 @@ namespace
         {
             assert(mFIFO != 0);
             mTail = 0;
-            memset(mFIFO.get(), 0xff, sizeof(uint32_t) * mCacheSize);
+            memset(mFIFO.get(), 0xff, sizeof(index_t) * mCacheSize);
         }
 
-        bool access(uint32_t vertex)
+        bool access(index_t vertex)
         {
-            assert(vertex != UNUSED32);
+            assert(vertex != index_t(-1));
             assert(mFIFO != 0);
 
             for (size_t ptr = 0; ptr < mCacheSize; ++ptr)
@@ -506,69 +565,120 @@ namespace
     private:
         uint32_t                    mTail;
         uint32_t                    mCacheSize;
-        std::unique_ptr<uint32_t[]> mFIFO;
+        scratch_array<index_t>      mFIFO;
     };
 
 
     //---------------------------------------------------------------------------------
-    template<class index_t>
-    HRESULT StripReorderImpl(
+#ifdef _OPENMP
+    const size_t c_MinParallelFaces = 4096;
+#endif
+
+    template<class index_t, class link_t>
+    HRESULT StripReorderSubset(
+        mesh_status<index_t, link_t>& status,
         _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
-        _In_reads_(nFaces * 3) const uint32_t* adjacency,
-        _In_reads_opt_(nFaces) const uint32_t* attributes,
-        _Out_writes_(nFaces) uint32_t* faceRemap)
+        size_t faceOffset, size_t faceCount,
+        _Inout_updates_all_(nFaces) uint32_t* faceRemapInverse)
     {
-        auto subsets = ComputeSubsets(attributes, nFaces);
+        HRESULT hr = status.setSubset(indices, nFaces, faceOffset, faceCount);
+        if (FAILED(hr))
+            return hr;
 
-        assert(!subsets.empty());
+        uint32_t curface = 0;
+
+        for (;;)
+        {
+            uint32_t face = status.find_initial();
+            if (face == UNUSED32)
+                break;
+
+            status.mark(face);
+
+            uint32_t next = status.find_next(face);
+
+            for (;;)
+            {
+                assert(face != UNUSED32);
+                faceRemapInverse[face] = uint32_t(curface + faceOffset);
+                curface += 1;
+
+                // if at end of strip, break out
+                if (next >= 3)
+                    break;
+
+                face = status.get_neighbors(face, next);
+                assert(face != UNUSED32);
+
+                status.mark(face);
+
+                next = status.find_next(face);
+            }
+        }
+
+        return S_OK;
+    }
 
-        mesh_status<index_t> status;
+    template<class index_t, class link_t>
+    HRESULT StripReorderLinks(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        const std::vector<std::pair<size_t, size_t>>& subsets,
+        _Out_writes_(nFaces) uint32_t* faceRemap)
+    {
+        mesh_status<index_t, link_t> status;
         HRESULT hr = status.initialize(indices, nFaces, adjacency, subsets);
         if (FAILED(hr))
             return hr;
 
-        std::unique_ptr<uint32_t[]> faceRemapInverse(new (std::nothrow) uint32_t[nFaces]);
+        auto faceRemapInverse = make_scratch<uint32_t>(nFaces);
         if (!faceRemapInverse)
             return E_OUTOFMEMORY;
 
         memset(faceRemapInverse.get(), 0xff, sizeof(uint32_t) * nFaces);
 
-        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+#ifdef _OPENMP
+        if (subsets.size() > 1 && nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
         {
-            hr = status.setSubset(indices, nFaces, it->first, it->second);
-            if (FAILED(hr))
-                return hr;
+            // subsets share no faces, so each thread walks whole subsets with its own status
+            auto order = ScheduleSubsets(subsets);
 
-            uint32_t curface = 0;
+            std::vector<HRESULT> results(subsets.size(), S_OK);
 
-            for (;;)
-            {
-                uint32_t face = status.find_initial();
-                if (face == UNUSED32)
-                    break;
+            stage_stats* owner = stage_stats::current();
 
-                status.mark(face);
+            #pragma omp parallel
+            {
+                stage_stats::worker bind(owner);
 
-                uint32_t next = status.find_next(face);
+                mesh_status<index_t, link_t> local;
+                HRESULT hrLocal = local.initialize(status);
 
-                for (;;)
+                #pragma omp for schedule(dynamic, 1)
+                for (int j = 0; j < int(order.size()); ++j)
                 {
-                    assert(face != UNUSED32);
-                    faceRemapInverse[face] = uint32_t(curface + it->first);
-                    curface += 1;
-
-                    // if at end of strip, break out
-                    if (next >= 3)
-                        break;
-
-                    face = status.get_neighbors(face, next);
-                    assert(face != UNUSED32);
+                    size_t subset = order[size_t(j)];
 
-                    status.mark(face);
-
-                    next = status.find_next(face);
+                    results[subset] = FAILED(hrLocal) ? hrLocal
+                        : StripReorderSubset<index_t, link_t>(local, indices, nFaces, subsets[subset].first, subsets[subset].second, faceRemapInverse.get());
                 }
             }
+
+            for (auto it = results.cbegin(); it != results.cend(); ++it)
+            {
+                if (FAILED(*it))
+                    return *it;
+            }
+        }
+        else
+#endif
+        {
+            for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+            {
+                hr = StripReorderSubset<index_t, link_t>(status, indices, nFaces, it->first, it->second, faceRemapInverse.get());
+                if (FAILED(hr))
+                    return hr;
+            }
         }
 
         // inverse remap
@@ -588,168 +698,221 @@ namespace
 
 
     //---------------------------------------------------------------------------------
-    template<class index_t>
-    HRESULT VertexCacheStripReorderImpl(
+    template<class index_t, class link_t>
+    HRESULT VertexCacheStripReorderSubset(
+        mesh_status<index_t, link_t>& status, sim_vcache<index_t>& vcache,
         _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
-        _In_reads_(nFaces * 3) const uint32_t* adjacency,
-        _In_reads_opt_(nFaces) const uint32_t* attributes,
-        _Out_writes_(nFaces) uint32_t* faceRemap,
-        uint32_t vertexCache, uint32_t restart)
+        size_t faceOffset, size_t faceCount, uint32_t desired,
+        _Inout_updates_all_(nFaces) uint32_t* faceRemapInverse)
     {
-        auto subsets = ComputeSubsets(attributes, nFaces);
-
-        assert(!subsets.empty());
-
-        mesh_status<index_t> status;
-        HRESULT hr = status.initialize(indices, nFaces, adjacency, subsets);
-        if (FAILED(hr))
-            return hr;
-
-        sim_vcache vcache;
-        hr = vcache.initialize(vertexCache);
+        HRESULT hr = status.setSubset(indices, nFaces, faceOffset, faceCount);
         if (FAILED(hr))
             return hr;
 
-        std::unique_ptr<uint32_t[]> faceRemapInverse(new (std::nothrow) uint32_t[nFaces]);
-        if (!faceRemapInverse)
-            return E_OUTOFMEMORY;
+        vcache.clear();
 
-        memset(faceRemapInverse.get(), 0xff, sizeof(uint32_t) * nFaces);
+        uint32_t locnext = 0;
+        facecorner_t nextCorner(UNUSED32, UNUSED32);
+        facecorner_t curCorner(UNUSED32, UNUSED32);
 
-        assert(vertexCache >= restart);
-        uint32_t desired = vertexCache - restart;
+        uint32_t curface = 0;
 
-        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        for (;;)
         {
-            hr = status.setSubset(indices, nFaces, it->first, it->second);
-            if (FAILED(hr))
-                return hr;
-
-            vcache.clear();
-
-            uint32_t locnext = 0;
-            facecorner_t nextCorner(UNUSED32, UNUSED32);
-            facecorner_t curCorner(UNUSED32, UNUSED32);
+            assert(nextCorner.first == UNUSED32);
 
-            uint32_t curface = 0;
+            curCorner.first = status.find_initial();
+            if (curCorner.first == UNUSED32)
+                break;
 
-            for (;;)
+            uint32_t n0 = status.get_neighbors(curCorner.first, 0);
+            if ((n0 != UNUSED32) && !status.isprocessed(n0))
             {
-                assert(nextCorner.first == UNUSED32);
-
-                curCorner.first = status.find_initial();
-                if (curCorner.first == UNUSED32)
-                    break;
-
-                uint32_t n0 = status.get_neighbors(curCorner.first, 0);
-                if ((n0 != UNUSED32) && !status.isprocessed(n0))
+                curCorner.second = 1;
+            }
+            else
+            {
+                uint32_t n1 = status.get_neighbors(curCorner.first, 1);
+                if ((n1 != UNUSED32) && !status.isprocessed(n1))
                 {
-                    curCorner.second = 1;
+                    curCorner.second = 2;
                 }
                 else
                 {
-                    uint32_t n1 = status.get_neighbors(curCorner.first, 1);
-                    if ((n1 != UNUSED32) && !status.isprocessed(n1))
+                    curCorner.second = 0;
+                }
+            }
+
+            bool striprestart = false;
+            for (;;)
+            {
+                assert(curCorner.first != UNUSED32);
+                assert(!status.isprocessed(curCorner.first));
+
+                // Decision: either add a ring of faces or restart strip
+                if (nextCorner.first != UNUSED32)
+                {
+                    uint32_t nf = 0;
+                    for (facecorner_t temp = curCorner; ; )
                     {
-                        curCorner.second = 2;
+                        facecorner_t next = counterclockwise_corner<index_t, link_t>(temp, status);
+                        if ((next.first == UNUSED32) || status.isprocessed(next.first))
+                            break;
+                        ++nf;
+                        temp = next;
                     }
-                    else
+
+                    if (locnext + nf > desired)
                     {
-                        curCorner.second = 0;
+                        // restart
+                        if (!status.isprocessed(nextCorner.first))
+                        {
+                            curCorner = nextCorner;
+                        }
+
+                        nextCorner.first = UNUSED32;
                     }
                 }
 
-                bool striprestart = false;
                 for (;;)
                 {
                     assert(curCorner.first != UNUSED32);
-                    assert(!status.isprocessed(curCorner.first));
+                    status.mark(curCorner.first);
 
-                    // Decision: either add a ring of faces or restart strip
-                    if (nextCorner.first != UNUSED32)
-                    {
-                        uint32_t nf = 0;
-                        for (facecorner_t temp = curCorner; ; )
-                        {
-                            facecorner_t next = counterclockwise_corner<index_t>(temp, status);
-                            if ((next.first == UNUSED32) || status.isprocessed(next.first))
-                                break;
-                            ++nf;
-                            temp = next;
-                        }
+                    faceRemapInverse[curCorner.first] = uint32_t(curface + faceOffset);
+                    curface += 1;
+
+                    assert(indices[curCorner.first * 3] != index_t(-1));
+                    if (!vcache.access(indices[curCorner.first * 3]))
+                        locnext += 1;
+
+                    assert(indices[curCorner.first * 3 + 1] != index_t(-1));
+                    if (!vcache.access(indices[curCorner.first * 3 + 1]))
+                        locnext += 1;
+
+                    assert(indices[curCorner.first * 3 + 2] != index_t(-1));
+                    if (!vcache.access(indices[curCorner.first * 3 + 2]))
+                        locnext += 1;
 
-                        if (locnext + nf > desired)
+                    facecorner_t intCorner = counterclockwise_corner<index_t, link_t>(curCorner, status);
+                    bool interiornei = (intCorner.first != UNUSED32) && !status.isprocessed(intCorner.first);
+
+                    facecorner_t extCorner = counterclockwise_corner<index_t, link_t>(facecorner_t(curCorner.first, (curCorner.second + 2) % 3), status);
+                    bool exteriornei = (extCorner.first != UNUSED32) && !status.isprocessed(extCorner.first);
+
+                    if (interiornei)
+                    {
+                        if (exteriornei)
                         {
-                            // restart
-                            if (!status.isprocessed(nextCorner.first))
+                            if (nextCorner.first == UNUSED32)
                             {
-                                curCorner = nextCorner;
+                                nextCorner = extCorner;
+                                locnext = 0;
                             }
+                        }
+                        curCorner = intCorner;
+                    }
+                    else if (exteriornei)
+                    {
+                        curCorner = extCorner;
+                        break;
+                    }
+                    else
+                    {
+                        curCorner = nextCorner;
+                        nextCorner.first = UNUSED32;
 
-                            nextCorner.first = UNUSED32;
+                        if ((curCorner.first == UNUSED32) || status.isprocessed(curCorner.first))
+                        {
+                            striprestart = true;
+                            break;
                         }
                     }
+                }
 
-                    for (;;)
-                    {
-                        assert(curCorner.first != UNUSED32);
-                        status.mark(curCorner.first);
+                if (striprestart)
+                    break;
+            }
+        }
+
+        return S_OK;
+    }
 
-                        faceRemapInverse[curCorner.first] = uint32_t(curface + it->first);
-                        curface += 1;
+    template<class index_t, class link_t>
+    HRESULT VertexCacheStripReorderLinks(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        const std::vector<std::pair<size_t, size_t>>& subsets,
+        _Out_writes_(nFaces) uint32_t* faceRemap,
+        uint32_t vertexCache, uint32_t restart)
+    {
+        mesh_status<index_t, link_t> status;
+        HRESULT hr = status.initialize(indices, nFaces, adjacency, subsets);
+        if (FAILED(hr))
+            return hr;
 
-                        assert(indices[curCorner.first * 3] != index_t(-1));
-                        if (!vcache.access(indices[curCorner.first * 3]))
-                            locnext += 1;
+        auto faceRemapInverse = make_scratch<uint32_t>(nFaces);
+        if (!faceRemapInverse)
+            return E_OUTOFMEMORY;
 
-                        assert(indices[curCorner.first * 3 + 1] != index_t(-1));
-                        if (!vcache.access(indices[curCorner.first * 3 + 1]))
-                            locnext += 1;
+        memset(faceRemapInverse.get(), 0xff, sizeof(uint32_t) * nFaces);
 
-                        assert(indices[curCorner.first * 3 + 2] != index_t(-1));
-                        if (!vcache.access(indices[curCorner.first * 3 + 2]))
-                            locnext += 1;
+        assert(vertexCache >= restart);
+        uint32_t desired = vertexCache - restart;
 
-                        facecorner_t intCorner = counterclockwise_corner<index_t>(curCorner, status);
-                        bool interiornei = (intCorner.first != UNUSED32) && !status.isprocessed(intCorner.first);
+#ifdef _OPENMP
+        if (subsets.size() > 1 && nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
+        {
+            // subsets share no faces, so each thread walks whole subsets with its own status and cache
+            auto order = ScheduleSubsets(subsets);
 
-                        facecorner_t extCorner = counterclockwise_corner<index_t>(facecorner_t(curCorner.first, (curCorner.second + 2) % 3), status);
-                        bool exteriornei = (extCorner.first != UNUSED32) && !status.isprocessed(extCorner.first);
+            std::vector<HRESULT> results(subsets.size(), S_OK);
 
-                        if (interiornei)
-                        {
-                            if (exteriornei)
-                            {
-                                if (nextCorner.first == UNUSED32)
-                                {
-                                    nextCorner = extCorner;
-                                    locnext = 0;
-                                }
-                            }
-                            curCorner = intCorner;
-                        }
-                        else if (exteriornei)
-                        {
-                            curCorner = extCorner;
-                            break;
-                        }
-                        else
-                        {
-                            curCorner = nextCorner;
-                            nextCorner.first = UNUSED32;
+            stage_stats* owner = stage_stats::current();
 
-                            if ((curCorner.first == UNUSED32) || status.isprocessed(curCorner.first))
-                            {
-                                striprestart = true;
-                                break;
-                            }
-                        }
-                    }
+            #pragma omp parallel
+            {
+                stage_stats::worker bind(owner);
 
-                    if (striprestart)
-                        break;
+                mesh_status<index_t, link_t> local;
+                HRESULT hrLocal = local.initialize(status);
+
+                sim_vcache<index_t> vcache;
+                if (SUCCEEDED(hrLocal))
+                    hrLocal = vcache.initialize(vertexCache);
+
+                #pragma omp for schedule(dynamic, 1)
+                for (int j = 0; j < int(order.size()); ++j)
+                {
+                    size_t subset = order[size_t(j)];
+
+                    results[subset] = FAILED(hrLocal) ? hrLocal
+                        : VertexCacheStripReorderSubset<index_t, link_t>(local, vcache, indices, nFaces,
+                            subsets[subset].first, subsets[subset].second, desired, faceRemapInverse.get());
                 }
             }
+
+            for (auto it = results.cbegin(); it != results.cend(); ++it)
+            {
+                if (FAILED(*it))
+                    return *it;
+            }
+        }
+        else
+#endif
+        {
+            sim_vcache<index_t> vcache;
+            hr = vcache.initialize(vertexCache);
+            if (FAILED(hr))
+                return hr;
+
+            for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+            {
+                hr = VertexCacheStripReorderSubset<index_t, link_t>(status, vcache, indices, nFaces,
+                    it->first, it->second, desired, faceRemapInverse.get());
+                if (FAILED(hr))
+                    return hr;
+            }
         }
 
         // inverse remap
@@ -766,8 +929,68 @@ namespace
 
         return S_OK;
     }
+
+
+    //---------------------------------------------------------------------------------
+    // The packed layout is used when every subset fits in 16-bit links, otherwise the
+    // whole mesh falls back to 32-bit links
+    //---------------------------------------------------------------------------------
+    inline bool UsePackedLinks(const std::vector<std::pair<size_t, size_t>>& subsets)
+    {
+        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        {
+            if (it->second > c_MaxPackedSubset)
+                return false;
+        }
+
+        return true;
+    }
+
+    template<class index_t>
+    HRESULT StripReorderImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        _In_reads_opt_(nFaces) const uint32_t* attributes,
+        _Out_writes_(nFaces) uint32_t* faceRemap)
+    {
+        auto subsets = ComputeSubsets(attributes, nFaces);
+
+        assert(!subsets.empty());
+
+        if (UsePackedLinks(subsets))
+            return StripReorderLinks<index_t, uint16_t>(indices, nFaces, adjacency, subsets, faceRemap);
+
+        return StripReorderLinks<index_t, uint32_t>(indices, nFaces, adjacency, subsets, faceRemap);
+    }
+
+    template<class index_t>
+    HRESULT VertexCacheStripReorderImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        _In_reads_opt_(nFaces) const uint32_t* attributes,
+        _Out_writes_(nFaces) uint32_t* faceRemap,
+        uint32_t vertexCache, uint32_t restart)
+    {
+        auto subsets = ComputeSubsets(attributes, nFaces);
+
+        assert(!subsets.empty());
+
+        if (UsePackedLinks(subsets))
+            return VertexCacheStripReorderLinks<index_t, uint16_t>(indices, nFaces, adjacency, subsets, faceRemap, vertexCache, restart);
+
+        return VertexCacheStripReorderLinks<index_t, uint32_t>(indices, nFaces, adjacency, subsets, faceRemap, vertexCache, restart);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeOptimizeFaces(size_t nFaces, size_t vertexCache)
+{
+    return mesh_status<uint32_t, uint32_t>::scratch_size(nFaces) + ScratchBytes<uint32_t>(nFaces) + ScratchBytes<uint32_t>(vertexCache);
 }
 
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -777,6 +1000,8 @@ HRESULT DirectX::OptimizeFaces(
     const uint16_t* indices, size_t nFaces, const uint32_t* adjacency,
     uint32_t* faceRemap, uint32_t vertexCache, uint32_t restart)
 {
+    stage_stats stats("OptimizeFaces", nFaces, 0);
+
     if (!indices || !nFaces || !adjacency || !faceRemap)
         return E_INVALIDARG;
 
@@ -801,6 +1026,8 @@ HRESULT DirectX::OptimizeFaces(
     const uint32_t* indices, size_t nFaces, const uint32_t* adjacency,
     uint32_t* faceRemap, uint32_t vertexCache, uint32_t restart)
 {
+    stage_stats stats("OptimizeFaces", nFaces, 0);
+
     if (!indices || !nFaces || !adjacency || !faceRemap)
         return E_INVALIDARG;
 
@@ -827,6 +1054,8 @@ HRESULT DirectX::OptimizeFacesEx(
     const uint16_t* indices, size_t nFaces, const uint32_t* adjacency, const uint32_t* attributes,
     uint32_t* faceRemap, uint32_t vertexCache, uint32_t restart)
 {
+    stage_stats stats("OptimizeFacesEx", nFaces, 0);
+
     if (!indices || !nFaces || !adjacency || !attributes || !faceRemap)
         return E_INVALIDARG;
 
@@ -851,6 +1080,8 @@ HRESULT DirectX::OptimizeFacesEx(
     const uint32_t* indices, size_t nFaces, const uint32_t* adjacency, const uint32_t* attributes,
     uint32_t* faceRemap, uint32_t vertexCache, uint32_t restart)
 {
+    stage_stats stats("OptimizeFacesEx", nFaces, 0);
+
     if (!indices || !nFaces || !adjacency || !attributes || !faceRemap)
         return E_INVALIDARG;
 
@@ -88,14 +88,22 @@
 #include <malloc.h>
 
 #include <algorithm>
+#include <atomic>
 #include <map>
+#include <new>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 
 #include "directxmesh.h"
 
 #include "scoped.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 #ifndef XBOX_DXGI_FORMAT_R10G10B10_SNORM_A2_UNORM
 #define XBOX_DXGI_FORMAT_R10G10B10_SNORM_A2_UNORM DXGI_FORMAT(189)
 #endif
@@ -347,4 +355,208 @@ namespace DirectX
         return edge;
     }
 
+
+    //-------------------------------------------------------------------------------------
+    // Times an entry-point and reports it to the callback installed on the calling thread
+    //-------------------------------------------------------------------------------------
+    class stage_stats
+    {
+    public:
+        stage_stats(_In_z_ const char* stage, size_t nFaces, size_t nVerts);
+        ~stage_stats();
+
+        stage_stats(stage_stats const&) = delete;
+        stage_stats& operator= (stage_stats const&) = delete;
+
+        static stage_stats* current();
+
+        // Attributes allocations made on an OpenMP worker thread to the stage that started the region;
+        // scratch for the region comes from the heap since an arena belongs to a single thread
+        class worker
+        {
+        public:
+            explicit worker(_In_opt_ stage_stats* owner);
+            ~worker();
+
+            worker(worker const&) = delete;
+            worker& operator= (worker const&) = delete;
+
+        private:
+            stage_stats*    m_previous;
+            void*           m_previousArena;
+        };
+
+    private:
+        friend void TrackTempBytes(size_t bytes);
+
+        MeshStatsCallback       m_callback;
+        void*                   m_context;
+        stage_stats*            m_parent;
+        int64_t                 m_start;
+        MeshStageStats          m_stats;
+        std::atomic<size_t>     m_tempBytes;
+    };
+
+    void TrackTempBytes(size_t bytes);
+        // Adds to the temporary memory total of the stage being timed on this thread, if any
+
+
+    //-------------------------------------------------------------------------------------
+    // Temporary buffers come from the arena installed with SetScratchArena, or the heap
+    //-------------------------------------------------------------------------------------
+    const size_t c_ScratchAlignment = 16;
+
+    inline size_t ScratchBytes(size_t bytes)
+    {
+        return (std::max<size_t>(bytes, 1) + c_ScratchAlignment - 1) & ~(c_ScratchAlignment - 1);
+    }
+
+    template<class T>
+    inline size_t ScratchBytes(size_t count)
+    {
+        return ScratchBytes(sizeof(T) * count);
+    }
+
+    void* ScratchAllocate(size_t bytes, _Out_ void** arena);
+        // Sets arena to the allocator to pass back to ScratchFree, or null for the heap
+
+    void ScratchFree(_In_opt_ void* ptr, _In_opt_ void* arena, size_t bytes);
+
+    struct scratch_deleter
+    {
+        scratch_deleter() : arena(nullptr), bytes(0) {}
+        scratch_deleter(_In_opt_ void* a, size_t b) : arena(a), bytes(b) {}
+
+        void operator()(void* p) const { ScratchFree(p, arena, bytes); }
+
+        void*   arena;
+        size_t  bytes;
+    };
+
+    template<class T> using scratch_array = std::unique_ptr<T[], scratch_deleter>;
+
+    // Returns null on failure, like new (std::nothrow) T[count]
+    template<class T>
+    inline scratch_array<T> make_scratch(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Scratch elements are never destroyed");
+        static_assert(std::alignment_of<T>::value <= c_ScratchAlignment, "Scratch alignment is too small");
+
+        if (count > (SIZE_MAX - c_ScratchAlignment) / sizeof(T))
+            return scratch_array<T>();
+
+        size_t bytes = sizeof(T) * count;
+
+        void* arena = nullptr;
+        auto ptr = static_cast<T*>(ScratchAllocate(bytes, &arena));
+        if (!ptr)
+            return scratch_array<T>();
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            new (&ptr[j]) T;
+        }
+
+        TrackTempBytes(bytes);
+
+        return scratch_array<T>(ptr, scratch_deleter(arena, bytes));
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Stable counting sort of items by partition key (items keyed as UNUSED32 are dropped),
+    // split into nBlocks parallel blocks with nBlocks * nParts counts
+    inline void PartitionItems(
+        _In_reads_(nItems) const uint32_t* keys, size_t nItems,
+        uint32_t nParts, uint32_t nBlocks,
+        _Out_writes_(nBlocks * nParts) size_t* counts,
+        _Out_writes_(nItems) uint32_t* order,
+        _Out_writes_(nParts + 1) size_t* partOffsets)
+    {
+        size_t blockSize = (nItems + nBlocks - 1) / nBlocks;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t* bcounts = counts + size_t(block) * nParts;
+            memset(bcounts, 0, sizeof(size_t) * nParts);
+
+            size_t end = std::min<size_t>(nItems, size_t(block + 1) * blockSize);
+            for (size_t j = size_t(block) * blockSize; j < end; ++j)
+            {
+                uint32_t key = keys[j];
+                if (key != UNUSED32)
+                    ++bcounts[key];
+            }
+        }
+
+        // Partition-major prefix sum so each partition is contiguous and in item order
+        size_t total = 0;
+        for (uint32_t part = 0; part < nParts; ++part)
+        {
+            partOffsets[part] = total;
+
+            for (uint32_t block = 0; block < nBlocks; ++block)
+            {
+                size_t count = counts[block * nParts + part];
+                counts[block * nParts + part] = total;
+                total += count;
+            }
+        }
+        partOffsets[nParts] = total;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t* bcounts = counts + size_t(block) * nParts;
+
+            size_t end = std::min<size_t>(nItems, size_t(block + 1) * blockSize);
+            for (size_t j = size_t(block) * blockSize; j < end; ++j)
+            {
+                uint32_t key = keys[j];
+                if (key != UNUSED32)
+                    order[bcounts[key]++] = uint32_t(j);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Upper bounds on the scratch a call takes from the arena, used by ComputeScratchSize
+    size_t ScratchSizeAdjacency(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeValidate(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeClean(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeNormals(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeTangentFrame(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeOptimizeFaces(size_t nFaces, size_t vertexCache);
+    size_t ScratchSizeOptimizeFacesLRU(size_t nFaces);
+    size_t ScratchSizeOptimizeFacesOverdraw(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeOptimizeVertices(size_t nVerts);
+    size_t ScratchSizeOptimizeMesh(size_t nFaces, size_t nVerts, size_t vertexCache);
+    size_t ScratchSizePositionStream(size_t nFaces, size_t nVerts, size_t vertexCache);
+    size_t ScratchSizeAttributeSort(size_t nFaces);
+    size_t ScratchSizeRemap(size_t nFaces, size_t nVerts, size_t stride);
+    size_t ScratchSizePartition(size_t nFaces, size_t nVerts);
+    size_t ScratchSizeWeld(size_t nVerts, size_t nElements);
+    size_t ScratchSizeSimplify(size_t nFaces, size_t nVerts);
+
+
+#ifdef _OPENMP
+    //-------------------------------------------------------------------------------------
+    // Orders attribute subsets largest first for dynamically scheduled parallel loops
+    inline std::vector<size_t> ScheduleSubsets(const std::vector<std::pair<size_t, size_t>>& subsets)
+    {
+        std::vector<size_t> order(subsets.size());
+        for (size_t j = 0; j < order.size(); ++j)
+        {
+            order[j] = j;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return subsets[a].second > subsets[b].second;
+        });
+
+        return order;
+    }
+#endif
+
 }; // namespace
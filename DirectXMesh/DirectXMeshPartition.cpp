@@ -0,0 +1,723 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshPartition.cpp
+//
+// DirectX Mesh Geometry Library - Spatial partitioning for chunked processing
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    //---------------------------------------------------------------------------------
+    // Utilities
+    //---------------------------------------------------------------------------------
+
+    // Faces are ordered by the Morton code of their centroid with a counting sort, so the only working memory
+    // is a counter per cell; the cells get finer with the size of the group, up to c_MortonBits per axis, and
+    // faces keep their original order within a cell
+    const uint32_t c_MortonBits = 6;
+
+    inline uint32_t MortonBits(size_t nFaces)
+    {
+        // about four faces per cell
+        uint32_t bits = 1;
+        while (bits < c_MortonBits && (size_t(1) << (bits * 3 + 2)) < nFaces)
+        {
+            ++bits;
+        }
+
+        return bits;
+    }
+
+    inline uint32_t SpreadBits(uint32_t x)
+    {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x << 8)) & 0x0300f00f;
+        x = (x | (x << 4)) & 0x030c30c3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    }
+
+    inline uint32_t XM_CALLCONV MortonCode(FXMVECTOR centroid, FXMVECTOR minBound, FXMVECTOR scale, uint32_t bits)
+    {
+        XMVECTOR q = XMVectorMultiply(XMVectorSubtract(centroid, minBound), scale);
+        q = XMVectorClamp(q, g_XMZero, XMVectorReplicate(float((1u << bits) - 1)));
+
+        XMUINT3 cell;
+        XMStoreUInt3(&cell, XMVectorTruncate(q));
+
+        return SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+    }
+
+    // Cell of a face, or the count of cells for an unused face so that unused faces sort last
+    template<class index_t>
+    inline uint32_t XM_CALLCONV FaceCell(
+        _In_reads_(3) const index_t* face,
+        _In_ const XMFLOAT3* positions,
+        FXMVECTOR minBound, FXMVECTOR scale, uint32_t bits)
+    {
+        if (face[0] == index_t(-1)
+            || face[1] == index_t(-1)
+            || face[2] == index_t(-1))
+            return 1u << (bits * 3);
+
+        XMVECTOR centroid = XMVectorAdd(XMLoadFloat3(&positions[face[0]]), XMLoadFloat3(&positions[face[1]]));
+        centroid = XMVectorMultiply(XMVectorAdd(centroid, XMLoadFloat3(&positions[face[2]])), XMVectorReplicate(1.f / 3.f));
+
+        return MortonCode(centroid, minBound, scale, bits);
+    }
+
+    // Chunk vertices and boundary edges are found through flat open-addressing tables (linear probing)
+    // sized by what they hold, never by the mesh
+    struct vertexMapEntry
+    {
+        uint32_t    vertex;     // UNUSED32 for an empty slot
+        uint32_t    local;
+    };
+
+    inline size_t HashSlot(uint32_t hash, size_t mask)
+    {
+        // 32-bit finalizer from MurmurHash3
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+        return size_t(hash) & mask;
+    }
+
+    // Power-of-2 table size that keeps the load factor at or below 2/3
+    inline size_t HashTableSize(size_t nEntries)
+    {
+        size_t minSize = nEntries + (nEntries >> 1) + 1;
+
+        size_t size = 16;
+        while (size < minSize)
+        {
+            if (size > (SIZE_MAX / (sizeof(vertexMapEntry) * 2)))
+                return 0;
+
+            size <<= 1;
+        }
+
+        return size;
+    }
+
+    // An edge of a chunk face with no neighbor in its chunk, matched against the other chunks afterwards
+    struct boundaryEdge
+    {
+        uint32_t    corner;     // face * 3 + point, with the face in mesh order
+        uint32_t    chunk;      // UNUSED32 once matched
+        uint32_t    v1;
+        uint32_t    v2;
+        uint32_t    hash;
+    };
+
+    inline bool SamePosition(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+    }
+
+    inline uint32_t PositionHash(const XMFLOAT3& p)
+    {
+        // adding zero folds -0 into +0, so that equal positions hash the same
+        float v[3] = { p.x + 0.f, p.y + 0.f, p.z + 0.f };
+
+        uint32_t bits[3];
+        memcpy(bits, v, sizeof(bits));
+
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+
+    inline uint32_t EdgeHash(const XMFLOAT3& p1, const XMFLOAT3& p2)
+    {
+        return (PositionHash(p1) * 2654435761u) ^ PositionHash(p2);
+    }
+
+    // Validates the chunks, returning the face count of the largest or 0 when any is out of range
+    size_t MaxChunkFaces(size_t nFaces, const std::vector<std::pair<size_t, size_t>>& chunks)
+    {
+        size_t maxFaces = 0;
+        for (auto it = chunks.cbegin(); it != chunks.cend(); ++it)
+        {
+            if (!it->second || it->first >= nFaces || it->second > (nFaces - it->first))
+                return 0;
+
+            maxFaces = std::max(maxFaces, it->second);
+        }
+
+        return maxFaces;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT PartitionMeshImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_opt_(nFaces) const uint32_t* attributes, size_t maxChunkFaces,
+        _Out_writes_(nFaces) uint32_t* faceRemap,
+        std::vector<std::pair<size_t, size_t>>& chunks)
+    {
+        chunks.clear();
+
+        if (!indices || !nFaces || !positions || !nVerts || !maxChunkFaces || !faceRemap)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        XMVECTOR minBound = g_XMFltMax;
+        XMVECTOR maxBound = XMVectorNegate(g_XMFltMax);
+        XMVECTOR third = XMVectorReplicate(1.f / 3.f);
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            index_t i0 = indices[face * 3];
+            index_t i1 = indices[face * 3 + 1];
+            index_t i2 = indices[face * 3 + 2];
+
+            if (i0 == index_t(-1)
+                || i1 == index_t(-1)
+                || i2 == index_t(-1))
+                continue;
+
+            if (i0 >= nVerts
+                || i1 >= nVerts
+                || i2 >= nVerts)
+                return E_UNEXPECTED;
+
+            XMVECTOR centroid = XMVectorAdd(XMLoadFloat3(&positions[i0]), XMLoadFloat3(&positions[i1]));
+            centroid = XMVectorMultiply(XMVectorAdd(centroid, XMLoadFloat3(&positions[i2])), third);
+
+            minBound = XMVectorMin(minBound, centroid);
+            maxBound = XMVectorMax(maxBound, centroid);
+        }
+
+        // the same scale on every axis keeps the cells cubic, so flat meshes still split by area
+        XMVECTOR extent = XMVectorSubtract(maxBound, minBound);
+        extent = XMVectorMax(XMVectorMax(XMVectorSplatX(extent), XMVectorSplatY(extent)), XMVectorSplatZ(extent));
+
+        // each attribute group is ordered and split on its own, so chunks never span groups
+        auto subsets = ComputeSubsets(attributes, nFaces);
+
+        size_t maxGroup = 0;
+        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        {
+            maxGroup = std::max(maxGroup, it->second);
+        }
+
+        // one counter per cell, plus one for the unused faces
+        auto counts = make_scratch<uint32_t>((size_t(1) << (MortonBits(maxGroup) * 3)) + 1);
+        if (!counts)
+            return E_OUTOFMEMORY;
+
+        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        {
+            size_t count = it->second;
+
+            uint32_t bits = MortonBits(count);
+            size_t nCells = size_t(1) << (bits * 3);
+
+            XMVECTOR cells = XMVectorReplicate(float(1u << bits));
+            XMVECTOR scale = XMVectorSelect(XMVectorDivide(cells, extent), g_XMZero, XMVectorLessOrEqual(extent, g_XMZero));
+
+            memset(counts.get(), 0, sizeof(uint32_t) * (nCells + 1));
+
+            for (size_t face = it->first; face < it->first + count; ++face)
+            {
+                ++counts[FaceCell(&indices[face * 3], positions, minBound, scale, bits)];
+            }
+
+            uint32_t offset = uint32_t(it->first);
+            for (size_t j = 0; j <= nCells; ++j)
+            {
+                uint32_t n = counts[j];
+                counts[j] = offset;
+                offset += n;
+            }
+
+            for (size_t face = it->first; face < it->first + count; ++face)
+            {
+                faceRemap[counts[FaceCell(&indices[face * 3], positions, minBound, scale, bits)]++] = uint32_t(face);
+            }
+
+            // evenly sized chunks, with any unused faces sorted to the end of the group
+            size_t nChunks = (count + maxChunkFaces - 1) / maxChunkFaces;
+
+            size_t start = 0;
+            for (size_t j = 1; j <= nChunks; ++j)
+            {
+                size_t end = (count * j) / nChunks;
+                chunks.emplace_back(std::pair<size_t, size_t>(it->first + start, end - start));
+                start = end;
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ExtractChunkImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts,
+        _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+        size_t chunkOffset, size_t chunkFaces,
+        _Out_writes_(chunkFaces * 3) index_t* chunkIndices,
+        std::vector<uint32_t>& chunkVerts)
+    {
+        chunkVerts.clear();
+
+        if (!indices || !nFaces || !nVerts || !chunkFaces || !chunkIndices)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        if (chunkOffset >= nFaces || chunkFaces > (nFaces - chunkOffset))
+            return E_INVALIDARG;
+
+        size_t mapSize = HashTableSize(std::min<size_t>(chunkFaces * 3, nVerts));
+        if (!mapSize)
+            return E_OUTOFMEMORY;
+
+        auto vertexMap = make_scratch<vertexMapEntry>(mapSize);
+        if (!vertexMap)
+            return E_OUTOFMEMORY;
+
+        memset(vertexMap.get(), 0xff, sizeof(vertexMapEntry) * mapSize);
+
+        size_t mask = mapSize - 1;
+
+        for (size_t j = 0; j < chunkFaces; ++j)
+        {
+            size_t face = chunkOffset + j;
+            if (faceRemap)
+            {
+                face = faceRemap[face];
+                if (face >= nFaces)
+                    return E_FAIL;
+            }
+
+            for (size_t point = 0; point < 3; ++point)
+            {
+                index_t i = indices[face * 3 + point];
+                if (i == index_t(-1))
+                {
+                    chunkIndices[j * 3 + point] = index_t(-1);
+                    continue;
+                }
+
+                if (i >= nVerts)
+                    return E_UNEXPECTED;
+
+                size_t slot = HashSlot(uint32_t(i), mask);
+                while (vertexMap[slot].vertex != UNUSED32 && vertexMap[slot].vertex != i)
+                {
+                    slot = (slot + 1) & mask;
+                }
+
+                if (vertexMap[slot].vertex == UNUSED32)
+                {
+                    vertexMap[slot].vertex = uint32_t(i);
+                    vertexMap[slot].local = uint32_t(chunkVerts.size());
+                    chunkVerts.push_back(uint32_t(i));
+                }
+
+                chunkIndices[j * 3 + point] = index_t(vertexMap[slot].local);
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT GenerateAdjacencyChunkedImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+        const std::vector<std::pair<size_t, size_t>>& chunks,
+        _Out_writes_(nFaces * 3) uint32_t* adjacency)
+    {
+        if (!indices || !nFaces || !positions || !nVerts || !adjacency)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        size_t maxFaces = MaxChunkFaces(nFaces, chunks);
+        if (!maxFaces)
+            return E_INVALIDARG;
+
+        size_t maxVerts = std::min(maxFaces * 3, nVerts);
+
+        auto chunkIndices = make_scratch<index_t>(maxFaces * 3);
+        auto chunkAdjacency = make_scratch<uint32_t>(maxFaces * 3);
+        auto chunkPositions = make_scratch<XMFLOAT3>(maxVerts);
+        if (!chunkIndices || !chunkAdjacency || !chunkPositions)
+            return E_OUTOFMEMORY;
+
+        memset(adjacency, 0xff, sizeof(uint32_t) * nFaces * 3);
+
+        // Adjacency within each chunk, keeping the edges left open for matching across chunks
+        std::vector<boundaryEdge> edges;
+        std::vector<uint32_t> chunkVerts;
+
+        for (size_t j = 0; j < chunks.size(); ++j)
+        {
+            size_t chunkOffset = chunks[j].first;
+            size_t chunkFaces = chunks[j].second;
+
+            HRESULT hr = ExtractChunkImpl<index_t>(indices, nFaces, nVerts, faceRemap, chunkOffset, chunkFaces,
+                                                   chunkIndices.get(), chunkVerts);
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t k = 0; k < chunkVerts.size(); ++k)
+            {
+                chunkPositions[k] = positions[chunkVerts[k]];
+            }
+
+            hr = GenerateAdjacencyAndPointReps(chunkIndices.get(), chunkFaces, chunkPositions.get(), chunkVerts.size(), 0.f,
+                                               nullptr, chunkAdjacency.get());
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t k = 0; k < chunkFaces; ++k)
+            {
+                uint32_t face = (faceRemap) ? faceRemap[chunkOffset + k] : uint32_t(chunkOffset + k);
+
+                const index_t* local = &chunkIndices[k * 3];
+
+                // unused and degenerate faces have no neighbors
+                bool open = (local[0] != index_t(-1) && local[1] != index_t(-1) && local[2] != index_t(-1));
+                if (open)
+                {
+                    open = !SamePosition(chunkPositions[local[0]], chunkPositions[local[1]])
+                        && !SamePosition(chunkPositions[local[1]], chunkPositions[local[2]])
+                        && !SamePosition(chunkPositions[local[0]], chunkPositions[local[2]]);
+                }
+
+                for (size_t point = 0; point < 3; ++point)
+                {
+                    uint32_t neighbor = chunkAdjacency[k * 3 + point];
+                    if (neighbor != UNUSED32)
+                    {
+                        adjacency[face * 3 + point] = (faceRemap) ? faceRemap[chunkOffset + neighbor] : uint32_t(chunkOffset + neighbor);
+                    }
+                    else if (open)
+                    {
+                        uint32_t v1 = chunkVerts[local[point]];
+                        uint32_t v2 = chunkVerts[local[(point + 1) % 3]];
+
+                        boundaryEdge edge = { face * 3 + uint32_t(point), uint32_t(j), v1, v2,
+                                              EdgeHash(positions[v1], positions[v2]) };
+                        edges.push_back(edge);
+                    }
+                }
+            }
+        }
+
+        if (edges.empty())
+            return S_OK;
+
+        // Stitch each open edge to the first open edge of another chunk running the other way
+        size_t tableSize = HashTableSize(edges.size());
+        if (!tableSize)
+            return E_OUTOFMEMORY;
+
+        auto table = make_scratch<uint32_t>(tableSize);
+        if (!table)
+            return E_OUTOFMEMORY;
+
+        memset(table.get(), 0xff, sizeof(uint32_t) * tableSize);
+
+        size_t mask = tableSize - 1;
+
+        for (size_t j = 0; j < edges.size(); ++j)
+        {
+            size_t slot = HashSlot(edges[j].hash, mask);
+            while (table[slot] != UNUSED32)
+            {
+                slot = (slot + 1) & mask;
+            }
+
+            table[slot] = uint32_t(j);
+        }
+
+        for (size_t j = 0; j < edges.size(); ++j)
+        {
+            boundaryEdge& edge = edges[j];
+            if (edge.chunk == UNUSED32)
+                continue;
+
+            uint32_t face = edge.corner / 3;
+            const XMFLOAT3& p1 = positions[edge.v1];
+            const XMFLOAT3& p2 = positions[edge.v2];
+
+            uint32_t hash = EdgeHash(p2, p1);
+
+            for (size_t slot = HashSlot(hash, mask); table[slot] != UNUSED32; slot = (slot + 1) & mask)
+            {
+                boundaryEdge& other = edges[table[slot]];
+                if (other.hash != hash
+                    || other.chunk == UNUSED32
+                    || other.chunk == edge.chunk
+                    || !SamePosition(positions[other.v1], p2)
+                    || !SamePosition(positions[other.v2], p1))
+                    continue;
+
+                // as in GenerateAdjacencyAndPointReps, two faces are only linked through one edge
+                uint32_t otherFace = other.corner / 3;
+
+                bool linked = false;
+                for (uint32_t point = 0; point < 3; ++point)
+                {
+                    if (adjacency[face * 3 + point] == otherFace || adjacency[otherFace * 3 + point] == face)
+                    {
+                        linked = true;
+                        break;
+                    }
+                }
+
+                if (linked)
+                    continue;
+
+                adjacency[edge.corner] = otherFace;
+                adjacency[other.corner] = face;
+
+                edge.chunk = other.chunk = UNUSED32;
+                break;
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeNormalsChunkedImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_opt_(nFaces) const uint32_t* faceRemap,
+        const std::vector<std::pair<size_t, size_t>>& chunks,
+        DWORD flags,
+        _Inout_updates_all_(nVerts) XMFLOAT3* normals)
+    {
+        if (!indices || !nFaces || !positions || !nVerts || !normals)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        size_t maxFaces = MaxChunkFaces(nFaces, chunks);
+        if (!maxFaces)
+            return E_INVALIDARG;
+
+        size_t maxVerts = std::min(maxFaces * 3, nVerts);
+
+        auto chunkIndices = make_scratch<index_t>(maxFaces * 3);
+        auto chunkPositions = make_scratch<XMFLOAT3>(maxVerts);
+        auto chunkNormals = make_scratch<XMFLOAT3>(maxVerts);
+        if (!chunkIndices || !chunkPositions || !chunkNormals)
+            return E_OUTOFMEMORY;
+
+        bool accumulate = (flags & CNORM_ACCUMULATE) ? true : false;
+        if (!accumulate)
+        {
+            memset(normals, 0, sizeof(XMFLOAT3) * nVerts);
+        }
+
+        // The weighted face normal sums of each chunk add up to those of the whole mesh
+        std::vector<uint32_t> chunkVerts;
+
+        for (size_t j = 0; j < chunks.size(); ++j)
+        {
+            HRESULT hr = ExtractChunkImpl<index_t>(indices, nFaces, nVerts, faceRemap, chunks[j].first, chunks[j].second,
+                                                   chunkIndices.get(), chunkVerts);
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t k = 0; k < chunkVerts.size(); ++k)
+            {
+                chunkPositions[k] = positions[chunkVerts[k]];
+            }
+
+            memset(chunkNormals.get(), 0, sizeof(XMFLOAT3) * chunkVerts.size());
+
+            hr = ComputeNormals(chunkIndices.get(), chunks[j].second, chunkPositions.get(), chunkVerts.size(),
+                                flags | CNORM_ACCUMULATE, chunkNormals.get());
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t k = 0; k < chunkVerts.size(); ++k)
+            {
+                XMFLOAT3& n = normals[chunkVerts[k]];
+                XMStoreFloat3(&n, XMVectorAdd(XMLoadFloat3(&n), XMLoadFloat3(&chunkNormals[k])));
+            }
+        }
+
+        // The sums already carry the winding, so normalizing them gives what ComputeNormals stores
+        if (!accumulate)
+        {
+            for (size_t vert = 0; vert < nVerts; ++vert)
+            {
+                XMStoreFloat3(&normals[vert], XMVector3Normalize(XMLoadFloat3(&normals[vert])));
+            }
+        }
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizePartition(size_t nFaces, size_t nVerts)
+{
+    size_t counts = ScratchBytes<uint32_t>((size_t(1) << (MortonBits(nFaces) * 3)) + 1);
+    size_t extract = ScratchBytes<vertexMapEntry>(HashTableSize(std::min<size_t>(nFaces * 3, nVerts)));
+    return std::max(counts, extract);
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::PartitionMesh(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* attributes, size_t maxChunkFaces,
+    uint32_t* faceRemap,
+    std::vector<std::pair<size_t, size_t>>& chunks)
+{
+    stage_stats stats("PartitionMesh", nFaces, nVerts);
+
+    return PartitionMeshImpl<uint16_t>(indices, nFaces, positions, nVerts, attributes, maxChunkFaces, faceRemap, chunks);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::PartitionMesh(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* attributes, size_t maxChunkFaces,
+    uint32_t* faceRemap,
+    std::vector<std::pair<size_t, size_t>>& chunks)
+{
+    stage_stats stats("PartitionMesh", nFaces, nVerts);
+
+    return PartitionMeshImpl<uint32_t>(indices, nFaces, positions, nVerts, attributes, maxChunkFaces, faceRemap, chunks);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ExtractChunk(
+    const uint16_t* indices, size_t nFaces, size_t nVerts,
+    const uint32_t* faceRemap,
+    size_t chunkOffset, size_t chunkFaces,
+    uint16_t* chunkIndices,
+    std::vector<uint32_t>& chunkVerts)
+{
+    return ExtractChunkImpl<uint16_t>(indices, nFaces, nVerts, faceRemap, chunkOffset, chunkFaces, chunkIndices, chunkVerts);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ExtractChunk(
+    const uint32_t* indices, size_t nFaces, size_t nVerts,
+    const uint32_t* faceRemap,
+    size_t chunkOffset, size_t chunkFaces,
+    uint32_t* chunkIndices,
+    std::vector<uint32_t>& chunkVerts)
+{
+    return ExtractChunkImpl<uint32_t>(indices, nFaces, nVerts, faceRemap, chunkOffset, chunkFaces, chunkIndices, chunkVerts);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::GenerateAdjacencyChunked(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* faceRemap,
+    const std::vector<std::pair<size_t, size_t>>& chunks,
+    uint32_t* adjacency)
+{
+    stage_stats stats("GenerateAdjacencyChunked", nFaces, nVerts);
+
+    return GenerateAdjacencyChunkedImpl<uint16_t>(indices, nFaces, positions, nVerts, faceRemap, chunks, adjacency);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::GenerateAdjacencyChunked(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* faceRemap,
+    const std::vector<std::pair<size_t, size_t>>& chunks,
+    uint32_t* adjacency)
+{
+    stage_stats stats("GenerateAdjacencyChunked", nFaces, nVerts);
+
+    return GenerateAdjacencyChunkedImpl<uint32_t>(indices, nFaces, positions, nVerts, faceRemap, chunks, adjacency);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeNormalsChunked(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* faceRemap,
+    const std::vector<std::pair<size_t, size_t>>& chunks,
+    DWORD flags,
+    XMFLOAT3* normals)
+{
+    stage_stats stats("ComputeNormalsChunked", nFaces, nVerts);
+
+    return ComputeNormalsChunkedImpl<uint16_t>(indices, nFaces, positions, nVerts, faceRemap, chunks, flags, normals);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeNormalsChunked(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* faceRemap,
+    const std::vector<std::pair<size_t, size_t>>& chunks,
+    DWORD flags,
+    XMFLOAT3* normals)
+{
+    stage_stats stats("ComputeNormalsChunked", nFaces, nVerts);
+
+    return ComputeNormalsChunkedImpl<uint32_t>(indices, nFaces, positions, nVerts, faceRemap, chunks, flags, normals);
+}
@@ -0,0 +1,677 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshQuantize.cpp
+//
+// DirectX Mesh Geometry Library - Vertex quantization
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    //---------------------------------------------------------------------------------
+    // Candidate formats
+    //---------------------------------------------------------------------------------
+
+    struct QuantizeCandidate
+    {
+        DXGI_FORMAT         format;
+        QUANTIZE_ENCODING   encoding;
+        float               scale;
+        float               bias;
+            // Fixed dequantization of the used components, ignored when taken from the data bounds
+        bool                fromBounds;
+    };
+
+    // Each list is ordered by size, and by precision within a size, ending with the lossless format. A less precise
+    // format of the same size is only listed when the flags can rule out the one before it
+    const QuantizeCandidate s_range1[] =
+    {
+        { DXGI_FORMAT_R8_UNORM,             QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16_UNORM,            QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16_FLOAT,            QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32_FLOAT,            QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    const QuantizeCandidate s_range2[] =
+    {
+        { DXGI_FORMAT_R8G8_UNORM,           QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16_UNORM,         QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16_FLOAT,         QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32G32_FLOAT,         QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    const QuantizeCandidate s_range3[] =
+    {
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32G32B32_FLOAT,      QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    const QuantizeCandidate s_range4[] =
+    {
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, true },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    const QuantizeCandidate s_unit3[] =
+    {
+        { DXGI_FORMAT_R8G8_SNORM,           QUANTIZE_ENCODE_OCTAHEDRAL, 1.f, 0.f, false },
+        { DXGI_FORMAT_R16G16_SNORM,         QUANTIZE_ENCODE_OCTAHEDRAL, 1.f, 0.f, false },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    QUANTIZE_ENCODE_LINEAR, 2.f, -1.f, false },
+        { DXGI_FORMAT_R8G8B8A8_SNORM,       QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R16G16B16A16_SNORM,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32G32B32_FLOAT,      QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    // The handedness sign in w needs an exact +1 or -1, which rules out octahedral encoding
+    const QuantizeCandidate s_unit4[] =
+    {
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    QUANTIZE_ENCODE_LINEAR, 2.f, -1.f, false },
+        { DXGI_FORMAT_R8G8B8A8_SNORM,       QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R16G16B16A16_SNORM,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   QUANTIZE_ENCODE_LINEAR, 1.f, 0.f, false },
+    };
+
+    inline bool IsFloatFormat(DXGI_FORMAT fmt)
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R32G32_FLOAT:
+        case DXGI_FORMAT_R16G16_FLOAT:
+        case DXGI_FORMAT_R32_FLOAT:
+        case DXGI_FORMAT_R16_FLOAT:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    // Number of components of the float and normalized formats that can be re-quantized, or 0 to keep the format
+    size_t QuantizableComponents(DXGI_FORMAT fmt)
+    {
+        switch (static_cast<int>(fmt))
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_SNORM:
+            return 4;
+
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return 3;
+
+        case DXGI_FORMAT_R32G32_FLOAT:
+        case DXGI_FORMAT_R16G16_FLOAT:
+        case DXGI_FORMAT_R16G16_UNORM:
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R8G8_UNORM:
+        case DXGI_FORMAT_R8G8_SNORM:
+            return 2;
+
+        case DXGI_FORMAT_R32_FLOAT:
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R16_UNORM:
+        case DXGI_FORMAT_R16_SNORM:
+        case DXGI_FORMAT_R8_UNORM:
+        case DXGI_FORMAT_R8_SNORM:
+            return 1;
+
+        default:
+            return 0;
+        }
+    }
+
+    // Resolution of the SNORM formats used for octahedral encoding
+    inline float OctahedralGrid(DXGI_FORMAT fmt)
+    {
+        switch (fmt)
+        {
+        case DXGI_FORMAT_R8G8_SNORM:    return 127.f;
+        case DXGI_FORMAT_R16G16_SNORM:  return 32767.f;
+        default:                        return 0.f;
+        }
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Octahedral encoding
+    //---------------------------------------------------------------------------------
+
+    // Folding the lower hemisphere over the diagonals is its own inverse on the square
+    inline void Fold(float& x, float& y)
+    {
+        float fx = (1.f - fabsf(y)) * ((x >= 0.f) ? 1.f : -1.f);
+        float fy = (1.f - fabsf(x)) * ((y >= 0.f) ? 1.f : -1.f);
+        x = fx;
+        y = fy;
+    }
+
+    inline XMVECTOR XM_CALLCONV EncodeOctahedral(FXMVECTOR v)
+    {
+        XMFLOAT3 n;
+        XMStoreFloat3(&n, v);
+
+        float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+        if (l1 <= 0.f)
+            return XMVectorZero();
+
+        float x = n.x / l1;
+        float y = n.y / l1;
+        if (n.z < 0.f)
+        {
+            Fold(x, y);
+        }
+
+        return XMVectorSet(x, y, 0.f, 0.f);
+    }
+
+    inline XMVECTOR XM_CALLCONV DecodeOctahedral(FXMVECTOR e)
+    {
+        float x = XMVectorGetX(e);
+        float y = XMVectorGetY(e);
+        float z = 1.f - fabsf(x) - fabsf(y);
+        if (z < 0.f)
+        {
+            Fold(x, y);
+        }
+
+        return XMVector3Normalize(XMVectorSet(x, y, z, 0.f));
+    }
+
+    // Rounds the encoding to the neighboring grid point that decodes closest to v, which is often not the nearest one
+    XMVECTOR XM_CALLCONV SnapOctahedral(FXMVECTOR v, FXMVECTOR e, float grid)
+    {
+        XMVECTOR n = XMVector3Normalize(v);
+
+        float bx = floorf(XMVectorGetX(e) * grid);
+        float by = floorf(XMVectorGetY(e) * grid);
+
+        XMVECTOR best = e;
+        float bestDot = -FLT_MAX;
+        for (int j = 0; j < 4; ++j)
+        {
+            float x = std::min(std::max(bx + float(j & 1), -grid), grid) / grid;
+            float y = std::min(std::max(by + float(j >> 1), -grid), grid) / grid;
+
+            XMVECTOR c = XMVectorSet(x, y, 0.f, 0.f);
+            float d = XMVectorGetX(XMVector3Dot(DecodeOctahedral(c), n));
+            if (d > bestDot)
+            {
+                bestDot = d;
+                best = c;
+            }
+        }
+
+        return best;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Error measurement
+    //---------------------------------------------------------------------------------
+
+    // Writes the quantized values in the given format and reads them back as the GPU would see them
+    HRESULT RoundTrip(
+        _In_reads_(nVerts) const XMVECTOR* quantized, size_t nVerts, DXGI_FORMAT format,
+        _Out_writes_bytes_(nVerts * BytesPerElement(format)) uint8_t* temp,
+        _Out_writes_(nVerts) XMVECTOR* result)
+    {
+        const D3D11_INPUT_ELEMENT_DESC desc = { "QUANTIZED", 0, format, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+
+        VBWriter writer;
+        HRESULT hr = writer.Initialize(&desc, 1);
+        if (FAILED(hr))
+            return hr;
+
+        hr = writer.AddStream(temp, nVerts, 0);
+        if (FAILED(hr))
+            return hr;
+
+        hr = writer.Write(quantized, "QUANTIZED", 0, nVerts);
+        if (FAILED(hr))
+            return hr;
+
+        VBReader reader;
+        hr = reader.Initialize(&desc, 1);
+        if (FAILED(hr))
+            return hr;
+
+        hr = reader.AddStream(temp, nVerts, 0);
+        if (FAILED(hr))
+            return hr;
+
+        return reader.Read(result, "QUANTIZED", 0, nVerts);
+    }
+
+    float MeasureError(
+        _In_reads_(nVerts) const XMVECTOR* data, _In_reads_(nVerts) const XMVECTOR* decoded, size_t nVerts,
+        size_t nComponents, QUANTIZE_DATA type)
+    {
+        float maxError = 0.f;
+
+        if (type == QUANTIZE_DATA_UNIT_VECTOR)
+        {
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                XMVECTOR a = data[j];
+                XMVECTOR b = decoded[j];
+
+                // Degenerate vectors have no direction to preserve
+                if (XMVectorGetX(XMVector3LengthSq(a)) < 1e-12f)
+                    continue;
+
+                if (nComponents > 3 && ((XMVectorGetW(a) < 0.f) != (XMVectorGetW(b) < 0.f)))
+                    return XM_PI;
+
+                // More accurate than acos for the small angles being compared
+                float s = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+                float c = XMVectorGetX(XMVector3Dot(a, b));
+                float angle = atan2f(s, c);
+
+                // Comparisons with NaN fail, so report it as the largest error
+                if (!(angle <= maxError))
+                    maxError = (angle > maxError) ? angle : FLT_MAX;
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                XMFLOAT4A a, b;
+                XMStoreFloat4A(&a, data[j]);
+                XMStoreFloat4A(&b, decoded[j]);
+
+                const float* pa = &a.x;
+                const float* pb = &b.x;
+                for (size_t c = 0; c < nComponents; ++c)
+                {
+                    float err = fabsf(pa[c] - pb[c]);
+                    if (!(err <= maxError))
+                        maxError = (err > maxError) ? err : FLT_MAX;
+                }
+            }
+        }
+
+        return maxError;
+    }
+
+    VertexQuantization MakeQuantization(
+        const QuantizeCandidate& candidate, size_t nComponents, DWORD flags,
+        const XMFLOAT4& boundsMin, const XMFLOAT4& boundsMax)
+    {
+        VertexQuantization q = {};
+        q.format = candidate.format;
+        q.encoding = candidate.encoding;
+
+        float* scale = &q.scale.x;
+        float* bias = &q.bias.x;
+        const float* pmin = &boundsMin.x;
+        const float* pmax = &boundsMax.x;
+
+        size_t used = (candidate.encoding == QUANTIZE_ENCODE_OCTAHEDRAL) ? 3 : nComponents;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            if (c >= used)
+            {
+                scale[c] = 0.f;
+                bias[c] = (c == 3) ? 1.f : 0.f;
+            }
+            else if (candidate.fromBounds && !(flags & QUANTIZE_NO_SCALE_BIAS))
+            {
+                scale[c] = pmax[c] - pmin[c];
+                bias[c] = pmin[c];
+            }
+            else
+            {
+                scale[c] = candidate.scale;
+                bias[c] = candidate.bias;
+            }
+        }
+
+        return q;
+    }
+
+    bool IsAllowed(const QuantizeCandidate& candidate, DWORD flags)
+    {
+        if ((flags & QUANTIZE_FLOAT_ONLY) && !IsFloatFormat(candidate.format))
+            return false;
+
+        if (candidate.encoding == QUANTIZE_ENCODE_OCTAHEDRAL)
+            return !(flags & (QUANTIZE_NO_OCTAHEDRAL | QUANTIZE_NO_SCALE_BIAS));
+
+        if ((flags & QUANTIZE_NO_SCALE_BIAS) && !candidate.fromBounds)
+            return (candidate.scale == 1.f && candidate.bias == 0.f);
+
+        return true;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class desc_t>
+    HRESULT ComputeQuantizedLayoutImpl(
+        _In_reads_(nDecl) const desc_t* vbDecl, size_t nDecl,
+        const VBReader& reader, size_t nVerts,
+        float positionTolerance, float normalTolerance, float texcoordTolerance,
+        DWORD flags,
+        _Out_writes_(nDecl) desc_t* quantizedDecl,
+        _Out_writes_(nDecl) VertexQuantization* quantization)
+    {
+        if (!vbDecl || !nDecl || !nVerts || !quantizedDecl || !quantization)
+            return E_INVALIDARG;
+
+        if (nVerts >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        auto data = make_scratch<XMVECTOR>(nVerts);
+        if (!data)
+            return E_OUTOFMEMORY;
+
+        for (size_t j = 0; j < nDecl; ++j)
+        {
+            const desc_t& desc = vbDecl[j];
+
+            quantizedDecl[j] = desc;
+            quantizedDecl[j].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+            VertexQuantization& q = quantization[j];
+            memset(&q, 0, sizeof(VertexQuantization));
+            q.format = desc.Format;
+            q.encoding = QUANTIZE_ENCODE_LINEAR;
+            q.scale = XMFLOAT4(1.f, 1.f, 1.f, 1.f);
+
+            size_t nComponents = QuantizableComponents(desc.Format);
+            if (!nComponents || !desc.SemanticName)
+                continue;
+
+            QUANTIZE_DATA type;
+            float tolerance;
+            if (!_stricmp(desc.SemanticName, "SV_Position") || !_stricmp(desc.SemanticName, "POSITION"))
+            {
+                type = QUANTIZE_DATA_RANGE;
+                tolerance = positionTolerance;
+            }
+            else if (!_stricmp(desc.SemanticName, "NORMAL")
+                     || !_stricmp(desc.SemanticName, "TANGENT")
+                     || !_stricmp(desc.SemanticName, "BINORMAL"))
+            {
+                if (nComponents < 3)
+                    continue;
+
+                type = QUANTIZE_DATA_UNIT_VECTOR;
+                tolerance = normalTolerance;
+            }
+            else if (!_stricmp(desc.SemanticName, "TEXCOORD"))
+            {
+                type = QUANTIZE_DATA_RANGE;
+                tolerance = texcoordTolerance;
+            }
+            else
+            {
+                continue;
+            }
+
+            if (tolerance < 0.f)
+                continue;
+
+            HRESULT hr = reader.Read(data.get(), desc.SemanticName, desc.SemanticIndex, nVerts);
+            if (FAILED(hr))
+                return hr;
+
+            hr = ComputeQuantization(data.get(), nVerts, nComponents, type, tolerance, flags, q);
+            if (FAILED(hr))
+                return hr;
+
+            quantizedDecl[j].Format = q.format;
+        }
+
+        return S_OK;
+    }
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeQuantization(
+    const XMVECTOR* data, size_t nVerts, size_t nComponents,
+    QUANTIZE_DATA type, float tolerance, DWORD flags,
+    VertexQuantization& result)
+{
+    if (!data || !nVerts || !nComponents || nComponents > 4 || !(tolerance >= 0.f))
+        return E_INVALIDARG;
+
+    if (nVerts >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    const QuantizeCandidate* candidates;
+    size_t nCandidates;
+    switch (type)
+    {
+    case QUANTIZE_DATA_RANGE:
+        switch (nComponents)
+        {
+        case 1:     candidates = s_range1; nCandidates = _countof(s_range1); break;
+        case 2:     candidates = s_range2; nCandidates = _countof(s_range2); break;
+        case 3:     candidates = s_range3; nCandidates = _countof(s_range3); break;
+        default:    candidates = s_range4; nCandidates = _countof(s_range4); break;
+        }
+        break;
+
+    case QUANTIZE_DATA_UNIT_VECTOR:
+        if (nComponents < 3)
+            return E_INVALIDARG;
+
+        if (nComponents == 3)
+        {
+            candidates = s_unit3;
+            nCandidates = _countof(s_unit3);
+        }
+        else
+        {
+            candidates = s_unit4;
+            nCandidates = _countof(s_unit4);
+        }
+        break;
+
+    default:
+        return E_INVALIDARG;
+    }
+
+    // Bounds of the data for the range formats
+    XMVECTOR vmin = g_XMFltMax;
+    XMVECTOR vmax = XMVectorNegate(g_XMFltMax);
+    for (size_t j = 0; j < nVerts; ++j)
+    {
+        vmin = XMVectorMin(vmin, data[j]);
+        vmax = XMVectorMax(vmax, data[j]);
+    }
+
+    XMFLOAT4 boundsMin, boundsMax;
+    XMStoreFloat4(&boundsMin, vmin);
+    XMStoreFloat4(&boundsMax, vmax);
+
+    auto quantized = make_scratch<XMVECTOR>(nVerts * 2);
+    auto temp = make_scratch<uint8_t>(nVerts * sizeof(XMFLOAT4));
+    if (!quantized || !temp)
+        return E_OUTOFMEMORY;
+
+    XMVECTOR* decoded = quantized.get() + nVerts;
+
+    for (size_t j = 0; j < nCandidates; ++j)
+    {
+        const QuantizeCandidate& candidate = candidates[j];
+
+        bool last = (j + 1) >= nCandidates;
+        if (!last && !IsAllowed(candidate, flags))
+            continue;
+
+        VertexQuantization q = MakeQuantization(candidate, nComponents, flags, boundsMin, boundsMax);
+
+        HRESULT hr = QuantizeVertices(data, nVerts, q, quantized.get());
+        if (FAILED(hr))
+            return hr;
+
+        hr = RoundTrip(quantized.get(), nVerts, q.format, temp.get(), decoded);
+        if (FAILED(hr))
+            return hr;
+
+        hr = DequantizeVertices(decoded, nVerts, q, decoded);
+        if (FAILED(hr))
+            return hr;
+
+        q.maxError = MeasureError(data, decoded, nVerts, nComponents, type);
+
+        if (q.maxError <= tolerance || last)
+        {
+            result = q;
+            return S_OK;
+        }
+    }
+
+    return E_FAIL;
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::QuantizeVertices(
+    const XMVECTOR* data, size_t nVerts,
+    const VertexQuantization& quantization,
+    XMVECTOR* quantized)
+{
+    if (!data || !nVerts || !quantized)
+        return E_INVALIDARG;
+
+    switch (quantization.encoding)
+    {
+    case QUANTIZE_ENCODE_LINEAR:
+        {
+            XMVECTOR scale = XMLoadFloat4(&quantization.scale);
+            XMVECTOR bias = XMLoadFloat4(&quantization.bias);
+
+            // Unused and constant components have no scale, so they are stored as zero
+            XMVECTOR invScale = XMVectorSelect(XMVectorReciprocal(scale), XMVectorZero(), XMVectorEqual(scale, XMVectorZero()));
+
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                quantized[j] = XMVectorMultiply(XMVectorSubtract(data[j], bias), invScale);
+            }
+        }
+        break;
+
+    case QUANTIZE_ENCODE_OCTAHEDRAL:
+        {
+            float grid = OctahedralGrid(quantization.format);
+
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                XMVECTOR e = EncodeOctahedral(data[j]);
+                quantized[j] = (grid > 0.f) ? SnapOctahedral(data[j], e, grid) : e;
+            }
+        }
+        break;
+
+    default:
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::DequantizeVertices(
+    const XMVECTOR* quantized, size_t nVerts,
+    const VertexQuantization& quantization,
+    XMVECTOR* data)
+{
+    if (!quantized || !nVerts || !data)
+        return E_INVALIDARG;
+
+    switch (quantization.encoding)
+    {
+    case QUANTIZE_ENCODE_LINEAR:
+        {
+            XMVECTOR scale = XMLoadFloat4(&quantization.scale);
+            XMVECTOR bias = XMLoadFloat4(&quantization.bias);
+
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                data[j] = XMVectorMultiplyAdd(quantized[j], scale, bias);
+            }
+        }
+        break;
+
+    case QUANTIZE_ENCODE_OCTAHEDRAL:
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            data[j] = XMVectorSelect(g_XMIdentityR3, DecodeOctahedral(quantized[j]), g_XMSelect1110);
+        }
+        break;
+
+    default:
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+#if defined(__d3d11_h__) || defined(__d3d11_x_h__)
+_Use_decl_annotations_
+HRESULT DirectX::ComputeQuantizedLayout(
+    const D3D11_INPUT_ELEMENT_DESC* vbDecl, size_t nDecl,
+    const VBReader& reader, size_t nVerts,
+    float positionTolerance, float normalTolerance, float texcoordTolerance,
+    DWORD flags,
+    D3D11_INPUT_ELEMENT_DESC* quantizedDecl,
+    VertexQuantization* quantization)
+{
+    return ComputeQuantizedLayoutImpl<D3D11_INPUT_ELEMENT_DESC>(vbDecl, nDecl, reader, nVerts,
+        positionTolerance, normalTolerance, texcoordTolerance, flags, quantizedDecl, quantization);
+}
+#endif
+
+#if defined(__d3d12_h__) || defined(__d3d12_x_h__)
+static_assert(D3D11_APPEND_ALIGNED_ELEMENT == D3D12_APPEND_ALIGNED_ELEMENT, "D3D12 mismatch");
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeQuantizedLayout(
+    const D3D12_INPUT_LAYOUT_DESC& vbDecl,
+    const VBReader& reader, size_t nVerts,
+    float positionTolerance, float normalTolerance, float texcoordTolerance,
+    DWORD flags,
+    D3D12_INPUT_ELEMENT_DESC* quantizedDecl,
+    VertexQuantization* quantization)
+{
+    return ComputeQuantizedLayoutImpl<D3D12_INPUT_ELEMENT_DESC>(vbDecl.pInputElementDescs, vbDecl.NumElements, reader, nVerts,
+        positionTolerance, normalTolerance, texcoordTolerance, flags, quantizedDecl, quantization);
+}
+#endif
@@ -19,6 +19,66 @@ using namespace DirectX;
 
 namespace
 {
+    //---------------------------------------------------------------------------------
+    // Parallel support
+    //---------------------------------------------------------------------------------
+
+    // Smaller buffers are always remapped serially
+    const size_t c_MinParallelFaces = 16384;
+    const size_t c_MinParallelVerts = 16384;
+
+    inline bool UseParallel(size_t count, size_t minParallel)
+    {
+#ifdef _OPENMP
+        return (count >= minParallel && omp_get_max_threads() > 1);
+#else
+        UNREFERENCED_PARAMETER(count);
+        UNREFERENCED_PARAMETER(minParallel);
+        return false;
+#endif
+    }
+
+    //---------------------------------------------------------------------------------
+    // Runs process over [0, count) in contiguous blocks, one per thread for large
+    // counts, and returns the failure of the first failing block, which is the same
+    // result as the serial loop. Each element must be independent of the others.
+    template<class Fn>
+    HRESULT ProcessBlocks(size_t count, size_t minParallel, Fn process)
+    {
+#ifdef _OPENMP
+        if (UseParallel(count, minParallel))
+        {
+            auto nBlocks = uint32_t(omp_get_max_threads());
+
+            size_t blockSize = (count + nBlocks - 1) / nBlocks;
+
+            std::vector<HRESULT> results(nBlocks, S_OK);
+
+            #pragma omp parallel for
+            for (int block = 0; block < int(nBlocks); ++block)
+            {
+                size_t begin = std::min(count, size_t(block) * blockSize);
+                size_t end = std::min(count, begin + blockSize);
+
+                results[size_t(block)] = process(begin, end);
+            }
+
+            for (auto it = results.cbegin(); it != results.cend(); ++it)
+            {
+                if (FAILED(*it))
+                    return *it;
+            }
+
+            return S_OK;
+        }
+#else
+        UNREFERENCED_PARAMETER(minParallel);
+#endif
+
+        return process(size_t(0), count);
+    }
+
+
     //---------------------------------------------------------------------------------
 #pragma warning(push)
 #pragma warning( disable : 6101 )
@@ -37,31 +97,35 @@ namespace
         assert((!adjin && !adjout) || ((adjin && adjout) && adjin != adjout));
         _Analysis_assume_((!adjin && !adjout) || ((adjin && adjout) && adjin != adjout));
 
-        for (size_t j = 0; j < nFaces; ++j)
+        // Gathers into the output in order, so large buffers are split between threads
+        return ProcessBlocks(nFaces, c_MinParallelFaces, [=](size_t begin, size_t end) -> HRESULT
         {
-            uint32_t src = faceRemap[j];
-
-            if (src == UNUSED32)
-                continue;
-
-            if (src < nFaces)
+            for (size_t j = begin; j < end; ++j)
             {
-                ibout[j * 3] = ibin[src * 3];
-                ibout[j * 3 + 1] = ibin[src * 3 + 1];
-                ibout[j * 3 + 2] = ibin[src * 3 + 2];
+                uint32_t src = faceRemap[j];
+
+                if (src == UNUSED32)
+                    continue;
 
-                if (adjin && adjout)
+                if (src < nFaces)
                 {
-                    adjout[j * 3] = adjin[src * 3];
-                    adjout[j * 3 + 1] = adjin[src * 3 + 1];
-                    adjout[j * 3 + 2] = adjin[src * 3 + 2];
+                    ibout[j * 3] = ibin[src * 3];
+                    ibout[j * 3 + 1] = ibin[src * 3 + 1];
+                    ibout[j * 3 + 2] = ibin[src * 3 + 2];
+
+                    if (adjin && adjout)
+                    {
+                        adjout[j * 3] = adjin[src * 3];
+                        adjout[j * 3 + 1] = adjin[src * 3 + 1];
+                        adjout[j * 3 + 2] = adjin[src * 3 + 2];
+                    }
                 }
+                else
+                    return E_FAIL;
             }
-            else
-                return E_FAIL;
-        }
 
-        return S_OK;
+            return S_OK;
+        });
     }
 
 #pragma warning(pop)
@@ -77,7 +141,7 @@ namespace
         assert(ib != 0 && faceRemap != 0);
         _Analysis_assume_(ib != 0 && faceRemap != 0);
 
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[(sizeof(bool) + sizeof(uint32_t)) * nFaces]);
+        auto temp = make_scratch<uint8_t>((sizeof(bool) + sizeof(uint32_t)) * nFaces);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -162,7 +226,7 @@ namespace
         if (stride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
             return E_INVALIDARG;
 
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[(sizeof(bool) * nVerts) + stride]);
+        auto temp = make_scratch<uint8_t>((sizeof(bool) * nVerts) + stride);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -245,6 +309,275 @@ namespace
     }
 
 
+    //---------------------------------------------------------------------------------
+    // Used by FINALIZE_CYCLES: the cycles of the remap are found first, walking them
+    // exactly as SwapVertices does, and then each is rotated with one write per vertex.
+    // Cycles touch disjoint vertices, so they can be rotated concurrently.
+    //---------------------------------------------------------------------------------
+    const uint8_t c_VertexUntouched = 0;
+    const uint8_t c_VertexMoved = 1;
+    const uint8_t c_VertexCycleStart = 2;
+
+    void RotateCycle(
+        _Inout_ uint8_t* ptr, size_t stride,
+        _In_ const uint32_t* vertexRemap, uint32_t start, uint32_t length,
+        _Out_writes_bytes_(stride * 2) uint8_t* vbtemp)
+    {
+        uint8_t* carry = vbtemp;
+        uint8_t* save = vbtemp + stride;
+
+        memcpy(carry, ptr + start * stride, stride);
+
+        uint32_t dest = vertexRemap[start];
+        for (uint32_t k = 0; k < length; ++k)
+        {
+            memcpy(save, ptr + dest * stride, stride);
+            memcpy(ptr + dest * stride, carry, stride);
+            std::swap(carry, save);
+
+            dest = vertexRemap[dest];
+        }
+
+        memcpy(ptr + start * stride, carry, stride);
+    }
+
+    HRESULT RotateVertexCycles(
+        _Inout_updates_bytes_all_(nVerts*stride) void* vb, size_t stride, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* vertexRemap)
+    {
+        if (!vb || !stride || !nVerts || !vertexRemap)
+            return E_INVALIDARG;
+
+        if (stride > D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES)
+            return E_INVALIDARG;
+
+        // each cycle takes at least two vertices, so a start and length pair per cycle fits in nVerts
+        auto temp = make_scratch<uint8_t>((sizeof(uint32_t) + sizeof(uint8_t)) * nVerts);
+        if (!temp)
+            return E_OUTOFMEMORY;
+
+        auto cycles = reinterpret_cast<uint32_t*>(temp.get());
+        auto state = temp.get() + sizeof(uint32_t) * nVerts;
+        memset(state, c_VertexUntouched, nVerts);
+
+        size_t nCycles = 0;
+        bool overlap = false;
+
+        for (uint32_t j = 0; j < nVerts && !overlap; ++j)
+        {
+            if (state[j] != c_VertexUntouched)
+                continue;
+
+            uint32_t dest = vertexRemap[j];
+
+            if (dest == UNUSED32)
+                continue;
+
+            if (dest >= nVerts)
+                return E_UNEXPECTED;
+
+            state[j] = c_VertexCycleStart;
+
+            if (dest != j && state[dest] != c_VertexUntouched)
+            {
+                overlap = true;
+                break;
+            }
+
+            uint32_t length = 0;
+
+            while (dest != j)
+            {
+                state[dest] = c_VertexMoved;
+                ++length;
+
+                dest = vertexRemap[dest];
+
+                if (dest == UNUSED32)
+                    break;
+
+                if (dest >= nVerts)
+                    return E_FAIL;
+
+                if (state[dest] == c_VertexMoved)
+                    break;
+
+                if (dest != j && state[dest] == c_VertexCycleStart)
+                {
+                    overlap = true;
+                    break;
+                }
+            }
+
+            if (length > 0)
+            {
+                cycles[nCycles * 2] = j;
+                cycles[nCycles * 2 + 1] = length;
+                ++nCycles;
+            }
+        }
+
+        if (overlap)
+        {
+            // not a permutation, so the result depends on the order of the swaps
+            temp.reset();
+            return SwapVertices(vb, stride, nVerts, nullptr, vertexRemap);
+        }
+
+        auto ptr = reinterpret_cast<uint8_t*>(vb);
+
+#ifdef _OPENMP
+        if (nCycles > 1 && UseParallel(nVerts, c_MinParallelVerts))
+        {
+            auto nThreads = size_t(omp_get_max_threads());
+
+            auto vbtemp = make_scratch<uint8_t>(stride * 2 * nThreads);
+            if (!vbtemp)
+                return E_OUTOFMEMORY;
+
+            #pragma omp parallel for schedule(dynamic, 256)
+            for (int c = 0; c < int(nCycles); ++c)
+            {
+                uint8_t* threadTemp = vbtemp.get() + stride * 2 * size_t(omp_get_thread_num());
+
+                RotateCycle(ptr, stride, vertexRemap, cycles[c * 2], cycles[c * 2 + 1], threadTemp);
+            }
+
+            return S_OK;
+        }
+#endif
+
+        auto vbtemp = make_scratch<uint8_t>(stride * 2);
+        if (!vbtemp)
+            return E_OUTOFMEMORY;
+
+        for (size_t c = 0; c < nCycles; ++c)
+        {
+            RotateCycle(ptr, stride, vertexRemap, cycles[c * 2], cycles[c * 2 + 1], vbtemp.get());
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Out-of-place vertex remaps are applied as a gather through the inverse remap, so
+    // the output is written in order: one contiguous range per thread, optionally with
+    // non-temporal stores.
+    //---------------------------------------------------------------------------------
+    inline void CopyVertex(
+        _Out_writes_bytes_(stride) uint8_t* dest, _In_reads_bytes_(stride) const uint8_t* src, size_t stride,
+        bool streaming)
+    {
+#if defined(_XM_SSE_INTRINSICS_)
+        if (streaming)
+        {
+            if (!(stride & 15) && !(reinterpret_cast<uintptr_t>(dest) & 15))
+            {
+                for (size_t i = 0; i < stride; i += 16)
+                {
+                    _mm_stream_si128(reinterpret_cast<__m128i*>(dest + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+                }
+                return;
+            }
+
+            if (!(stride & 3) && !(reinterpret_cast<uintptr_t>(dest) & 3))
+            {
+                for (size_t i = 0; i < stride; i += 4)
+                {
+                    int value;
+                    memcpy(&value, src + i, sizeof(int));
+                    _mm_stream_si32(reinterpret_cast<int*>(dest + i), value);
+                }
+                return;
+            }
+        }
+#else
+        UNREFERENCED_PARAMETER(streaming);
+#endif
+
+        memcpy(dest, src, stride);
+    }
+
+    // Later sources win, as with the serial scatter. Duplicates are numbered from nVerts.
+    HRESULT InvertVertexRemap(
+        size_t nVerts,
+        _In_reads_opt_(nDupVerts) const uint32_t* dupVerts, size_t nDupVerts,
+        _In_reads_opt_(nVerts + nDupVerts) const uint32_t* vertexRemap,
+        _Out_writes_(nVerts + nDupVerts) uint32_t* inverse)
+    {
+        size_t newVerts = nVerts + nDupVerts;
+
+        memset(inverse, 0xff, sizeof(uint32_t) * newVerts);
+
+        for (uint32_t j = 0; j < newVerts; ++j)
+        {
+            uint32_t dest = (vertexRemap) ? vertexRemap[j] : j;
+
+            if (dest == UNUSED32)
+                continue;
+
+            if (dest >= newVerts)
+                return E_FAIL;
+
+            if (j >= nVerts && dupVerts[j - nVerts] >= nVerts)
+                return E_FAIL;
+
+            inverse[dest] = j;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT GatherVertices(
+        _In_reads_bytes_(nVerts*stride) const void* vbin, size_t stride, size_t nVerts,
+        _In_reads_opt_(nDupVerts) const uint32_t* dupVerts, size_t nDupVerts,
+        _In_reads_(nVerts + nDupVerts) const uint32_t* inverse, bool streaming,
+        _Out_writes_bytes_((nVerts + nDupVerts)*stride) void* vbout,
+        _In_reads_opt_(nVerts + nDupVerts) const uint32_t* pointRep,
+        _In_reads_opt_(nVerts + nDupVerts) const uint32_t* vertexRemap,
+        _Out_writes_opt_(nVerts + nDupVerts) uint32_t* prout)
+    {
+        size_t newVerts = nVerts + nDupVerts;
+
+        auto sptr = reinterpret_cast<const uint8_t*>(vbin);
+        auto dptr = reinterpret_cast<uint8_t*>(vbout);
+
+        return ProcessBlocks(newVerts, c_MinParallelVerts, [=](size_t begin, size_t end) -> HRESULT
+        {
+            for (size_t j = begin; j < end; ++j)
+            {
+                uint32_t src = inverse[j];
+
+                if (src == UNUSED32)
+                    continue;
+
+                uint32_t data = (src < nVerts) ? src : dupVerts[src - nVerts];
+
+                CopyVertex(dptr + j * stride, sptr + data * stride, stride, streaming);
+
+                if (pointRep)
+                {
+                    uint32_t pr = pointRep[src];
+                    if (pr < newVerts)
+                    {
+                        prout[j] = (vertexRemap) ? vertexRemap[pr] : pr;
+                    }
+                }
+            }
+
+#if defined(_XM_SSE_INTRINSICS_)
+            if (streaming)
+            {
+                _mm_sfence();
+            }
+#endif
+
+            return S_OK;
+        });
+    }
+
+
     //---------------------------------------------------------------------------------
     template<class index_t>
     HRESULT FinalizeIBImpl(
@@ -261,34 +594,37 @@ namespace
         if (nVerts >= index_t(-1))
             return E_INVALIDARG;
 
-        for (size_t j = 0; j < (nFaces * 3); ++j)
+        return ProcessBlocks(nFaces * 3, c_MinParallelFaces * 3, [=](size_t begin, size_t end) -> HRESULT
         {
-            index_t i = ibin[j];
-            if (i == index_t(-1))
+            for (size_t j = begin; j < end; ++j)
             {
-                ibout[j] = index_t(-1);
-                continue;
-            }
+                index_t i = ibin[j];
+                if (i == index_t(-1))
+                {
+                    ibout[j] = index_t(-1);
+                    continue;
+                }
 
-            if (i >= nVerts)
-                return E_UNEXPECTED;
+                if (i >= nVerts)
+                    return E_UNEXPECTED;
 
-            uint32_t dest = vertexRemap[i];
-            if (dest == UNUSED32)
-            {
-                ibout[j] = i;
-                continue;
-            }
+                uint32_t dest = vertexRemap[i];
+                if (dest == UNUSED32)
+                {
+                    ibout[j] = i;
+                    continue;
+                }
 
-            if (dest < nVerts)
-            {
-                ibout[j] = index_t(dest);
+                if (dest < nVerts)
+                {
+                    ibout[j] = index_t(dest);
+                }
+                else
+                    return E_FAIL;
             }
-            else
-                return E_FAIL;
-        }
 
-        return S_OK;
+            return S_OK;
+        });
     }
 
 
@@ -307,31 +643,56 @@ namespace
         if (nVerts >= index_t(-1))
             return E_INVALIDARG;
 
-        for (size_t j = 0; j < (nFaces * 3); ++j)
+        return ProcessBlocks(nFaces * 3, c_MinParallelFaces * 3, [=](size_t begin, size_t end) -> HRESULT
         {
-            index_t i = ib[j];
-            if (i == index_t(-1))
-                continue;
+            for (size_t j = begin; j < end; ++j)
+            {
+                index_t i = ib[j];
+                if (i == index_t(-1))
+                    continue;
 
-            if (i >= nVerts)
-                return E_UNEXPECTED;
+                if (i >= nVerts)
+                    return E_UNEXPECTED;
 
-            uint32_t dest = vertexRemap[i];
-            if (dest == UNUSED32)
-                continue;
+                uint32_t dest = vertexRemap[i];
+                if (dest == UNUSED32)
+                    continue;
 
-            if (dest < nVerts)
-            {
-                ib[j] = index_t(dest);
+                if (dest < nVerts)
+                {
+                    ib[j] = index_t(dest);
+                }
+                else
+                    return E_FAIL;
             }
-            else
-                return E_FAIL;
-        }
 
-        return S_OK;
+            return S_OK;
+        });
     }
 }
 
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeRemap(size_t nFaces, size_t nVerts, size_t stride)
+{
+#ifdef _OPENMP
+    auto nThreads = size_t(std::max(omp_get_max_threads(), 1));
+#else
+    size_t nThreads = 1;
+#endif
+
+    size_t swap = ScratchBytes((sizeof(bool) * nVerts) + stride);
+
+    size_t gather = ScratchBytes<uint32_t>(nVerts) * 2;
+
+    size_t cycles = std::max(ScratchBytes((sizeof(uint32_t) + sizeof(uint8_t)) * nVerts) + ScratchBytes(stride * 2 * nThreads), swap);
+
+    return std::max(ScratchBytes((sizeof(bool) + sizeof(uint32_t)) * nFaces),
+                    std::max(gather, cycles));
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -521,8 +882,10 @@ _Use_decl_annotations_
 HRESULT DirectX::FinalizeVB(
     const void* vbin, size_t stride, size_t nVerts,
     const uint32_t* dupVerts, size_t nDupVerts,
-    const uint32_t* vertexRemap, void* vbout)
+    const uint32_t* vertexRemap, void* vbout, DWORD flags)
 {
+    stage_stats stats("FinalizeVB", 0, nVerts + nDupVerts);
+
     if (!vbin || !stride || !nVerts || !vbout)
         return E_INVALIDARG;
 
@@ -549,13 +912,28 @@ HRESULT DirectX::FinalizeVB(
 
     size_t newVerts = nVerts + nDupVerts;
 
-    auto sptr = reinterpret_cast<const uint8_t*>(vbin);
-    auto dptr = reinterpret_cast<uint8_t*>(vbout);
-
 #ifdef _DEBUG
     memset(vbout, 0, newVerts * stride);
 #endif
 
+    bool streaming = (flags & FINALIZE_STREAMING) != 0;
+    if (streaming || UseParallel(newVerts, c_MinParallelVerts))
+    {
+        auto inverse = make_scratch<uint32_t>(newVerts);
+        if (!inverse)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = InvertVertexRemap(nVerts, dupVerts, nDupVerts, vertexRemap, inverse.get());
+        if (FAILED(hr))
+            return hr;
+
+        return GatherVertices(vbin, stride, nVerts, dupVerts, nDupVerts, inverse.get(), streaming, vbout,
+                              nullptr, nullptr, nullptr);
+    }
+
+    auto sptr = reinterpret_cast<const uint8_t*>(vbin);
+    auto dptr = reinterpret_cast<uint8_t*>(vbout);
+
     for (size_t j = 0; j < nVerts; ++j)
     {
         uint32_t dest = (vertexRemap) ? vertexRemap[j] : uint32_t(j);
@@ -603,11 +981,16 @@ HRESULT DirectX::FinalizeVB(
 _Use_decl_annotations_
 HRESULT DirectX::FinalizeVB(
     void* vb, size_t stride,
-    size_t nVerts, const uint32_t* vertexRemap)
+    size_t nVerts, const uint32_t* vertexRemap, DWORD flags)
 {
+    stage_stats stats("FinalizeVB", 0, nVerts);
+
     if (nVerts >= UINT32_MAX)
         return E_INVALIDARG;
 
+    if (flags & FINALIZE_CYCLES)
+        return RotateVertexCycles(vb, stride, nVerts, vertexRemap);
+
     return SwapVertices(vb, stride, nVerts, nullptr, vertexRemap);
 }
 
@@ -623,8 +1006,10 @@ _Use_decl_annotations_
 HRESULT DirectX::FinalizeVBAndPointReps(
     const void* vbin, size_t stride, size_t nVerts, const uint32_t* prin,
     const uint32_t* dupVerts, size_t nDupVerts, const uint32_t* vertexRemap,
-    void* vbout, uint32_t* prout)
+    void* vbout, uint32_t* prout, DWORD flags)
 {
+    stage_stats stats("FinalizeVBAndPointReps", 0, nVerts + nDupVerts);
+
     if (!vbin || !stride || !nVerts || !prin || !vbout || !prout)
         return E_INVALIDARG;
 
@@ -658,7 +1043,10 @@ HRESULT DirectX::FinalizeVBAndPointReps(
     memset(vbout, 0, newVerts * stride);
 #endif
 
-    std::unique_ptr<uint32_t[]> pointRep(new uint32_t[nVerts + nDupVerts]);
+    auto pointRep = make_scratch<uint32_t>(nVerts + nDupVerts);
+    if (!pointRep)
+        return E_OUTOFMEMORY;
+
     memcpy(pointRep.get(), prin, sizeof(uint32_t) * nVerts);
     for (size_t i = 0; i < nDupVerts; ++i)
     {
@@ -687,6 +1075,21 @@ HRESULT DirectX::FinalizeVBAndPointReps(
         }
     }
 
+    bool streaming = (flags & FINALIZE_STREAMING) != 0;
+    if (streaming || UseParallel(newVerts, c_MinParallelVerts))
+    {
+        auto inverse = make_scratch<uint32_t>(newVerts);
+        if (!inverse)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = InvertVertexRemap(nVerts, dupVerts, nDupVerts, vertexRemap, inverse.get());
+        if (FAILED(hr))
+            return hr;
+
+        return GatherVertices(vbin, stride, nVerts, dupVerts, nDupVerts, inverse.get(), streaming, vbout,
+                              pointRep.get(), vertexRemap, prout);
+    }
+
     size_t j = 0;
 
     for (; j < nVerts; ++j)
@@ -750,6 +1153,8 @@ HRESULT DirectX::FinalizeVBAndPointReps(
     void* vb, size_t stride, size_t nVerts,
     uint32_t* pointRep, const uint32_t* vertexRemap)
 {
+    stage_stats stats("FinalizeVBAndPointReps", 0, nVerts);
+
     if (nVerts >= UINT32_MAX)
         return E_INVALIDARG;
 
@@ -0,0 +1,595 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshSimplify.cpp
+//
+// DirectX Mesh Geometry Library - Mesh simplification
+//
+// Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"
+// ACM SIGGRAPH 1997
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    //---------------------------------------------------------------------------------
+    // Area-weighted sum of squared distances to the planes of a vertex's faces, stored
+    // as the upper triangle of a symmetric 4x4 matrix
+    //---------------------------------------------------------------------------------
+    struct quadric
+    {
+        double a00, a01, a02, a03;
+        double a11, a12, a13;
+        double a22, a23;
+        double a33;
+        double weight;
+
+        void reset()
+        {
+            memset(this, 0, sizeof(quadric));
+        }
+
+        void add_plane(double x, double y, double z, double d, double w)
+        {
+            a00 += w * x * x; a01 += w * x * y; a02 += w * x * z; a03 += w * x * d;
+            a11 += w * y * y; a12 += w * y * z; a13 += w * y * d;
+            a22 += w * z * z; a23 += w * z * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        void add(const quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+        }
+
+        // Weighted sum of squared distances of p to the planes of both quadrics
+        static double error(const quadric& q0, const quadric& q1, const XMFLOAT3& p)
+        {
+            double x = p.x;
+            double y = p.y;
+            double z = p.z;
+
+            double e = (q0.a00 + q1.a00) * x * x + (q0.a11 + q1.a11) * y * y + (q0.a22 + q1.a22) * z * z + (q0.a33 + q1.a33)
+                + 2.0 * ((q0.a01 + q1.a01) * x * y + (q0.a02 + q1.a02) * x * z + (q0.a12 + q1.a12) * y * z
+                       + (q0.a03 + q1.a03) * x + (q0.a13 + q1.a13) * y + (q0.a23 + q1.a23) * z);
+
+            return (e > 0.0) ? e : 0.0;
+        }
+    };
+
+    static_assert(std::is_trivially_destructible<quadric>::value, "quadric is scratch memory");
+
+    inline XMVECTOR FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+    {
+        XMVECTOR v0 = XMLoadFloat3(&p0);
+        XMVECTOR v1 = XMLoadFloat3(&p1);
+        XMVECTOR v2 = XMLoadFloat3(&p2);
+
+        return XMVector3Cross(XMVectorSubtract(v1, v0), XMVectorSubtract(v2, v0));
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // Faces around each vertex, rebuilt from the live faces before every pass
+    //---------------------------------------------------------------------------------
+    void BuildVertexFaces(
+        _In_reads_(nFaces * 3) const uint32_t* ib, size_t nFaces, size_t nVerts,
+        _Out_writes_(nVerts + 1) uint32_t* offsets, _Out_writes_(nFaces * 3) uint32_t* faces)
+    {
+        memset(offsets, 0, sizeof(uint32_t) * (nVerts + 1));
+
+        for (size_t j = 0; j < nFaces * 3; ++j)
+        {
+            if (ib[j] != UNUSED32)
+                ++offsets[ib[j] + 1];
+        }
+
+        for (size_t vert = 0; vert < nVerts; ++vert)
+        {
+            offsets[vert + 1] += offsets[vert];
+        }
+
+        for (uint32_t face = 0; face < nFaces; ++face)
+        {
+            for (size_t point = 0; point < 3; ++point)
+            {
+                uint32_t v = ib[face * 3 + point];
+                if (v != UNUSED32)
+                    faces[offsets[v]++] = face;
+            }
+        }
+
+        // Filling advanced each offset to the start of the next vertex
+        for (size_t vert = nVerts; vert > 0; --vert)
+        {
+            offsets[vert] = offsets[vert - 1];
+        }
+        offsets[0] = 0;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT SimplifyMeshImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nVerts) const uint32_t* pointRep,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        _In_reads_opt_(nFaces) const uint32_t* attributes,
+        size_t targetFaces, float maxError,
+        _Out_writes_(nFaces * 3) index_t* simplifiedIndices, size_t& nSimplifiedFaces,
+        _Out_opt_ float* resultError)
+    {
+        nSimplifiedFaces = 0;
+
+        if (resultError)
+            *resultError = 0.f;
+
+        if (!indices || !nFaces || !positions || !nVerts || !pointRep || !adjacency || !simplifiedIndices)
+            return E_INVALIDARG;
+
+        if (!(maxError >= 0.f))
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        auto ib = make_scratch<uint32_t>(nFaces * 3 * 2 + nVerts + 1);
+        auto vertTemp = make_scratch<uint32_t>(nVerts * 5);
+        auto quadrics = make_scratch<quadric>(nVerts);
+        auto costs = make_scratch<float>(nVerts);
+        auto locked = make_scratch<uint8_t>(nVerts);
+        if (!ib || !vertTemp || !quadrics || !costs || !locked)
+            return E_OUTOFMEMORY;
+
+        uint32_t* faces = ib.get() + nFaces * 3;
+        uint32_t* offsets = ib.get() + nFaces * 6;
+
+        uint32_t* marks = vertTemp.get();
+        uint32_t* touched = vertTemp.get() + nVerts;
+        uint32_t* targets = vertTemp.get() + nVerts * 2;
+        uint32_t* order = vertTemp.get() + nVerts * 3;
+        uint32_t* groups = vertTemp.get() + nVerts * 4;
+
+        // Working copy of the faces, with unused and degenerate faces dropped
+        size_t nLiveFaces = 0;
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            uint32_t i0 = (indices[face * 3] == index_t(-1)) ? UNUSED32 : uint32_t(indices[face * 3]);
+            uint32_t i1 = (indices[face * 3 + 1] == index_t(-1)) ? UNUSED32 : uint32_t(indices[face * 3 + 1]);
+            uint32_t i2 = (indices[face * 3 + 2] == index_t(-1)) ? UNUSED32 : uint32_t(indices[face * 3 + 2]);
+
+            if (i0 == UNUSED32 || i1 == UNUSED32 || i2 == UNUSED32 || i0 == i1 || i1 == i2 || i2 == i0)
+            {
+                ib[face * 3] = ib[face * 3 + 1] = ib[face * 3 + 2] = UNUSED32;
+                continue;
+            }
+
+            if (i0 >= nVerts || i1 >= nVerts || i2 >= nVerts)
+                return E_UNEXPECTED;
+
+            ib[face * 3] = i0;
+            ib[face * 3 + 1] = i1;
+            ib[face * 3 + 2] = i2;
+            ++nLiveFaces;
+        }
+
+        // Plane quadrics of each vertex's faces
+        for (size_t vert = 0; vert < nVerts; ++vert)
+        {
+            quadrics[vert].reset();
+        }
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            const uint32_t* f = &ib[face * 3];
+            if (f[0] == UNUSED32)
+                continue;
+
+            XMVECTOR n = FaceNormal(positions[f[0]], positions[f[1]], positions[f[2]]);
+
+            float length = XMVectorGetX(XMVector3Length(n));
+            if (!(length > 0.f))
+                continue;
+
+            XMFLOAT3 normal;
+            XMStoreFloat3(&normal, XMVectorScale(n, 1.f / length));
+
+            const XMFLOAT3& p = positions[f[0]];
+            double d = -(double(normal.x) * p.x + double(normal.y) * p.y + double(normal.z) * p.z);
+
+            for (size_t point = 0; point < 3; ++point)
+            {
+                quadrics[f[point]].add_plane(normal.x, normal.y, normal.z, d, double(length) * 0.5);
+            }
+        }
+
+        // Vertices that stay: seams and co-located vertices, and vertices on open borders, attribute
+        // boundaries, or edges that are not shared by exactly two consistently wound faces
+        memset(locked.get(), 0, nVerts);
+        memset(marks, 0, sizeof(uint32_t) * nVerts);
+
+        for (size_t vert = 0; vert < nVerts; ++vert)
+        {
+            uint32_t rep = pointRep[vert];
+            if (rep >= nVerts)
+                return E_UNEXPECTED;
+
+            ++marks[rep];
+        }
+
+        for (size_t vert = 0; vert < nVerts; ++vert)
+        {
+            if (marks[pointRep[vert]] > 1)
+                locked[vert] = 1;
+        }
+
+        // Co-located vertices are linked in rings, so the checks below see every face around a position
+        for (uint32_t vert = 0; vert < nVerts; ++vert)
+        {
+            groups[vert] = vert;
+        }
+
+        for (uint32_t vert = 0; vert < nVerts; ++vert)
+        {
+            uint32_t rep = pointRep[vert];
+            if (rep != vert)
+            {
+                groups[vert] = groups[rep];
+                groups[rep] = vert;
+            }
+        }
+
+        for (uint32_t face = 0; face < nFaces; ++face)
+        {
+            const uint32_t* f = &ib[face * 3];
+            if (f[0] == UNUSED32)
+                continue;
+
+            for (uint32_t edge = 0; edge < 3; ++edge)
+            {
+                uint32_t v0 = f[edge];
+                uint32_t v1 = f[(edge + 1) % 3];
+
+                uint32_t neighbor = adjacency[face * 3 + edge];
+
+                bool shared = false;
+                if (neighbor < nFaces && (!attributes || attributes[neighbor] == attributes[face]))
+                {
+                    const uint32_t* g = &ib[neighbor * 3];
+                    for (uint32_t k = 0; k < 3; ++k)
+                    {
+                        if (g[k] == v1 && g[(k + 1) % 3] == v0 && adjacency[neighbor * 3 + k] == face)
+                            shared = true;
+                    }
+                }
+
+                if (!shared)
+                {
+                    locked[v0] = locked[v1] = 1;
+                }
+            }
+        }
+
+        BuildVertexFaces(ib.get(), nFaces, nVerts, offsets, faces);
+
+        // Every edge of the remaining vertices is shared by two faces, so walking across them visits each face around
+        // the vertex once, unless its faces form more than one fan
+        for (uint32_t vert = 0; vert < nVerts; ++vert)
+        {
+            uint32_t valence = offsets[vert + 1] - offsets[vert];
+            if (locked[vert] || !valence)
+                continue;
+
+            uint32_t face = faces[offsets[vert]];
+            uint32_t steps = 0;
+            do
+            {
+                const uint32_t* f = &ib[face * 3];
+                uint32_t corner = (f[0] == vert) ? 0 : ((f[1] == vert) ? 1 : 2);
+                if (f[corner] != vert)
+                    break;
+
+                face = adjacency[face * 3 + corner];
+                ++steps;
+            } while (face != faces[offsets[vert]] && steps <= valence);
+
+            if (steps != valence || face != faces[offsets[vert]])
+                locked[vert] = 1;
+        }
+
+        // Collapses each remaining vertex onto a neighbor in passes, cheapest first. A collapse claims the vertex,
+        // its target, and its neighbors for the rest of the pass, and no vertex co-located with a claimed one is a
+        // target, so every check sees their faces as they were when the faces around each vertex were gathered.
+        const double limit = double(maxError) * double(maxError);
+        double largestError = 0.0;
+
+        memset(marks, 0, sizeof(uint32_t) * nVerts);
+        memset(touched, 0, sizeof(uint32_t) * nVerts);
+
+        uint32_t tag = 0;
+
+        for (uint32_t pass = 1; nLiveFaces > targetFaces; ++pass)
+        {
+            if (pass > 1)
+            {
+                BuildVertexFaces(ib.get(), nFaces, nVerts, offsets, faces);
+            }
+
+            uint32_t nCandidates = 0;
+            for (uint32_t vert = 0; vert < nVerts; ++vert)
+            {
+                if (locked[vert] || offsets[vert] == offsets[vert + 1])
+                    continue;
+
+                double best = DBL_MAX;
+                uint32_t target = UNUSED32;
+
+                for (uint32_t j = offsets[vert]; j < offsets[vert + 1]; ++j)
+                {
+                    const uint32_t* f = &ib[faces[j] * 3];
+                    for (size_t point = 0; point < 3; ++point)
+                    {
+                        uint32_t other = f[point];
+                        if (other == vert)
+                            continue;
+
+                        double weight = quadrics[vert].weight + quadrics[other].weight;
+                        double cost = quadric::error(quadrics[vert], quadrics[other], positions[other]);
+                        if (weight > 0.0)
+                            cost /= weight;
+
+                        if (cost < best || (cost == best && other < target))
+                        {
+                            best = cost;
+                            target = other;
+                        }
+                    }
+                }
+
+                if (target == UNUSED32 || best > limit)
+                    continue;
+
+                targets[vert] = target;
+                costs[vert] = float(best);
+                order[nCandidates++] = vert;
+            }
+
+            const float* ccosts = costs.get();
+            std::sort(order, order + nCandidates, [=](uint32_t a, uint32_t b) -> bool
+            {
+                return (ccosts[a] < ccosts[b]) || (ccosts[a] == ccosts[b] && a < b);
+            });
+
+            size_t nCollapsed = 0;
+            for (uint32_t c = 0; c < nCandidates && nLiveFaces > targetFaces; ++c)
+            {
+                uint32_t vert = order[c];
+                uint32_t target = targets[vert];
+
+                bool claimed = (touched[vert] == pass);
+
+                uint32_t member = target;
+                do
+                {
+                    if (touched[member] == pass)
+                        claimed = true;
+
+                    member = groups[member];
+                } while (member != target && !claimed);
+
+                if (claimed)
+                    continue;
+
+                // Link condition: exactly the two vertices opposite the collapsed edge neighbor both ends
+                uint32_t targetRep = pointRep[target];
+                tag += 2;
+
+                for (uint32_t j = offsets[vert]; j < offsets[vert + 1]; ++j)
+                {
+                    const uint32_t* f = &ib[faces[j] * 3];
+                    for (size_t point = 0; point < 3; ++point)
+                    {
+                        marks[pointRep[f[point]]] = tag;
+                    }
+                }
+
+                uint32_t common = 0;
+
+                member = target;
+                do
+                {
+                    for (uint32_t j = offsets[member]; j < offsets[member + 1]; ++j)
+                    {
+                        const uint32_t* f = &ib[faces[j] * 3];
+                        for (size_t point = 0; point < 3; ++point)
+                        {
+                            uint32_t rep = pointRep[f[point]];
+                            if (marks[rep] == tag && rep != pointRep[vert] && rep != targetRep)
+                            {
+                                marks[rep] = tag + 1;
+                                ++common;
+                            }
+                        }
+                    }
+
+                    member = groups[member];
+                } while (member != target);
+
+                if (common != 2)
+                    continue;
+
+                // Nor may a face it moves onto the target already be there, which removing the last vertex inside a
+                // triangle of neighbors would do; faces across a seam count too
+                bool duplicate = false;
+                for (uint32_t j = offsets[vert]; j < offsets[vert + 1] && !duplicate; ++j)
+                {
+                    const uint32_t* f = &ib[faces[j] * 3];
+                    if (f[0] == target || f[1] == target || f[2] == target)
+                        continue;
+
+                    uint32_t corner = (f[0] == vert) ? 0 : ((f[1] == vert) ? 1 : 2);
+                    uint32_t a = pointRep[f[(corner + 1) % 3]];
+                    uint32_t b = pointRep[f[(corner + 2) % 3]];
+
+                    if (a == targetRep || b == targetRep)
+                    {
+                        duplicate = true;
+                        break;
+                    }
+
+                    member = target;
+                    do
+                    {
+                        for (uint32_t k = offsets[member]; k < offsets[member + 1] && !duplicate; ++k)
+                        {
+                            const uint32_t* g = &ib[faces[k] * 3];
+
+                            bool hasA = false;
+                            bool hasB = false;
+                            for (size_t point = 0; point < 3; ++point)
+                            {
+                                uint32_t rep = pointRep[g[point]];
+                                hasA |= (rep == a);
+                                hasB |= (rep == b);
+                            }
+
+                            duplicate = hasA && hasB;
+                        }
+
+                        member = groups[member];
+                    } while (member != target && !duplicate);
+                }
+
+                if (duplicate)
+                    continue;
+
+                // No face that remains may flip
+                const XMFLOAT3& moved = positions[target];
+
+                bool flipped = false;
+                for (uint32_t j = offsets[vert]; j < offsets[vert + 1] && !flipped; ++j)
+                {
+                    const uint32_t* f = &ib[faces[j] * 3];
+                    if (f[0] == target || f[1] == target || f[2] == target)
+                        continue;
+
+                    XMVECTOR n0 = FaceNormal(positions[f[0]], positions[f[1]], positions[f[2]]);
+                    XMVECTOR n1 = FaceNormal((f[0] == vert) ? moved : positions[f[0]],
+                                             (f[1] == vert) ? moved : positions[f[1]],
+                                             (f[2] == vert) ? moved : positions[f[2]]);
+
+                    flipped = !(XMVectorGetX(XMVector3Dot(n0, n1)) > 0.f);
+                }
+
+                if (flipped)
+                    continue;
+
+                // Collapse
+                for (uint32_t j = offsets[vert]; j < offsets[vert + 1]; ++j)
+                {
+                    uint32_t* f = &ib[faces[j] * 3];
+                    for (size_t point = 0; point < 3; ++point)
+                    {
+                        touched[f[point]] = pass;
+                    }
+
+                    if (f[0] == target || f[1] == target || f[2] == target)
+                    {
+                        f[0] = f[1] = f[2] = UNUSED32;
+                        --nLiveFaces;
+                        continue;
+                    }
+
+                    for (size_t point = 0; point < 3; ++point)
+                    {
+                        if (f[point] == vert)
+                            f[point] = target;
+                    }
+                }
+
+                quadrics[target].add(quadrics[vert]);
+
+                if (costs[vert] > largestError)
+                    largestError = costs[vert];
+
+                ++nCollapsed;
+            }
+
+            if (!nCollapsed)
+                break;
+        }
+
+        for (size_t j = 0; j < nFaces * 3; ++j)
+        {
+            simplifiedIndices[j] = (ib[j] == UNUSED32) ? index_t(-1) : index_t(ib[j]);
+        }
+
+        nSimplifiedFaces = nLiveFaces;
+
+        if (resultError)
+            *resultError = float(sqrt(largestError));
+
+        return S_OK;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeSimplify(size_t nFaces, size_t nVerts)
+{
+    return ScratchBytes<uint32_t>(nFaces * 3 * 2 + nVerts + 1) + ScratchBytes<uint32_t>(nVerts * 5)
+        + ScratchBytes<quadric>(nVerts) + ScratchBytes<float>(nVerts) + ScratchBytes<uint8_t>(nVerts);
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::SimplifyMesh(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* pointRep, const uint32_t* adjacency, const uint32_t* attributes,
+    size_t targetFaces, float maxError,
+    uint16_t* simplifiedIndices, size_t& nSimplifiedFaces, float* resultError)
+{
+    stage_stats stats("SimplifyMesh", nFaces, nVerts);
+
+    return SimplifyMeshImpl<uint16_t>(indices, nFaces, positions, nVerts, pointRep, adjacency, attributes,
+                                      targetFaces, maxError, simplifiedIndices, nSimplifiedFaces, resultError);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::SimplifyMesh(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* pointRep, const uint32_t* adjacency, const uint32_t* attributes,
+    size_t targetFaces, float maxError,
+    uint32_t* simplifiedIndices, size_t& nSimplifiedFaces, float* resultError)
+{
+    stage_stats stats("SimplifyMesh", nFaces, nVerts);
+
+    return SimplifyMeshImpl<uint32_t>(indices, nFaces, positions, nVerts, pointRep, adjacency, attributes,
+                                      targetFaces, maxError, simplifiedIndices, nSimplifiedFaces, resultError);
+}
@@ -19,97 +19,67 @@ using namespace DirectX;
 
 namespace
 {
+    const float EPSILON = 0.0001f;
+
     //---------------------------------------------------------------------------------
-    // Compute tangent and bi-tangent for each vertex
+    // Per-face tangent and bi-tangent contribution
     //---------------------------------------------------------------------------------
-    template<class index_t>
-    HRESULT ComputeTangentFrameImpl(
-        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
-        _In_reads_(nVerts) const XMFLOAT3* positions,
-        _In_reads_(nVerts) const XMFLOAT3* normals,
-        _In_reads_(nVerts) const XMFLOAT2* texcoords,
-        size_t nVerts,
-        _Out_writes_opt_(nVerts) XMFLOAT3* tangents3,
-        _Out_writes_opt_(nVerts) XMFLOAT4* tangents4,
-        _Out_writes_opt_(nVerts) XMFLOAT3* bitangents)
+    inline void ComputeFaceTangents(
+        _In_ const XMFLOAT3* positions,
+        _In_ const XMFLOAT2* texcoords,
+        size_t i0, size_t i1, size_t i2,
+        _Out_ XMVECTOR& tan, _Out_ XMVECTOR& bitan)
     {
-        if (!indices || !nFaces || !positions || !normals || !texcoords || !nVerts)
-            return E_INVALIDARG;
-
-        if (nVerts >= index_t(-1))
-            return E_INVALIDARG;
-
-        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
-            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-
-        static const float EPSILON = 0.0001f;
         static const XMVECTORF32 s_flips = { { { 1.f, -1.f, -1.f, 1.f } } };
 
-        ScopedAlignedArrayXMVECTOR temp(reinterpret_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nVerts * 2, 16)));
-        if (!temp)
-            return E_OUTOFMEMORY;
-
-        memset(temp.get(), 0, sizeof(XMVECTOR) * nVerts * 2);
-
-        XMVECTOR* tangent1 = temp.get();
-        XMVECTOR* tangent2 = temp.get() + nVerts;
-
-        for (size_t face = 0; face < nFaces; ++face)
-        {
-            index_t i0 = indices[face * 3];
-            index_t i1 = indices[face * 3 + 1];
-            index_t i2 = indices[face * 3 + 2];
-
-            if (i0 == index_t(-1)
-                || i1 == index_t(-1)
-                || i2 == index_t(-1))
-                continue;
-
-            if (i0 >= nVerts
-                || i1 >= nVerts
-                || i2 >= nVerts)
-                return E_UNEXPECTED;
-
-            XMVECTOR t0 = XMLoadFloat2(&texcoords[i0]);
-            XMVECTOR t1 = XMLoadFloat2(&texcoords[i1]);
-            XMVECTOR t2 = XMLoadFloat2(&texcoords[i2]);
+        XMVECTOR t0 = XMLoadFloat2(&texcoords[i0]);
+        XMVECTOR t1 = XMLoadFloat2(&texcoords[i1]);
+        XMVECTOR t2 = XMLoadFloat2(&texcoords[i2]);
 
-            XMVECTOR s = XMVectorMergeXY(XMVectorSubtract(t1, t0), XMVectorSubtract(t2, t0));
+        XMVECTOR s = XMVectorMergeXY(XMVectorSubtract(t1, t0), XMVectorSubtract(t2, t0));
 
-            XMFLOAT4A tmp;
-            XMStoreFloat4A(&tmp, s);
+        XMFLOAT4A tmp;
+        XMStoreFloat4A(&tmp, s);
 
-            float d = tmp.x * tmp.w - tmp.z * tmp.y;
-            d = (fabsf(d) <= EPSILON) ? 1.f : (1.f / d);
-            s = XMVectorScale(s, d);
-            s = XMVectorMultiply(s, s_flips);
+        float d = tmp.x * tmp.w - tmp.z * tmp.y;
+        d = (fabsf(d) <= EPSILON) ? 1.f : (1.f / d);
+        s = XMVectorScale(s, d);
+        s = XMVectorMultiply(s, s_flips);
 
-            XMMATRIX m0;
-            m0.r[0] = XMVectorPermute<3, 2, 6, 7>(s, g_XMZero);
-            m0.r[1] = XMVectorPermute<1, 0, 4, 5>(s, g_XMZero);
-            m0.r[2] = m0.r[3] = g_XMZero;
+        XMMATRIX m0;
+        m0.r[0] = XMVectorPermute<3, 2, 6, 7>(s, g_XMZero);
+        m0.r[1] = XMVectorPermute<1, 0, 4, 5>(s, g_XMZero);
+        m0.r[2] = m0.r[3] = g_XMZero;
 
-            XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
-            XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
-            XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
+        XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+        XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+        XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 
-            XMMATRIX m1;
-            m1.r[0] = XMVectorSubtract(p1, p0);
-            m1.r[1] = XMVectorSubtract(p2, p0);
-            m1.r[2] = m1.r[3] = g_XMZero;
+        XMMATRIX m1;
+        m1.r[0] = XMVectorSubtract(p1, p0);
+        m1.r[1] = XMVectorSubtract(p2, p0);
+        m1.r[2] = m1.r[3] = g_XMZero;
 
-            XMMATRIX uv = XMMatrixMultiply(m0, m1);
+        XMMATRIX uv = XMMatrixMultiply(m0, m1);
 
-            tangent1[i0] = XMVectorAdd(tangent1[i0], uv.r[0]);
-            tangent1[i1] = XMVectorAdd(tangent1[i1], uv.r[0]);
-            tangent1[i2] = XMVectorAdd(tangent1[i2], uv.r[0]);
+        tan = uv.r[0];
+        bitan = uv.r[1];
+    }
 
-            tangent2[i0] = XMVectorAdd(tangent2[i0], uv.r[1]);
-            tangent2[i1] = XMVectorAdd(tangent2[i1], uv.r[1]);
-            tangent2[i2] = XMVectorAdd(tangent2[i2], uv.r[1]);
-        }
 
-        for (size_t j = 0; j < nVerts; ++j)
+    //---------------------------------------------------------------------------------
+    // Orthonormalize the summed frames for a range of vertices
+    //---------------------------------------------------------------------------------
+    void OrthonormalizeFrames(
+        _In_ const XMFLOAT3* normals,
+        _In_ const XMVECTOR* tangent1,
+        _In_ const XMVECTOR* tangent2,
+        size_t begin, size_t end,
+        _Out_writes_opt_(end) XMFLOAT3* tangents3,
+        _Out_writes_opt_(end) XMFLOAT4* tangents4,
+        _Out_writes_opt_(end) XMFLOAT3* bitangents)
+    {
+        for (size_t j = begin; j < end; ++j)
         {
             // Gram-Schmidt orthonormalization
             XMVECTOR b0 = XMLoadFloat3(&normals[j]);
@@ -184,11 +154,215 @@ namespace
                 XMStoreFloat3(&bitangents[j], b2);
             }
         }
+    }
+
+
+#ifdef _OPENMP
+    //---------------------------------------------------------------------------------
+    // Parallel support
+    //---------------------------------------------------------------------------------
+
+    // Smaller meshes are always processed serially
+    const size_t c_MinParallelFaces = 16384;
+
+    //---------------------------------------------------------------------------------
+    // The per-face contributions are computed in parallel first, and the corners are
+    // bucketed by vertex range. Each thread then sums its own bucket in face order and
+    // orthonormalizes its vertices, so the results match the serial code exactly.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeTangentFrameParallel(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions,
+        _In_reads_(nVerts) const XMFLOAT3* normals,
+        _In_reads_(nVerts) const XMFLOAT2* texcoords,
+        size_t nVerts,
+        _Out_writes_opt_(nVerts) XMFLOAT3* tangents3,
+        _Out_writes_opt_(nVerts) XMFLOAT4* tangents4,
+        _Out_writes_opt_(nVerts) XMFLOAT3* bitangents)
+    {
+        auto nBlocks = uint32_t(omp_get_max_threads());
+
+        auto temp = make_scratch<XMVECTOR>((nVerts + nFaces) * 2);
+        auto cornerTemp = make_scratch<uint32_t>(nFaces * 6);
+        auto counts = make_scratch<size_t>(nBlocks * nBlocks + nBlocks + 1);
+        if (!temp || !cornerTemp || !counts)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* tangent1 = temp.get();
+        XMVECTOR* tangent2 = temp.get() + nVerts;
+        XMVECTOR* faceData = temp.get() + nVerts * 2;
+
+        uint32_t* cornerKeys = cornerTemp.get();
+        uint32_t* cornerOrder = cornerTemp.get() + nFaces * 3;
+        size_t* blockOffsets = counts.get() + nBlocks * nBlocks;
+
+        size_t faceBlockSize = (nFaces + nBlocks - 1) / nBlocks;
+        size_t vertBlockSize = (nVerts + nBlocks - 1) / nBlocks;
+
+        bool badIndex = false;
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t end = std::min<size_t>(nFaces, size_t(block + 1) * faceBlockSize);
+            for (size_t face = size_t(block) * faceBlockSize; face < end; ++face)
+            {
+                index_t i0 = indices[face * 3];
+                index_t i1 = indices[face * 3 + 1];
+                index_t i2 = indices[face * 3 + 2];
+
+                if (i0 == index_t(-1)
+                    || i1 == index_t(-1)
+                    || i2 == index_t(-1))
+                {
+                    cornerKeys[face * 3] = cornerKeys[face * 3 + 1] = cornerKeys[face * 3 + 2] = UNUSED32;
+                    continue;
+                }
+
+                if (i0 >= nVerts
+                    || i1 >= nVerts
+                    || i2 >= nVerts)
+                {
+                    badIndex = true;
+                    continue;
+                }
+
+                cornerKeys[face * 3] = uint32_t(i0 / vertBlockSize);
+                cornerKeys[face * 3 + 1] = uint32_t(i1 / vertBlockSize);
+                cornerKeys[face * 3 + 2] = uint32_t(i2 / vertBlockSize);
+
+                ComputeFaceTangents(positions, texcoords, i0, i1, i2, faceData[face * 2], faceData[face * 2 + 1]);
+            }
+        }
+
+        if (badIndex)
+            return E_UNEXPECTED;
+
+        PartitionItems(cornerKeys, nFaces * 3, nBlocks, nBlocks, counts.get(), cornerOrder, blockOffsets);
+
+        #pragma omp parallel for
+        for (int block = 0; block < int(nBlocks); ++block)
+        {
+            size_t vbegin = std::min<size_t>(nVerts, size_t(block) * vertBlockSize);
+            size_t vend = std::min<size_t>(nVerts, size_t(block + 1) * vertBlockSize);
+            if (vbegin >= vend)
+                continue;
+
+            memset(&tangent1[vbegin], 0, sizeof(XMVECTOR) * (vend - vbegin));
+            memset(&tangent2[vbegin], 0, sizeof(XMVECTOR) * (vend - vbegin));
+
+            for (size_t j = blockOffsets[block]; j < blockOffsets[block + 1]; ++j)
+            {
+                uint32_t corner = cornerOrder[j];
+                size_t face = corner / 3;
+
+                size_t i = indices[corner];
+                assert(i >= vbegin && i < vend);
+
+                tangent1[i] = XMVectorAdd(tangent1[i], faceData[face * 2]);
+                tangent2[i] = XMVectorAdd(tangent2[i], faceData[face * 2 + 1]);
+            }
+
+            OrthonormalizeFrames(normals, tangent1, tangent2, vbegin, vend, tangents3, tangents4, bitangents);
+        }
+
+        return S_OK;
+    }
+#endif
+
+
+    //---------------------------------------------------------------------------------
+    // Compute tangent and bi-tangent for each vertex
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeTangentFrameImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions,
+        _In_reads_(nVerts) const XMFLOAT3* normals,
+        _In_reads_(nVerts) const XMFLOAT2* texcoords,
+        size_t nVerts,
+        _Out_writes_opt_(nVerts) XMFLOAT3* tangents3,
+        _Out_writes_opt_(nVerts) XMFLOAT4* tangents4,
+        _Out_writes_opt_(nVerts) XMFLOAT3* bitangents)
+    {
+        if (!indices || !nFaces || !positions || !normals || !texcoords || !nVerts)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+#ifdef _OPENMP
+        if (nFaces >= c_MinParallelFaces && omp_get_max_threads() > 1)
+        {
+            return ComputeTangentFrameParallel(indices, nFaces, positions, normals, texcoords, nVerts, tangents3, tangents4, bitangents);
+        }
+#endif
+
+        auto temp = make_scratch<XMVECTOR>(nVerts * 2);
+        if (!temp)
+            return E_OUTOFMEMORY;
+
+        memset(temp.get(), 0, sizeof(XMVECTOR) * nVerts * 2);
+
+        XMVECTOR* tangent1 = temp.get();
+        XMVECTOR* tangent2 = temp.get() + nVerts;
+
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            index_t i0 = indices[face * 3];
+            index_t i1 = indices[face * 3 + 1];
+            index_t i2 = indices[face * 3 + 2];
+
+            if (i0 == index_t(-1)
+                || i1 == index_t(-1)
+                || i2 == index_t(-1))
+                continue;
+
+            if (i0 >= nVerts
+                || i1 >= nVerts
+                || i2 >= nVerts)
+                return E_UNEXPECTED;
+
+            XMVECTOR tan, bitan;
+            ComputeFaceTangents(positions, texcoords, i0, i1, i2, tan, bitan);
+
+            tangent1[i0] = XMVectorAdd(tangent1[i0], tan);
+            tangent1[i1] = XMVectorAdd(tangent1[i1], tan);
+            tangent1[i2] = XMVectorAdd(tangent1[i2], tan);
+
+            tangent2[i0] = XMVectorAdd(tangent2[i0], bitan);
+            tangent2[i1] = XMVectorAdd(tangent2[i1], bitan);
+            tangent2[i2] = XMVectorAdd(tangent2[i2], bitan);
+        }
+
+        OrthonormalizeFrames(normals, tangent1, tangent2, 0, nVerts, tangents3, tangents4, bitangents);
 
         return S_OK;
     }
 }
 
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeTangentFrame(size_t nFaces, size_t nVerts)
+{
+    // the parallel path also keeps per-face data
+    size_t bytes = ScratchBytes<XMVECTOR>((nVerts + nFaces) * 2);
+
+#ifdef _OPENMP
+    size_t nBlocks = size_t(omp_get_max_threads());
+
+    bytes += ScratchBytes<uint32_t>(nFaces * 6) + ScratchBytes<size_t>(nBlocks * nBlocks + nBlocks + 1);
+#endif
+
+    return bytes;
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -200,6 +374,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT3* tangents, XMFLOAT3* bitangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents && !bitangents)
         return E_INVALIDARG;
 
@@ -214,6 +390,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT3* tangents, XMFLOAT3* bitangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents && !bitangents)
         return E_INVALIDARG;
 
@@ -228,6 +406,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT4* tangents, XMFLOAT3* bitangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents && !bitangents)
         return E_INVALIDARG;
 
@@ -242,6 +422,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT4* tangents, XMFLOAT3* bitangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents && !bitangents)
         return E_INVALIDARG;
 
@@ -256,6 +438,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT4* tangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents)
         return E_INVALIDARG;
 
@@ -270,6 +454,8 @@ HRESULT DirectX::ComputeTangentFrame(
     const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texcoords,
     size_t nVerts, XMFLOAT4* tangents)
 {
+    stage_stats stats("ComputeTangentFrame", nFaces, nVerts);
+
     if (!tangents)
         return E_INVALIDARG;
 
@@ -418,6 +418,24 @@ std::vector<std::pair<size_t, size_t>> DirectX::ComputeSubsets(const uint32_t* a
 
     for (size_t j = 1; j < nFaces; ++j)
     {
+#if defined(_XM_SSE_INTRINSICS_)
+        // Skip over the current group eight faces at a time
+        __m128i vlast = _mm_set1_epi32(static_cast<int>(lastAttr));
+        while (j + 8 <= nFaces)
+        {
+            __m128i v0 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(attributes + j)), vlast);
+            __m128i v1 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(attributes + j + 4)), vlast);
+            if (_mm_movemask_epi8(_mm_and_si128(v0, v1)) != 0xffff)
+                break;
+
+            j += 8;
+            count += 8;
+        }
+
+        if (j >= nFaces)
+            break;
+#endif
+
         if (attributes[j] != lastAttr)
         {
             subsets.emplace_back(std::pair<size_t, size_t>(offset, count));
@@ -439,12 +457,439 @@ std::vector<std::pair<size_t, size_t>> DirectX::ComputeSubsets(const uint32_t* a
     return subsets;
 }
 
+//=====================================================================================
+// Instrumentation
+//=====================================================================================
+namespace
+{
+    struct thread_state
+    {
+        MeshStatsCallback   callback;
+        void*               context;
+        stage_stats*        current;
+        void*               arena;
+    };
+
+    __declspec(thread) thread_state s_thread = {};
+
+    int64_t GetTicks()
+    {
+        LARGE_INTEGER t;
+        QueryPerformanceCounter(&t);
+        return t.QuadPart;
+    }
+
+    int64_t GetTickFrequency()
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::SetMeshStatsCallback(MeshStatsCallback callback, void* context)
+{
+    s_thread.callback = callback;
+    s_thread.context = (callback) ? context : nullptr;
+}
+
+_Use_decl_annotations_
+stage_stats::stage_stats(const char* stage, size_t nFaces, size_t nVerts) :
+    m_callback(s_thread.callback),
+    m_context(s_thread.context),
+    m_parent(nullptr),
+    m_start(0),
+    m_tempBytes(0)
+{
+    m_stats.stage = stage;
+    m_stats.elapsedMicroseconds = 0;
+    m_stats.tempBytes = 0;
+    m_stats.nFaces = nFaces;
+    m_stats.nVerts = nVerts;
+
+    if (m_callback)
+    {
+        m_parent = s_thread.current;
+        s_thread.current = this;
+        m_start = GetTicks();
+    }
+}
+
+stage_stats::~stage_stats()
+{
+    if (!m_callback)
+        return;
+
+    int64_t elapsed = GetTicks() - m_start;
+    int64_t frequency = GetTickFrequency();
+
+    m_stats.elapsedMicroseconds = uint64_t(elapsed / frequency) * 1000000 + uint64_t((elapsed % frequency) * 1000000 / frequency);
+    m_stats.tempBytes = m_tempBytes;
+
+    s_thread.current = m_parent;
+
+    // Nested stages count towards the stage that called them
+    if (m_parent)
+    {
+        m_parent->m_tempBytes += m_stats.tempBytes;
+    }
+
+    m_callback(m_stats, m_context);
+}
+
+stage_stats* stage_stats::current()
+{
+    return s_thread.current;
+}
+
+_Use_decl_annotations_
+stage_stats::worker::worker(stage_stats* owner) :
+    m_previous(s_thread.current),
+    m_previousArena(s_thread.arena)
+{
+    s_thread.current = owner;
+    s_thread.arena = nullptr;
+}
+
+stage_stats::worker::~worker()
+{
+    s_thread.current = m_previous;
+    s_thread.arena = m_previousArena;
+}
+
+void DirectX::TrackTempBytes(size_t bytes)
+{
+    stage_stats* stats = s_thread.current;
+    if (stats)
+    {
+        stats->m_tempBytes += bytes;
+    }
+}
+
+
+//=====================================================================================
+// Scratch Memory
+//=====================================================================================
+
+namespace
+{
+    const size_t c_ArenaAlignment = 64;
+    const size_t c_ArenaGranularity = 64 * 1024;
+
+    //---------------------------------------------------------------------------------
+    // Bump allocator for the temporary buffers of one thread. Buffers are almost always
+    // freed in the reverse order they were allocated, so the top of the arena is popped
+    // on free and the arena is rewound once nothing is live. Requests that do not fit
+    // are served by the heap, and the arena grows to its peak the next time it is idle.
+    class arena_allocator
+    {
+    public:
+        arena_allocator() :
+            mBase(nullptr),
+            mCapacity(0),
+            mOffset(0),
+            mLive(0),
+            mInUse(0),
+            mPeak(0)
+        {
+        }
+
+        ~arena_allocator()
+        {
+            assert(!mLive);
+            if (mBase)
+            {
+                _aligned_free(mBase);
+            }
+        }
+
+        arena_allocator(arena_allocator const&) = delete;
+        arena_allocator& operator= (arena_allocator const&) = delete;
+
+        HRESULT Reserve(size_t bytes)
+        {
+            if (mLive)
+                return E_UNEXPECTED;
+
+            if (bytes <= mCapacity)
+                return S_OK;
+
+            if (bytes > SIZE_MAX - c_ArenaGranularity)
+                return E_INVALIDARG;
+
+            size_t capacity = (bytes + c_ArenaGranularity - 1) & ~(c_ArenaGranularity - 1);
+
+            auto base = reinterpret_cast<uint8_t*>(_aligned_malloc(capacity, c_ArenaAlignment));
+            if (!base)
+                return E_OUTOFMEMORY;
+
+            if (mBase)
+            {
+                _aligned_free(mBase);
+            }
+
+            mBase = base;
+            mCapacity = capacity;
+            mOffset = 0;
+
+            return S_OK;
+        }
+
+        void Release()
+        {
+            if (mLive)
+                return;
+
+            if (mBase)
+            {
+                _aligned_free(mBase);
+                mBase = nullptr;
+            }
+
+            mCapacity = mOffset = 0;
+        }
+
+        void* Allocate(size_t bytes)
+        {
+            size_t size = ScratchBytes(bytes);
+
+            void* ptr = nullptr;
+            if (size <= mCapacity - mOffset)
+            {
+                ptr = mBase + mOffset;
+                mOffset += size;
+            }
+            else
+            {
+                ptr = _aligned_malloc(size, c_ScratchAlignment);
+                if (!ptr)
+                    return nullptr;
+            }
+
+            ++mLive;
+            mInUse += size;
+            if (mInUse > mPeak)
+                mPeak = mInUse;
+
+            return ptr;
+        }
+
+        void Free(_In_ void* ptr, size_t bytes)
+        {
+            size_t size = ScratchBytes(bytes);
+
+            auto p = static_cast<uint8_t*>(ptr);
+            if (mBase && p >= mBase && p < mBase + mCapacity)
+            {
+                if (p + size == mBase + mOffset)
+                {
+                    mOffset -= size;
+                }
+            }
+            else
+            {
+                _aligned_free(ptr);
+            }
+
+            assert(mLive > 0 && mInUse >= size);
+            --mLive;
+            mInUse -= size;
+
+            if (!mLive)
+            {
+                mOffset = 0;
+
+                if (mPeak > mCapacity)
+                {
+                    // Failing to grow just leaves the larger requests on the heap
+                    (void)Reserve(mPeak);
+                }
+            }
+        }
+
+        size_t GetCapacity() const { return mCapacity; }
+        size_t GetPeakUsage() const { return mPeak; }
+
+    private:
+        uint8_t*    mBase;
+        size_t      mCapacity;
+        size_t      mOffset;
+        size_t      mLive;
+        size_t      mInUse;
+        size_t      mPeak;
+    };
+}
+
+class ScratchArena::Impl : public arena_allocator
+{
+};
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void* DirectX::ScratchAllocate(size_t bytes, void** arena)
+{
+    auto allocator = static_cast<arena_allocator*>(s_thread.arena);
+    *arena = allocator;
+
+    if (allocator)
+        return allocator->Allocate(bytes);
+
+    return _aligned_malloc(ScratchBytes(bytes), c_ScratchAlignment);
+}
+
+_Use_decl_annotations_
+void DirectX::ScratchFree(void* ptr, void* arena, size_t bytes)
+{
+    if (!ptr)
+        return;
+
+    if (arena)
+    {
+        static_cast<arena_allocator*>(arena)->Free(ptr, bytes);
+    }
+    else
+    {
+        _aligned_free(ptr);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Public constructor.
+ScratchArena::ScratchArena()
+    : pImpl(new Impl())
+{
+}
+
+
+// Move constructor.
+ScratchArena::ScratchArena(ScratchArena&& moveFrom)
+    : pImpl(std::move(moveFrom.pImpl))
+{
+}
+
+
+// Move assignment.
+ScratchArena& ScratchArena::operator= (ScratchArena&& moveFrom)
+{
+    pImpl = std::move(moveFrom.pImpl);
+    return *this;
+}
+
+
+// Public destructor.
+ScratchArena::~ScratchArena()
+{
+}
+
+
+_Use_decl_annotations_
+HRESULT ScratchArena::Reserve(size_t bytes)
+{
+    return pImpl->Reserve(bytes);
+}
+
+
+void ScratchArena::Release()
+{
+    pImpl->Release();
+}
+
+
+size_t ScratchArena::GetCapacity() const
+{
+    return pImpl->GetCapacity();
+}
+
+
+size_t ScratchArena::GetPeakUsage() const
+{
+    return pImpl->GetPeakUsage();
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::SetScratchArena(ScratchArena* arena)
+{
+    arena_allocator* allocator = (arena) ? arena->pImpl.get() : nullptr;
+    s_thread.arena = allocator;
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+size_t DirectX::ComputeScratchSize(SCRATCH_OPERATION op, size_t nFaces, size_t nVerts, size_t extra)
+{
+    switch (op)
+    {
+    case SCRATCH_ADJACENCY:         return ScratchSizeAdjacency(nFaces, nVerts);
+    case SCRATCH_VALIDATE:          return ScratchSizeValidate(nFaces, nVerts);
+    case SCRATCH_CLEAN:             return ScratchSizeClean(nFaces, nVerts);
+    case SCRATCH_NORMALS:           return ScratchSizeNormals(nFaces, nVerts);
+    case SCRATCH_TANGENTFRAME:      return ScratchSizeTangentFrame(nFaces, nVerts);
+    case SCRATCH_OPTIMIZEFACES:     return ScratchSizeOptimizeFaces(nFaces, (extra) ? extra : size_t(OPTFACES_V_DEFAULT));
+    case SCRATCH_OPTIMIZEFACES_LRU: return ScratchSizeOptimizeFacesLRU(nFaces);
+    case SCRATCH_OPTIMIZEVERTICES:  return ScratchSizeOptimizeVertices(nVerts);
+    case SCRATCH_REMAP:             return ScratchSizeRemap(nFaces, nVerts, extra);
+    case SCRATCH_OPTIMIZEMESH:      return ScratchSizeOptimizeMesh(nFaces, nVerts, (extra) ? extra : size_t(OPTFACES_V_DEFAULT));
+    case SCRATCH_PARTITION:         return ScratchSizePartition(nFaces, nVerts);
+    case SCRATCH_ATTRIBUTESORT:     return ScratchSizeAttributeSort(nFaces);
+    case SCRATCH_OPTIMIZEFACES_OVERDRAW: return ScratchSizeOptimizeFacesOverdraw(nFaces, nVerts);
+    case SCRATCH_POSITIONSTREAM:    return ScratchSizePositionStream(nFaces, nVerts, (extra) ? extra : size_t(OPTFACES_V_DEFAULT));
+    case SCRATCH_WELDVERTICES:      return ScratchSizeWeld(nVerts, extra);
+    case SCRATCH_SIMPLIFY:          return ScratchSizeSimplify(nFaces, nVerts);
+    default:                        return 0;
+    }
+}
+
+
 //=====================================================================================
 // Mesh Optimization Utilities
 //=====================================================================================
 
 namespace
 {
+    //---------------------------------------------------------------------------------
+    // Returns the position of value in a cache of count entries, or count if it is not
+    // present. Entries are padded with UNUSED32 to a multiple of 4.
+    inline size_t FindCacheEntry(_In_reads_(count) const uint32_t* entries, size_t count, uint32_t value)
+    {
+        assert((count & 3) == 0);
+        assert(value != UNUSED32);
+
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i probe = _mm_set1_epi32(static_cast<int>(value));
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&entries[j]));
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(e, probe)));
+            if (mask)
+            {
+                return j + ((mask & 1) ? 0 : (mask & 2) ? 1 : (mask & 4) ? 2 : 3);
+            }
+        }
+#else
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (entries[j] == value)
+                return j;
+        }
+#endif
+
+        return count;
+    }
+
+    inline size_t PaddedCacheSize(size_t cacheSize)
+    {
+        return (cacheSize + 3) & ~size_t(3);
+    }
+
+
+    //---------------------------------------------------------------------------------
     template<class index_t>
     void ComputeVertexCacheMissRateImpl(
         _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts, size_t cacheSize,
@@ -464,26 +909,19 @@ namespace
 
         size_t misses = 0;
 
-        std::unique_ptr<uint32_t[]> fifo(new uint32_t[cacheSize]);
+        const size_t fifoSize = PaddedCacheSize(cacheSize);
+
+        std::unique_ptr<uint32_t[]> fifo(new uint32_t[fifoSize]);
         size_t tail = 0;
 
-        memset(fifo.get(), 0xff, sizeof(uint32_t) * cacheSize);
+        memset(fifo.get(), 0xff, sizeof(uint32_t) * fifoSize);
 
         for (size_t j = 0; j < (nFaces * 3); ++j)
         {
             if (indices[j] == index_t(-1))
                 continue;
 
-            bool found = false;
-
-            for (size_t ptr = 0; ptr < cacheSize; ++ptr)
-            {
-                if (fifo[ptr] == indices[j])
-                {
-                    found = true;
-                    break;
-                }
-            }
+            bool found = FindCacheEntry(fifo.get(), fifoSize, uint32_t(indices[j])) < fifoSize;
 
             if (!found)
             {
@@ -500,6 +938,115 @@ namespace
         // ideal is 1.0, worst case is 6.0
         atvr = float(misses) / float(nVerts);
     }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeVertexCacheMissRatesImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces, size_t nVerts,
+        _In_reads_(nCaches) const size_t* cacheSizes, size_t nCaches, DWORD flags,
+        _Out_writes_(nCaches) float* acmr, _Out_writes_(nCaches) float* atvr)
+    {
+        if (!indices || !nFaces || !nVerts || !cacheSizes || !nCaches || !acmr || !atvr)
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        size_t maxCache = 0;
+        for (size_t c = 0; c < nCaches; ++c)
+        {
+            if (!cacheSizes[c] || cacheSizes[c] >= UINT32_MAX)
+                return E_INVALIDARG;
+
+            maxCache = std::max(maxCache, cacheSizes[c]);
+        }
+
+        std::unique_ptr<uint32_t[]> misses(new (std::nothrow) uint32_t[nCaches]);
+        if (!misses)
+            return E_OUTOFMEMORY;
+
+        memset(misses.get(), 0, sizeof(uint32_t) * nCaches);
+
+        if (flags & VCACHE_LRU)
+        {
+            // Every LRU cache holds a prefix of the same recency stack, so one stack covers all sizes
+            const size_t stackSize = PaddedCacheSize(maxCache);
+
+            std::unique_ptr<uint32_t[]> stack(new (std::nothrow) uint32_t[stackSize]);
+            if (!stack)
+                return E_OUTOFMEMORY;
+
+            memset(stack.get(), 0xff, sizeof(uint32_t) * stackSize);
+
+            for (size_t j = 0; j < (nFaces * 3); ++j)
+            {
+                index_t v = indices[j];
+                if (v == index_t(-1))
+                    continue;
+
+                if (v >= nVerts)
+                    return E_UNEXPECTED;
+
+                size_t pos = FindCacheEntry(stack.get(), stackSize, uint32_t(v));
+
+                for (size_t c = 0; c < nCaches; ++c)
+                {
+                    if (pos >= cacheSizes[c])
+                        ++misses[c];
+                }
+
+                // move to the front, dropping the oldest entry on a miss
+                memmove(&stack[1], &stack[0], sizeof(uint32_t) * std::min(pos, maxCache - 1));
+                stack[0] = uint32_t(v);
+            }
+        }
+        else
+        {
+            // A FIFO entry is evicted once cacheSize more misses happen after it was inserted, so
+            // recording the miss count at insertion per vertex replaces searching the FIFO
+            if ((uint64_t(nVerts) * uint64_t(nCaches)) >= UINT32_MAX)
+                return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+            std::unique_ptr<uint32_t[]> inserted(new (std::nothrow) uint32_t[nVerts * nCaches]);
+            if (!inserted)
+                return E_OUTOFMEMORY;
+
+            memset(inserted.get(), 0xff, sizeof(uint32_t) * nVerts * nCaches);
+
+            for (size_t j = 0; j < (nFaces * 3); ++j)
+            {
+                index_t v = indices[j];
+                if (v == index_t(-1))
+                    continue;
+
+                if (v >= nVerts)
+                    return E_UNEXPECTED;
+
+                uint32_t* stamps = &inserted[size_t(v) * nCaches];
+
+                for (size_t c = 0; c < nCaches; ++c)
+                {
+                    if (stamps[c] == UNUSED32 || (misses[c] - stamps[c]) > cacheSizes[c])
+                    {
+                        stamps[c] = misses[c];
+                        ++misses[c];
+                    }
+                }
+            }
+        }
+
+        for (size_t c = 0; c < nCaches; ++c)
+        {
+            acmr[c] = float(misses[c]) / float(nFaces);
+            atvr[c] = float(misses[c]) / float(nVerts);
+        }
+
+        return S_OK;
+    }
 }
 
 //-------------------------------------------------------------------------------------
@@ -518,3 +1065,23 @@ void DirectX::ComputeVertexCacheMissRate(
 {
     ComputeVertexCacheMissRateImpl<uint32_t>(indices, nFaces, nVerts, cacheSize, acmr, atvr);
 }
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeVertexCacheMissRates(
+    const uint16_t* indices, size_t nFaces, size_t nVerts,
+    const size_t* cacheSizes, size_t nCaches, DWORD flags,
+    float* acmr, float* atvr)
+{
+    return ComputeVertexCacheMissRatesImpl<uint16_t>(indices, nFaces, nVerts, cacheSizes, nCaches, flags, acmr, atvr);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeVertexCacheMissRates(
+    const uint32_t* indices, size_t nFaces, size_t nVerts,
+    const size_t* cacheSizes, size_t nCaches, DWORD flags,
+    float* acmr, float* atvr)
+{
+    return ComputeVertexCacheMissRatesImpl<uint32_t>(indices, nFaces, nVerts, cacheSizes, nCaches, flags, acmr, atvr);
+}
@@ -22,6 +22,10 @@ namespace
 {
     const size_t c_MaxSlot = 32;
     const size_t c_MaxStride = 2048;
+    const size_t c_MaxElements = 32;
+
+    // Vertices converted at a time by a multi-element read, so an interleaved buffer stays in cache
+    const size_t c_BlockVerts = 256;
 
     enum INPUT_CLASSIFICATION
     {
@@ -46,6 +50,7 @@ namespace
     static_assert(static_cast<int>(PER_INSTANCE_DATA) == static_cast<int>(D3D11_INPUT_PER_INSTANCE_DATA), "D3D11 mismatch");
     static_assert(c_MaxSlot == D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "D3D11 mismatch");
     static_assert(c_MaxStride == D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES, "D3D11 mismatch");
+    static_assert(c_MaxElements == D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT, "D3D11 mismatch");
 #endif
 
 #if defined(__d3d12_h__) || defined(__d3d12_x_h__)
@@ -54,6 +59,232 @@ namespace
     static_assert(static_cast<int>(PER_INSTANCE_DATA) == static_cast<int>(D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA), "D3D12 mismatch");
     static_assert(c_MaxSlot == D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "D3D12 mismatch");
     static_assert(c_MaxStride == D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES, "D3D12 mismatch");
+    static_assert(c_MaxElements == D3D12_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT, "D3D12 mismatch");
+#endif
+
+    //---------------------------------------------------------------------------------
+    void StoreElements(VBELEMENT_TYPE type, _Out_ void* data, size_t first, _In_reads_(count) const XMVECTOR* src, size_t count)
+    {
+        switch (type)
+        {
+        case VBELEMENT_FLOAT:
+            {
+                auto dptr = reinterpret_cast<float*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    XMStoreFloat(dptr++, src[j]);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT2:
+            {
+                auto dptr = reinterpret_cast<XMFLOAT2*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    XMStoreFloat2(dptr++, src[j]);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT3:
+            {
+                auto dptr = reinterpret_cast<XMFLOAT3*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    XMStoreFloat3(dptr++, src[j]);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT4:
+            {
+                auto dptr = reinterpret_cast<XMFLOAT4*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    XMStoreFloat4(dptr++, src[j]);
+                }
+            }
+            break;
+
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+
+#if defined(_XM_SSE_INTRINSICS_)
+    //---------------------------------------------------------------------------------
+    // Batched conversions for common compressed formats, 4 vertices per iteration.
+    // These produce the same results as the DirectXMath loads in the per-vertex loops.
+    //---------------------------------------------------------------------------------
+
+    // Returns how many of count vertices at ptr fit in the buffer, rounded down to a multiple of 4
+    inline size_t BatchCount(const uint8_t* ptr, const uint8_t* eptr, size_t stride, size_t size, size_t count)
+    {
+        if ((ptr + size) > eptr)
+            return 0;
+
+        size_t fit = (size_t(eptr - ptr) - size) / stride + 1;
+        return std::min(fit, count) & ~size_t(3);
+    }
+
+    inline __m128i XM_CALLCONV Gather32(const uint8_t* ptr, size_t stride)
+    {
+        return _mm_setr_epi32(
+            *reinterpret_cast<const int32_t*>(ptr),
+            *reinterpret_cast<const int32_t*>(ptr + stride),
+            *reinterpret_cast<const int32_t*>(ptr + stride * 2),
+            *reinterpret_cast<const int32_t*>(ptr + stride * 3));
+    }
+
+    inline __m128i XM_CALLCONV Gather64(const uint8_t* ptr, size_t stride)
+    {
+        return _mm_unpacklo_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr)),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr + stride)));
+    }
+
+    inline __m128 XM_CALLCONV Select(__m128i mask, __m128 a, __m128 b)
+    {
+        // mask ? a : b
+        return _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(mask), a), _mm_andnot_ps(_mm_castsi128_ps(mask), b));
+    }
+
+    // Converts 4 halfs held in the low 16 bits of each lane
+    inline __m128 XM_CALLCONV HalfToFloat(__m128i h)
+    {
+#if defined(_XM_F16C_INTRINSICS_)
+        return _mm_cvtph_ps(_mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(h, 16), 16), _mm_setzero_si128()));
+#else
+        const __m128i expMant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+        const __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+
+        // Normalized values only need the exponent rebiased, INF/NAN get the maximum exponent
+        __m128i bits = _mm_add_epi32(_mm_slli_epi32(expMant, 13), _mm_set1_epi32(112 << 23));
+        __m128i infNan = _mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7BFF));
+        bits = _mm_add_epi32(bits, _mm_and_si128(infNan, _mm_set1_epi32(112 << 23)));
+
+        // Denormalized values and zero are the mantissa scaled by 2^-24
+        const __m128 denorm = _mm_mul_ps(_mm_cvtepi32_ps(expMant), _mm_set1_ps(1.f / 16777216.f));
+        __m128 v = Select(_mm_cmplt_epi32(expMant, _mm_set1_epi32(0x0400)), denorm, _mm_castsi128_ps(bits));
+
+        return _mm_or_ps(v, _mm_castsi128_ps(sign));
+#endif
+    }
+
+    // Converts 4 unsigned small floats with a 5-bit exponent and mantissaBits of mantissa
+    inline __m128 XM_CALLCONV SmallFloatToFloat(__m128i f, int mantissaBits, int infNanMin, float denormScale)
+    {
+        __m128i bits = _mm_add_epi32(_mm_sll_epi32(f, _mm_cvtsi32_si128(23 - mantissaBits)), _mm_set1_epi32(112 << 23));
+        __m128i infNan = _mm_cmpgt_epi32(f, _mm_set1_epi32(infNanMin - 1));
+        bits = _mm_add_epi32(bits, _mm_and_si128(infNan, _mm_set1_epi32(112 << 23)));
+
+        const __m128 denorm = _mm_mul_ps(_mm_cvtepi32_ps(f), _mm_set1_ps(denormScale));
+        return Select(_mm_cmplt_epi32(f, _mm_set1_epi32(1 << mantissaBits)), denorm, _mm_castsi128_ps(bits));
+    }
+
+    void LoadHalf2Batch(_Out_writes_(count) XMVECTOR* buffer, const uint8_t* ptr, size_t stride, size_t count, bool)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            __m128i h = Gather32(ptr, stride);
+
+            __m128 lo = HalfToFloat(_mm_unpacklo_epi16(h, zero));
+            __m128 hi = HalfToFloat(_mm_unpackhi_epi16(h, zero));
+
+            *buffer++ = _mm_movelh_ps(lo, _mm_setzero_ps());
+            *buffer++ = _mm_movehl_ps(_mm_setzero_ps(), lo);
+            *buffer++ = _mm_movelh_ps(hi, _mm_setzero_ps());
+            *buffer++ = _mm_movehl_ps(_mm_setzero_ps(), hi);
+
+            ptr += stride * 4;
+        }
+    }
+
+    void LoadHalf4Batch(_Out_writes_(count) XMVECTOR* buffer, const uint8_t* ptr, size_t stride, size_t count, bool)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        for (size_t j = 0; j < count; j += 2)
+        {
+            __m128i h = Gather64(ptr, stride);
+
+            *buffer++ = HalfToFloat(_mm_unpacklo_epi16(h, zero));
+            *buffer++ = HalfToFloat(_mm_unpackhi_epi16(h, zero));
+
+            ptr += stride * 2;
+        }
+    }
+
+    void LoadFloat3PKBatch(_Out_writes_(count) XMVECTOR* buffer, const uint8_t* ptr, size_t stride, size_t count, bool x2bias)
+    {
+        const __m128i mask11 = _mm_set1_epi32(0x7FF);
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            __m128i v = Gather32(ptr, stride);
+
+            // 11-bit x and y have a 6-bit mantissa, 10-bit z has a 5-bit mantissa
+            __m128 x = SmallFloatToFloat(_mm_and_si128(v, mask11), 6, 0x7C0, 1.f / 1048576.f);
+            __m128 y = SmallFloatToFloat(_mm_and_si128(_mm_srli_epi32(v, 11), mask11), 6, 0x7C0, 1.f / 1048576.f);
+            __m128 z = SmallFloatToFloat(_mm_srli_epi32(v, 22), 5, 0x3E0, 1.f / 524288.f);
+            __m128 w = _mm_setzero_ps();
+
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            XMVECTOR r[4] = { x, y, z, w };
+            for (size_t k = 0; k < 4; ++k)
+            {
+                if (x2bias)
+                {
+                    XMVECTOR v2 = XMVectorMultiplyAdd(r[k], g_XMTwo, g_XMNegativeOne);
+                    r[k] = XMVectorSelect(r[k], v2, g_XMSelect1110);
+                }
+                *buffer++ = r[k];
+            }
+
+            ptr += stride * 4;
+        }
+    }
+
+    void LoadUByteN4Batch(_Out_writes_(count) XMVECTOR* buffer, const uint8_t* ptr, size_t stride, size_t count, bool x2bias)
+    {
+        static const XMVECTORF32 s_Scale = { { { 1.f / 255.f, 1.f / 255.f, 1.f / 255.f, 1.f / 255.f } } };
+
+        const __m128i zero = _mm_setzero_si128();
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            __m128i v = Gather32(ptr, stride);
+
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+            XMVECTOR r[4] =
+            {
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+                _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)),
+                _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero))
+            };
+
+            for (size_t k = 0; k < 4; ++k)
+            {
+                XMVECTOR n = XMVectorMultiply(r[k], s_Scale);
+                if (x2bias)
+                {
+                    n = XMVectorMultiplyAdd(n, g_XMTwo, g_XMNegativeOne);
+                }
+                *buffer++ = n;
+            }
+
+            ptr += stride * 4;
+        }
+    }
 #endif
 }
 
@@ -70,6 +301,7 @@ public:
     HRESULT Initialize(_In_reads_(nDecl) const InputElementDesc* vbDecl, size_t nDecl);
     HRESULT AddStream(_In_reads_bytes_(stride*nVerts) const void* vb, size_t nVerts, size_t inputSlot, size_t stride);
     HRESULT Read(_Out_writes_(count) XMVECTOR* buffer, _In_z_ const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const;
+    HRESULT Read(_In_reads_(nElements) const VBElementData* elements, size_t nElements, size_t count) const;
 
     void Release()
     {
@@ -120,6 +352,8 @@ public:
     }
 
 private:
+    HRESULT ReadElement(const InputElementDesc& desc, _Out_writes_(count) XMVECTOR* buffer, size_t first, size_t count, bool x2bias) const;
+
     typedef std::multimap<std::string, uint32_t> SemanticMap;
 
     std::vector<InputElementDesc>           mInputDesc;
@@ -274,31 +508,29 @@ HRESULT VBReader::Impl::AddStream(const void* vb, size_t nVerts, size_t inputSlo
         }\
         break;
 
+#if defined(_XM_SSE_INTRINSICS_)
+#define LOAD_BATCH( type, func )\
+        {\
+            size_t batch = BatchCount(ptr, eptr, stride, sizeof(type), count);\
+            func( buffer, ptr, stride, batch, x2bias );\
+            buffer += batch;\
+            ptr += stride * batch;\
+            count -= batch;\
+        }
+#else
+#define LOAD_BATCH( type, func )
+#endif
+
 _Use_decl_annotations_
-HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const
+HRESULT VBReader::Impl::ReadElement(const InputElementDesc& desc, XMVECTOR* buffer, size_t first, size_t count, bool x2bias) const
 {
-    if (!buffer || !semanticName || !count)
-        return E_INVALIDARG;
-
-    auto range = mSemantics.equal_range(semanticName);
-
-    auto it = range.first;
-    for (; it != range.second; ++it)
-    {
-        if (mInputDesc[it->second].SemanticIndex == semanticIndex)
-            break;
-    }
-
-    if (it == range.second)
-        return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
-
-    uint32_t inputSlot = mInputDesc[it->second].InputSlot;
+    uint32_t inputSlot = desc.InputSlot;
 
     auto vb = reinterpret_cast<const uint8_t*>(mBuffers[inputSlot]);
     if (!vb)
         return E_FAIL;
 
-    if (count > mVerts[inputSlot])
+    if ((first + count) > mVerts[inputSlot])
         return E_BOUNDS;
 
     uint32_t stride = mStrides[inputSlot];
@@ -306,9 +538,9 @@ HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigne
         return E_UNEXPECTED;
 
     const uint8_t* eptr = vb + stride * mVerts[inputSlot];
-    const uint8_t* ptr = vb + mInputDesc[it->second].AlignedByteOffset;
+    const uint8_t* ptr = vb + desc.AlignedByteOffset + stride * first;
 
-    switch (static_cast<int>(mInputDesc[it->second].Format))
+    switch (static_cast<int>(desc.Format))
     {
     case DXGI_FORMAT_R32G32B32A32_FLOAT:
         LOAD_VERTS(XMFLOAT4, XMLoadFloat4)
@@ -329,6 +561,7 @@ HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigne
         LOAD_VERTS(XMINT3, XMLoadSInt3)
 
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        LOAD_BATCH(XMHALF4, LoadHalf4Batch)
         LOAD_VERTS(XMHALF4, XMLoadHalf4)
 
     case DXGI_FORMAT_R16G16B16A16_UNORM:
@@ -359,9 +592,11 @@ HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigne
         LOAD_VERTS(XMUDEC4, XMLoadUDec4);
 
     case DXGI_FORMAT_R11G11B10_FLOAT:
+        LOAD_BATCH(XMFLOAT3PK, LoadFloat3PKBatch)
         LOAD_VERTS3_X2(XMFLOAT3PK, XMLoadFloat3PK, x2bias)
 
     case DXGI_FORMAT_R8G8B8A8_UNORM:
+        LOAD_BATCH(XMUBYTEN4, LoadUByteN4Batch)
         LOAD_VERTS4_X2(XMUBYTEN4, XMLoadUByteN4, x2bias)
 
     case DXGI_FORMAT_R8G8B8A8_UINT:
@@ -374,6 +609,7 @@ HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigne
         LOAD_VERTS(XMBYTE4, XMLoadByte4)
 
     case DXGI_FORMAT_R16G16_FLOAT:
+        LOAD_BATCH(XMHALF2, LoadHalf2Batch)
         LOAD_VERTS(XMHALF2, XMLoadHalf2)
 
     case DXGI_FORMAT_R16G16_UNORM:
@@ -639,6 +875,79 @@ HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigne
 }
 
 
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT VBReader::Impl::Read(XMVECTOR* buffer, const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const
+{
+    if (!buffer || !semanticName || !count)
+        return E_INVALIDARG;
+
+    auto desc = GetElement(semanticName, semanticIndex);
+    if (!desc)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+
+    return ReadElement(*desc, buffer, 0, count, x2bias);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT VBReader::Impl::Read(const VBElementData* elements, size_t nElements, size_t count) const
+{
+    if (!elements || !nElements || !count)
+        return E_INVALIDARG;
+
+    if (nElements > c_MaxElements)
+        return E_INVALIDARG;
+
+    // Resolve the semantics once for the whole buffer
+    const InputElementDesc* descs[c_MaxElements];
+
+    for (size_t j = 0; j < nElements; ++j)
+    {
+        if (!elements[j].semanticName || !elements[j].data || elements[j].type > VBELEMENT_FLOAT4)
+            return E_INVALIDARG;
+
+        descs[j] = GetElement(elements[j].semanticName, elements[j].semanticIndex);
+        if (!descs[j])
+            return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+
+        if (count > mVerts[descs[j]->InputSlot])
+            return E_BOUNDS;
+    }
+
+    // Convert a block of vertices for every element before moving on through the buffer
+    XMVECTOR temp[c_BlockVerts];
+
+    for (size_t first = 0; first < count; first += c_BlockVerts)
+    {
+        size_t n = std::min(c_BlockVerts, count - first);
+
+        for (size_t j = 0; j < nElements; ++j)
+        {
+            const VBElementData& element = elements[j];
+
+            if (element.type == VBELEMENT_VECTOR)
+            {
+                HRESULT hr = ReadElement(*descs[j], reinterpret_cast<XMVECTOR*>(element.data) + first, first, n, element.x2bias);
+                if (FAILED(hr))
+                    return hr;
+            }
+            else
+            {
+                HRESULT hr = ReadElement(*descs[j], temp, first, n, element.x2bias);
+                if (FAILED(hr))
+                    return hr;
+
+                StoreElements(element.type, element.data, first, temp, n);
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -790,6 +1099,13 @@ HRESULT VBReader::Read(XMFLOAT4* buffer, const char* semanticName, unsigned int
 }
 
 
+_Use_decl_annotations_
+HRESULT VBReader::Read(const VBElementData* elements, size_t nElements, size_t count) const
+{
+    return pImpl->Read(elements, nElements, count);
+}
+
+
 //-------------------------------------------------------------------------------------
 void VBReader::Release()
 {
@@ -22,6 +22,10 @@ namespace
 {
     const size_t c_MaxSlot = 32;
     const size_t c_MaxStride = 2048;
+    const size_t c_MaxElements = 32;
+
+    // Vertices converted at a time by a multi-element write, so an interleaved buffer stays in cache
+    const size_t c_BlockVerts = 256;
 
     enum INPUT_CLASSIFICATION
     {
@@ -46,6 +50,7 @@ namespace
     static_assert(static_cast<int>(PER_INSTANCE_DATA) == static_cast<int>(D3D11_INPUT_PER_INSTANCE_DATA), "D3D11 mismatch");
     static_assert(c_MaxSlot == D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "D3D11 mismatch");
     static_assert(c_MaxStride == D3D11_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES, "D3D11 mismatch");
+    static_assert(c_MaxElements == D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT, "D3D11 mismatch");
 #endif
 
 #if defined(__d3d12_h__) || defined(__d3d12_x_h__)
@@ -54,6 +59,309 @@ namespace
     static_assert(static_cast<int>(PER_INSTANCE_DATA) == static_cast<int>(D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA), "D3D12 mismatch");
     static_assert(c_MaxSlot == D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "D3D12 mismatch");
     static_assert(c_MaxStride == D3D12_REQ_MULTI_ELEMENT_STRUCTURE_SIZE_IN_BYTES, "D3D12 mismatch");
+    static_assert(c_MaxElements == D3D12_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT, "D3D12 mismatch");
+#endif
+
+    //---------------------------------------------------------------------------------
+    void LoadElements(VBELEMENT_TYPE type, _In_ const void* data, size_t first, _Out_writes_(count) XMVECTOR* dest, size_t count)
+    {
+        switch (type)
+        {
+        case VBELEMENT_FLOAT:
+            {
+                auto sptr = reinterpret_cast<const float*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    dest[j] = XMLoadFloat(sptr++);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT2:
+            {
+                auto sptr = reinterpret_cast<const XMFLOAT2*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    dest[j] = XMLoadFloat2(sptr++);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT3:
+            {
+                auto sptr = reinterpret_cast<const XMFLOAT3*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    dest[j] = XMLoadFloat3(sptr++);
+                }
+            }
+            break;
+
+        case VBELEMENT_FLOAT4:
+            {
+                auto sptr = reinterpret_cast<const XMFLOAT4*>(data) + first;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    dest[j] = XMLoadFloat4(sptr++);
+                }
+            }
+            break;
+
+        default:
+            assert(false);
+            break;
+        }
+    }
+
+
+#if defined(_XM_SSE_INTRINSICS_)
+    //---------------------------------------------------------------------------------
+    // Batched conversions for common compressed formats, 4 vertices per iteration.
+    // These produce the same results as the DirectXMath stores in the per-vertex loops;
+    // a group holding values outside the ranges converted here (such as denormalized,
+    // INF, or NAN values, whose handling differs between DirectXMath versions) is
+    // stored with those functions instead.
+    //---------------------------------------------------------------------------------
+
+    // Returns how many of count vertices at ptr fit in the buffer, rounded down to a multiple of 4
+    inline size_t BatchCount(const uint8_t* ptr, const uint8_t* eptr, size_t stride, size_t size, size_t count)
+    {
+        if ((ptr + size) > eptr)
+            return 0;
+
+        size_t fit = (size_t(eptr - ptr) - size) / stride + 1;
+        return std::min(fit, count) & ~size_t(3);
+    }
+
+    inline void XM_CALLCONV Scatter32(uint8_t* ptr, size_t stride, __m128i v)
+    {
+        *reinterpret_cast<int32_t*>(ptr) = _mm_cvtsi128_si32(v);
+        *reinterpret_cast<int32_t*>(ptr + stride) = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+        *reinterpret_cast<int32_t*>(ptr + stride * 2) = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+        *reinterpret_cast<int32_t*>(ptr + stride * 3) = _mm_cvtsi128_si32(_mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+    }
+
+    inline void XM_CALLCONV Scatter64(uint8_t* ptr, size_t stride, __m128i v)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(ptr), v);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(ptr + stride), _mm_unpackhi_epi64(v, v));
+    }
+
+    // Applies the x2bias of the per-vertex loops to 4 vertices, leaving the components where select is 0 unchanged
+    inline void XM_CALLCONV BiasBatch(_Out_writes_(4) XMVECTOR* dest, _In_reads_(4) const XMVECTOR* buffer, bool x2bias, FXMVECTOR select)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            XMVECTOR v = buffer[k];
+            if (x2bias)
+            {
+                XMVECTOR v2 = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                v2 = XMVectorMultiplyAdd(v2, g_XMOneHalf, g_XMOneHalf);
+                v = XMVectorSelect(v, v2, select);
+            }
+            dest[k] = v;
+        }
+    }
+
+#if !defined(_XM_F16C_INTRINSICS_)
+    // Converts 4 floats to halfs held in the low 16 bits of each lane, sign extended for _mm_packs_epi32. Lanes that
+    // are not zero or a normalized half are flagged in bad
+    inline __m128i XM_CALLCONV FloatToHalf(__m128 v, __m128i& bad)
+    {
+        const __m128i bits = _mm_castps_si128(v);
+        const __m128i expMant = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+        const __m128i sign = _mm_srai_epi32(_mm_andnot_si128(_mm_set1_epi32(0x7FFFFFFF), bits), 16);
+
+        // Rebias the exponent and round the mantissa to nearest even
+        __m128i h = _mm_sub_epi32(expMant, _mm_set1_epi32((112 << 23) - 0x0FFF));
+        h = _mm_add_epi32(h, _mm_and_si128(_mm_srli_epi32(expMant, 13), _mm_set1_epi32(1)));
+        h = _mm_srli_epi32(h, 13);
+
+        const __m128i zero = _mm_cmpeq_epi32(expMant, _mm_setzero_si128());
+        const __m128i normal = _mm_and_si128(_mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x387FFFFF)),
+                                             _mm_cmplt_epi32(expMant, _mm_set1_epi32(0x477FE001)));
+        bad = _mm_or_si128(bad, _mm_xor_si128(_mm_or_si128(zero, normal), _mm_set1_epi32(-1)));
+
+        return _mm_or_si128(_mm_andnot_si128(zero, h), sign);
+    }
+#endif
+
+    // Converts 8 floats to halfs, returning false if any is left to XMConvertFloatToHalf
+    inline bool XM_CALLCONV FloatToHalf(__m128 a, __m128 b, __m128i& h)
+    {
+#if defined(_XM_F16C_INTRINSICS_)
+        h = _mm_unpacklo_epi64(_mm_cvtps_ph(a, 0), _mm_cvtps_ph(b, 0));
+        return true;
+#else
+        __m128i bad = _mm_setzero_si128();
+        h = _mm_packs_epi32(FloatToHalf(a, bad), FloatToHalf(b, bad));
+        return !_mm_movemask_epi8(bad);
+#endif
+    }
+
+    // Converts 4 floats to unsigned small floats with a 5-bit exponent and mantissaBits of mantissa. Zero and negative
+    // values are stored as zero; lanes that are not one of those or a normalized value up to maxBits are flagged in bad
+    inline __m128i XM_CALLCONV FloatToSmallFloat(__m128 v, int mantissaBits, int maxBits, __m128i& bad)
+    {
+        const int shift = 23 - mantissaBits;
+
+        const __m128i bits = _mm_castps_si128(v);
+        const __m128i expMant = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+
+        __m128i f = _mm_sub_epi32(expMant, _mm_set1_epi32((112 << 23) - ((1 << (shift - 1)) - 1)));
+        f = _mm_add_epi32(f, _mm_and_si128(_mm_srl_epi32(expMant, _mm_cvtsi32_si128(shift)), _mm_set1_epi32(1)));
+        f = _mm_srl_epi32(f, _mm_cvtsi32_si128(shift));
+
+        const __m128i finite = _mm_cmplt_epi32(expMant, _mm_set1_epi32(0x7F800000));
+        const __m128i zero = _mm_or_si128(_mm_cmpeq_epi32(expMant, _mm_setzero_si128()),
+                                          _mm_and_si128(_mm_srai_epi32(bits, 31), finite));
+        const __m128i normal = _mm_and_si128(_mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x387FFFFF)),
+                                             _mm_cmplt_epi32(expMant, _mm_set1_epi32(maxBits + 1)));
+        bad = _mm_or_si128(bad, _mm_xor_si128(_mm_or_si128(zero, normal), _mm_set1_epi32(-1)));
+
+        return _mm_andnot_si128(zero, f);
+    }
+
+    void StoreHalf2Batch(uint8_t* ptr, size_t stride, _In_reads_(count) const XMVECTOR* buffer, size_t count, bool)
+    {
+        for (size_t j = 0; j < count; j += 4)
+        {
+            __m128i h;
+            if (FloatToHalf(_mm_movelh_ps(buffer[0], buffer[1]), _mm_movelh_ps(buffer[2], buffer[3]), h))
+            {
+                Scatter32(ptr, stride, h);
+            }
+            else
+            {
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    XMStoreHalf2(reinterpret_cast<XMHALF2*>(ptr + stride * k), buffer[k]);
+                }
+            }
+
+            buffer += 4;
+            ptr += stride * 4;
+        }
+    }
+
+    void StoreHalf4Batch(uint8_t* ptr, size_t stride, _In_reads_(count) const XMVECTOR* buffer, size_t count, bool)
+    {
+        for (size_t j = 0; j < count; j += 2)
+        {
+            __m128i h;
+            if (FloatToHalf(buffer[0], buffer[1], h))
+            {
+                Scatter64(ptr, stride, h);
+            }
+            else
+            {
+                XMStoreHalf4(reinterpret_cast<XMHALF4*>(ptr), buffer[0]);
+                XMStoreHalf4(reinterpret_cast<XMHALF4*>(ptr + stride), buffer[1]);
+            }
+
+            buffer += 2;
+            ptr += stride * 2;
+        }
+    }
+
+    void StoreFloat3PKBatch(uint8_t* ptr, size_t stride, _In_reads_(count) const XMVECTOR* buffer, size_t count, bool x2bias)
+    {
+        for (size_t j = 0; j < count; j += 4)
+        {
+            XMVECTOR v[4];
+            BiasBatch(v, buffer, x2bias, g_XMSelect1111);
+
+            XMVECTOR x = v[0];
+            XMVECTOR y = v[1];
+            XMVECTOR z = v[2];
+            XMVECTOR w = v[3];
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            // 11-bit x and y have a 6-bit mantissa, 10-bit z has a 5-bit mantissa
+            __m128i bad = _mm_setzero_si128();
+            __m128i fx = FloatToSmallFloat(x, 6, 0x477E0000, bad);
+            __m128i fy = FloatToSmallFloat(y, 6, 0x477E0000, bad);
+            __m128i fz = FloatToSmallFloat(z, 5, 0x477C0000, bad);
+
+            if (!_mm_movemask_epi8(bad))
+            {
+                Scatter32(ptr, stride, _mm_or_si128(_mm_or_si128(fx, _mm_slli_epi32(fy, 11)), _mm_slli_epi32(fz, 22)));
+            }
+            else
+            {
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    XMStoreFloat3PK(reinterpret_cast<XMFLOAT3PK*>(ptr + stride * k), v[k]);
+                }
+            }
+
+            buffer += 4;
+            ptr += stride * 4;
+        }
+    }
+
+    void StoreUDecN4Batch(uint8_t* ptr, size_t stride, _In_reads_(count) const XMVECTOR* buffer, size_t count, bool x2bias)
+    {
+        static const XMVECTORF32 s_Scale = { { { 1023.f, 1023.f, 1023.f, 3.f } } };
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            XMVECTOR v[4];
+            BiasBatch(v, buffer, x2bias, g_XMSelect1110);
+
+            // Saturate, scale, and truncate as XMStoreUDecN4 does
+            __m128i c[4];
+            for (size_t k = 0; k < 4; ++k)
+            {
+                XMVECTOR n = _mm_min_ps(_mm_max_ps(v[k], g_XMZero), g_XMOne);
+                c[k] = _mm_cvttps_epi32(_mm_mul_ps(n, s_Scale));
+            }
+
+            __m128i x = _mm_unpacklo_epi32(c[0], c[1]);
+            __m128i y = _mm_unpacklo_epi32(c[2], c[3]);
+            __m128i z = _mm_unpackhi_epi32(c[0], c[1]);
+            __m128i w = _mm_unpackhi_epi32(c[2], c[3]);
+
+            __m128i r = _mm_or_si128(_mm_unpacklo_epi64(x, y), _mm_slli_epi32(_mm_unpackhi_epi64(x, y), 10));
+            r = _mm_or_si128(r, _mm_slli_epi32(_mm_unpacklo_epi64(z, w), 20));
+            r = _mm_or_si128(r, _mm_slli_epi32(_mm_unpackhi_epi64(z, w), 30));
+
+            Scatter32(ptr, stride, r);
+
+            buffer += 4;
+            ptr += stride * 4;
+        }
+    }
+
+    void StoreUByteN4Batch(uint8_t* ptr, size_t stride, _In_reads_(count) const XMVECTOR* buffer, size_t count, bool x2bias)
+    {
+        static const XMVECTORF32 s_Scale = { { { 255.f, 255.f, 255.f, 255.f } } };
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            XMVECTOR v[4];
+            BiasBatch(v, buffer, x2bias, g_XMSelect1111);
+
+            // Saturate, scale, and truncate as XMStoreUByteN4 does
+            __m128i c[4];
+            for (size_t k = 0; k < 4; ++k)
+            {
+                XMVECTOR n = _mm_min_ps(_mm_max_ps(v[k], g_XMZero), g_XMOne);
+                c[k] = _mm_cvttps_epi32(_mm_mul_ps(n, s_Scale));
+            }
+
+            // Each lane is at most 255, so the packs do not saturate
+            __m128i r = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+
+            *reinterpret_cast<int32_t*>(ptr) = _mm_cvtsi128_si32(r);
+            *reinterpret_cast<int32_t*>(ptr + stride) = _mm_cvtsi128_si32(_mm_srli_si128(r, 4));
+            *reinterpret_cast<int32_t*>(ptr + stride * 2) = _mm_cvtsi128_si32(_mm_srli_si128(r, 8));
+            *reinterpret_cast<int32_t*>(ptr + stride * 3) = _mm_cvtsi128_si32(_mm_srli_si128(r, 12));
+
+            buffer += 4;
+            ptr += stride * 4;
+        }
+    }
 #endif
 }
 
@@ -70,6 +378,7 @@ public:
     HRESULT Initialize(_In_reads_(nDecl) const InputElementDesc* vbDecl, size_t nDecl);
     HRESULT AddStream(_Out_writes_bytes_(stride*nVerts) void* vb, size_t nVerts, size_t inputSlot, size_t stride);
     HRESULT Write(_In_reads_(count) const XMVECTOR* buffer, _In_z_ const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const;
+    HRESULT Write(_In_reads_(nElements) const VBElementData* elements, size_t nElements, size_t count) const;
 
     void Release()
     {
@@ -120,6 +429,8 @@ public:
     }
 
 private:
+    HRESULT WriteElement(const InputElementDesc& desc, _In_reads_(count) const XMVECTOR* buffer, size_t first, size_t count, bool x2bias) const;
+
     typedef std::multimap<std::string, uint32_t> SemanticMap;
 
     std::vector<InputElementDesc>           mInputDesc;
@@ -242,31 +553,29 @@ HRESULT VBWriter::Impl::AddStream(void* vb, size_t nVerts, size_t inputSlot, siz
         }\
         break;
 
+#if defined(_XM_SSE_INTRINSICS_)
+#define STORE_BATCH( type, func )\
+        {\
+            size_t batch = BatchCount(ptr, eptr, stride, sizeof(type), count);\
+            func( ptr, stride, buffer, batch, x2bias );\
+            buffer += batch;\
+            ptr += stride * batch;\
+            count -= batch;\
+        }
+#else
+#define STORE_BATCH( type, func )
+#endif
+
 _Use_decl_annotations_
-HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const
+HRESULT VBWriter::Impl::WriteElement(const InputElementDesc& desc, const XMVECTOR* buffer, size_t first, size_t count, bool x2bias) const
 {
-    if (!buffer || !semanticName || !count)
-        return E_INVALIDARG;
-
-    auto range = mSemantics.equal_range(semanticName);
-
-    auto it = range.first;
-    for (; it != range.second; ++it)
-    {
-        if (mInputDesc[it->second].SemanticIndex == semanticIndex)
-            break;
-    }
-
-    if (it == range.second)
-        return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
-
-    uint32_t inputSlot = mInputDesc[it->second].InputSlot;
+    uint32_t inputSlot = desc.InputSlot;
 
     auto vb = reinterpret_cast<uint8_t*>(mBuffers[inputSlot]);
     if (!vb)
         return E_FAIL;
 
-    if (count > mVerts[inputSlot])
+    if ((first + count) > mVerts[inputSlot])
         return E_BOUNDS;
 
     uint32_t stride = mStrides[inputSlot];
@@ -274,9 +583,9 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
         return E_UNEXPECTED;
 
     const uint8_t* eptr = vb + stride * mVerts[inputSlot];
-    uint8_t* ptr = vb + mInputDesc[it->second].AlignedByteOffset;
+    uint8_t* ptr = vb + desc.AlignedByteOffset + stride * first;
 
-    switch (static_cast<int>(mInputDesc[it->second].Format))
+    switch (static_cast<int>(desc.Format))
     {
     case DXGI_FORMAT_R32G32B32A32_FLOAT:
         STORE_VERTS(XMFLOAT4, XMStoreFloat4)
@@ -297,6 +606,7 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
         STORE_VERTS(XMINT3, XMStoreSInt3)
 
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        STORE_BATCH(XMHALF4, StoreHalf4Batch)
         STORE_VERTS(XMHALF4, XMStoreHalf4)
 
     case DXGI_FORMAT_R16G16B16A16_UNORM:
@@ -321,6 +631,7 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
         STORE_VERTS(XMINT2, XMStoreSInt2)
 
     case DXGI_FORMAT_R10G10B10A2_UNORM:
+        STORE_BATCH(XMUDECN4, StoreUDecN4Batch)
         for (size_t icount = 0; icount < count; ++icount)
         {
             if ((ptr + sizeof(XMUDECN4)) > eptr)
@@ -341,9 +652,11 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
         STORE_VERTS(XMUDEC4, XMStoreUDec4);
 
     case DXGI_FORMAT_R11G11B10_FLOAT:
+        STORE_BATCH(XMFLOAT3PK, StoreFloat3PKBatch)
         STORE_VERTS_X2(XMFLOAT3PK, XMStoreFloat3PK, x2bias)
 
     case DXGI_FORMAT_R8G8B8A8_UNORM:
+        STORE_BATCH(XMUBYTEN4, StoreUByteN4Batch)
         STORE_VERTS_X2(XMUBYTEN4, XMStoreUByteN4, x2bias)
 
     case DXGI_FORMAT_R8G8B8A8_UINT:
@@ -356,6 +669,7 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
         STORE_VERTS(XMBYTE4, XMStoreByte4)
 
     case DXGI_FORMAT_R16G16_FLOAT:
+        STORE_BATCH(XMHALF2, StoreHalf2Batch)
         STORE_VERTS(XMHALF2, XMStoreHalf2)
 
     case DXGI_FORMAT_R16G16_UNORM:
@@ -637,6 +951,79 @@ HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName,
 }
 
 
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT VBWriter::Impl::Write(const XMVECTOR* buffer, const char* semanticName, unsigned int semanticIndex, size_t count, bool x2bias) const
+{
+    if (!buffer || !semanticName || !count)
+        return E_INVALIDARG;
+
+    auto desc = GetElement(semanticName, semanticIndex);
+    if (!desc)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+
+    return WriteElement(*desc, buffer, 0, count, x2bias);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT VBWriter::Impl::Write(const VBElementData* elements, size_t nElements, size_t count) const
+{
+    if (!elements || !nElements || !count)
+        return E_INVALIDARG;
+
+    if (nElements > c_MaxElements)
+        return E_INVALIDARG;
+
+    // Resolve the semantics once for the whole buffer
+    const InputElementDesc* descs[c_MaxElements];
+
+    for (size_t j = 0; j < nElements; ++j)
+    {
+        if (!elements[j].semanticName || !elements[j].data || elements[j].type > VBELEMENT_FLOAT4)
+            return E_INVALIDARG;
+
+        descs[j] = GetElement(elements[j].semanticName, elements[j].semanticIndex);
+        if (!descs[j])
+            return HRESULT_FROM_WIN32(ERROR_INVALID_NAME);
+
+        if (count > mVerts[descs[j]->InputSlot])
+            return E_BOUNDS;
+    }
+
+    // Convert a block of vertices for every element before moving on through the buffer
+    XMVECTOR temp[c_BlockVerts];
+
+    for (size_t first = 0; first < count; first += c_BlockVerts)
+    {
+        size_t n = std::min(c_BlockVerts, count - first);
+
+        for (size_t j = 0; j < nElements; ++j)
+        {
+            const VBElementData& element = elements[j];
+
+            if (element.type == VBELEMENT_VECTOR)
+            {
+                HRESULT hr = WriteElement(*descs[j], reinterpret_cast<const XMVECTOR*>(element.data) + first, first, n, element.x2bias);
+                if (FAILED(hr))
+                    return hr;
+            }
+            else
+            {
+                LoadElements(element.type, element.data, first, temp, n);
+
+                HRESULT hr = WriteElement(*descs[j], temp, first, n, element.x2bias);
+                if (FAILED(hr))
+                    return hr;
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -776,6 +1163,13 @@ HRESULT VBWriter::Write(const XMFLOAT4* buffer, const char* semanticName, unsign
 }
 
 
+_Use_decl_annotations_
+HRESULT VBWriter::Write(const VBElementData* elements, size_t nElements, size_t count) const
+{
+    return pImpl->Write(elements, nElements, count);
+}
+
+
 //-------------------------------------------------------------------------------------
 void VBWriter::Release()
 {
@@ -185,11 +185,10 @@ namespace
                 for (size_t point = 0; point < 3; ++point)
                 {
                     uint32_t k = adjacency[face * 3 + point];
-                    if (k == UNUSED32)
+                    // Out of range neighbors were reported above
+                    if (k >= nFaces)
                         continue;
 
-                    assert(k < nFaces);
-
                     uint32_t edge = find_edge<uint32_t>(&adjacency[k * 3], uint32_t(face));
                     if (edge >= 3)
                     {
@@ -249,7 +248,7 @@ namespace
     HRESULT ValidateNoBowties(
         _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
         _In_ size_t nVerts, _In_reads_opt_(nFaces * 3) const uint32_t* adjacency,
-        _In_opt_ std::wstring* msgs)
+        _In_opt_ std::wstring* msgs, _Inout_updates_opt_(nFaces) uint8_t* faceErrors = nullptr)
     {
         if (!adjacency)
         {
@@ -260,7 +259,7 @@ namespace
         }
 
         size_t tsize = (sizeof(bool) * nFaces * 3) + (sizeof(index_t) * nVerts * 2) + (sizeof(bool) * nVerts);
-        std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[tsize]);
+        auto temp = make_scratch<uint8_t>(tsize);
         if (!temp)
             return E_OUTOFMEMORY;
 
@@ -328,23 +327,29 @@ namespace
                     {
                         // We found a (unique) bowtie!
 
-                        if (!msgs)
+                        if (!msgs && !faceErrors)
                             return E_FAIL;
 
-                        if (result)
+                        if (faceErrors)
+                            faceErrors[curFace] |= VALIDATE_ERROR_BOWTIE;
+
+                        if (msgs)
                         {
-                            // If this is the first bowtie found, add a quick explanation
-                            *msgs += L"A bowtie was found.  Bowties can be fixed by calling Clean\n"
-                                L"  A bowtie is the usage of a single vertex by two separate fans of triangles.\n"
-                                L"  The fix is to duplicate the vertex so that each fan has its own vertex.\n";
-                            result = false;
+                            if (result)
+                            {
+                                // If this is the first bowtie found, add a quick explanation
+                                *msgs += L"A bowtie was found.  Bowties can be fixed by calling Clean\n"
+                                    L"  A bowtie is the usage of a single vertex by two separate fans of triangles.\n"
+                                    L"  The fix is to duplicate the vertex so that each fan has its own vertex.\n";
+                            }
+
+                            wchar_t buff[256];
+                            swprintf_s(buff, L"\nBowtie found around vertex %u shared by faces %u and %u\n", j, curFace, faceUsing[j]);
+                            *msgs += buff;
                         }
 
+                        result = false;
                         vertexBowtie[j] = true;
-
-                        wchar_t buff[256];
-                        swprintf_s(buff, L"\nBowtie found around vertex %u shared by faces %u and %u\n", j, curFace, faceUsing[j]);
-                        *msgs += buff;
                     }
                 }
             }
@@ -352,8 +357,173 @@ namespace
 
         return result ? S_OK : E_FAIL;
     }
+
+    //---------------------------------------------------------------------------------
+    // Returns the VALIDATE_ERROR bits for one face, making the same checks as
+    // ValidateIndices. Faces are independent, so they can be checked on any thread.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    uint32_t CheckFace(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_ size_t nVerts, _In_reads_opt_(nFaces * 3) const uint32_t* adjacency,
+        _In_ DWORD flags, size_t face)
+    {
+        uint32_t errors = VALIDATE_ERROR_NONE;
+
+        const index_t* f = &indices[face * 3];
+        const uint32_t* adj = (adjacency) ? &adjacency[face * 3] : nullptr;
+
+        // Check for values in-range
+        for (size_t point = 0; point < 3; ++point)
+        {
+            if (f[point] >= nVerts && f[point] != index_t(-1))
+                errors |= VALIDATE_ERROR_INDEX;
+
+            if (adj && adj[point] >= nFaces && adj[point] != UNUSED32)
+                errors |= VALIDATE_ERROR_NEIGHBOR;
+        }
+
+        // Check for unused faces
+        if (f[0] == index_t(-1) || f[1] == index_t(-1) || f[2] == index_t(-1))
+        {
+            if (flags & VALIDATE_UNUSED)
+            {
+                if (f[0] != f[1] || f[0] != f[2])
+                    errors |= VALIDATE_ERROR_UNUSED;
+
+                if (adj && (adj[0] != UNUSED32 || adj[1] != UNUSED32 || adj[2] != UNUSED32))
+                    errors |= VALIDATE_ERROR_UNUSED;
+            }
+
+            return errors;
+        }
+
+        // Check for degenerate triangles
+        if (f[0] == f[1] || f[0] == f[2] || f[1] == f[2])
+        {
+            if (flags & VALIDATE_DEGENERATE)
+                errors |= VALIDATE_ERROR_DEGENERATE;
+
+            return errors;
+        }
+
+        if (!adj)
+            return errors;
+
+        // Check for symmetric neighbors
+        if (flags & VALIDATE_ASYMMETRIC_ADJ)
+        {
+            for (size_t point = 0; point < 3; ++point)
+            {
+                uint32_t k = adj[point];
+                if (k >= nFaces)
+                    continue;
+
+                if (find_edge<uint32_t>(&adjacency[k * 3], uint32_t(face)) >= 3)
+                    errors |= VALIDATE_ERROR_ASYMMETRIC_ADJ;
+            }
+        }
+
+        // Check for duplicate neighbor
+        if (flags & VALIDATE_BACKFACING)
+        {
+            if ((adj[0] == adj[1] && adj[0] != UNUSED32)
+                || (adj[0] == adj[2] && adj[0] != UNUSED32)
+                || (adj[1] == adj[2] && adj[1] != UNUSED32))
+            {
+                errors |= VALIDATE_ERROR_BACKFACING;
+            }
+        }
+
+        return errors;
+    }
+
+    // Faces are checked in blocks of this size, which is also how often an early exit is noticed
+    const size_t c_ValidateBlockFaces = 16384;
+
+    //---------------------------------------------------------------------------------
+    // Checks the faces across threads, and then the bowties. Without faceErrors and
+    // errors, stops at the first problem found.
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ValidateFast(
+        _In_reads_(nFaces * 3) const index_t* indices, _In_ size_t nFaces,
+        _In_ size_t nVerts, _In_reads_opt_(nFaces * 3) const uint32_t* adjacency,
+        _In_ DWORD flags, _Out_writes_opt_(nFaces) uint8_t* faceErrors, _Out_opt_ DWORD* errors)
+    {
+        if (!adjacency && (flags & (VALIDATE_BACKFACING | VALIDATE_ASYMMETRIC_ADJ)))
+            return E_INVALIDARG;
+
+        const bool earlyExit = !faceErrors && !errors;
+
+        DWORD mask = VALIDATE_ERROR_NONE;
+        std::atomic<bool> failed(false);
+
+        auto nBlocks = int((nFaces + c_ValidateBlockFaces - 1) / c_ValidateBlockFaces);
+
+        #pragma omp parallel for schedule(dynamic) reduction(|: mask)
+        for (int block = 0; block < nBlocks; ++block)
+        {
+            if (earlyExit && failed.load(std::memory_order_relaxed))
+                continue;
+
+            size_t begin = size_t(block) * c_ValidateBlockFaces;
+            size_t end = std::min(nFaces, begin + c_ValidateBlockFaces);
+
+            for (size_t face = begin; face < end; ++face)
+            {
+                uint32_t error = CheckFace<index_t>(indices, nFaces, nVerts, adjacency, flags, face);
+
+                if (faceErrors)
+                    faceErrors[face] = uint8_t(error);
+
+                if (error)
+                {
+                    mask |= error;
+
+                    if (earlyExit)
+                    {
+                        failed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (earlyExit && mask)
+            return E_FAIL;
+
+        if (!adjacency && (flags & VALIDATE_BOWTIES))
+            return E_INVALIDARG;
+
+        // The fan walks assume valid indices and symmetric neighbors
+        if ((flags & VALIDATE_BOWTIES) && !(mask & (VALIDATE_ERROR_INDEX | VALIDATE_ERROR_NEIGHBOR | VALIDATE_ERROR_ASYMMETRIC_ADJ)))
+        {
+            HRESULT hr = ValidateNoBowties<index_t>(indices, nFaces, nVerts, adjacency, nullptr, faceErrors);
+            if (hr == E_FAIL)
+            {
+                mask |= VALIDATE_ERROR_BOWTIE;
+            }
+            else if (FAILED(hr))
+                return hr;
+        }
+
+        if (errors)
+            *errors = mask;
+
+        return (mask) ? E_FAIL : S_OK;
+    }
 }
 
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeValidate(size_t nFaces, size_t nVerts)
+{
+    return ScratchBytes((sizeof(bool) * nFaces * 3) + (sizeof(uint32_t) * nVerts * 2) + (sizeof(bool) * nVerts));
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -364,6 +534,8 @@ HRESULT DirectX::Validate(
     const uint16_t* indices, size_t nFaces, size_t nVerts,
     const uint32_t* adjacency, DWORD flags, std::wstring* msgs)
 {
+    stage_stats stats("Validate", nFaces, nVerts);
+
     if (!indices || !nFaces || !nVerts)
         return E_INVALIDARG;
 
@@ -376,7 +548,12 @@ HRESULT DirectX::Validate(
     if (msgs)
         msgs->clear();
 
-    HRESULT hr = ValidateIndices<uint16_t>(indices, nFaces, nVerts, adjacency, flags, msgs);
+    // Problems are rare, so messages are only built once the fast checks find one
+    HRESULT hr = ValidateFast<uint16_t>(indices, nFaces, nVerts, adjacency, flags, nullptr, nullptr);
+    if (SUCCEEDED(hr) || !msgs || hr == E_OUTOFMEMORY)
+        return hr;
+
+    hr = ValidateIndices<uint16_t>(indices, nFaces, nVerts, adjacency, flags, msgs);
     if (FAILED(hr))
         return hr;
 
@@ -397,6 +574,8 @@ HRESULT DirectX::Validate(
     const uint32_t* indices, size_t nFaces, size_t nVerts,
     const uint32_t* adjacency, DWORD flags, std::wstring* msgs)
 {
+    stage_stats stats("Validate", nFaces, nVerts);
+
     if (!indices || !nFaces || !nVerts)
         return E_INVALIDARG;
 
@@ -409,7 +588,12 @@ HRESULT DirectX::Validate(
     if (msgs)
         msgs->clear();
 
-    HRESULT hr = ValidateIndices<uint32_t>(indices, nFaces, nVerts, adjacency, flags, msgs);
+    // Problems are rare, so messages are only built once the fast checks find one
+    HRESULT hr = ValidateFast<uint32_t>(indices, nFaces, nVerts, adjacency, flags, nullptr, nullptr);
+    if (SUCCEEDED(hr) || !msgs || hr == E_OUTOFMEMORY)
+        return hr;
+
+    hr = ValidateIndices<uint32_t>(indices, nFaces, nVerts, adjacency, flags, msgs);
     if (FAILED(hr))
         return hr;
 
@@ -422,3 +606,51 @@ HRESULT DirectX::Validate(
 
     return S_OK;
 }
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ValidateFaces(
+    const uint16_t* indices, size_t nFaces, size_t nVerts,
+    const uint32_t* adjacency, DWORD flags, uint8_t* faceErrors, DWORD* errors)
+{
+    stage_stats stats("ValidateFaces", nFaces, nVerts);
+
+    if (!indices || !nFaces || !nVerts)
+        return E_INVALIDARG;
+
+    if (nVerts >= UINT16_MAX)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (errors)
+        *errors = VALIDATE_ERROR_NONE;
+
+    return ValidateFast<uint16_t>(indices, nFaces, nVerts, adjacency, flags, faceErrors, errors);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ValidateFaces(
+    const uint32_t* indices, size_t nFaces, size_t nVerts,
+    const uint32_t* adjacency, DWORD flags, uint8_t* faceErrors, DWORD* errors)
+{
+    stage_stats stats("ValidateFaces", nFaces, nVerts);
+
+    if (!indices || !nFaces || !nVerts)
+        return E_INVALIDARG;
+
+    if (nVerts >= UINT32_MAX)
+        return E_INVALIDARG;
+
+    if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    if (errors)
+        *errors = VALIDATE_ERROR_NONE;
+
+    return ValidateFast<uint32_t>(indices, nFaces, nVerts, adjacency, flags, faceErrors, errors);
+}
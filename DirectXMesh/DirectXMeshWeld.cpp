@@ -0,0 +1,498 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshWeld.cpp
+//
+// DirectX Mesh Geometry Library - Vertex welding
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Matches the input layout limit of VBReader
+    const size_t c_MaxWeldElements = 32;
+
+    // Cell coordinates are clamped so that neighboring cells never overflow
+    const float c_MaxCell = 1073741824.f;
+
+    //---------------------------------------------------------------------------------
+    // Spatial hash of the first element's x, y, and z. With a tolerance each component
+    // is quantized to cells of that size, so vertices within tolerance are in the same
+    // or adjacent cells; without one the cells are the exact values.
+    //---------------------------------------------------------------------------------
+    struct weld_cell
+    {
+        int32_t c[3];
+    };
+
+    inline int32_t QuantizeComponent(float value, float tolerance)
+    {
+        if (tolerance > 0.f)
+        {
+            float cell = floorf(value / tolerance);
+            if (!(cell > -c_MaxCell))
+                cell = -c_MaxCell;
+            else if (cell > c_MaxCell)
+                cell = c_MaxCell;
+
+            return int32_t(cell);
+        }
+
+        // Adding zero folds -0 into +0, which compares equal to it
+        value += 0.f;
+
+        int32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline weld_cell ComputeCell(const XMFLOAT4& value, float tolerance)
+    {
+        weld_cell cell;
+        cell.c[0] = QuantizeComponent(value.x, tolerance);
+        cell.c[1] = QuantizeComponent(value.y, tolerance);
+        cell.c[2] = QuantizeComponent(value.z, tolerance);
+        return cell;
+    }
+
+    inline uint32_t CellHashKey(int32_t x, int32_t y, int32_t z, size_t hashSize)
+    {
+        uint32_t hash = (uint32_t(x) * 73856093u) ^ (uint32_t(y) * 19349663u) ^ (uint32_t(z) * 83492791u);
+        return uint32_t(hash % hashSize);
+    }
+
+
+    //---------------------------------------------------------------------------------
+    class vertex_welder
+    {
+    public:
+        vertex_welder(
+            _In_reads_(nVerts * nElements) const XMFLOAT4* data, size_t nVerts,
+            _In_reads_(nElements) const float* tolerances, size_t nElements,
+            _Inout_updates_all_(hashSize) uint32_t* heads, size_t hashSize,
+            _Inout_updates_all_(nVerts) uint32_t* next) :
+            mData(data),
+            mNVerts(nVerts),
+            mTolerances(tolerances),
+            mNElements(nElements),
+            mHeads(heads),
+            mHashSize(hashSize),
+            mNext(next)
+        {
+        }
+
+        // Returns the earliest welded vertex within tolerance of vert, adding vert as a new
+        // one if there is none. Vertices of a bucket must be added in increasing order.
+        uint32_t Weld(uint32_t vert)
+        {
+            float tolerance = mTolerances[0];
+
+            weld_cell cell = ComputeCell(mData[vert], tolerance);
+
+            uint32_t found = UNUSED32;
+
+            if (tolerance > 0.f)
+            {
+                for (int32_t dz = -1; dz <= 1; ++dz)
+                {
+                    for (int32_t dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int32_t dx = -1; dx <= 1; ++dx)
+                        {
+                            uint32_t hashKey = CellHashKey(cell.c[0] + dx, cell.c[1] + dy, cell.c[2] + dz, mHashSize);
+                            found = Search(hashKey, vert, found);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                found = Search(CellHashKey(cell.c[0], cell.c[1], cell.c[2], mHashSize), vert, found);
+            }
+
+            if (found != UNUSED32)
+                return found;
+
+            Add(vert, cell);
+
+            return vert;
+        }
+
+        // Adds vert to the hash without welding it
+        void Add(uint32_t vert)
+        {
+            Add(vert, ComputeCell(mData[vert], mTolerances[0]));
+        }
+
+        // With every vertex added, each bucket in increasing order, returns the vertex vert welds to given the remap
+        // of the vertices before it, or UNUSED32 if that depends on an earlier vertex whose remap is still UNUSED32
+        uint32_t Resolve(uint32_t vert, _In_ const uint32_t* remap) const
+        {
+            weld_cell cell = ComputeCell(mData[vert], mTolerances[0]);
+
+            uint32_t found = UNUSED32;
+            uint32_t pending = UNUSED32;
+
+            for (int32_t dz = -1; dz <= 1; ++dz)
+            {
+                for (int32_t dy = -1; dy <= 1; ++dy)
+                {
+                    for (int32_t dx = -1; dx <= 1; ++dx)
+                    {
+                        uint32_t hashKey = CellHashKey(cell.c[0] + dx, cell.c[1] + dy, cell.c[2] + dz, mHashSize);
+                        for (uint32_t other = mHeads[hashKey]; other < vert && other < std::min(found, pending); other = mNext[other])
+                        {
+                            // Welded vertices are never the one welded to
+                            uint32_t state = remap[other];
+                            if ((state != UNUSED32 && state != other) || !IsNear(other, vert))
+                                continue;
+
+                            if (state == UNUSED32)
+                                pending = other;
+                            else
+                                found = other;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (pending < found)
+                return UNUSED32;
+
+            return (found != UNUSED32) ? found : vert;
+        }
+
+    private:
+        void Add(uint32_t vert, const weld_cell& cell)
+        {
+            uint32_t hashKey = CellHashKey(cell.c[0], cell.c[1], cell.c[2], mHashSize);
+            mNext[vert] = mHeads[hashKey];
+            mHeads[hashKey] = vert;
+        }
+
+        uint32_t Search(uint32_t hashKey, uint32_t vert, uint32_t found) const
+        {
+            for (uint32_t other = mHeads[hashKey]; other != UNUSED32; other = mNext[other])
+            {
+                if (other < found && IsNear(other, vert))
+                    found = other;
+            }
+
+            return found;
+        }
+
+        bool IsNear(uint32_t a, uint32_t b) const
+        {
+            for (size_t j = 0; j < mNElements; ++j)
+            {
+                const XMFLOAT4* element = mData + j * mNVerts;
+
+                XMVECTOR va = XMLoadFloat4(&element[a]);
+                XMVECTOR vb = XMLoadFloat4(&element[b]);
+
+                if (!XMVector4NearEqual(va, vb, XMVectorReplicate(mTolerances[j])))
+                    return false;
+            }
+
+            return true;
+        }
+
+        const XMFLOAT4* mData;
+        size_t          mNVerts;
+        const float*    mTolerances;
+        size_t          mNElements;
+        uint32_t*       mHeads;
+        size_t          mHashSize;
+        uint32_t*       mNext;
+    };
+
+
+#ifdef _OPENMP
+    //---------------------------------------------------------------------------------
+    // Parallel support
+    //---------------------------------------------------------------------------------
+
+    // Smaller vertex sets are always welded serially
+    const size_t c_MinParallelCount = 65536;
+
+    // Vertices resolved together by the toleranced weld, after all those before them
+    const size_t c_ResolveWindow = 16384;
+
+    //---------------------------------------------------------------------------------
+    // Without a position tolerance a vertex only searches its own bucket, so the buckets
+    // are split across threads and each partition is walked in vertex order. This welds
+    // exactly like the serial loop.
+    //---------------------------------------------------------------------------------
+    HRESULT WeldExactParallel(
+        _In_reads_(nVerts * nElements) const XMFLOAT4* data, size_t nVerts,
+        _In_reads_(nElements) const float* tolerances, size_t nElements,
+        _Inout_updates_all_(hashSize) uint32_t* heads, size_t hashSize,
+        _Inout_updates_all_(nVerts) uint32_t* next,
+        _Out_writes_(nVerts) uint32_t* vertexRemap)
+    {
+        auto nBlocks = uint32_t(omp_get_max_threads());
+        uint32_t nParts = nBlocks * 4;
+
+        auto temp = make_scratch<uint32_t>(nVerts * 2);
+        auto counts = make_scratch<size_t>(nBlocks * nParts + nParts + 1);
+        if (!temp || !counts)
+            return E_OUTOFMEMORY;
+
+        uint32_t* partKeys = temp.get();
+        uint32_t* order = temp.get() + nVerts;
+        size_t* partOffsets = counts.get() + nBlocks * nParts;
+
+        #pragma omp parallel for
+        for (int vert = 0; vert < int(nVerts); ++vert)
+        {
+            weld_cell cell = ComputeCell(data[vert], 0.f);
+            partKeys[vert] = CellHashKey(cell.c[0], cell.c[1], cell.c[2], hashSize) % nParts;
+        }
+
+        PartitionItems(partKeys, nVerts, nParts, nBlocks, counts.get(), order, partOffsets);
+
+        vertex_welder welder(data, nVerts, tolerances, nElements, heads, hashSize, next);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int part = 0; part < int(nParts); ++part)
+        {
+            for (size_t j = partOffsets[part]; j < partOffsets[part + 1]; ++j)
+            {
+                uint32_t vert = order[j];
+                vertexRemap[vert] = welder.Weld(vert);
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    // With a position tolerance a vertex welds to the earliest unwelded vertex near it,
+    // which depends on the vertices before it in the 27 surrounding cells. Every vertex
+    // is added to the hash, partitioned by bucket as above, and then resolved a window at
+    // a time in rounds; a vertex is settled once no earlier vertex near it that could
+    // still be an unwelded one is unsettled. Whatever remains of a window when a round
+    // settles too few is finished in vertex order. This welds exactly like the serial loop.
+    //---------------------------------------------------------------------------------
+    HRESULT WeldToleranceParallel(
+        _In_reads_(nVerts * nElements) const XMFLOAT4* data, size_t nVerts,
+        _In_reads_(nElements) const float* tolerances, size_t nElements,
+        _Inout_updates_all_(hashSize) uint32_t* heads, size_t hashSize,
+        _Inout_updates_all_(nVerts) uint32_t* next,
+        _Out_writes_(nVerts) uint32_t* vertexRemap)
+    {
+        auto nBlocks = uint32_t(omp_get_max_threads());
+        uint32_t nParts = nBlocks * 4;
+
+        auto temp = make_scratch<uint32_t>(nVerts * 2);
+        auto counts = make_scratch<size_t>(nBlocks * nParts + nParts + 1);
+        if (!temp || !counts)
+            return E_OUTOFMEMORY;
+
+        uint32_t* partKeys = temp.get();
+        uint32_t* order = temp.get() + nVerts;
+        size_t* partOffsets = counts.get() + nBlocks * nParts;
+
+        float tolerance = tolerances[0];
+
+        #pragma omp parallel for
+        for (int vert = 0; vert < int(nVerts); ++vert)
+        {
+            weld_cell cell = ComputeCell(data[vert], tolerance);
+            partKeys[vert] = CellHashKey(cell.c[0], cell.c[1], cell.c[2], hashSize) % nParts;
+            vertexRemap[vert] = UNUSED32;
+        }
+
+        PartitionItems(partKeys, nVerts, nParts, nBlocks, counts.get(), order, partOffsets);
+
+        vertex_welder welder(data, nVerts, tolerances, nElements, heads, hashSize, next);
+
+        // Adding each partition in reverse leaves its buckets in increasing order
+        #pragma omp parallel for schedule(dynamic)
+        for (int part = 0; part < int(nParts); ++part)
+        {
+            for (size_t j = partOffsets[part + 1]; j > partOffsets[part]; --j)
+            {
+                welder.Add(order[j - 1]);
+            }
+        }
+
+        // The partitions are no longer needed, so the scratch now holds the unsettled vertices of a window
+        uint32_t* active = temp.get();
+        uint32_t* settled = temp.get() + nVerts;
+
+        for (size_t base = 0; base < nVerts; base += c_ResolveWindow)
+        {
+            size_t nActive = std::min(c_ResolveWindow, nVerts - base);
+            for (size_t j = 0; j < nActive; ++j)
+            {
+                active[j] = uint32_t(base + j);
+            }
+
+            while (nActive > 0)
+            {
+                #pragma omp parallel for schedule(dynamic, 256)
+                for (int j = 0; j < int(nActive); ++j)
+                {
+                    settled[j] = welder.Resolve(active[j], vertexRemap);
+                }
+
+                size_t remaining = 0;
+                for (size_t j = 0; j < nActive; ++j)
+                {
+                    if (settled[j] != UNUSED32)
+                        vertexRemap[active[j]] = settled[j];
+                    else
+                        active[remaining++] = active[j];
+                }
+
+                // Long chains of nearby vertices settle a few per round
+                bool progress = (nActive - remaining) * 4 >= nActive;
+                nActive = remaining;
+
+                if (!progress)
+                    break;
+            }
+
+            for (size_t j = 0; j < nActive; ++j)
+            {
+                uint32_t vert = active[j];
+                vertexRemap[vert] = welder.Resolve(vert, vertexRemap);
+                assert(vertexRemap[vert] != UNUSED32);
+            }
+        }
+
+        return S_OK;
+    }
+#endif
+}
+
+//-------------------------------------------------------------------------------------
+// Upper bound on the scratch taken on the calling thread, for ComputeScratchSize
+//-------------------------------------------------------------------------------------
+size_t DirectX::ScratchSizeWeld(size_t nVerts, size_t nElements)
+{
+    size_t bytes = ScratchBytes<XMFLOAT4>(nVerts * nElements) + ScratchBytes<float>(nElements) + ScratchBytes<uint32_t>(nVerts) * 2;
+
+#ifdef _OPENMP
+    size_t nBlocks = size_t(omp_get_max_threads());
+    size_t nParts = nBlocks * 4;
+
+    bytes += ScratchBytes<uint32_t>(nVerts * 2) + ScratchBytes<size_t>(nBlocks * nParts + nParts + 1);
+#endif
+
+    return bytes;
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT DirectX::WeldVertices(
+    const VBReader& reader, size_t nVerts,
+    const WeldElement* elements, size_t nElements,
+    uint32_t* vertexRemap, size_t& nWeldedVerts, uint32_t* vbRemap)
+{
+    stage_stats stats("WeldVertices", 0, nVerts);
+
+    nWeldedVerts = 0;
+
+    if (!nVerts || !elements || !nElements || !vertexRemap)
+        return E_INVALIDARG;
+
+    if (vbRemap == vertexRemap)
+        return E_INVALIDARG;
+
+    if (nVerts >= UINT32_MAX)
+        return E_INVALIDARG;
+
+    if (nElements > c_MaxWeldElements)
+        return E_INVALIDARG;
+
+    for (size_t j = 0; j < nElements; ++j)
+    {
+        if (!elements[j].semanticName || !(elements[j].tolerance >= 0.f) || elements[j].tolerance == INFINITY)
+            return E_INVALIDARG;
+    }
+
+    if ((uint64_t(nVerts) * nElements) >= (SIZE_MAX / sizeof(XMFLOAT4)))
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    auto data = make_scratch<XMFLOAT4>(nVerts * nElements);
+    auto tolerances = make_scratch<float>(nElements);
+    auto temp = make_scratch<uint32_t>(nVerts * 2);
+    if (!data || !tolerances || !temp)
+        return E_OUTOFMEMORY;
+
+    // Read all the elements in one pass over the vertex buffer
+    VBElementData reads[c_MaxWeldElements];
+    for (size_t j = 0; j < nElements; ++j)
+    {
+        VBElementData element = { elements[j].semanticName, elements[j].semanticIndex, VBELEMENT_FLOAT4, data.get() + j * nVerts, false };
+        reads[j] = element;
+
+        tolerances[j] = elements[j].tolerance;
+    }
+
+    HRESULT hr = reader.Read(reads, nElements, nVerts);
+    if (FAILED(hr))
+        return hr;
+
+    size_t hashSize = nVerts;
+
+    uint32_t* heads = temp.get();
+    uint32_t* next = temp.get() + nVerts;
+
+    memset(heads, 0xff, sizeof(uint32_t) * hashSize);
+
+    // Each vertex is first mapped to the earliest vertex it welds to
+#ifdef _OPENMP
+    if (nVerts >= c_MinParallelCount && omp_get_max_threads() > 1)
+    {
+        if (tolerances[0] > 0.f)
+            hr = WeldToleranceParallel(data.get(), nVerts, tolerances.get(), nElements, heads, hashSize, next, vertexRemap);
+        else
+            hr = WeldExactParallel(data.get(), nVerts, tolerances.get(), nElements, heads, hashSize, next, vertexRemap);
+        if (FAILED(hr))
+            return hr;
+    }
+    else
+#endif
+    {
+        vertex_welder welder(data.get(), nVerts, tolerances.get(), nElements, heads, hashSize, next);
+
+        for (uint32_t vert = 0; vert < nVerts; ++vert)
+        {
+            vertexRemap[vert] = welder.Weld(vert);
+        }
+    }
+
+    // Then renumbered in order of those earliest vertices, which always precede the vertices welded to them
+    uint32_t newVerts = 0;
+    for (uint32_t vert = 0; vert < nVerts; ++vert)
+    {
+        uint32_t first = vertexRemap[vert];
+        vertexRemap[vert] = (first == vert) ? newVerts++ : vertexRemap[first];
+
+        if (vbRemap)
+            vbRemap[vert] = (first == vert) ? vertexRemap[vert] : UNUSED32;
+    }
+
+    nWeldedVerts = newVerts;
+
+    return S_OK;
+}
@@ -0,0 +1,616 @@
+//-------------------------------------------------------------------------------------
+// DirectXMeshletGenerator.cpp
+//
+// DirectX Mesh Geometry Library - Meshlet generation and culling data
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//-------------------------------------------------------------------------------------
+
+#include "DirectXMeshP.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+    //---------------------------------------------------------------------------------
+    // Utilities
+    //---------------------------------------------------------------------------------
+
+    // Cones wider than this are not worth testing, so culling is disabled for them
+    const float c_MinConeDot = 0.1f;
+
+    // Faces are marked as used, free, or with the index of the meshlet that has them as candidates
+    const uint32_t c_FaceUsed = UINT32_MAX;
+    const uint32_t c_FaceFree = UINT32_MAX - 1;
+
+    inline XMVECTOR XM_CALLCONV FaceCentroid(FXMVECTOR p0, FXMVECTOR p1, FXMVECTOR p2)
+    {
+        return XMVectorMultiply(XMVectorAdd(XMVectorAdd(p0, p1), p2), XMVectorReplicate(1.f / 3.f));
+    }
+
+    // Builds meshlets one at a time from the faces of a subset
+    template<class index_t>
+    class MeshletBuilder
+    {
+    public:
+        MeshletBuilder(
+            _In_ const index_t* indices,
+            _In_ const XMFLOAT3* positions,
+            _In_ const uint32_t* adjacency,
+            _Inout_ uint32_t* vertexSlot,
+            _Inout_ uint32_t* faceMark,
+            size_t maxVerts, size_t maxPrims,
+            std::vector<Meshlet>& meshlets,
+            std::vector<uint8_t>& uniqueVertexIB,
+            std::vector<MeshletTriangle>& primitiveIndices) :
+            m_indices(indices),
+            m_positions(positions),
+            m_adjacency(adjacency),
+            m_vertexSlot(vertexSlot),
+            m_faceMark(faceMark),
+            m_maxVerts(maxVerts),
+            m_maxPrims(maxPrims),
+            m_subsetBegin(0),
+            m_subsetEnd(0),
+            m_meshlets(meshlets),
+            m_uniqueVertexIB(uniqueVertexIB),
+            m_primitiveIndices(primitiveIndices),
+            m_centroidSum(g_XMZero)
+        {
+            m_verts.reserve(maxVerts);
+            m_prims.reserve(maxPrims);
+            m_candidates.reserve(maxPrims * 3);
+        }
+
+        MeshletBuilder(MeshletBuilder const&) = delete;
+        MeshletBuilder& operator= (MeshletBuilder const&) = delete;
+
+        void Build(size_t faceOffset, size_t faceCount)
+        {
+            m_subsetBegin = faceOffset;
+            m_subsetEnd = faceOffset + faceCount;
+
+            size_t seed = faceOffset;
+            for (;;)
+            {
+                uint32_t face = PickCandidate();
+                if (face == UNUSED32)
+                {
+                    // a meshlet that still has neighbors but no room for them is complete
+                    if (!m_candidates.empty())
+                    {
+                        Flush();
+                        continue;
+                    }
+
+                    // otherwise continue from the next unused face in IB order
+                    while (seed < m_subsetEnd && m_faceMark[seed] == c_FaceUsed)
+                        ++seed;
+
+                    if (seed >= m_subsetEnd)
+                        break;
+
+                    if (!m_prims.empty() && NewVertexCount(seed) + m_verts.size() > m_maxVerts)
+                    {
+                        Flush();
+                        continue;
+                    }
+
+                    face = uint32_t(seed);
+                }
+
+                AddFace(face);
+
+                if (m_prims.size() >= m_maxPrims)
+                {
+                    Flush();
+                }
+            }
+
+            Flush();
+        }
+
+    private:
+        size_t NewVertexCount(size_t face) const
+        {
+            const index_t* corners = &m_indices[face * 3];
+
+            size_t count = 0;
+            for (size_t point = 0; point < 3; ++point)
+            {
+                if (m_vertexSlot[corners[point]] != UNUSED32)
+                    continue;
+
+                // degenerate faces repeat a corner
+                bool repeat = false;
+                for (size_t k = 0; k < point; ++k)
+                {
+                    if (corners[k] == corners[point])
+                        repeat = true;
+                }
+
+                if (!repeat)
+                    ++count;
+            }
+
+            return count;
+        }
+
+        // Chooses the candidate adding the fewest vertices, then the one nearest the meshlet centroid
+        uint32_t PickCandidate()
+        {
+            if (m_prims.empty())
+                return UNUSED32;
+
+            XMVECTOR center = XMVectorScale(m_centroidSum, 1.f / float(m_prims.size()));
+
+            uint32_t best = UNUSED32;
+            size_t bestNew = SIZE_MAX;
+            float bestDistance = 0.f;
+
+            size_t count = 0;
+            for (size_t j = 0; j < m_candidates.size(); ++j)
+            {
+                uint32_t face = m_candidates[j];
+                if (m_faceMark[face] == c_FaceUsed)
+                    continue;
+
+                m_candidates[count++] = face;
+
+                size_t newVerts = NewVertexCount(face);
+                if (m_verts.size() + newVerts > m_maxVerts)
+                    continue;
+
+                if (newVerts > bestNew)
+                    continue;
+
+                const index_t* corners = &m_indices[face * 3];
+                XMVECTOR centroid = FaceCentroid(XMLoadFloat3(&m_positions[corners[0]]),
+                    XMLoadFloat3(&m_positions[corners[1]]),
+                    XMLoadFloat3(&m_positions[corners[2]]));
+
+                float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(centroid, center)));
+
+                if (newVerts < bestNew || distance < bestDistance)
+                {
+                    best = face;
+                    bestNew = newVerts;
+                    bestDistance = distance;
+                }
+            }
+
+            m_candidates.resize(count);
+
+            return best;
+        }
+
+        void AddFace(uint32_t face)
+        {
+            m_faceMark[face] = c_FaceUsed;
+
+            const index_t* corners = &m_indices[face * 3];
+
+            uint32_t local[3];
+            for (size_t point = 0; point < 3; ++point)
+            {
+                index_t i = corners[point];
+                if (m_vertexSlot[i] == UNUSED32)
+                {
+                    m_vertexSlot[i] = uint32_t(m_verts.size());
+                    m_verts.push_back(i);
+                }
+
+                local[point] = m_vertexSlot[i];
+            }
+
+            MeshletTriangle tri;
+            tri.i0 = local[0];
+            tri.i1 = local[1];
+            tri.i2 = local[2];
+            m_prims.push_back(tri);
+
+            m_centroidSum = XMVectorAdd(m_centroidSum, FaceCentroid(XMLoadFloat3(&m_positions[corners[0]]),
+                XMLoadFloat3(&m_positions[corners[1]]),
+                XMLoadFloat3(&m_positions[corners[2]])));
+
+            // neighbors within the subset become candidates, marked with the meshlet being built
+            uint32_t mark = uint32_t(m_meshlets.size());
+            for (size_t point = 0; point < 3; ++point)
+            {
+                uint32_t neighbor = m_adjacency[face * 3 + point];
+                if (neighbor < m_subsetBegin || neighbor >= m_subsetEnd)
+                    continue;
+
+                if (m_faceMark[neighbor] == c_FaceUsed || m_faceMark[neighbor] == mark)
+                    continue;
+
+                m_faceMark[neighbor] = mark;
+                m_candidates.push_back(neighbor);
+            }
+        }
+
+        void Flush()
+        {
+            if (m_prims.empty())
+                return;
+
+            Meshlet meshlet;
+            meshlet.VertCount = uint32_t(m_verts.size());
+            meshlet.VertOffset = uint32_t(m_uniqueVertexIB.size() / sizeof(index_t));
+            meshlet.PrimCount = uint32_t(m_prims.size());
+            meshlet.PrimOffset = uint32_t(m_primitiveIndices.size());
+            m_meshlets.push_back(meshlet);
+
+            auto bytes = reinterpret_cast<const uint8_t*>(m_verts.data());
+            m_uniqueVertexIB.insert(m_uniqueVertexIB.end(), bytes, bytes + m_verts.size() * sizeof(index_t));
+            m_primitiveIndices.insert(m_primitiveIndices.end(), m_prims.cbegin(), m_prims.cend());
+
+            for (auto it = m_verts.cbegin(); it != m_verts.cend(); ++it)
+            {
+                m_vertexSlot[*it] = UNUSED32;
+            }
+
+            m_verts.clear();
+            m_prims.clear();
+            m_candidates.clear();
+            m_centroidSum = g_XMZero;
+        }
+
+        const index_t*                  m_indices;
+        const XMFLOAT3*                 m_positions;
+        const uint32_t*                 m_adjacency;
+        uint32_t*                       m_vertexSlot;
+        uint32_t*                       m_faceMark;
+        size_t                          m_maxVerts;
+        size_t                          m_maxPrims;
+        size_t                          m_subsetBegin;
+        size_t                          m_subsetEnd;
+
+        std::vector<Meshlet>&           m_meshlets;
+        std::vector<uint8_t>&           m_uniqueVertexIB;
+        std::vector<MeshletTriangle>&   m_primitiveIndices;
+
+        std::vector<index_t>            m_verts;
+        std::vector<MeshletTriangle>    m_prims;
+        std::vector<uint32_t>           m_candidates;
+        XMVECTOR                        m_centroidSum;
+    };
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeMeshletsImpl(
+        _In_reads_(nFaces * 3) const index_t* indices, size_t nFaces,
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nSubsets) const std::pair<size_t, size_t>* subsets, size_t nSubsets,
+        _In_reads_(nFaces * 3) const uint32_t* adjacency,
+        std::vector<Meshlet>& meshlets,
+        std::vector<uint8_t>& uniqueVertexIB,
+        std::vector<MeshletTriangle>& primitiveIndices,
+        _Out_writes_opt_(nSubsets) std::pair<size_t, size_t>* meshletSubsets,
+        size_t maxVerts, size_t maxPrims)
+    {
+        meshlets.clear();
+        uniqueVertexIB.clear();
+        primitiveIndices.clear();
+
+        if (!indices || !nFaces || !positions || !nVerts || !subsets || !nSubsets || !adjacency)
+            return E_INVALIDARG;
+
+        if (maxVerts < MESHLET_MINIMUM_SIZE || maxVerts > MESHLET_MAXIMUM_SIZE
+            || maxPrims < MESHLET_MINIMUM_SIZE || maxPrims > MESHLET_MAXIMUM_SIZE)
+            return E_INVALIDARG;
+
+        if (nVerts >= index_t(-1))
+            return E_INVALIDARG;
+
+        if ((uint64_t(nFaces) * 3) >= UINT32_MAX)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        for (size_t j = 0; j < nSubsets; ++j)
+        {
+            if (subsets[j].first >= nFaces || subsets[j].second > (nFaces - subsets[j].first))
+                return E_INVALIDARG;
+        }
+
+        auto vertexSlot = make_scratch<uint32_t>(nVerts);
+        auto faceMark = make_scratch<uint32_t>(nFaces);
+        if (!vertexSlot || !faceMark)
+            return E_OUTOFMEMORY;
+
+        memset(vertexSlot.get(), 0xff, sizeof(uint32_t) * nVerts);
+
+        // unused faces are never placed in a meshlet
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            index_t i0 = indices[face * 3];
+            index_t i1 = indices[face * 3 + 1];
+            index_t i2 = indices[face * 3 + 2];
+
+            if (i0 == index_t(-1)
+                || i1 == index_t(-1)
+                || i2 == index_t(-1))
+            {
+                faceMark[face] = c_FaceUsed;
+                continue;
+            }
+
+            if (i0 >= nVerts
+                || i1 >= nVerts
+                || i2 >= nVerts)
+                return E_UNEXPECTED;
+
+            faceMark[face] = c_FaceFree;
+        }
+
+        MeshletBuilder<index_t> builder(indices, positions, adjacency, vertexSlot.get(), faceMark.get(),
+            maxVerts, maxPrims, meshlets, uniqueVertexIB, primitiveIndices);
+
+        for (size_t j = 0; j < nSubsets; ++j)
+        {
+            size_t first = meshlets.size();
+
+            builder.Build(subsets[j].first, subsets[j].second);
+
+            if (meshletSubsets)
+            {
+                meshletSubsets[j] = std::pair<size_t, size_t>(first, meshlets.size() - first);
+            }
+        }
+
+        return S_OK;
+    }
+
+
+    //---------------------------------------------------------------------------------
+    template<class index_t>
+    HRESULT ComputeCullDataImpl(
+        _In_reads_(nVerts) const XMFLOAT3* positions, size_t nVerts,
+        _In_reads_(nMeshlets) const Meshlet* meshlets, size_t nMeshlets,
+        _In_reads_(nVertIndices) const index_t* uniqueVertexIndices, size_t nVertIndices,
+        _In_reads_(nPrimIndices) const MeshletTriangle* primitiveIndices, size_t nPrimIndices,
+        _Out_writes_(nMeshlets) CullData* cullData,
+        DWORD flags)
+    {
+        if (!positions || !nVerts || !meshlets || !nMeshlets || !uniqueVertexIndices || !primitiveIndices || !cullData)
+            return E_INVALIDARG;
+
+        bool cw = (flags & MESHLET_WIND_CW) != 0;
+
+        XMFLOAT3 points[MESHLET_MAXIMUM_SIZE];
+        XMVECTOR normals[MESHLET_MAXIMUM_SIZE];
+
+        for (size_t m = 0; m < nMeshlets; ++m)
+        {
+            const Meshlet& meshlet = meshlets[m];
+
+            if (!meshlet.VertCount || meshlet.VertCount > MESHLET_MAXIMUM_SIZE
+                || !meshlet.PrimCount || meshlet.PrimCount > MESHLET_MAXIMUM_SIZE)
+                return E_FAIL;
+
+            if (meshlet.VertOffset >= nVertIndices || meshlet.VertCount > (nVertIndices - meshlet.VertOffset)
+                || meshlet.PrimOffset >= nPrimIndices || meshlet.PrimCount > (nPrimIndices - meshlet.PrimOffset))
+                return E_FAIL;
+
+            for (size_t j = 0; j < meshlet.VertCount; ++j)
+            {
+                index_t i = uniqueVertexIndices[meshlet.VertOffset + j];
+                if (i >= nVerts)
+                    return E_UNEXPECTED;
+
+                points[j] = positions[i];
+            }
+
+            CullData& cull = cullData[m];
+            BoundingSphere::CreateFromPoints(cull.BoundingSphere, meshlet.VertCount, points, sizeof(XMFLOAT3));
+
+            // face normals, with zero for degenerate faces
+            size_t nNormals = 0;
+            XMVECTOR axis = g_XMZero;
+
+            for (size_t j = 0; j < meshlet.PrimCount; ++j)
+            {
+                const MeshletTriangle& tri = primitiveIndices[meshlet.PrimOffset + j];
+                if (tri.i0 >= meshlet.VertCount || tri.i1 >= meshlet.VertCount || tri.i2 >= meshlet.VertCount)
+                    return E_UNEXPECTED;
+
+                XMVECTOR p0 = XMLoadFloat3(&points[tri.i0]);
+                XMVECTOR p1 = XMLoadFloat3(&points[tri.i1]);
+                XMVECTOR p2 = XMLoadFloat3(&points[tri.i2]);
+
+                XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+                if (XMVector3Equal(n, g_XMZero))
+                {
+                    normals[j] = g_XMZero;
+                    continue;
+                }
+
+                n = XMVector3Normalize(n);
+                if (cw)
+                {
+                    n = XMVectorNegate(n);
+                }
+
+                normals[j] = n;
+                axis = XMVectorAdd(axis, n);
+                ++nNormals;
+            }
+
+            // the test uses the axis as the shader will see it after quantization
+            XMUBYTEN4 cone;
+            float minDot = -1.f;
+
+            if (nNormals > 0 && !XMVector3Equal(axis, g_XMZero))
+            {
+                axis = XMVector3Normalize(axis);
+                XMStoreUByteN4(&cone, XMVectorMultiplyAdd(axis, g_XMOneHalf, g_XMOneHalf));
+
+                axis = XMVectorMultiplyAdd(XMLoadUByteN4(&cone), XMVectorReplicate(2.f), g_XMNegativeOne);
+                axis = XMVector3Normalize(XMVectorSetW(axis, 0.f));
+
+                minDot = 1.f;
+                for (size_t j = 0; j < meshlet.PrimCount; ++j)
+                {
+                    if (XMVector3Equal(normals[j], g_XMZero))
+                        continue;
+
+                    minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, normals[j])));
+                }
+            }
+
+            if (minDot <= c_MinConeDot)
+            {
+                // no useful cone, so it never culls
+                XMStoreUByteN4(&cull.NormalCone, XMVectorSet(0.5f, 0.5f, 0.5f, 1.f));
+                cull.ApexOffset = 0.f;
+                continue;
+            }
+
+            // the apex is the point along -axis that lies behind every face plane
+            XMVECTOR center = XMLoadFloat3(&cull.BoundingSphere.Center);
+
+            float apexOffset = -FLT_MAX;
+            for (size_t j = 0; j < meshlet.PrimCount; ++j)
+            {
+                XMVECTOR n = normals[j];
+                if (XMVector3Equal(n, g_XMZero))
+                    continue;
+
+                const MeshletTriangle& tri = primitiveIndices[meshlet.PrimOffset + j];
+                XMVECTOR p0 = XMLoadFloat3(&points[tri.i0]);
+
+                float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), n))
+                    / XMVectorGetX(XMVector3Dot(axis, n));
+
+                apexOffset = std::max(apexOffset, t);
+            }
+
+            // sine of the half-angle, rounded up so quantization only widens the cone
+            float cutoff = sqrtf(std::max(0.f, 1.f - minDot * minDot));
+            cone.w = uint8_t(std::min(255.f, ceilf(cutoff * 255.f)));
+
+            cull.NormalCone = cone;
+            cull.ApexOffset = apexOffset;
+        }
+
+        return S_OK;
+    }
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMeshlets(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* adjacency,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint8_t>& uniqueVertexIB,
+    std::vector<MeshletTriangle>& primitiveIndices,
+    size_t maxVerts, size_t maxPrims)
+{
+    stage_stats stats("ComputeMeshlets", nFaces, nVerts);
+
+    std::pair<size_t, size_t> subset(0, nFaces);
+    return ComputeMeshletsImpl<uint16_t>(indices, nFaces, positions, nVerts, &subset, 1, adjacency,
+        meshlets, uniqueVertexIB, primitiveIndices, nullptr, maxVerts, maxPrims);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMeshlets(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const uint32_t* adjacency,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint8_t>& uniqueVertexIB,
+    std::vector<MeshletTriangle>& primitiveIndices,
+    size_t maxVerts, size_t maxPrims)
+{
+    stage_stats stats("ComputeMeshlets", nFaces, nVerts);
+
+    std::pair<size_t, size_t> subset(0, nFaces);
+    return ComputeMeshletsImpl<uint32_t>(indices, nFaces, positions, nVerts, &subset, 1, adjacency,
+        meshlets, uniqueVertexIB, primitiveIndices, nullptr, maxVerts, maxPrims);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMeshlets(
+    const uint16_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const std::pair<size_t, size_t>* subsets, size_t nSubsets,
+    const uint32_t* adjacency,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint8_t>& uniqueVertexIB,
+    std::vector<MeshletTriangle>& primitiveIndices,
+    std::pair<size_t, size_t>* meshletSubsets,
+    size_t maxVerts, size_t maxPrims)
+{
+    stage_stats stats("ComputeMeshlets", nFaces, nVerts);
+
+    if (!meshletSubsets)
+        return E_INVALIDARG;
+
+    return ComputeMeshletsImpl<uint16_t>(indices, nFaces, positions, nVerts, subsets, nSubsets, adjacency,
+        meshlets, uniqueVertexIB, primitiveIndices, meshletSubsets, maxVerts, maxPrims);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeMeshlets(
+    const uint32_t* indices, size_t nFaces,
+    const XMFLOAT3* positions, size_t nVerts,
+    const std::pair<size_t, size_t>* subsets, size_t nSubsets,
+    const uint32_t* adjacency,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint8_t>& uniqueVertexIB,
+    std::vector<MeshletTriangle>& primitiveIndices,
+    std::pair<size_t, size_t>* meshletSubsets,
+    size_t maxVerts, size_t maxPrims)
+{
+    stage_stats stats("ComputeMeshlets", nFaces, nVerts);
+
+    if (!meshletSubsets)
+        return E_INVALIDARG;
+
+    return ComputeMeshletsImpl<uint32_t>(indices, nFaces, positions, nVerts, subsets, nSubsets, adjacency,
+        meshlets, uniqueVertexIB, primitiveIndices, meshletSubsets, maxVerts, maxPrims);
+}
+
+
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeCullData(
+    const XMFLOAT3* positions, size_t nVerts,
+    const Meshlet* meshlets, size_t nMeshlets,
+    const uint16_t* uniqueVertexIndices, size_t nVertIndices,
+    const MeshletTriangle* primitiveIndices, size_t nPrimIndices,
+    CullData* cullData,
+    DWORD flags)
+{
+    return ComputeCullDataImpl<uint16_t>(positions, nVerts, meshlets, nMeshlets, uniqueVertexIndices, nVertIndices,
+        primitiveIndices, nPrimIndices, cullData, flags);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ComputeCullData(
+    const XMFLOAT3* positions, size_t nVerts,
+    const Meshlet* meshlets, size_t nMeshlets,
+    const uint32_t* uniqueVertexIndices, size_t nVertIndices,
+    const MeshletTriangle* primitiveIndices, size_t nPrimIndices,
+    CullData* cullData,
+    DWORD flags)
+{
+    return ComputeCullDataImpl<uint32_t>(positions, nVerts, meshlets, nMeshlets, uniqueVertexIndices, nVertIndices,
+        primitiveIndices, nPrimIndices, cullData, flags);
+}
@@ -0,0 +1,1926 @@
+//--------------------------------------------------------------------------------------
+// File: MeshBench.cpp
+//
+// MeshBench command-line tool (benchmark and regression harness for DirectXMesh library)
+//
+// Generates synthetic meshes and times the DirectXMesh entry points on each of them for
+// 16-bit and 32-bit indices, reporting the quality of their output alongside
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// http://go.microsoft.com/fwlink/?LinkID=324981
+//--------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NODRAWTEXT
+#define NOGDI
+#define NOBITMAP
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <windows.h>
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <d3d11_1.h>
+
+#include <directxmath.h>
+
+#include "DirectXMesh.h"
+
+using namespace DirectX;
+
+enum OPTIONS
+{
+    OPT_MESH = 1,
+    OPT_FACES,
+    OPT_INDEX,
+    OPT_ITERATIONS,
+    OPT_FILTER,
+    OPT_OUTPUTFILE,
+    OPT_ARENA,
+    OPT_NOLOGO,
+    OPT_MAX
+};
+
+static_assert(OPT_MAX <= 32, "dwOptions is a DWORD bitfield");
+
+enum MESH_TYPES
+{
+    MESH_GRID       = 0x1,
+    MESH_SPHERE     = 0x2,
+    MESH_SCAN       = 0x4,
+    MESH_SUBSETS    = 0x8,
+    MESH_ALL        = 0xF,
+};
+
+struct SValue
+{
+    LPCWSTR pName;
+    DWORD dwValue;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+const SValue g_pOptions[] =
+{
+    { L"mesh",      OPT_MESH },
+    { L"faces",     OPT_FACES },
+    { L"index",     OPT_INDEX },
+    { L"iter",      OPT_ITERATIONS },
+    { L"filter",    OPT_FILTER },
+    { L"o",         OPT_OUTPUTFILE },
+    { L"arena",     OPT_ARENA },
+    { L"nologo",    OPT_NOLOGO },
+    { nullptr,      0 }
+};
+
+const SValue g_pMeshTypes[] =
+{
+    { L"grid",      MESH_GRID },
+    { L"sphere",    MESH_SPHERE },
+    { L"scan",      MESH_SCAN },
+    { L"subsets",   MESH_SUBSETS },
+    { L"all",       MESH_ALL },
+    { nullptr,      0 }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    const size_t c_DefaultFaceCounts[] = { 10000, 100000, 1000000 };
+
+    const size_t c_MaxFaceCount = 64 * 1024 * 1024;
+
+    const size_t c_DefaultIterations = 3;
+
+#pragma prefast(disable : 26018, "Only used with static internal arrays")
+
+    DWORD LookupByName(const wchar_t *pName, const SValue *pArray)
+    {
+        while (pArray->pName)
+        {
+            if (!_wcsicmp(pName, pArray->pName))
+                return pArray->dwValue;
+
+            pArray++;
+        }
+
+        return 0;
+    }
+
+
+    void PrintLogo()
+    {
+        wprintf(L"Microsoft (R) MeshBench Command-line Tool\n");
+        wprintf(L"Copyright (C) Microsoft Corp. All rights reserved.\n");
+#ifdef _DEBUG
+        wprintf(L"*** Debug build ***\n");
+#endif
+        wprintf(L"\n");
+    }
+
+
+    void PrintUsage()
+    {
+        PrintLogo();
+
+        wprintf(L"Usage: meshbench <options>\n");
+        wprintf(L"\n");
+        wprintf(L"   -mesh <list>        comma-separated meshes to generate: grid, sphere, scan, subsets, or\n");
+        wprintf(L"                       all (def: all)\n");
+        wprintf(L"   -faces <list>       comma-separated face counts for each mesh, with an optional k or m\n");
+        wprintf(L"                       suffix (def: 10k,100k,1m; up to 64m)\n");
+        wprintf(L"   -index <16|32>      only time one index width (def: both; 16-bit is skipped for meshes\n");
+        wprintf(L"                       with 65535 or more vertices)\n");
+        wprintf(L"   -iter <count>       timed runs of each case, reporting the fastest and median (def: 3)\n");
+        wprintf(L"   -filter <text>      only time the cases whose name contains <text>\n");
+        wprintf(L"   -o <filename>       write the results as JSON\n");
+        wprintf(L"   -arena              serve temporary memory from a ScratchArena instead of the heap\n");
+        wprintf(L"   -nologo             suppress copyright message\n");
+
+        wprintf(L"\n");
+    }
+
+
+    // Parses a comma-separated list of counts such as "10k,2m"
+    bool ParseFaceCounts(_In_z_ const wchar_t* str, std::vector<size_t>& counts)
+    {
+        counts.clear();
+
+        const wchar_t* ptr = str;
+        for (;;)
+        {
+            wchar_t* end = nullptr;
+            unsigned long value = wcstoul(ptr, &end, 10);
+            if (end == ptr)
+                return false;
+
+            size_t count = value;
+            if (*end == L'k' || *end == L'K')
+            {
+                count *= 1000;
+                ++end;
+            }
+            else if (*end == L'm' || *end == L'M')
+            {
+                count *= 1000000;
+                ++end;
+            }
+
+            if (!count || count > c_MaxFaceCount)
+                return false;
+
+            counts.push_back(count);
+
+            if (!*end)
+                return true;
+
+            if (*end != L',')
+                return false;
+
+            ptr = end + 1;
+        }
+    }
+
+
+    // Parses a comma-separated list of mesh type names into MESH_TYPES bits
+    bool ParseMeshTypes(_In_z_ const wchar_t* str, DWORD& types)
+    {
+        types = 0;
+
+        wchar_t name[64] = {};
+        size_t len = 0;
+        for (const wchar_t* ptr = str;; ++ptr)
+        {
+            if (*ptr && *ptr != L',')
+            {
+                if (len + 1 >= _countof(name))
+                    return false;
+
+                name[len++] = *ptr;
+                continue;
+            }
+
+            name[len] = 0;
+            DWORD type = LookupByName(name, g_pMeshTypes);
+            if (!type)
+                return false;
+
+            types |= type;
+            len = 0;
+
+            if (!*ptr)
+                return true;
+        }
+    }
+
+
+    int64_t GetTicks()
+    {
+        LARGE_INTEGER t = {};
+        QueryPerformanceCounter(&t);
+        return t.QuadPart;
+    }
+
+    double TicksToMilliseconds(int64_t ticks)
+    {
+        LARGE_INTEGER f = {};
+        QueryPerformanceFrequency(&f);
+        return double(ticks) * 1000.0 / double(f.QuadPart);
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Synthetic meshes
+
+    struct BenchVertex
+    {
+        XMFLOAT3 position;
+        XMFLOAT3 normal;
+        XMFLOAT2 textureCoordinate;
+    };
+
+    const D3D11_INPUT_ELEMENT_DESC c_BenchLayout[] =
+    {
+        { "SV_Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL",      0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD",    0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+
+    static_assert(sizeof(BenchVertex) == 32, "Mismatch with c_BenchLayout");
+
+    struct BenchMesh
+    {
+        const char*                 name;
+        float                       epsilon;
+            // Mesh type, and the distance within which its duplicated positions are the same point
+
+        std::vector<uint32_t>       indices;
+        std::vector<uint32_t>       attributes;
+        std::vector<XMFLOAT3>       positions;
+        std::vector<XMFLOAT2>       texcoords;
+        std::vector<uint32_t>       pointReps;
+            // Made by the generator. pointReps is only given for meshes whose duplicated positions are not exact
+
+        std::vector<XMFLOAT3>       normals;
+        std::vector<BenchVertex>    vertices;
+        std::vector<uint32_t>       adjacency;
+        std::vector<uint32_t>       faceRemap;
+        std::vector<uint32_t>       vertexRemap;
+            // Computed with the library before any case is timed. faceRemap is the OptimizeFacesEx order, and
+            // vertexRemap the OptimizeVertices order of the faces in that order
+
+        size_t GetFaceCount() const { return indices.size() / 3; }
+        size_t GetVertexCount() const { return positions.size(); }
+    };
+
+    void AddQuad(std::vector<uint32_t>& indices, size_t i0, size_t i1, size_t i2, size_t i3)
+    {
+        // i0 i1 are one edge and i2 i3 the opposite one, counter-clockwise seen from +z for a grid
+        indices.push_back(uint32_t(i0));
+        indices.push_back(uint32_t(i1));
+        indices.push_back(uint32_t(i2));
+
+        indices.push_back(uint32_t(i1));
+        indices.push_back(uint32_t(i3));
+        indices.push_back(uint32_t(i2));
+    }
+
+    size_t GridSize(size_t nFaces)
+    {
+        return std::max<size_t>(1, size_t(sqrt(double(nFaces) / 2.0) + 0.5));
+    }
+
+    // Deterministic value in [-1, 1] for a grid point
+    float GridNoise(size_t x, size_t y)
+    {
+        uint32_t h = (uint32_t(x) * 73856093u) ^ (uint32_t(y) * 19349663u);
+        h ^= h >> 13;
+        h *= 0x5bd1e995u;
+        h ^= h >> 15;
+        return float(h & 0xffffff) / float(0xffffff) * 2.f - 1.f;
+    }
+
+
+    // Unit square of n x n quads in row order
+    void MakeGrid(size_t nFaces, BenchMesh& mesh)
+    {
+        size_t n = GridSize(nFaces);
+        float cell = 1.f / float(n);
+
+        mesh.name = "grid";
+        mesh.epsilon = cell * 1e-3f;
+
+        for (size_t y = 0; y <= n; ++y)
+        {
+            for (size_t x = 0; x <= n; ++x)
+            {
+                mesh.positions.push_back(XMFLOAT3(float(x) * cell, float(y) * cell, 0.f));
+                mesh.texcoords.push_back(XMFLOAT2(float(x) * cell, float(y) * cell));
+            }
+        }
+
+        for (size_t y = 0; y < n; ++y)
+        {
+            for (size_t x = 0; x < n; ++x)
+            {
+                size_t i0 = y * (n + 1) + x;
+                AddQuad(mesh.indices, i0, i0 + 1, i0 + n + 1, i0 + n + 2);
+            }
+        }
+
+        mesh.attributes.assign(mesh.GetFaceCount(), 0);
+    }
+
+
+    // Unit UV sphere in stack order. The texcoord seam is a column of duplicated positions, and each pole a ring of
+    // them, so geometric adjacency and point reps have real work
+    void MakeSphere(size_t nFaces, BenchMesh& mesh)
+    {
+        size_t stacks = std::max<size_t>(2, size_t(sqrt(double(nFaces) / 4.0) + 0.5));
+        size_t slices = stacks * 2;
+
+        mesh.name = "sphere";
+        mesh.epsilon = 1e-5f;
+
+        for (size_t i = 0; i <= stacks; ++i)
+        {
+            float v = float(i) / float(stacks);
+
+            float sinLat, cosLat;
+            XMScalarSinCos(&sinLat, &cosLat, XM_PI * v);
+            if (i == 0 || i == stacks)
+            {
+                cosLat = (i == 0) ? 1.f : -1.f;
+            }
+
+            for (size_t j = 0; j <= slices; ++j)
+            {
+                float u = float(j) / float(slices);
+
+                float sinLon, cosLon;
+                XMScalarSinCos(&sinLon, &cosLon, XM_2PI * float(j % slices) / float(slices));
+
+                if (i == 0 || i == stacks)
+                {
+                    mesh.positions.push_back(XMFLOAT3(0.f, cosLat, 0.f));
+                }
+                else
+                {
+                    mesh.positions.push_back(XMFLOAT3(sinLat * cosLon, cosLat, sinLat * sinLon));
+                }
+                mesh.texcoords.push_back(XMFLOAT2(u, v));
+            }
+        }
+
+        for (size_t i = 0; i < stacks; ++i)
+        {
+            for (size_t j = 0; j < slices; ++j)
+            {
+                size_t i0 = i * (slices + 1) + j;
+                size_t i1 = i0 + 1;
+                size_t i2 = i0 + slices + 1;
+                size_t i3 = i2 + 1;
+
+                // Pole rings only get the triangle that is not degenerate
+                if (i != 0)
+                {
+                    mesh.indices.push_back(uint32_t(i0));
+                    mesh.indices.push_back(uint32_t(i1));
+                    mesh.indices.push_back(uint32_t(i2));
+                }
+
+                if (i != stacks - 1)
+                {
+                    mesh.indices.push_back(uint32_t(i1));
+                    mesh.indices.push_back(uint32_t(i3));
+                    mesh.indices.push_back(uint32_t(i2));
+                }
+            }
+        }
+
+        mesh.attributes.assign(mesh.GetFaceCount(), 0);
+    }
+
+
+    // Noisy height field scanned in tiles. Each tile has its own vertices, so tile borders are duplicated with a small
+    // jitter; about 1% of the faces are missing; and faces and vertices are stored in random order. The duplicates are
+    // given as point reps, as the scanner would know them
+    const size_t c_ScanTileSize = 32;
+
+    void MakeScan(size_t nFaces, BenchMesh& mesh)
+    {
+        size_t n = GridSize(nFaces);
+        float cell = 1.f / float(n);
+
+        mesh.name = "scan";
+        mesh.epsilon = cell * 4e-3f;
+
+        std::mt19937 rng(0x5ca9u);
+        std::uniform_real_distribution<float> jitter(-cell * 1e-3f, cell * 1e-3f);
+
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> gridPoints;
+
+        for (size_t y0 = 0; y0 < n; y0 += c_ScanTileSize)
+        {
+            for (size_t x0 = 0; x0 < n; x0 += c_ScanTileSize)
+            {
+                size_t x1 = std::min(n, x0 + c_ScanTileSize);
+                size_t y1 = std::min(n, y0 + c_ScanTileSize);
+                size_t w = x1 - x0 + 1;
+                size_t base = mesh.positions.size();
+
+                for (size_t y = y0; y <= y1; ++y)
+                {
+                    for (size_t x = x0; x <= x1; ++x)
+                    {
+                        float fx = float(x) * cell;
+                        float fy = float(y) * cell;
+                        float height = 0.1f * sinf(fx * 12.f) * cosf(fy * 9.f) + 0.25f * cell * GridNoise(x, y);
+
+                        mesh.positions.push_back(XMFLOAT3(fx + jitter(rng), fy + jitter(rng), height + jitter(rng)));
+                        mesh.texcoords.push_back(XMFLOAT2(fx, fy));
+                        gridPoints.push_back(uint32_t(y * (n + 1) + x));
+                    }
+                }
+
+                for (size_t y = y0; y < y1; ++y)
+                {
+                    for (size_t x = x0; x < x1; ++x)
+                    {
+                        if (!(rng() % 100))
+                            continue;
+
+                        size_t i0 = base + (y - y0) * w + (x - x0);
+                        AddQuad(indices, i0, i0 + 1, i0 + w, i0 + w + 1);
+                    }
+                }
+            }
+        }
+
+        // Random face order
+        size_t nScanFaces = indices.size() / 3;
+
+        std::vector<uint32_t> order(nScanFaces);
+        for (size_t j = 0; j < nScanFaces; ++j)
+            order[j] = uint32_t(j);
+
+        std::shuffle(order.begin(), order.end(), rng);
+
+        // Random vertex order
+        size_t nVerts = mesh.positions.size();
+
+        std::vector<uint32_t> vertexOrder(nVerts);
+        for (size_t j = 0; j < nVerts; ++j)
+            vertexOrder[j] = uint32_t(j);
+
+        std::shuffle(vertexOrder.begin(), vertexOrder.end(), rng);
+
+        std::vector<uint32_t> newIndex(nVerts);
+        std::vector<XMFLOAT3> positions(nVerts);
+        std::vector<XMFLOAT2> texcoords(nVerts);
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            uint32_t src = vertexOrder[j];
+            newIndex[src] = uint32_t(j);
+            positions[j] = mesh.positions[src];
+            texcoords[j] = mesh.texcoords[src];
+        }
+
+        mesh.positions.swap(positions);
+        mesh.texcoords.swap(texcoords);
+
+        // Each grid point is represented by its lowest numbered vertex
+        std::vector<uint32_t> reps((n + 1) * (n + 1), uint32_t(-1));
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            uint32_t& rep = reps[gridPoints[vertexOrder[j]]];
+            rep = std::min(rep, uint32_t(j));
+        }
+
+        mesh.pointReps.resize(nVerts);
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            mesh.pointReps[j] = reps[gridPoints[vertexOrder[j]]];
+        }
+
+        mesh.indices.resize(nScanFaces * 3);
+        for (size_t j = 0; j < nScanFaces; ++j)
+        {
+            for (size_t k = 0; k < 3; ++k)
+            {
+                mesh.indices[j * 3 + k] = newIndex[indices[order[j] * 3 + k]];
+            }
+        }
+
+        mesh.attributes.assign(nScanFaces, 0);
+    }
+
+
+    // Unit square split into tiles of 8 x 8 quads, each its own attribute. Faces are grouped by tile, but the ids are
+    // shuffled so the groups are out of order, and vertices on tile borders are shared between attributes
+    const size_t c_SubsetTileSize = 8;
+
+    void MakeSubsets(size_t nFaces, BenchMesh& mesh)
+    {
+        size_t n = GridSize(nFaces);
+        float cell = 1.f / float(n);
+
+        mesh.name = "subsets";
+        mesh.epsilon = cell * 1e-3f;
+
+        for (size_t y = 0; y <= n; ++y)
+        {
+            for (size_t x = 0; x <= n; ++x)
+            {
+                mesh.positions.push_back(XMFLOAT3(float(x) * cell, float(y) * cell, 0.25f * cell * GridNoise(x, y)));
+                mesh.texcoords.push_back(XMFLOAT2(float(x) * cell, float(y) * cell));
+            }
+        }
+
+        size_t tiles = (n + c_SubsetTileSize - 1) / c_SubsetTileSize;
+
+        std::vector<uint32_t> ids(tiles * tiles);
+        for (size_t j = 0; j < ids.size(); ++j)
+            ids[j] = uint32_t(j);
+
+        std::mt19937 rng(0x5b5e7u);
+        std::shuffle(ids.begin(), ids.end(), rng);
+
+        for (size_t ty = 0; ty < tiles; ++ty)
+        {
+            for (size_t tx = 0; tx < tiles; ++tx)
+            {
+                size_t x1 = std::min(n, (tx + 1) * c_SubsetTileSize);
+                size_t y1 = std::min(n, (ty + 1) * c_SubsetTileSize);
+
+                for (size_t y = ty * c_SubsetTileSize; y < y1; ++y)
+                {
+                    for (size_t x = tx * c_SubsetTileSize; x < x1; ++x)
+                    {
+                        size_t i0 = y * (n + 1) + x;
+                        AddQuad(mesh.indices, i0, i0 + 1, i0 + n + 1, i0 + n + 2);
+
+                        mesh.attributes.push_back(ids[ty * tiles + tx]);
+                        mesh.attributes.push_back(ids[ty * tiles + tx]);
+                    }
+                }
+            }
+        }
+    }
+
+
+    // Fills in the derived streams and remaps every case reads
+    HRESULT PrepareMesh(BenchMesh& mesh)
+    {
+        size_t nFaces = mesh.GetFaceCount();
+        size_t nVerts = mesh.GetVertexCount();
+
+        // Exact matches are enough for the generated meshes without point reps, and much faster than an epsilon sweep
+        HRESULT hr;
+        mesh.adjacency.resize(nFaces * 3);
+        if (mesh.pointReps.empty())
+        {
+            mesh.pointReps.resize(nVerts);
+            hr = GenerateAdjacencyAndPointReps(mesh.indices.data(), nFaces, mesh.positions.data(), nVerts, 0.f,
+                                               mesh.pointReps.data(), mesh.adjacency.data());
+        }
+        else
+        {
+            hr = ConvertPointRepsToAdjacency(mesh.indices.data(), nFaces, mesh.positions.data(), nVerts,
+                                             mesh.pointReps.data(), mesh.adjacency.data());
+        }
+        if (FAILED(hr))
+            return hr;
+
+        mesh.normals.resize(nVerts);
+        hr = ComputeNormals(mesh.indices.data(), nFaces, mesh.positions.data(), nVerts, CNORM_DEFAULT, mesh.normals.data());
+        if (FAILED(hr))
+            return hr;
+
+        mesh.vertices.resize(nVerts);
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            mesh.vertices[j].position = mesh.positions[j];
+            mesh.vertices[j].normal = mesh.normals[j];
+            mesh.vertices[j].textureCoordinate = mesh.texcoords[j];
+        }
+
+        mesh.faceRemap.resize(nFaces);
+        hr = OptimizeFacesEx(mesh.indices.data(), nFaces, mesh.adjacency.data(), mesh.attributes.data(), mesh.faceRemap.data());
+        if (FAILED(hr))
+            return hr;
+
+        std::vector<uint32_t> optimized(nFaces * 3);
+        hr = ReorderIB(mesh.indices.data(), nFaces, mesh.faceRemap.data(), optimized.data());
+        if (FAILED(hr))
+            return hr;
+
+        mesh.vertexRemap.resize(nVerts);
+        return OptimizeVertices(optimized.data(), nFaces, nVerts, mesh.vertexRemap.data());
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Timed cases
+
+    const size_t c_MaxMetrics = 4;
+
+    struct BenchResult
+    {
+        const char* mesh;
+        size_t      nFaces;
+        size_t      nVerts;
+        unsigned    indexBits;
+            // Mesh the case ran on, and its index width (0 for entry points that take no IB)
+
+        const char* name;
+        HRESULT     hr;
+        double      minMs;
+        double      medianMs;
+        size_t      tempBytes;
+            // Fastest and median of the timed runs, and the most temporary memory the library reported for one
+
+        size_t      nMetrics;
+        const char* metricNames[c_MaxMetrics];
+        double      metricValues[c_MaxMetrics];
+            // Quality of the output, such as the ACMR/ATVR of a face order
+    };
+
+    void __cdecl RecordTempBytes(const MeshStageStats& stats, _In_opt_ void* context)
+    {
+        auto tempBytes = reinterpret_cast<size_t*>(context);
+        *tempBytes = std::max(*tempBytes, stats.tempBytes);
+    }
+
+    class BenchRunner
+    {
+    public:
+        BenchRunner(size_t iterations, _In_opt_z_ const wchar_t* filter) :
+            mIterations(iterations),
+            mMesh(""),
+            mFaces(0),
+            mVerts(0),
+            mIndexBits(0),
+            mPending(false)
+        {
+            if (filter)
+            {
+                for (const wchar_t* c = filter; *c; ++c)
+                    mFilter += char(*c);
+            }
+        }
+
+        BenchRunner(BenchRunner const&) = delete;
+        BenchRunner& operator= (BenchRunner const&) = delete;
+
+        void SetMesh(_In_z_ const char* mesh, size_t nFaces, size_t nVerts, unsigned indexBits)
+        {
+            mMesh = mesh;
+            mFaces = nFaces;
+            mVerts = nVerts;
+            mIndexBits = indexBits;
+        }
+
+        bool IsSelected(_In_z_ const char* name) const
+        {
+            return mFilter.empty() || strstr(name, mFilter.c_str()) != nullptr;
+        }
+
+        // Times body over the iterations, calling setup untimed before each one to restore any inputs it modifies.
+        // Returns true if the case ran and succeeded, after which AddMetric can describe its output.
+        template<typename Setup, typename Body>
+        bool Run(_In_z_ const char* name, Setup setup, Body body)
+        {
+            Flush();
+
+            if (!IsSelected(name))
+                return false;
+
+            BenchResult result = {};
+            result.mesh = mMesh;
+            result.nFaces = mFaces;
+            result.nVerts = mVerts;
+            result.indexBits = mIndexBits;
+            result.name = name;
+
+            std::vector<double> times;
+            for (size_t j = 0; j < mIterations; ++j)
+            {
+                setup();
+
+                SetMeshStatsCallback(RecordTempBytes, &result.tempBytes);
+
+                int64_t start = GetTicks();
+                result.hr = body();
+                int64_t end = GetTicks();
+
+                SetMeshStatsCallback(nullptr);
+
+                if (FAILED(result.hr))
+                    break;
+
+                times.push_back(TicksToMilliseconds(end - start));
+            }
+
+            if (SUCCEEDED(result.hr))
+            {
+                std::sort(times.begin(), times.end());
+                result.minMs = times.front();
+                result.medianMs = times[times.size() / 2];
+            }
+
+            mResults.push_back(result);
+            mPending = true;
+
+            return SUCCEEDED(result.hr);
+        }
+
+        // Notes a case that was not run on this mesh
+        void Skip(_In_z_ const char* name, _In_z_ const char* reason)
+        {
+            Flush();
+
+            if (!IsSelected(name))
+                return;
+
+            wchar_t index[8] = L"-";
+            if (mIndexBits)
+                swprintf_s(index, L"%u", mIndexBits);
+
+            wprintf(L"%-8hs %10Iu %10Iu %5ls %-40hs skipped (%hs)\n", mMesh, mFaces, mVerts, index, name, reason);
+        }
+
+        void AddMetric(_In_z_ const char* name, double value)
+        {
+            if (!mPending)
+                return;
+
+            BenchResult& result = mResults.back();
+            if (result.nMetrics < c_MaxMetrics)
+            {
+                result.metricNames[result.nMetrics] = name;
+                result.metricValues[result.nMetrics] = value;
+                ++result.nMetrics;
+            }
+        }
+
+        // Prints the last case run, once its metrics are in
+        void Flush()
+        {
+            if (!mPending)
+                return;
+
+            mPending = false;
+
+            const BenchResult& result = mResults.back();
+
+            wchar_t index[8] = L"-";
+            if (result.indexBits)
+                swprintf_s(index, L"%u", result.indexBits);
+
+            if (FAILED(result.hr))
+            {
+                wprintf(L"%-8hs %10Iu %10Iu %5ls %-40hs FAILED (%08X)\n", result.mesh, result.nFaces, result.nVerts, index,
+                        result.name, static_cast<unsigned int>(result.hr));
+                return;
+            }
+
+            wprintf(L"%-8hs %10Iu %10Iu %5ls %-40hs %10.3f %10.3f %10Iu", result.mesh, result.nFaces, result.nVerts, index,
+                    result.name, result.minMs, result.medianMs, (result.tempBytes + 1023) / 1024);
+
+            for (size_t j = 0; j < result.nMetrics; ++j)
+            {
+                wprintf(L"  %hs %g", result.metricNames[j], result.metricValues[j]);
+            }
+
+            wprintf(L"\n");
+        }
+
+        const std::vector<BenchResult>& GetResults() const { return mResults; }
+
+    private:
+        size_t                      mIterations;
+        std::string                 mFilter;
+        const char*                 mMesh;
+        size_t                      mFaces;
+        size_t                      mVerts;
+        unsigned                    mIndexBits;
+        bool                        mPending;
+        std::vector<BenchResult>    mResults;
+    };
+
+    void PrintHeader()
+    {
+        wprintf(L"%-8ls %10ls %10ls %5ls %-40ls %10ls %10ls %10ls  %ls\n", L"mesh", L"faces", L"verts", L"index", L"case",
+                L"ms", L"median ms", L"temp KB", L"output");
+    }
+
+    void NoSetup()
+    {
+    }
+
+    // Reports the vertex cache miss rates of an IB for the cache the face optimizer targets
+    template<class index_t>
+    void AddCacheMetrics(BenchRunner& runner, _In_reads_(nFaces*3) const index_t* indices, size_t nFaces, size_t nVerts,
+                         bool lru)
+    {
+        float acmr = 0.f;
+        float atvr = 0.f;
+
+        if (lru)
+        {
+            size_t cacheSize = OPTFACES_LRU_DEFAULT;
+            if (FAILED(ComputeVertexCacheMissRates(indices, nFaces, nVerts, &cacheSize, 1, VCACHE_LRU, &acmr, &atvr)))
+                return;
+        }
+        else
+        {
+            ComputeVertexCacheMissRate(indices, nFaces, nVerts, OPTFACES_V_DEFAULT, acmr, atvr);
+        }
+
+        runner.AddMetric("acmr", acmr);
+        runner.AddMetric("atvr", atvr);
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Entry points that take an IB, for one index width
+    const size_t c_ChunkFaces = 16384;
+
+    const size_t c_MaxEpsilonFaces = 250000;
+        // The epsilon vertex sweep of GenerateAdjacencyAndPointReps grows with the square of the mesh size on these
+        // meshes, so it is only timed up to here
+
+    template<class index_t>
+    void BenchIndexed(BenchRunner& runner, const BenchMesh& mesh, const std::vector<index_t>& source)
+    {
+        const size_t nFaces = mesh.GetFaceCount();
+        const size_t nVerts = mesh.GetVertexCount();
+
+        const index_t* indices = source.data();
+        const XMFLOAT3* positions = mesh.positions.data();
+        const XMFLOAT3* normals = mesh.normals.data();
+        const XMFLOAT2* texcoords = mesh.texcoords.data();
+        const uint32_t* attributes = mesh.attributes.data();
+        const uint32_t* pointReps = mesh.pointReps.data();
+        const uint32_t* adjacency = mesh.adjacency.data();
+        const uint32_t* optimizedFaces = mesh.faceRemap.data();
+        const uint32_t* optimizedVerts = mesh.vertexRemap.data();
+
+        // Working buffers shared by the cases
+        std::vector<index_t> ib(nFaces * 3);
+        std::vector<uint32_t> adj(nFaces * 3);
+        std::vector<uint32_t> attr(nFaces);
+        std::vector<uint32_t> pr(nVerts);
+        std::vector<uint32_t> faceRemap(nFaces);
+        std::vector<uint32_t> vertexRemap(nVerts);
+
+        // The IB in OptimizeFacesEx order, and then also in OptimizeVertices order, as written after OptimizeMesh
+        std::vector<index_t> optimizedIB(nFaces * 3);
+        std::vector<index_t> finalIB(nFaces * 3);
+        if (FAILED(ReorderIB(indices, nFaces, optimizedFaces, optimizedIB.data()))
+            || FAILED(FinalizeIB(optimizedIB.data(), nFaces, optimizedVerts, nVerts, finalIB.data())))
+        {
+            wprintf(L"ERROR: Failed preparing the optimized IB\n");
+            return;
+        }
+
+        //--- Vertex cache metrics ---
+        float acmr = 0.f;
+        float atvr = 0.f;
+        if (runner.Run("ComputeVertexCacheMissRate", NoSetup, [&]() -> HRESULT
+            {
+                ComputeVertexCacheMissRate(indices, nFaces, nVerts, OPTFACES_V_DEFAULT, acmr, atvr);
+                return S_OK;
+            }))
+        {
+            runner.AddMetric("acmr", acmr);
+            runner.AddMetric("atvr", atvr);
+        }
+
+        {
+            const size_t cacheSizes[] = { 12, 16, 24, 32 };
+            float acmrs[_countof(cacheSizes)] = {};
+            float atvrs[_countof(cacheSizes)] = {};
+            if (runner.Run("ComputeVertexCacheMissRates", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeVertexCacheMissRates(indices, nFaces, nVerts, cacheSizes, _countof(cacheSizes), VCACHE_LRU,
+                                                       acmrs, atvrs);
+                }))
+            {
+                runner.AddMetric("acmr12", acmrs[0]);
+                runner.AddMetric("acmr32", acmrs[3]);
+            }
+        }
+
+        //--- Adjacency ---
+        if (runner.Run("GenerateAdjacencyAndPointReps", NoSetup, [&]() -> HRESULT
+            {
+                return GenerateAdjacencyAndPointReps(indices, nFaces, positions, nVerts, 0.f, pr.data(), adj.data());
+            }))
+        {
+            runner.AddMetric("boundaryEdges", double(std::count(adj.cbegin(), adj.cend(), uint32_t(-1))));
+        }
+
+        if (nFaces > c_MaxEpsilonFaces)
+        {
+            runner.Skip("GenerateAdjacencyAndPointReps/epsilon", "too many faces for the epsilon vertex sweep");
+        }
+        else if (runner.Run("GenerateAdjacencyAndPointReps/epsilon", NoSetup, [&]() -> HRESULT
+            {
+                return GenerateAdjacencyAndPointReps(indices, nFaces, positions, nVerts, mesh.epsilon, pr.data(), adj.data());
+            }))
+        {
+            runner.AddMetric("boundaryEdges", double(std::count(adj.cbegin(), adj.cend(), uint32_t(-1))));
+        }
+
+        if (runner.Run("ConvertPointRepsToAdjacency", NoSetup, [&]() -> HRESULT
+            {
+                return ConvertPointRepsToAdjacency(indices, nFaces, positions, nVerts, pointReps, adj.data());
+            }))
+        {
+            runner.AddMetric("boundaryEdges", double(std::count(adj.cbegin(), adj.cend(), uint32_t(-1))));
+        }
+
+        {
+            std::vector<index_t> indicesAdj(nFaces * 6);
+            runner.Run("GenerateGSAdjacency", NoSetup, [&]() -> HRESULT
+            {
+                return GenerateGSAdjacency(indices, nFaces, pointReps, adjacency, nVerts, indicesAdj.data());
+            });
+        }
+
+        //--- Normals and tangent frames ---
+        {
+            std::vector<XMFLOAT3> vnormals(nVerts);
+            runner.Run("ComputeNormals", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeNormals(indices, nFaces, positions, nVerts, CNORM_DEFAULT, vnormals.data());
+            });
+
+            runner.Run("ComputeNormals/area", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeNormals(indices, nFaces, positions, nVerts, CNORM_WEIGHT_BY_AREA, vnormals.data());
+            });
+
+            runner.Run("ComputeNormals/equal", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeNormals(indices, nFaces, positions, nVerts, CNORM_WEIGHT_EQUAL, vnormals.data());
+            });
+        }
+
+        {
+            std::vector<XMFLOAT4> tangents4(nVerts);
+            std::vector<XMFLOAT3> tangents3(nVerts);
+            std::vector<XMFLOAT3> bitangents(nVerts);
+
+            runner.Run("ComputeTangentFrame", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeTangentFrame(indices, nFaces, positions, normals, texcoords, nVerts, tangents4.data());
+            });
+
+            runner.Run("ComputeTangentFrame/bitangents", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeTangentFrame(indices, nFaces, positions, normals, texcoords, nVerts, tangents3.data(), bitangents.data());
+            });
+
+            runner.Run("ComputeTangentFrame/handedness", NoSetup, [&]() -> HRESULT
+            {
+                return ComputeTangentFrame(indices, nFaces, positions, normals, texcoords, nVerts, tangents4.data(), bitangents.data());
+            });
+        }
+
+        //--- Validation and clean-up ---
+        const DWORD validateFlags = VALIDATE_BACKFACING | VALIDATE_BOWTIES | VALIDATE_DEGENERATE | VALIDATE_UNUSED
+                                  | VALIDATE_ASYMMETRIC_ADJ;
+
+        {
+            // Problems found are part of the output, not a failure of the case
+            HRESULT valid = S_OK;
+            if (runner.Run("Validate", NoSetup, [&]() -> HRESULT
+                {
+                    valid = Validate(indices, nFaces, nVerts, adjacency, validateFlags);
+                    return (valid == E_FAIL) ? S_OK : valid;
+                }))
+            {
+                runner.AddMetric("valid", (valid == S_OK) ? 1.0 : 0.0);
+            }
+        }
+
+        {
+            std::vector<uint8_t> faceErrors(nFaces);
+            DWORD errors = 0;
+            if (runner.Run("ValidateFaces", NoSetup, [&]() -> HRESULT
+                {
+                    HRESULT hr = ValidateFaces(indices, nFaces, nVerts, adjacency, validateFlags, faceErrors.data(), &errors);
+                    return (hr == E_FAIL) ? S_OK : hr;
+                }))
+            {
+                runner.AddMetric("errorFaces", double(nFaces - size_t(std::count(faceErrors.cbegin(), faceErrors.cend(), uint8_t(0)))));
+                runner.AddMetric("errors", double(errors));
+            }
+        }
+
+        {
+            std::vector<uint32_t> dupVerts;
+            if (runner.Run("Clean",
+                [&]()
+                {
+                    std::copy(source.cbegin(), source.cend(), ib.begin());
+                    std::copy(mesh.adjacency.cbegin(), mesh.adjacency.cend(), adj.begin());
+                },
+                [&]() -> HRESULT
+                {
+                    return Clean(ib.data(), nFaces, nVerts, adj.data(), attributes, dupVerts, true);
+                }))
+            {
+                runner.AddMetric("dupVerts", double(dupVerts.size()));
+            }
+        }
+
+        //--- Face and vertex optimization ---
+        if (runner.Run("OptimizeFaces", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFaces(indices, nFaces, adjacency, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, false);
+        }
+
+        if (runner.Run("OptimizeFacesEx", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFacesEx(indices, nFaces, adjacency, attributes, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, false);
+        }
+
+        if (runner.Run("OptimizeFacesLRU", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFacesLRU(indices, nFaces, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, true);
+        }
+
+        if (runner.Run("OptimizeFacesLRUEx", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFacesLRUEx(indices, nFaces, attributes, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, true);
+        }
+
+        if (runner.Run("OptimizeFacesLRUFast", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFacesLRUFast(indices, nFaces, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, true);
+        }
+
+        if (runner.Run("OptimizeFacesLRUFastEx", NoSetup, [&]() -> HRESULT
+            {
+                return OptimizeFacesLRUFastEx(indices, nFaces, attributes, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, true);
+        }
+
+        if (runner.Run("OptimizeFacesOverdraw",
+            [&]()
+            {
+                std::copy(mesh.faceRemap.cbegin(), mesh.faceRemap.cend(), faceRemap.begin());
+            },
+            [&]() -> HRESULT
+            {
+                return OptimizeFacesOverdraw(indices, nFaces, positions, nVerts, attributes, faceRemap.data());
+            })
+            && SUCCEEDED(ReorderIB(indices, nFaces, faceRemap.data(), ib.data())))
+        {
+            AddCacheMetrics(runner, ib.data(), nFaces, nVerts, false);
+        }
+
+        runner.Run("OptimizeVertices", NoSetup, [&]() -> HRESULT
+        {
+            return OptimizeVertices(optimizedIB.data(), nFaces, nVerts, vertexRemap.data());
+        });
+
+        {
+            std::vector<BenchVertex> vb(nVerts);
+            MeshVertexStream stream = { vb.data(), sizeof(BenchVertex) };
+
+            auto setup = [&]()
+            {
+                std::copy(source.cbegin(), source.cend(), ib.begin());
+                std::copy(mesh.adjacency.cbegin(), mesh.adjacency.cend(), adj.begin());
+                std::copy(mesh.attributes.cbegin(), mesh.attributes.cend(), attr.begin());
+                std::copy(mesh.vertices.cbegin(), mesh.vertices.cend(), vb.begin());
+            };
+
+            // A chunk size of 0 optimizes the whole mesh with OptimizeMesh
+            const struct { const char* name; DWORD flags; size_t chunkFaces; } optimizeMeshCases[] =
+            {
+                { "OptimizeMesh",               OPTMESH_DEFAULT,                        0 },
+                { "OptimizeMesh/lru",           OPTMESH_LRU,                            0 },
+                { "OptimizeMesh/lrufast",       OPTMESH_LRU_FAST,                       0 },
+                { "OptimizeMesh/overdraw",      OPTMESH_DEFAULT | OPTMESH_OVERDRAW,     0 },
+                { "OptimizeMeshChunked",        OPTMESH_DEFAULT,                        c_ChunkFaces },
+                { "OptimizeMeshChunked/lru",    OPTMESH_LRU,                            c_ChunkFaces },
+            };
+
+            for (size_t j = 0; j < _countof(optimizeMeshCases); ++j)
+            {
+                DWORD flags = optimizeMeshCases[j].flags;
+                size_t chunkFaces = optimizeMeshCases[j].chunkFaces;
+                if (runner.Run(optimizeMeshCases[j].name, setup, [&]() -> HRESULT
+                    {
+                        return (chunkFaces)
+                            ? OptimizeMeshChunked(ib.data(), nFaces, adj.data(), attr.data(), positions, nVerts, chunkFaces,
+                                                  &stream, 1, flags)
+                            : OptimizeMesh(ib.data(), nFaces, adj.data(), attr.data(), nVerts, &stream, 1, flags, 0, 0, positions);
+                    }))
+                {
+                    AddCacheMetrics(runner, ib.data(), nFaces, nVerts, (flags & (OPTMESH_LRU | OPTMESH_LRU_FAST)) != 0);
+                }
+            }
+        }
+
+        {
+            std::vector<index_t> depthIndices(nFaces * 3);
+            std::vector<XMFLOAT3> depthPositions(nVerts);
+            size_t nDepthFaces = 0;
+            size_t nDepthVerts = 0;
+            if (runner.Run("GeneratePositionStream", NoSetup, [&]() -> HRESULT
+                {
+                    return GeneratePositionStream(indices, nFaces, positions, nVerts, pointReps,
+                                                  depthIndices.data(), nDepthFaces, depthPositions.data(), nDepthVerts);
+                }))
+            {
+                runner.AddMetric("depthFaces", double(nDepthFaces));
+                runner.AddMetric("depthVerts", double(nDepthVerts));
+            }
+        }
+
+        {
+            std::vector<index_t> simplified(nFaces * 3);
+            size_t nSimplifiedFaces = 0;
+            float error = 0.f;
+            if (runner.Run("SimplifyMesh", NoSetup, [&]() -> HRESULT
+                {
+                    return SimplifyMesh(indices, nFaces, positions, nVerts, pointReps, adjacency, attributes,
+                                        nFaces / 2, FLT_MAX, simplified.data(), nSimplifiedFaces, &error);
+                }))
+            {
+                runner.AddMetric("faces", double(nSimplifiedFaces));
+                runner.AddMetric("error", error);
+            }
+        }
+
+        //--- Remapping ---
+        runner.Run("ReorderIB", NoSetup, [&]() -> HRESULT
+        {
+            return ReorderIB(indices, nFaces, optimizedFaces, ib.data());
+        });
+
+        runner.Run("ReorderIB/inplace",
+            [&]()
+            {
+                std::copy(source.cbegin(), source.cend(), ib.begin());
+            },
+            [&]() -> HRESULT
+            {
+                return ReorderIB(ib.data(), nFaces, optimizedFaces);
+            });
+
+        runner.Run("ReorderIBAndAdjacency", NoSetup, [&]() -> HRESULT
+        {
+            return ReorderIBAndAdjacency(indices, nFaces, adjacency, optimizedFaces, ib.data(), adj.data());
+        });
+
+        runner.Run("ReorderIBAndAdjacency/inplace",
+            [&]()
+            {
+                std::copy(source.cbegin(), source.cend(), ib.begin());
+                std::copy(mesh.adjacency.cbegin(), mesh.adjacency.cend(), adj.begin());
+            },
+            [&]() -> HRESULT
+            {
+                return ReorderIBAndAdjacency(ib.data(), nFaces, adj.data(), optimizedFaces);
+            });
+
+        runner.Run("FinalizeIB", NoSetup, [&]() -> HRESULT
+        {
+            return FinalizeIB(optimizedIB.data(), nFaces, optimizedVerts, nVerts, ib.data());
+        });
+
+        runner.Run("FinalizeIB/inplace",
+            [&]()
+            {
+                std::copy(optimizedIB.cbegin(), optimizedIB.cend(), ib.begin());
+            },
+            [&]() -> HRESULT
+            {
+                return FinalizeIB(ib.data(), nFaces, optimizedVerts, nVerts);
+            });
+
+        //--- Chunked processing ---
+        {
+            std::vector<std::pair<size_t, size_t>> chunks;
+            if (runner.Run("PartitionMesh", NoSetup, [&]() -> HRESULT
+                {
+                    return PartitionMesh(indices, nFaces, positions, nVerts, attributes, c_ChunkFaces, faceRemap.data(), chunks);
+                }))
+            {
+                runner.AddMetric("chunks", double(chunks.size()));
+            }
+
+            if (runner.IsSelected("ExtractChunk")
+                && (!chunks.empty()
+                    || SUCCEEDED(PartitionMesh(indices, nFaces, positions, nVerts, attributes, c_ChunkFaces, faceRemap.data(), chunks))))
+            {
+                std::vector<index_t> chunkIndices(c_ChunkFaces * 3);
+                std::vector<uint32_t> chunkVerts;
+                size_t maxChunkVerts = 0;
+                if (runner.Run("ExtractChunk", NoSetup, [&]() -> HRESULT
+                    {
+                        // Every chunk of the mesh in turn
+                        for (auto it = chunks.cbegin(); it != chunks.cend(); ++it)
+                        {
+                            HRESULT hr = ExtractChunk(indices, nFaces, nVerts, faceRemap.data(), it->first, it->second,
+                                                      chunkIndices.data(), chunkVerts);
+                            if (FAILED(hr))
+                                return hr;
+
+                            maxChunkVerts = std::max(maxChunkVerts, chunkVerts.size());
+                        }
+                        return S_OK;
+                    }))
+                {
+                    runner.AddMetric("chunks", double(chunks.size()));
+                    runner.AddMetric("maxChunkVerts", double(maxChunkVerts));
+                }
+            }
+
+            if ((runner.IsSelected("GenerateAdjacencyChunked") || runner.IsSelected("ComputeNormalsChunked"))
+                && (!chunks.empty()
+                    || SUCCEEDED(PartitionMesh(indices, nFaces, positions, nVerts, attributes, c_ChunkFaces, faceRemap.data(), chunks))))
+            {
+                if (runner.Run("GenerateAdjacencyChunked", NoSetup, [&]() -> HRESULT
+                    {
+                        return GenerateAdjacencyChunked(indices, nFaces, positions, nVerts, faceRemap.data(), chunks, adj.data());
+                    }))
+                {
+                    runner.AddMetric("boundaryEdges", double(std::count(adj.cbegin(), adj.cend(), uint32_t(-1))));
+                }
+
+                std::vector<XMFLOAT3> vnormals(nVerts);
+                runner.Run("ComputeNormalsChunked", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeNormalsChunked(indices, nFaces, positions, nVerts, faceRemap.data(), chunks, CNORM_DEFAULT,
+                                                 vnormals.data());
+                });
+            }
+        }
+
+        //--- Meshlets ---
+        {
+            std::vector<Meshlet> meshlets;
+            std::vector<uint8_t> uniqueVertexIB;
+            std::vector<MeshletTriangle> primitiveIndices;
+            if (runner.Run("ComputeMeshlets", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeMeshlets(indices, nFaces, positions, nVerts, adjacency, meshlets, uniqueVertexIB, primitiveIndices);
+                }))
+            {
+                runner.AddMetric("meshlets", double(meshlets.size()));
+                runner.AddMetric("vertsPerMeshlet", double(uniqueVertexIB.size() / sizeof(index_t)) / double(meshlets.size()));
+            }
+
+            {
+                auto subsets = ComputeSubsets(attributes, nFaces);
+
+                std::vector<Meshlet> subsetMeshlets;
+                std::vector<uint8_t> subsetVertexIB;
+                std::vector<MeshletTriangle> subsetPrimitives;
+                std::vector<std::pair<size_t, size_t>> meshletSubsets(subsets.size());
+                if (runner.Run("ComputeMeshlets/subsets", NoSetup, [&]() -> HRESULT
+                    {
+                        return ComputeMeshlets(indices, nFaces, positions, nVerts, subsets.data(), subsets.size(), adjacency,
+                                               subsetMeshlets, subsetVertexIB, subsetPrimitives, meshletSubsets.data());
+                    }))
+                {
+                    runner.AddMetric("meshlets", double(subsetMeshlets.size()));
+                    runner.AddMetric("vertsPerMeshlet", double(subsetVertexIB.size() / sizeof(index_t)) / double(subsetMeshlets.size()));
+                }
+            }
+
+            if (runner.IsSelected("ComputeCullData")
+                && (!meshlets.empty()
+                    || SUCCEEDED(ComputeMeshlets(indices, nFaces, positions, nVerts, adjacency, meshlets, uniqueVertexIB, primitiveIndices))))
+            {
+                std::vector<CullData> cullData(meshlets.size());
+                runner.Run("ComputeCullData", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeCullData(positions, nVerts, meshlets.data(), meshlets.size(),
+                                           reinterpret_cast<const index_t*>(uniqueVertexIB.data()), uniqueVertexIB.size() / sizeof(index_t),
+                                           primitiveIndices.data(), primitiveIndices.size(), cullData.data());
+                });
+            }
+        }
+
+        //--- Compression, of the IB as written after OptimizeMesh ---
+        {
+            std::vector<uint8_t> encoded;
+            if (runner.Run("EncodeIndexBuffer", NoSetup, [&]() -> HRESULT
+                {
+                    return EncodeIndexBuffer(finalIB.data(), nFaces, encoded);
+                }))
+            {
+                runner.AddMetric("bytes", double(encoded.size()));
+                runner.AddMetric("bitsPerFace", double(encoded.size()) * 8.0 / double(nFaces));
+            }
+
+            if (runner.IsSelected("DecodeIndexBuffer")
+                && (!encoded.empty() || SUCCEEDED(EncodeIndexBuffer(finalIB.data(), nFaces, encoded))))
+            {
+                if (runner.Run("DecodeIndexBuffer", NoSetup, [&]() -> HRESULT
+                    {
+                        return DecodeIndexBuffer(encoded.data(), encoded.size(), nFaces, ib.data());
+                    }))
+                {
+                    runner.AddMetric("exact", (ib == finalIB) ? 1.0 : 0.0);
+                }
+            }
+        }
+
+        runner.Flush();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Entry points that take no IB
+    struct aligned_deleter { void operator()(void* p) { _aligned_free(p); } };
+
+    typedef std::unique_ptr<XMVECTOR[], aligned_deleter> ScopedVectorArray;
+
+    ScopedVectorArray NewVectorArray(size_t count)
+    {
+        return ScopedVectorArray(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * count, 16)));
+    }
+
+    void BenchVertices(BenchRunner& runner, const BenchMesh& mesh)
+    {
+        const size_t nFaces = mesh.GetFaceCount();
+        const size_t nVerts = mesh.GetVertexCount();
+        const size_t stride = sizeof(BenchVertex);
+
+        const BenchVertex* vertices = mesh.vertices.data();
+        const uint32_t* pointReps = mesh.pointReps.data();
+        const uint32_t* optimizedVerts = mesh.vertexRemap.data();
+
+        std::vector<uint32_t> attr(nFaces);
+        std::vector<uint32_t> faceRemap(nFaces);
+        std::vector<uint32_t> pr(nVerts);
+        std::vector<BenchVertex> vb(nVerts);
+        std::vector<BenchVertex> vbout(nVerts);
+
+        //--- Attributes ---
+        {
+            std::vector<std::pair<size_t, size_t>> subsets;
+            if (runner.Run("ComputeSubsets", NoSetup, [&]() -> HRESULT
+                {
+                    subsets = ComputeSubsets(mesh.attributes.data(), nFaces);
+                    return S_OK;
+                }))
+            {
+                runner.AddMetric("subsets", double(subsets.size()));
+            }
+
+            auto setup = [&]()
+            {
+                std::copy(mesh.attributes.cbegin(), mesh.attributes.cend(), attr.begin());
+            };
+
+            runner.Run("AttributeSort", setup, [&]() -> HRESULT
+            {
+                return AttributeSort(nFaces, attr.data(), faceRemap.data());
+            });
+
+            if (runner.Run("AttributeSort/subsets", setup, [&]() -> HRESULT
+                {
+                    return AttributeSort(nFaces, attr.data(), faceRemap.data(), subsets);
+                }))
+            {
+                runner.AddMetric("subsets", double(subsets.size()));
+            }
+        }
+
+        //--- Vertex buffer access ---
+        VBReader reader;
+        VBWriter writer;
+        if (FAILED(reader.Initialize(c_BenchLayout, _countof(c_BenchLayout)))
+            || FAILED(reader.AddStream(vertices, nVerts, 0, stride))
+            || FAILED(writer.Initialize(c_BenchLayout, _countof(c_BenchLayout)))
+            || FAILED(writer.AddStream(vbout.data(), nVerts, 0, stride)))
+        {
+            wprintf(L"ERROR: Failed initializing the VB reader and writer\n");
+            return;
+        }
+
+        {
+            std::vector<XMFLOAT3> positions(nVerts);
+            std::vector<XMFLOAT3> normals(nVerts);
+            std::vector<XMFLOAT2> texcoords(nVerts);
+
+            const VBElementData elements[] =
+            {
+                { "SV_Position", 0, VBELEMENT_FLOAT3, positions.data(), false },
+                { "NORMAL",      0, VBELEMENT_FLOAT3, normals.data(),   false },
+                { "TEXCOORD",    0, VBELEMENT_FLOAT2, texcoords.data(), false },
+            };
+
+            runner.Run("VBReader::Read", NoSetup, [&]() -> HRESULT
+            {
+                return reader.Read(elements, _countof(elements), nVerts);
+            });
+
+            runner.Run("VBWriter::Write", NoSetup, [&]() -> HRESULT
+            {
+                return writer.Write(elements, _countof(elements), nVerts);
+            });
+        }
+
+        {
+            const WeldElement elements[] =
+            {
+                { "SV_Position", 0, mesh.epsilon },
+                { "NORMAL",      0, 1e-3f },
+                { "TEXCOORD",    0, 0.f },
+            };
+
+            std::vector<uint32_t> vertexRemap(nVerts);
+            size_t nWeldedVerts = 0;
+            if (runner.Run("WeldVertices", NoSetup, [&]() -> HRESULT
+                {
+                    return WeldVertices(reader, nVerts, elements, _countof(elements), vertexRemap.data(), nWeldedVerts);
+                }))
+            {
+                runner.AddMetric("weldedVerts", double(nWeldedVerts));
+            }
+        }
+
+        //--- Remapping, to the OptimizeVertices order ---
+        runner.Run("FinalizeVB", NoSetup, [&]() -> HRESULT
+        {
+            return FinalizeVB(vertices, stride, nVerts, nullptr, 0, optimizedVerts, vbout.data());
+        });
+
+        runner.Run("FinalizeVB/streaming", NoSetup, [&]() -> HRESULT
+        {
+            return FinalizeVB(vertices, stride, nVerts, nullptr, 0, optimizedVerts, vbout.data(), FINALIZE_STREAMING);
+        });
+
+        auto copyVB = [&]()
+        {
+            std::copy(mesh.vertices.cbegin(), mesh.vertices.cend(), vb.begin());
+        };
+
+        runner.Run("FinalizeVB/inplace", copyVB, [&]() -> HRESULT
+        {
+            return FinalizeVB(vb.data(), stride, nVerts, optimizedVerts);
+        });
+
+        runner.Run("FinalizeVB/cycles", copyVB, [&]() -> HRESULT
+        {
+            return FinalizeVB(vb.data(), stride, nVerts, optimizedVerts, FINALIZE_CYCLES);
+        });
+
+        runner.Run("FinalizeVBAndPointReps", NoSetup, [&]() -> HRESULT
+        {
+            return FinalizeVBAndPointReps(vertices, stride, nVerts, pointReps, nullptr, 0, optimizedVerts, vbout.data(), pr.data());
+        });
+
+        runner.Run("FinalizeVBAndPointReps/inplace",
+            [&]()
+            {
+                copyVB();
+                std::copy(mesh.pointReps.cbegin(), mesh.pointReps.cend(), pr.begin());
+            },
+            [&]() -> HRESULT
+            {
+                return FinalizeVBAndPointReps(vb.data(), stride, nVerts, pr.data(), optimizedVerts);
+            });
+
+        //--- Compression, of the VB in OptimizeVertices order ---
+        std::vector<BenchVertex> finalVB(nVerts);
+        if (FAILED(FinalizeVB(vertices, stride, nVerts, nullptr, 0, optimizedVerts, finalVB.data())))
+        {
+            wprintf(L"ERROR: Failed preparing the optimized VB\n");
+            return;
+        }
+
+        {
+            std::vector<uint8_t> encoded;
+            if (runner.Run("EncodeVertexBuffer", NoSetup, [&]() -> HRESULT
+                {
+                    return EncodeVertexBuffer(finalVB.data(), nVerts, stride, encoded);
+                }))
+            {
+                runner.AddMetric("bytes", double(encoded.size()));
+                runner.AddMetric("ratio", double(encoded.size()) / double(nVerts * stride));
+            }
+
+            if (runner.IsSelected("DecodeVertexBuffer")
+                && (!encoded.empty() || SUCCEEDED(EncodeVertexBuffer(finalVB.data(), nVerts, stride, encoded))))
+            {
+                if (runner.Run("DecodeVertexBuffer", NoSetup, [&]() -> HRESULT
+                    {
+                        return DecodeVertexBuffer(encoded.data(), encoded.size(), nVerts, stride, vbout.data());
+                    }))
+                {
+                    runner.AddMetric("exact", memcmp(vbout.data(), finalVB.data(), nVerts * stride) ? 0.0 : 1.0);
+                }
+            }
+        }
+
+        //--- Quantization ---
+        {
+            auto positions = NewVectorArray(nVerts);
+            auto normals = NewVectorArray(nVerts);
+            auto quantized = NewVectorArray(nVerts);
+            if (!positions || !normals || !quantized)
+            {
+                wprintf(L"ERROR: Out of memory\n");
+                return;
+            }
+
+            for (size_t j = 0; j < nVerts; ++j)
+            {
+                positions[j] = XMLoadFloat3(&mesh.positions[j]);
+                normals[j] = XMLoadFloat3(&mesh.normals[j]);
+            }
+
+            VertexQuantization quantization = {};
+            if (runner.Run("ComputeQuantization", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeQuantization(positions.get(), nVerts, 3, QUANTIZE_DATA_RANGE, 1e-4f, QUANTIZE_DEFAULT, quantization);
+                }))
+            {
+                runner.AddMetric("bytes", double(BytesPerElement(quantization.format)));
+                runner.AddMetric("maxError", quantization.maxError);
+            }
+
+            {
+                VertexQuantization normalQuantization = {};
+                if (runner.Run("ComputeQuantization/normals", NoSetup, [&]() -> HRESULT
+                    {
+                        return ComputeQuantization(normals.get(), nVerts, 3, QUANTIZE_DATA_UNIT_VECTOR, 1e-2f, QUANTIZE_DEFAULT,
+                                                   normalQuantization);
+                    }))
+                {
+                    runner.AddMetric("bytes", double(BytesPerElement(normalQuantization.format)));
+                    runner.AddMetric("maxError", normalQuantization.maxError);
+                }
+            }
+
+            if (quantization.format == DXGI_FORMAT_UNKNOWN
+                && FAILED(ComputeQuantization(positions.get(), nVerts, 3, QUANTIZE_DATA_RANGE, 1e-4f, QUANTIZE_DEFAULT, quantization)))
+            {
+                wprintf(L"ERROR: Failed preparing the position quantization\n");
+                return;
+            }
+
+            runner.Run("QuantizeVertices", NoSetup, [&]() -> HRESULT
+            {
+                return QuantizeVertices(positions.get(), nVerts, quantization, quantized.get());
+            });
+
+            runner.Run("DequantizeVertices", NoSetup, [&]() -> HRESULT
+            {
+                return DequantizeVertices(quantized.get(), nVerts, quantization, positions.get());
+            });
+
+            D3D11_INPUT_ELEMENT_DESC quantizedDecl[_countof(c_BenchLayout)] = {};
+            VertexQuantization layoutQuantization[_countof(c_BenchLayout)] = {};
+            if (runner.Run("ComputeQuantizedLayout", NoSetup, [&]() -> HRESULT
+                {
+                    return ComputeQuantizedLayout(c_BenchLayout, _countof(c_BenchLayout), reader, nVerts, 1e-4f, 1e-2f, 1e-4f,
+                                                  QUANTIZE_DEFAULT, quantizedDecl, layoutQuantization);
+                }))
+            {
+                uint32_t strides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+                ComputeInputLayout(quantizedDecl, _countof(quantizedDecl), nullptr, strides);
+                runner.AddMetric("stride", double(strides[0]));
+            }
+        }
+
+        runner.Flush();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Writes every case run as a JSON object, so that two builds can be diffed case by case
+    void AppendJSONNumber(std::string& json, double value)
+    {
+        char buff[64];
+        if (value == value && value - value == 0.0)
+        {
+            sprintf_s(buff, "%.6g", value);
+        }
+        else
+        {
+            strcpy_s(buff, "null");
+        }
+        json += buff;
+    }
+
+    bool WriteResultsJSON(_In_z_ const wchar_t* szFile, const std::vector<BenchResult>& results, size_t iterations, bool arena)
+    {
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+
+        char buff[1024];
+        sprintf_s(buff, "{ \"threads\": %d, \"iterations\": %Iu, \"arena\": %s, \"results\": [", threads, iterations,
+                  arena ? "true" : "false");
+
+        std::string json = buff;
+
+        for (auto it = results.cbegin(); it != results.cend(); ++it)
+        {
+            sprintf_s(buff, "%s\n  { \"mesh\": \"%s\", \"faces\": %Iu, \"verts\": %Iu, \"index\": %u, \"case\": \"%s\", \"hr\": \"0x%08X\", \"ms\": %.3f, \"medianMs\": %.3f, \"tempBytes\": %Iu, \"metrics\": {",
+                      (it == results.cbegin()) ? "" : ",", it->mesh, it->nFaces, it->nVerts, it->indexBits, it->name,
+                      static_cast<unsigned int>(it->hr), it->minMs, it->medianMs, it->tempBytes);
+            json += buff;
+
+            for (size_t j = 0; j < it->nMetrics; ++j)
+            {
+                json += (j > 0) ? ", \"" : " \"";
+                json += it->metricNames[j];
+                json += "\": ";
+                AppendJSONNumber(json, it->metricValues[j]);
+            }
+
+            json += (it->nMetrics > 0) ? " } }" : "} }";
+        }
+
+        json += "\n] }\n";
+
+        std::ofstream outFile(szFile, std::ios::binary);
+        if (!outFile)
+            return false;
+
+        outFile.write(json.c_str(), static_cast<std::streamsize>(json.size()));
+        return !outFile.fail();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    // Parameters and defaults
+    wchar_t szOutputFile[MAX_PATH] = {};
+    wchar_t szFilter[MAX_PATH] = {};
+
+    DWORD meshTypes = MESH_ALL;
+    std::vector<size_t> faceCounts(c_DefaultFaceCounts, c_DefaultFaceCounts + _countof(c_DefaultFaceCounts));
+    unsigned indexWidths = 16 | 32;
+    size_t iterations = c_DefaultIterations;
+
+    // Process command line
+    DWORD dwOptions = 0;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        PWSTR pArg = argv[iArg];
+
+        if (('-' != pArg[0]) && ('/' != pArg[0]))
+        {
+            wprintf(L"ERROR: unexpected argument '%ls'\n\n", pArg);
+            PrintUsage();
+            return 1;
+        }
+
+        pArg++;
+        PWSTR pValue;
+
+        for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+        if (*pValue)
+            *pValue++ = 0;
+
+        DWORD dwOption = LookupByName(pArg, g_pOptions);
+
+        if (!dwOption || (dwOptions & (1 << dwOption)))
+        {
+            wprintf(L"ERROR: unknown command-line option '%ls'\n\n", pArg);
+            PrintUsage();
+            return 1;
+        }
+
+        dwOptions |= 1 << dwOption;
+
+        // Handle options with additional value parameter
+        switch (dwOption)
+        {
+        case OPT_MESH:
+        case OPT_FACES:
+        case OPT_INDEX:
+        case OPT_ITERATIONS:
+        case OPT_FILTER:
+        case OPT_OUTPUTFILE:
+            if (!*pValue)
+            {
+                if ((iArg + 1 >= argc))
+                {
+                    wprintf(L"ERROR: missing value for command-line option '%ls'\n\n", pArg);
+                    PrintUsage();
+                    return 1;
+                }
+
+                iArg++;
+                pValue = argv[iArg];
+            }
+            break;
+        }
+
+        switch (dwOption)
+        {
+        case OPT_MESH:
+            if (!ParseMeshTypes(pValue, meshTypes))
+            {
+                wprintf(L"Invalid value specified with -mesh (%ls)\n", pValue);
+                return 1;
+            }
+            break;
+
+        case OPT_FACES:
+            if (!ParseFaceCounts(pValue, faceCounts))
+            {
+                wprintf(L"Invalid value specified with -faces (%ls)\n", pValue);
+                return 1;
+            }
+            break;
+
+        case OPT_INDEX:
+            if (swscanf_s(pValue, L"%u", &indexWidths) != 1 || (indexWidths != 16 && indexWidths != 32))
+            {
+                wprintf(L"Invalid value specified with -index (%ls)\n", pValue);
+                return 1;
+            }
+            break;
+
+        case OPT_ITERATIONS:
+            if (swscanf_s(pValue, L"%Iu", &iterations) != 1 || !iterations)
+            {
+                wprintf(L"Invalid value specified with -iter (%ls)\n", pValue);
+                return 1;
+            }
+            break;
+
+        case OPT_FILTER:
+            wcscpy_s(szFilter, MAX_PATH, pValue);
+            break;
+
+        case OPT_OUTPUTFILE:
+            wcscpy_s(szOutputFile, MAX_PATH, pValue);
+            break;
+        }
+    }
+
+    if (~dwOptions & (1 << OPT_NOLOGO))
+        PrintLogo();
+
+#ifdef _OPENMP
+    wprintf(L"%d threads, %Iu iterations per case\n\n", omp_get_max_threads(), iterations);
+#else
+    wprintf(L"1 thread, %Iu iterations per case\n\n", iterations);
+#endif
+
+    ScratchArena arena;
+    if (dwOptions & (1 << OPT_ARENA))
+    {
+        SetScratchArena(&arena);
+    }
+
+    BenchRunner runner(iterations, *szFilter ? szFilter : nullptr);
+
+    PrintHeader();
+
+    for (size_t type = 0; g_pMeshTypes[type].pName; ++type)
+    {
+        DWORD meshType = g_pMeshTypes[type].dwValue;
+        if (meshType == MESH_ALL || !(meshTypes & meshType))
+            continue;
+
+        for (auto it = faceCounts.cbegin(); it != faceCounts.cend(); ++it)
+        {
+            BenchMesh mesh;
+            switch (meshType)
+            {
+            case MESH_GRID:     MakeGrid(*it, mesh); break;
+            case MESH_SPHERE:   MakeSphere(*it, mesh); break;
+            case MESH_SCAN:     MakeScan(*it, mesh); break;
+            default:            MakeSubsets(*it, mesh); break;
+            }
+
+            HRESULT hr = PrepareMesh(mesh);
+            if (FAILED(hr))
+            {
+                wprintf(L"ERROR: Failed preparing %hs mesh of %Iu faces (%08X)\n", mesh.name, mesh.GetFaceCount(),
+                        static_cast<unsigned int>(hr));
+                return 1;
+            }
+
+            size_t nFaces = mesh.GetFaceCount();
+            size_t nVerts = mesh.GetVertexCount();
+
+            runner.SetMesh(mesh.name, nFaces, nVerts, 0);
+            BenchVertices(runner, mesh);
+
+            if (indexWidths & 16)
+            {
+                if (nVerts < UINT16_MAX)
+                {
+                    std::vector<uint16_t> indices16(mesh.indices.size());
+                    for (size_t j = 0; j < mesh.indices.size(); ++j)
+                        indices16[j] = static_cast<uint16_t>(mesh.indices[j]);
+
+                    runner.SetMesh(mesh.name, nFaces, nVerts, 16);
+                    BenchIndexed(runner, mesh, indices16);
+                }
+                else
+                {
+                    wprintf(L"%-8hs %10Iu %10Iu %5ls (too many vertices for 16-bit indices)\n", mesh.name, nFaces, nVerts, L"16");
+                }
+            }
+
+            if (indexWidths & 32)
+            {
+                runner.SetMesh(mesh.name, nFaces, nVerts, 32);
+                BenchIndexed(runner, mesh, mesh.indices);
+            }
+        }
+    }
+
+    SetScratchArena(nullptr);
+
+    if (*szOutputFile)
+    {
+        if (!WriteResultsJSON(szOutputFile, runner.GetResults(), iterations, (dwOptions & (1 << OPT_ARENA)) != 0))
+        {
+            wprintf(L"\nERROR: Failed writing results file '%ls'\n", szOutputFile);
+            return 1;
+        }
+    }
+
+    // Any failed case fails the run, so it can gate a build
+    for (auto it = runner.GetResults().cbegin(); it != runner.GetResults().cend(); ++it)
+    {
+        if (FAILED(it->hr))
+            return 1;
+    }
+
+    return 0;
+}
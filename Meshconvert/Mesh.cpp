@@ -21,6 +21,8 @@
 #include <DirectXPackedVector.h>
 #include <DirectXCollision.h>
 
+#include <stdio.h>
+
 using namespace DirectX;
 
 namespace
@@ -77,12 +79,191 @@ namespace
         return S_OK;
     }
 
+    //----------------------------------------------------------------------------------
+    // Writes count records of T, filled in by fill(index, record), through a fixed-size
+    // staging buffer rather than a copy of the whole array
+    template<typename T, typename Fn> HRESULT write_file_records(HANDLE hFile, size_t count, Fn fill)
+    {
+        const size_t chunkCount = std::max<size_t>(65536 / sizeof(T), 1);
+
+        std::unique_ptr<T[]> chunk(new (std::nothrow) T[std::min(count, chunkCount)]);
+        if (!chunk)
+            return E_OUTOFMEMORY;
+
+        for (size_t base = 0; base < count; base += chunkCount)
+        {
+            size_t n = std::min(count - base, chunkCount);
+
+            for (size_t j = 0; j < n; ++j)
+            {
+                fill(base + j, chunk[j]);
+            }
+
+            DWORD bytes = static_cast<DWORD>(sizeof(T) * n);
+
+            DWORD bytesWritten;
+            if (!WriteFile(hFile, chunk.get(), bytes, &bytesWritten, nullptr))
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            if (bytesWritten != bytes)
+                return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+    //----------------------------------------------------------------------------------
+    struct view_unmapper { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+    // Creates a file of a known size and writes it through a mapped view, so vertex and
+    // index data are built directly in the file instead of in a copy of it. The file is
+    // zero-filled, so padding only needs to be skipped.
+    class mapped_file_writer
+    {
+    public:
+        mapped_file_writer() : mData(nullptr), mSize(0), mOffset(0) {}
+
+        HRESULT create(_In_z_ const wchar_t* szFileName, uint64_t size)
+        {
+            if (!size)
+                return E_INVALIDARG;
+
+#if !defined(_WIN64)
+            if (size > UINT32_MAX)
+                return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+#endif
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+            mFile.reset(safe_handle(CreateFile2(szFileName, GENERIC_READ | GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr)));
+#else
+            mFile.reset(safe_handle(CreateFileW(szFileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
+#endif
+            if (!mFile)
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            // Mapping past the end of the file extends it to the full size
+            mMapping.reset(CreateFileMappingW(mFile.get(), nullptr, PAGE_READWRITE,
+                                              static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr));
+            if (!mMapping)
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            mView.reset(MapViewOfFile(mMapping.get(), FILE_MAP_WRITE, 0, 0, 0));
+            if (!mView)
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            mData = static_cast<uint8_t*>(mView.get());
+            mSize = static_cast<size_t>(size);
+            mOffset = 0;
+
+            return S_OK;
+        }
+
+        // Returns the next bytes of the file to be filled in place, or nullptr if past the end
+        uint8_t* reserve(size_t bytes)
+        {
+            if (!mData || bytes > (mSize - mOffset))
+                return nullptr;
+
+            uint8_t* ptr = mData + mOffset;
+            mOffset += bytes;
+            return ptr;
+        }
+
+        HRESULT write(_In_reads_bytes_(bytes) const void* data, size_t bytes)
+        {
+            uint8_t* ptr = reserve(bytes);
+            if (!ptr)
+                return E_FAIL;
+
+            memcpy(ptr, data, bytes);
+            return S_OK;
+        }
+
+        template<typename T> HRESULT write(const T& value)
+        {
+            return write(&value, sizeof(T));
+        }
+
+        HRESULT skip(size_t bytes)
+        {
+            return reserve(bytes) ? S_OK : E_FAIL;
+        }
+
+        bool complete() const { return mData && mOffset == mSize; }
+
+    private:
+        ScopedHandle                            mFile;
+        ScopedHandle                            mMapping;
+        std::unique_ptr<void, view_unmapper>    mView;
+        uint8_t*                                mData;
+        size_t                                  mSize;
+        size_t                                  mOffset;
+    };
+
+    //----------------------------------------------------------------------------------
+    // Narrows a 32-bit index buffer into 16-bit indices
+    HRESULT copy_indices16(_In_reads_(count) const uint32_t* indices, size_t count, _Out_writes_(count) uint16_t* ib)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            uint32_t index = indices[j];
+            if (index == uint32_t(-1))
+            {
+                ib[j] = uint16_t(-1);
+            }
+            else if (index >= UINT16_MAX)
+            {
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+            else
+            {
+                ib[j] = static_cast<uint16_t>(index);
+            }
+        }
+
+        return S_OK;
+    }
+
     inline UINT64 roundup4k(UINT64 value)
     {
         return ((value + 4095) / 4096) * 4096;
     }
 
-    static const uint8_t g_padding[4096] = {};
+    //----------------------------------------------------------------------------------
+    struct aligned_deleter { void operator()(void* p) { _aligned_free(p); } };
+
+    inline XMVECTOR XM_CALLCONV load_vector(const XMFLOAT2& v) { return XMLoadFloat2(&v); }
+    inline XMVECTOR XM_CALLCONV load_vector(const XMFLOAT3& v) { return XMLoadFloat3(&v); }
+    inline XMVECTOR XM_CALLCONV load_vector(const XMFLOAT4& v) { return XMLoadFloat4(&v); }
+
+    // Checks if half floats hold the first nComponents of each element within tolerance (in radians for unit
+    // vectors); a negative tolerance always keeps full floats
+    template<class T>
+    HRESULT fits_half(_In_reads_(nVerts) const T* data, size_t nVerts, size_t nComponents, QUANTIZE_DATA type,
+                      float tolerance, _Out_ bool& result)
+    {
+        result = false;
+
+        if (tolerance < 0.f)
+            return S_OK;
+
+        std::unique_ptr<XMVECTOR[], aligned_deleter> temp(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nVerts, 16)));
+        if (!temp)
+            return E_OUTOFMEMORY;
+
+        for (size_t j = 0; j < nVerts; ++j)
+        {
+            temp[j] = load_vector(data[j]);
+        }
+
+        VertexQuantization quant;
+        HRESULT hr = ComputeQuantization(temp.get(), nVerts, nComponents, type, tolerance, QUANTIZE_FLOAT_ONLY, quant);
+        if (FAILED(hr))
+            return hr;
+
+        result = (quant.format == DXGI_FORMAT_R16G16_FLOAT || quant.format == DXGI_FORMAT_R16G16B16A16_FLOAT);
+        return S_OK;
+    }
 }
 
 // Move constructor
@@ -109,6 +290,21 @@ Mesh& Mesh::operator= (Mesh&& moveFrom)
         mColors.swap( moveFrom.mColors );
         mBlendIndices.swap( moveFrom.mBlendIndices );
         mBlendWeights.swap( moveFrom.mBlendWeights );
+        mnDepthFaces = moveFrom.mnDepthFaces;
+        mnDepthVerts = moveFrom.mnDepthVerts;
+        mDepthIndices.swap( moveFrom.mDepthIndices );
+        mDepthPositions.swap( moveFrom.mDepthPositions );
+        mLODIndices.swap( moveFrom.mLODIndices );
+        mLODAttributes.swap( moveFrom.mLODAttributes );
+        mLODFaceOffsets.swap( moveFrom.mLODFaceOffsets );
+        mLODVertexCounts.swap( moveFrom.mLODVertexCounts );
+        mDerived = moveFrom.mDerived;
+        mStale = moveFrom.mStale;
+        mAdjacencyEpsilon = moveFrom.mAdjacencyEpsilon;
+        mNormalFlags = moveFrom.mNormalFlags;
+        mBiTangentsWanted = moveFrom.mBiTangentsWanted;
+        mDepthFlags = moveFrom.mDepthFlags;
+        mChunkFaces = moveFrom.mChunkFaces;
     }
     return *this;
 }
@@ -133,6 +329,198 @@ void Mesh::Clear()
     mColors.reset();
     mBlendIndices.reset();
     mBlendWeights.reset();
+
+    // Release depth stream
+    mnDepthFaces = mnDepthVerts = 0;
+    mDepthIndices.reset();
+    mDepthPositions.reset();
+
+    ReleaseLODs();
+
+    mDerived = mStale = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void Mesh::ReleaseLODs()
+{
+    mLODIndices.reset();
+    mLODAttributes.reset();
+    mLODFaceOffsets.clear();
+    mLODVertexCounts.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void Mesh::Invalidate( uint32_t streams )
+{
+    // Tangent frames are built from normals
+    if (streams & DERIVED_NORMALS)
+        streams |= DERIVED_TANGENTS;
+
+    // Loaded streams have nothing to rebuild from, so they are left as they are
+    streams &= mDerived;
+
+    // Stale streams are released so that edits and remaps skip them until they are rebuilt
+    if (streams & DERIVED_ADJACENCY)
+    {
+        mAdjacency.reset();
+    }
+
+    if (streams & DERIVED_NORMALS)
+    {
+        mNormals.reset();
+    }
+
+    if (streams & DERIVED_TANGENTS)
+    {
+        mTangents.reset();
+        mBiTangents.reset();
+    }
+
+    if (streams & DERIVED_DEPTH)
+    {
+        mnDepthFaces = mnDepthVerts = 0;
+        mDepthIndices.reset();
+        mDepthPositions.reset();
+    }
+
+    mStale |= streams;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT Mesh::UpdateDerived( uint32_t streams ) const
+{
+    if (streams & DERIVED_TANGENTS)
+        streams |= DERIVED_NORMALS;
+
+    streams &= mStale;
+    if (!streams)
+        return S_OK;
+
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions)
+        return E_UNEXPECTED;
+
+    if ((uint64_t(mnFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    // Chunked adjacency matches exact positions only, so geometric adjacency always covers the whole mesh
+    bool chunkAdjacency = mChunkFaces && !mAdjacencyEpsilon && (streams & DERIVED_ADJACENCY);
+    bool chunkNormals = mChunkFaces && (streams & DERIVED_NORMALS);
+
+    std::unique_ptr<uint32_t[]> faceRemap;
+    std::vector<std::pair<size_t, size_t>> chunks;
+    if (chunkAdjacency || chunkNormals)
+    {
+        faceRemap.reset( new (std::nothrow) uint32_t[ mnFaces ] );
+        if (!faceRemap)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = PartitionMesh(mIndices.get(), mnFaces, mPositions.get(), mnVerts, nullptr, mChunkFaces, faceRemap.get(), chunks);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    if (streams & DERIVED_ADJACENCY)
+    {
+        std::unique_ptr<uint32_t[]> adj( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
+        if (!adj)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = (chunkAdjacency)
+            ? GenerateAdjacencyChunked(mIndices.get(), mnFaces, mPositions.get(), mnVerts, faceRemap.get(), chunks, adj.get())
+            : GenerateAdjacencyAndPointReps(mIndices.get(), mnFaces, mPositions.get(), mnVerts, mAdjacencyEpsilon, nullptr, adj.get());
+        if (FAILED(hr))
+            return hr;
+
+        mAdjacency.swap(adj);
+        mStale &= ~uint32_t(DERIVED_ADJACENCY);
+    }
+
+    if (streams & DERIVED_NORMALS)
+    {
+        std::unique_ptr<XMFLOAT3[]> norms( new (std::nothrow) XMFLOAT3[ mnVerts ] );
+        if (!norms)
+            return E_OUTOFMEMORY;
+
+        HRESULT hr = (chunkNormals)
+            ? ComputeNormalsChunked(mIndices.get(), mnFaces, mPositions.get(), mnVerts, faceRemap.get(), chunks, mNormalFlags, norms.get())
+            : DirectX::ComputeNormals(mIndices.get(), mnFaces, mPositions.get(), mnVerts, mNormalFlags, norms.get());
+        if (FAILED(hr))
+            return hr;
+
+        mNormals.swap(norms);
+        mStale &= ~uint32_t(DERIVED_NORMALS);
+    }
+
+    if (streams & DERIVED_TANGENTS)
+    {
+        if (!mNormals || !mTexCoords)
+            return E_UNEXPECTED;
+
+        std::unique_ptr<XMFLOAT4[]> tan1( new (std::nothrow) XMFLOAT4[ mnVerts ] );
+        if (!tan1)
+            return E_OUTOFMEMORY;
+
+        std::unique_ptr<XMFLOAT3[]> tan2;
+        if (mBiTangentsWanted)
+        {
+            tan2.reset( new (std::nothrow) XMFLOAT3[ mnVerts ] );
+            if (!tan2)
+                return E_OUTOFMEMORY;
+        }
+
+        HRESULT hr = (tan2)
+            ? DirectX::ComputeTangentFrame(mIndices.get(), mnFaces, mPositions.get(), mNormals.get(), mTexCoords.get(), mnVerts,
+                                           tan1.get(), tan2.get())
+            : DirectX::ComputeTangentFrame(mIndices.get(), mnFaces, mPositions.get(), mNormals.get(), mTexCoords.get(), mnVerts,
+                                           tan1.get());
+        if (FAILED(hr))
+            return hr;
+
+        mTangents.swap(tan1);
+        mBiTangents.swap(tan2);
+        mStale &= ~uint32_t(DERIVED_TANGENTS);
+    }
+
+    if (streams & DERIVED_DEPTH)
+    {
+        std::unique_ptr<uint32_t[]> pointRep( new (std::nothrow) uint32_t[ mnVerts ] );
+        if (!pointRep)
+            return E_OUTOFMEMORY;
+
+        // Only exactly coincident positions are welded, so the depth stream rasterizes the same coverage
+        HRESULT hr = GenerateAdjacencyAndPointReps(mIndices.get(), mnFaces, mPositions.get(), mnVerts, 0.f, pointRep.get(), nullptr);
+        if (FAILED(hr))
+            return hr;
+
+        std::unique_ptr<uint32_t[]> indices( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
+        std::unique_ptr<XMFLOAT3[]> positions( new (std::nothrow) XMFLOAT3[ mnVerts ] );
+        if (!indices || !positions)
+            return E_OUTOFMEMORY;
+
+        size_t nDepthFaces = 0;
+        size_t nDepthVerts = 0;
+        hr = GeneratePositionStream(mIndices.get(), mnFaces, mPositions.get(), mnVerts, pointRep.get(),
+                                    indices.get(), nDepthFaces, positions.get(), nDepthVerts, mDepthFlags);
+        if (FAILED(hr))
+            return hr;
+
+        if (!nDepthFaces)
+        {
+            indices.reset();
+            positions.reset();
+        }
+
+        mnDepthFaces = nDepthFaces;
+        mnDepthVerts = nDepthVerts;
+        mDepthIndices.swap(indices);
+        mDepthPositions.swap(positions);
+        mStale &= ~uint32_t(DERIVED_DEPTH);
+    }
+
+    return S_OK;
 }
 
 
@@ -151,6 +539,9 @@ HRESULT Mesh::SetIndexData( size_t nFaces, const uint16_t* indices, uint32_t* at
     mIndices.reset();
     mAttributes.reset();
 
+    Invalidate(DERIVED_ALL);
+    ReleaseLODs();
+
     std::unique_ptr<uint32_t[]> ib(new (std::nothrow) uint32_t[nFaces * 3]);
     if (!ib)
         return E_OUTOFMEMORY;
@@ -197,6 +588,9 @@ HRESULT Mesh::SetIndexData( size_t nFaces, const uint32_t* indices, uint32_t* at
     mIndices.reset();
     mAttributes.reset();
 
+    Invalidate(DERIVED_ALL);
+    ReleaseLODs();
+
     std::unique_ptr<uint32_t[]> ib( new (std::nothrow) uint32_t[ nFaces * 3] );
     if ( !ib )
         return E_OUTOFMEMORY;
@@ -238,15 +632,24 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
     mBlendIndices.reset();
     mBlendWeights.reset();
 
+    // Normals and tangent frames are replaced by whatever the reader holds
+    mDerived &= ~uint32_t(DERIVED_NORMALS | DERIVED_TANGENTS);
+    mStale &= mDerived;
+
+    Invalidate(DERIVED_ADJACENCY | DERIVED_DEPTH);
+    ReleaseLODs();
+
     // Load positions (required)
     std::unique_ptr<XMFLOAT3[]> pos( new (std::nothrow) XMFLOAT3[ nVerts ] );
     if (!pos)
         return E_OUTOFMEMORY;
-    
-    HRESULT hr = reader.Read(pos.get(), "SV_Position", 0, nVerts);
-    if (FAILED(hr))
-        return hr;
-    
+
+    VBElementData elements[8];
+    size_t nElements = 0;
+
+    VBElementData position = { "SV_Position", 0, VBELEMENT_FLOAT3, pos.get(), false };
+    elements[nElements++] = position;
+
     // Load normals
     std::unique_ptr<XMFLOAT3[]> norms;
     auto e = reader.GetElement11("NORMAL", 0);
@@ -256,9 +659,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!norms)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(norms.get(), "NORMAL", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "NORMAL", 0, VBELEMENT_FLOAT3, norms.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load tangents
@@ -270,9 +672,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!tans1)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(tans1.get(), "TANGENT", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "TANGENT", 0, VBELEMENT_FLOAT4, tans1.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load bi-tangents
@@ -284,9 +685,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!tans2)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(tans2.get(), "BINORMAL", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "BINORMAL", 0, VBELEMENT_FLOAT3, tans2.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load texture coordinates
@@ -298,9 +698,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!texcoord)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(texcoord.get(), "TEXCOORD", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "TEXCOORD", 0, VBELEMENT_FLOAT2, texcoord.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load vertex colors
@@ -312,9 +711,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!colors)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(colors.get(), "COLOR", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "COLOR", 0, VBELEMENT_FLOAT4, colors.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load skinning bone indices
@@ -326,9 +724,8 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!blendIndices)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(blendIndices.get(), "BLENDINDICES", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "BLENDINDICES", 0, VBELEMENT_FLOAT4, blendIndices.get(), false };
+        elements[nElements++] = element;
     }
 
     // Load skinning bone weights
@@ -340,11 +737,15 @@ HRESULT Mesh::SetVertexData( _Inout_ DirectX::VBReader& reader, _In_ size_t nVer
         if (!blendWeights)
             return E_OUTOFMEMORY;
 
-        hr = reader.Read(blendWeights.get(), "BLENDWEIGHT", 0, nVerts);
-        if (FAILED(hr))
-            return hr;
+        VBElementData element = { "BLENDWEIGHT", 0, VBELEMENT_FLOAT4, blendWeights.get(), false };
+        elements[nElements++] = element;
     }
 
+    // Read all the elements in one pass over the vertex buffer
+    HRESULT hr = reader.Read(elements, nElements, nVerts);
+    if (FAILED(hr))
+        return hr;
+
     // Return values
     mPositions.swap( pos );
     mNormals.swap( norms );
@@ -367,6 +768,10 @@ HRESULT Mesh::Validate(DWORD flags, std::wstring* msgs) const
     if (!mnFaces || !mIndices || !mnVerts)
         return E_UNEXPECTED;
 
+    HRESULT hr = UpdateDerived(DERIVED_ADJACENCY);
+    if (FAILED(hr))
+        return hr;
+
     return DirectX::Validate(mIndices.get(), mnFaces, mnVerts, mAdjacency.get(), flags, msgs);
 }
 
@@ -377,8 +782,15 @@ HRESULT Mesh::Clean()
     if (!mnFaces || !mIndices || !mnVerts || !mPositions)
         return E_UNEXPECTED;
 
+    // Clean updates adjacency for the faces it moves onto split vertices
+    HRESULT hr = UpdateDerived(DERIVED_ADJACENCY);
+    if (FAILED(hr))
+        return hr;
+
+    ReleaseLODs();
+
     std::vector<uint32_t> dups;
-    HRESULT hr = DirectX::Clean(mIndices.get(), mnFaces, mnVerts, mAdjacency.get(), mAttributes.get(), dups);
+    hr = DirectX::Clean(mIndices.get(), mnFaces, mnVerts, mAdjacency.get(), mAttributes.get(), dups);
     if (FAILED(hr))
         return hr;
 
@@ -388,6 +800,9 @@ HRESULT Mesh::Clean()
         return S_OK;
     }
 
+    // Split vertices get their own normals and tangent frames when derived, rather than copies of the originals
+    Invalidate(DERIVED_NORMALS);
+
     size_t nNewVerts = mnVerts + dups.size();
 
     std::unique_ptr<XMFLOAT3[]> pos(new (std::nothrow) XMFLOAT3[nNewVerts]);
@@ -523,20 +938,24 @@ HRESULT Mesh::Clean()
 }
 
 
+//--------------------------------------------------------------------------------------
+void Mesh::SetChunkSize( _In_ size_t maxChunkFaces )
+{
+    mChunkFaces = maxChunkFaces;
+}
+
+
 //--------------------------------------------------------------------------------------
 HRESULT Mesh::GenerateAdjacency( _In_ float epsilon )
 {
     if (!mnFaces || !mIndices || !mnVerts || !mPositions)
         return E_UNEXPECTED;
 
-    if ((uint64_t(mnFaces) * 3) >= UINT32_MAX)
-        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
-
-    mAdjacency.reset( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
-    if ( !mAdjacency )
-        return E_OUTOFMEMORY;
+    mDerived |= DERIVED_ADJACENCY;
+    mAdjacencyEpsilon = epsilon;
 
-    return DirectX::GenerateAdjacencyAndPointReps(mIndices.get(), mnFaces, mPositions.get(), mnVerts, epsilon, nullptr, mAdjacency.get());
+    Invalidate(DERIVED_ADJACENCY);
+    return UpdateDerived(DERIVED_ADJACENCY);
 }
 
 
@@ -546,192 +965,344 @@ HRESULT Mesh::ComputeNormals( _In_ DWORD flags )
     if (!mnFaces || !mIndices || !mnVerts || !mPositions)
         return E_UNEXPECTED;
 
-    mNormals.reset( new (std::nothrow) XMFLOAT3[ mnVerts ] );
-    if (!mNormals)
-        return E_OUTOFMEMORY;
+    mDerived |= DERIVED_NORMALS;
+    mNormalFlags = flags;
 
-    return DirectX::ComputeNormals(mIndices.get(), mnFaces, mPositions.get(), mnVerts, flags, mNormals.get());
+    Invalidate(DERIVED_NORMALS);
+    return UpdateDerived(DERIVED_NORMALS);
 }
 
 
 //--------------------------------------------------------------------------------------
 HRESULT Mesh::ComputeTangentFrame( _In_ bool bitangents )
 {
-    if (!mnFaces || !mIndices || !mnVerts || !mPositions || !mNormals || !mTexCoords)
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions || !GetNormalBuffer() || !mTexCoords)
         return E_UNEXPECTED;
 
-    mTangents.reset();
-    mBiTangents.reset();
-
-    std::unique_ptr<XMFLOAT4[]> tan1( new (std::nothrow) XMFLOAT4[mnVerts] );
-    if (!tan1)
-        return E_OUTOFMEMORY;
-
-    std::unique_ptr<XMFLOAT3[]> tan2;
-    if (bitangents)
-    {
-        tan2.reset( new (std::nothrow) XMFLOAT3[mnVerts] );
-        if (!tan2)
-            return E_OUTOFMEMORY;
-
-        HRESULT hr = DirectX::ComputeTangentFrame(mIndices.get(), mnFaces, mPositions.get(), mNormals.get(), mTexCoords.get(), mnVerts,
-                                                  tan1.get(), tan2.get());
-        if (FAILED(hr))
-            return hr;
-    }
-    else
-    {
-        mBiTangents.reset();
-
-        HRESULT hr = DirectX::ComputeTangentFrame(mIndices.get(), mnFaces, mPositions.get(), mNormals.get(), mTexCoords.get(), mnVerts,
-                                                  tan1.get());
-        if (FAILED(hr))
-            return hr;
-    }
-
-    mTangents.swap( tan1 );
-    mBiTangents.swap( tan2 );
+    mDerived |= DERIVED_TANGENTS;
+    mBiTangentsWanted = bitangents;
 
-    return S_OK;
+    Invalidate(DERIVED_TANGENTS);
+    return UpdateDerived(DERIVED_TANGENTS);
 }
 
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-HRESULT Mesh::Optimize( bool lru )
+HRESULT Mesh::Optimize( bool lru, bool overdraw, bool clockwise )
 {
     if (!mnFaces || !mIndices || !mnVerts || !mPositions)
         return E_UNEXPECTED;
 
-    if (!lru && !mAdjacency)
-        return E_UNEXPECTED;
+    // Chunks build strips from their own adjacency
+    if (!lru && !mChunkFaces)
+    {
+        HRESULT hr = UpdateDerived(DERIVED_ADJACENCY);
+        if (FAILED(hr))
+            return hr;
 
-    HRESULT hr = S_OK;
+        if (!mAdjacency)
+            return E_UNEXPECTED;
+    }
 
-    {
-        std::unique_ptr<uint32_t[]> remap(new (std::nothrow) uint32_t[mnFaces]);
-        if (!remap)
-            return E_OUTOFMEMORY;
+    ReleaseLODs();
 
-        if (mAttributes)
+    // Stale derived streams were released, so only live streams are remapped; the depth stream does not
+    // depend on the face or vertex order and is left as it is.
+    // Note that Clean handles vertex splits due to reuse between attributes
+    MeshVertexStream streams[8];
+    size_t nStreams = 0;
+
+    auto addStream = [&](void* vb, size_t stride)
+    {
+        if (vb)
         {
-            // Note that Clean handles vertex splits due to reuse between attributes
+            streams[nStreams].vb = vb;
+            streams[nStreams].stride = stride;
+            ++nStreams;
+        }
+    };
 
-            hr = AttributeSort(mnFaces, mAttributes.get(), remap.get());
-            if (FAILED(hr))
-                return hr;
+    addStream(mPositions.get(), sizeof(XMFLOAT3));
+    addStream(mNormals.get(), sizeof(XMFLOAT3));
+    addStream(mTangents.get(), sizeof(XMFLOAT4));
+    addStream(mBiTangents.get(), sizeof(XMFLOAT3));
+    addStream(mTexCoords.get(), sizeof(XMFLOAT2));
+    addStream(mColors.get(), sizeof(XMFLOAT4));
+    addStream(mBlendIndices.get(), sizeof(XMFLOAT4));
+    addStream(mBlendWeights.get(), sizeof(XMFLOAT4));
 
-            if (mAdjacency)
-            {
-                hr = ReorderIBAndAdjacency(mIndices.get(), mnFaces, mAdjacency.get(), remap.get());
-            }
-            else
-            {
-                hr = ReorderIB(mIndices.get(), mnFaces, remap.get());
-            }
+    DWORD flags = (lru) ? OPTMESH_LRU : OPTMESH_DEFAULT;
+    if (overdraw)
+    {
+        flags |= OPTMESH_OVERDRAW;
+        if (clockwise)
+            flags |= OPTMESH_WIND_CW;
+    }
+
+    if (mChunkFaces)
+    {
+        return OptimizeMeshChunked(mIndices.get(), mnFaces, mAdjacency.get(), mAttributes.get(), mPositions.get(), mnVerts, mChunkFaces,
+                                   streams, nStreams, flags);
+    }
+
+    return OptimizeMesh(mIndices.get(), mnFaces, mAdjacency.get(), mAttributes.get(), mnVerts,
+                        streams, nStreams, flags, 0, 0, mPositions.get());
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT Mesh::GenerateDepthStream( bool lru, bool overdraw, bool clockwise )
+{
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions)
+        return E_UNEXPECTED;
+
+    DWORD flags = (lru) ? OPTMESH_LRU : OPTMESH_DEFAULT;
+    if (overdraw)
+    {
+        flags |= OPTMESH_OVERDRAW;
+        if (clockwise)
+            flags |= OPTMESH_WIND_CW;
+    }
+
+    mDerived |= DERIVED_DEPTH;
+    mDepthFlags = flags;
+
+    Invalidate(DERIVED_DEPTH);
+    return UpdateDerived(DERIVED_DEPTH);
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT Mesh::GenerateLODs( size_t nLODs, bool lru )
+{
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions)
+        return E_UNEXPECTED;
+
+    if (!nLODs)
+        return E_INVALIDARG;
+
+    ReleaseLODs();
+
+    HRESULT hr = UpdateDerived(DERIVED_ADJACENCY);
+    if (FAILED(hr))
+        return hr;
+
+    std::unique_ptr<uint32_t[]> pointRep( new (std::nothrow) uint32_t[ mnVerts ] );
+    std::unique_ptr<uint32_t[]> adj( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
+    std::unique_ptr<uint32_t[]> ib( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
+    std::unique_ptr<uint32_t[]> simplified( new (std::nothrow) uint32_t[ mnFaces * 3 ] );
+    std::unique_ptr<uint32_t[]> faceRemap( new (std::nothrow) uint32_t[ mnFaces ] );
+    if (!pointRep || !adj || !ib || !simplified || !faceRemap)
+        return E_OUTOFMEMORY;
+
+    std::unique_ptr<uint32_t[]> attr;
+    if (mAttributes)
+    {
+        attr.reset( new (std::nothrow) uint32_t[ mnFaces ] );
+        if (!attr)
+            return E_OUTOFMEMORY;
+
+        memcpy(attr.get(), mAttributes.get(), sizeof(uint32_t) * mnFaces);
+    }
+
+    // Seams are found with the same epsilon as the mesh adjacency, which the first level starts from; the
+    // adjacency of later levels is rebuilt from these point reps
+    hr = GenerateAdjacencyAndPointReps(mIndices.get(), mnFaces, mPositions.get(), mnVerts, mAdjacencyEpsilon,
+                                       pointRep.get(), (mAdjacency) ? nullptr : adj.get());
+    if (FAILED(hr))
+        return hr;
+
+    if (mAdjacency)
+    {
+        memcpy(adj.get(), mAdjacency.get(), sizeof(uint32_t) * mnFaces * 3);
+    }
+
+    memcpy(ib.get(), mIndices.get(), sizeof(uint32_t) * mnFaces * 3);
+
+    // Each level is simplified from the one before
+    std::vector<uint32_t> lodIndices;
+    std::vector<uint32_t> lodAttributes;
+    std::vector<size_t> lodFaceOffsets;
+    lodFaceOffsets.push_back(0);
+
+    size_t nFaces = mnFaces;
+    for (size_t lod = 0; lod < nLODs; ++lod)
+    {
+        if (lod > 0)
+        {
+            hr = ConvertPointRepsToAdjacency(ib.get(), nFaces, mPositions.get(), mnVerts, pointRep.get(), adj.get());
             if (FAILED(hr))
                 return hr;
+        }
 
-            // Optimize faces for pre-transform vertex cache
-            if (lru)
-            {
-                hr = OptimizeFacesLRUEx(mIndices.get(), mnFaces, mAttributes.get(), remap.get());
-            }
-            else
+        size_t nSimplifiedFaces = 0;
+        hr = SimplifyMesh(ib.get(), nFaces, mPositions.get(), mnVerts, pointRep.get(), adj.get(), attr.get(),
+                          nFaces / 2, FLT_MAX, simplified.get(), nSimplifiedFaces);
+        if (FAILED(hr))
+            return hr;
+
+        if (!nSimplifiedFaces || nSimplifiedFaces == nFaces)
+            break;
+
+        // Compact the remaining faces, which keeps attribute groups in order
+        size_t nLODFaces = 0;
+        for (size_t face = 0; face < nFaces; ++face)
+        {
+            if (simplified[face * 3] == uint32_t(-1))
+                continue;
+
+            memcpy(&ib[nLODFaces * 3], &simplified[face * 3], sizeof(uint32_t) * 3);
+            if (attr)
             {
-                hr = OptimizeFacesEx(mIndices.get(), mnFaces, mAdjacency.get(), mAttributes.get(), remap.get());
+                attr[nLODFaces] = attr[face];
             }
+            ++nLODFaces;
         }
-        else if (lru)
+
+        assert(nLODFaces == nSimplifiedFaces);
+        nFaces = nLODFaces;
+
+        if (lru)
         {
-            hr = OptimizeFacesLRU(mIndices.get(), mnFaces, remap.get());
+            hr = (attr) ? OptimizeFacesLRUEx(ib.get(), nFaces, attr.get(), faceRemap.get())
+                        : OptimizeFacesLRU(ib.get(), nFaces, faceRemap.get());
         }
         else
         {
-            hr = OptimizeFaces(mIndices.get(), mnFaces, mAdjacency.get(), remap.get());
+            hr = ConvertPointRepsToAdjacency(ib.get(), nFaces, mPositions.get(), mnVerts, pointRep.get(), adj.get());
+            if (FAILED(hr))
+                return hr;
+
+            hr = (attr) ? OptimizeFacesEx(ib.get(), nFaces, adj.get(), attr.get(), faceRemap.get())
+                        : OptimizeFaces(ib.get(), nFaces, adj.get(), faceRemap.get());
         }
         if (FAILED(hr))
             return hr;
 
-        if (mAdjacency)
-        {
-            hr = ReorderIBAndAdjacency(mIndices.get(), mnFaces, mAdjacency.get(), remap.get());
-        }
-        else
-        {
-            hr = ReorderIB(mIndices.get(), mnFaces, remap.get());
-        }
+        hr = ReorderIB(ib.get(), nFaces, faceRemap.get());
         if (FAILED(hr))
             return hr;
+
+        lodIndices.insert(lodIndices.end(), ib.get(), ib.get() + nFaces * 3);
+        if (attr)
+        {
+            lodAttributes.insert(lodAttributes.end(), attr.get(), attr.get() + nFaces);
+        }
+        lodFaceOffsets.push_back(lodFaceOffsets.back() + nFaces);
     }
 
-    // Optimize vertices for post-transform vertex cache
-    std::unique_ptr<uint32_t[]> remap(new (std::nothrow) uint32_t[mnVerts]);
-    if (!remap)
+    size_t nLODsBuilt = lodFaceOffsets.size() - 1;
+    if (!nLODsBuilt)
+        return S_OK;
+
+    size_t nLODFaces = lodFaceOffsets.back();
+    if ((uint64_t(mnFaces + nLODFaces) * 3) >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    // Ordering vertices by first use from the coarsest level up puts each level's vertices before those of the next,
+    // since every level only uses vertices of the one it was simplified from
+    std::unique_ptr<uint32_t[]> chain( new (std::nothrow) uint32_t[ (mnFaces + nLODFaces) * 3 ] );
+    std::unique_ptr<uint32_t[]> vertexOrder( new (std::nothrow) uint32_t[ mnVerts ] );
+    std::unique_ptr<uint32_t[]> vertexRemap( new (std::nothrow) uint32_t[ mnVerts ] );
+    std::unique_ptr<uint32_t[]> lodIB( new (std::nothrow) uint32_t[ nLODFaces * 3 ] );
+    if (!chain || !vertexOrder || !vertexRemap || !lodIB)
         return E_OUTOFMEMORY;
 
-    hr = OptimizeVertices(mIndices.get(), mnFaces, mnVerts, remap.get());
-    if (FAILED(hr))
-        return hr;
+    size_t nChainFaces = 0;
+    for (size_t lod = nLODsBuilt; lod > 0; --lod)
+    {
+        size_t count = lodFaceOffsets[lod] - lodFaceOffsets[lod - 1];
+        memcpy(&chain[nChainFaces * 3], &lodIndices[lodFaceOffsets[lod - 1] * 3], sizeof(uint32_t) * count * 3);
+        nChainFaces += count;
+    }
 
-    hr = FinalizeIB(mIndices.get(), mnFaces, remap.get(), mnVerts);
-    if (FAILED(hr))
-        return hr;
+    memcpy(&chain[nChainFaces * 3], mIndices.get(), sizeof(uint32_t) * mnFaces * 3);
+    nChainFaces += mnFaces;
 
-    hr = FinalizeVB(mPositions.get(), sizeof(XMFLOAT3), mnVerts, remap.get());
+    hr = OptimizeVertices(chain.get(), nChainFaces, mnVerts, vertexOrder.get());
     if (FAILED(hr))
         return hr;
 
-    if (mNormals)
-    {
-        hr = FinalizeVB(mNormals.get(), sizeof(XMFLOAT3), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
-    }
+    // OptimizeVertices gives the old vertex for each new one, where FinalizeIB and FinalizeVB take the new vertex
+    // for each old one. Vertices no face uses keep their order after all the others
+    memset(vertexRemap.get(), 0xff, sizeof(uint32_t) * mnVerts);
 
-    if (mTangents)
+    uint32_t nUsedVerts = 0;
+    for (uint32_t j = 0; j < mnVerts; ++j)
     {
-        hr = FinalizeVB(mTangents.get(), sizeof(XMFLOAT4), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
+        uint32_t vert = vertexOrder[j];
+        if (vert != uint32_t(-1))
+        {
+            vertexRemap[vert] = j;
+            ++nUsedVerts;
+        }
     }
 
-    if (mBiTangents)
+    for (uint32_t vert = 0; vert < mnVerts; ++vert)
     {
-        hr = FinalizeVB(mBiTangents.get(), sizeof(XMFLOAT3), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
+        if (vertexRemap[vert] == uint32_t(-1))
+        {
+            vertexRemap[vert] = nUsedVerts++;
+        }
     }
 
-    if (mTexCoords)
-    {
-        hr = FinalizeVB(mTexCoords.get(), sizeof(XMFLOAT2), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
-    }
+    hr = FinalizeIB(mIndices.get(), mnFaces, vertexRemap.get(), mnVerts);
+    if (FAILED(hr))
+        return hr;
 
-    if (mColors)
+    memcpy(lodIB.get(), lodIndices.data(), sizeof(uint32_t) * nLODFaces * 3);
+
+    hr = FinalizeIB(lodIB.get(), nLODFaces, vertexRemap.get(), mnVerts);
+    if (FAILED(hr))
+        return hr;
+
+    // Stale derived streams were released and are rebuilt from the reordered vertices; the depth stream has its own
+    void* streams[8] = { mPositions.get(), mNormals.get(), mTangents.get(), mBiTangents.get(),
+                         mTexCoords.get(), mColors.get(), mBlendIndices.get(), mBlendWeights.get() };
+    static const size_t s_strides[8] = { sizeof(XMFLOAT3), sizeof(XMFLOAT3), sizeof(XMFLOAT4), sizeof(XMFLOAT3),
+                                         sizeof(XMFLOAT2), sizeof(XMFLOAT4), sizeof(XMFLOAT4), sizeof(XMFLOAT4) };
+
+    for (size_t j = 0; j < _countof(streams); ++j)
     {
-        hr = FinalizeVB(mColors.get(), sizeof(XMFLOAT4), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
+        if (streams[j])
+        {
+            hr = FinalizeVB(streams[j], s_strides[j], mnVerts, vertexRemap.get());
+            if (FAILED(hr))
+                return hr;
+        }
     }
 
-    if (mBlendIndices)
+    // Each level uses the vertices up to the last one it references
+    std::vector<size_t> lodVertexCounts(nLODsBuilt, 0);
+    for (size_t lod = 0; lod < nLODsBuilt; ++lod)
     {
-        hr = FinalizeVB(mBlendIndices.get(), sizeof(XMFLOAT4), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
+        uint32_t maxVert = 0;
+        for (size_t j = lodFaceOffsets[lod] * 3; j < lodFaceOffsets[lod + 1] * 3; ++j)
+        {
+            maxVert = std::max(maxVert, lodIB[j]);
+        }
 
+        lodVertexCounts[lod] = size_t(maxVert) + 1;
     }
 
-    if (mBlendWeights)
+    std::unique_ptr<uint32_t[]> lodAttr;
+    if (attr)
     {
-        hr = FinalizeVB(mBlendWeights.get(), sizeof(XMFLOAT4), mnVerts, remap.get());
-        if (FAILED(hr))
-            return hr;
+        lodAttr.reset( new (std::nothrow) uint32_t[ nLODFaces ] );
+        if (!lodAttr)
+            return E_OUTOFMEMORY;
+
+        memcpy(lodAttr.get(), lodAttributes.data(), sizeof(uint32_t) * nLODFaces);
     }
 
+    mLODIndices.swap(lodIB);
+    mLODAttributes.swap(lodAttr);
+    mLODFaceOffsets.swap(lodFaceOffsets);
+    mLODVertexCounts.swap(lodVertexCounts);
+
     return S_OK;
 }
 
@@ -749,6 +1320,43 @@ HRESULT Mesh::ReverseWinding()
         iptr += 3;
     }
 
+    // Edge k runs from corner k to corner k + 1, so swapping corners 0 and 2 swaps edges 0 and 1
+    if (mAdjacency)
+    {
+        auto aptr = mAdjacency.get();
+        for (size_t j = 0; j < mnFaces; ++j)
+        {
+            std::swap( *aptr, *(aptr + 1) );
+            aptr += 3;
+        }
+    }
+
+    if (mDepthIndices)
+    {
+        auto dptr = mDepthIndices.get();
+        for (size_t j = 0; j < mnDepthFaces; ++j)
+        {
+            std::swap( *dptr, *(dptr + 2) );
+            dptr += 3;
+        }
+    }
+
+    if (mLODIndices)
+    {
+        auto lptr = mLODIndices.get();
+        for (size_t j = 0; j < mLODFaceOffsets.back(); ++j)
+        {
+            std::swap( *lptr, *(lptr + 2) );
+            lptr += 3;
+        }
+    }
+
+    // Normals and tangent frames are unchanged, so rebuilds use the opposite winding to match
+    mNormalFlags ^= CNORM_WIND_CW;
+
+    if (mDepthFlags & OPTMESH_OVERDRAW)
+        mDepthFlags ^= OPTMESH_WIND_CW;
+
     return S_OK;
 }
 
@@ -765,6 +1373,8 @@ HRESULT Mesh::InvertUTexCoord()
         tptr->x = 1.f - tptr->x;
     }
 
+    Invalidate(DERIVED_TANGENTS);
+
     return S_OK;
 }
 
@@ -781,6 +1391,8 @@ HRESULT Mesh::InvertVTexCoord()
         tptr->y = 1.f - tptr->y;
     }
 
+    Invalidate(DERIVED_TANGENTS);
+
     return S_OK;
 }
 
@@ -797,6 +1409,7 @@ HRESULT Mesh::ReverseHandedness()
         ptr->z = -ptr->z;
     }
 
+    // Mirroring reverses the faces' apparent winding, so rebuilt normals use the opposite winding to match these
     if (mNormals)
     {
         auto nptr = mNormals.get();
@@ -806,10 +1419,50 @@ HRESULT Mesh::ReverseHandedness()
         }
     }
 
+    mNormalFlags ^= CNORM_WIND_CW;
+
+    if (mDepthPositions)
+    {
+        auto dptr = mDepthPositions.get();
+        for (size_t j = 0; j < mnDepthVerts; ++j, ++dptr)
+        {
+            dptr->z = -dptr->z;
+        }
+    }
+
+    // Adjacency survives mirroring, but derived tangent frames are rebuilt from the new positions
+    Invalidate(DERIVED_TANGENTS);
+
     return S_OK;
 }
 
 
+//--------------------------------------------------------------------------------------
+size_t Mesh::GetLODFaceCount( size_t lod ) const
+{
+    if (!lod)
+        return mnFaces;
+
+    if (lod > mLODVertexCounts.size())
+        return 0;
+
+    return mLODFaceOffsets[lod] - mLODFaceOffsets[lod - 1];
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t Mesh::GetLODVertexCount( size_t lod ) const
+{
+    if (!lod)
+        return mnVerts;
+
+    if (lod > mLODVertexCounts.size())
+        return 0;
+
+    return mLODVertexCounts[lod - 1];
+}
+
+
 //--------------------------------------------------------------------------------------
 bool Mesh::Is16BitIndexBuffer() const
 {
@@ -877,90 +1530,67 @@ std::unique_ptr<uint16_t[]> Mesh::GetIndexBuffer16() const
 //--------------------------------------------------------------------------------------
 HRESULT Mesh::GetVertexBuffer(_Inout_ DirectX::VBWriter& writer) const
 {
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_NORMALS | DERIVED_TANGENTS);
+    if (FAILED(hr))
+        return hr;
+
     if (!mnVerts || !mPositions)
         return E_UNEXPECTED;
 
-    HRESULT hr = writer.Write(mPositions.get(), "SV_Position", 0, mnVerts );
-    if (FAILED(hr))
-        return hr;
+    VBElementData elements[8];
+    size_t nElements = 0;
 
-    if (mNormals)
+    VBElementData position = { "SV_Position", 0, VBELEMENT_FLOAT3, mPositions.get(), false };
+    elements[nElements++] = position;
+
+    if (mNormals && writer.GetElement11("NORMAL", 0))
     {
-        auto e = writer.GetElement11("NORMAL", 0);
-        if (e)
-        {
-            hr = writer.Write(mNormals.get(), "NORMAL", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "NORMAL", 0, VBELEMENT_FLOAT3, mNormals.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mTangents)
+    if (mTangents && writer.GetElement11("TANGENT", 0))
     {
-        auto e = writer.GetElement11("TANGENT", 0);
-        if (e)
-        {
-            hr = writer.Write(mTangents.get(), "TANGENT", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "TANGENT", 0, VBELEMENT_FLOAT4, mTangents.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mBiTangents)
+    if (mBiTangents && writer.GetElement11("BINORMAL", 0))
     {
-        auto e = writer.GetElement11("BINORMAL", 0);
-        if (e)
-        {
-            hr = writer.Write(mBiTangents.get(), "BINORMAL", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "BINORMAL", 0, VBELEMENT_FLOAT3, mBiTangents.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mTexCoords)
+    if (mTexCoords && writer.GetElement11("TEXCOORD", 0))
     {
-        auto e = writer.GetElement11("TEXCOORD", 0);
-        if (e)
-        {
-            hr = writer.Write(mTexCoords.get(), "TEXCOORD", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "TEXCOORD", 0, VBELEMENT_FLOAT2, mTexCoords.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mColors)
+    if (mColors && writer.GetElement11("COLOR", 0))
     {
-        auto e = writer.GetElement11("COLOR", 0);
-        if (e)
-        {
-            hr = writer.Write(mColors.get(), "COLOR", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "COLOR", 0, VBELEMENT_FLOAT4, mColors.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mBlendIndices)
+    if (mBlendIndices && writer.GetElement11("BLENDINDICES", 0))
     {
-        auto e = writer.GetElement11("BLENDINDICES", 0);
-        if (e)
-        {
-            hr = writer.Write(mBlendIndices.get(), "BLENDINDICES", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "BLENDINDICES", 0, VBELEMENT_FLOAT4, mBlendIndices.get(), false };
+        elements[nElements++] = element;
     }
 
-    if (mBlendWeights)
+    if (mBlendWeights && writer.GetElement11("BLENDWEIGHT", 0))
     {
-        auto e = writer.GetElement11("BLENDWEIGHT", 0);
-        if (e)
-        {
-            hr = writer.Write(mBlendWeights.get(), "BLENDWEIGHT", 0, mnVerts);
-            if (FAILED(hr))
-                return hr;
-        }
+        VBElementData element = { "BLENDWEIGHT", 0, VBELEMENT_FLOAT4, mBlendWeights.get(), false };
+        elements[nElements++] = element;
     }
 
+    // Write all the elements in one pass over the vertex buffer
+    hr = writer.Write(elements, nElements, mnVerts);
+    if (FAILED(hr))
+        return hr;
+
     return S_OK;
 }
 
@@ -991,6 +1621,13 @@ namespace VBO
 
     static_assert(sizeof(header_t) == 8, "VBO header size mismatch");
     static_assert(sizeof(vertex_t) == 32, "VBO vertex size mismatch");
+
+    const D3D11_INPUT_ELEMENT_DESC s_vboLayout[] =
+    {
+        { "SV_Position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
 }; // namespace
 
 
@@ -1003,6 +1640,11 @@ HRESULT Mesh::ExportToVBO( const wchar_t* szFileName ) const
     if ( !szFileName )
         return E_INVALIDARG;
 
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_NORMALS);
+    if (FAILED(hr))
+        return hr;
+
     if (!mnFaces || !mIndices || !mnVerts || !mPositions || !mNormals || !mTexCoords)
         return E_UNEXPECTED;
 
@@ -1017,70 +1659,48 @@ HRESULT Mesh::ExportToVBO( const wchar_t* szFileName ) const
     header.numVertices = static_cast<uint32_t>( mnVerts );
     header.numIndices = static_cast<uint32_t>( mnFaces*3 );
 
-    // Setup vertices/indices for VBO
+    if ( !Is16BitIndexBuffer() )
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Write header and data directly into the mapped file
+    size_t vertSize = sizeof(vertex_t) * header.numVertices;
+    size_t indexSize = sizeof(uint16_t) * header.numIndices;
+
+    mapped_file_writer file;
+    hr = file.create( szFileName, uint64_t(sizeof(header_t)) + vertSize + indexSize );
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write( header );
+    if (FAILED(hr))
+        return hr;
 
-    std::unique_ptr<vertex_t[]> vb(new (std::nothrow) vertex_t[mnVerts]);
-    std::unique_ptr<uint16_t[]> ib(new (std::nothrow) uint16_t[header.numIndices]);
+    uint8_t* vb = file.reserve( vertSize );
+    uint8_t* ib = file.reserve( indexSize );
     if (!vb || !ib)
-        return E_OUTOFMEMORY;
+        return E_FAIL;
 
-    // Copy to VB
-    auto vptr = vb.get();
-    for (size_t j = 0; j < mnVerts; ++j, ++vptr)
     {
-        vptr->position = mPositions[j];
-        vptr->normal = mNormals[j];
-        vptr->textureCoordinate = mTexCoords[j];
+        VBWriter writer;
+
+        hr = writer.Initialize( s_vboLayout, _countof(s_vboLayout) );
+        if (FAILED(hr))
+            return hr;
+
+        hr = writer.AddStream( vb, mnVerts, 0, sizeof(vertex_t) );
+        if (FAILED(hr))
+            return hr;
+
+        hr = GetVertexBuffer( writer );
+        if (FAILED(hr))
+            return hr;
     }
 
-    // Copy to IB
-    auto iptr = ib.get();
-    for (size_t j = 0; j < header.numIndices; ++j, ++iptr)
-    {
-        uint32_t index = mIndices[j];
-        if (index == uint32_t(-1))
-        {
-            *iptr = uint16_t(-1);
-        }
-        else if (index >= UINT16_MAX)
-        {
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-        else
-        {
-            *iptr = static_cast<uint16_t>(index);
-        }
-    }
-
-    // Write header and data
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    ScopedHandle hFile(safe_handle(CreateFile2(szFileName, GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr)));
-#else
-    ScopedHandle hFile(safe_handle(CreateFileW(szFileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
-#endif
-    if (!hFile)
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    HRESULT hr = write_file( hFile.get(), header );
+    hr = copy_indices16( mIndices.get(), header.numIndices, reinterpret_cast<uint16_t*>( ib ) );
     if (FAILED(hr))
         return hr;
 
-    DWORD vertSize = static_cast<DWORD>( sizeof(vertex_t) * header.numVertices );
-
-    DWORD bytesWritten;
-    if (!WriteFile(hFile.get(), vb.get(), vertSize, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != vertSize)
-        return E_FAIL;
-
-    DWORD indexSize = static_cast<DWORD>( sizeof(uint16_t) * header.numIndices );
-
-    if (!WriteFile(hFile.get(), ib.get(), indexSize, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != indexSize)
-        return E_FAIL;
+    assert( file.complete() );
 
     return S_OK;
 }
@@ -1122,87 +1742,55 @@ HRESULT Mesh::CreateFromVBO( const wchar_t* szFileName, std::unique_ptr<Mesh>& r
     if (fileInfo.EndOfFile.LowPart < sizeof(header_t))
         return E_FAIL;
 
-    // Read VBO header
-    DWORD bytesRead = 0;
+    // Map the file, reading the vertices and indices from the view
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
 
-    header_t header;
-    if (!ReadFile(hFile.get(), &header, sizeof(header_t), &bytesRead, nullptr))
-    {
+    std::unique_ptr<const uint8_t, view_unmapper> view(static_cast<const uint8_t*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    if (!view)
         return HRESULT_FROM_WIN32(GetLastError());
-    }
 
-    if (bytesRead != sizeof(header))
-        return E_FAIL;
+    header_t header;
+    memcpy(&header, view.get(), sizeof(header_t));
 
     if (!header.numVertices || !header.numIndices)
         return E_FAIL;
 
-    result.reset( new (std::nothrow) Mesh );
-    if (!result)
-        return E_OUTOFMEMORY;
-
-    // Read vertices/indices from VBO
-    std::unique_ptr<vertex_t[]> vb(new (std::nothrow) vertex_t[header.numVertices]);
-    std::unique_ptr<uint16_t[]> ib( new (std::nothrow) uint16_t[ header.numIndices ] );
-    if (!vb || !ib)
-        return E_OUTOFMEMORY;
-
-    DWORD vertSize = static_cast<DWORD>( sizeof(vertex_t) * header.numVertices );
-
-    if (!ReadFile(hFile.get(), vb.get(), vertSize, &bytesRead, nullptr))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
+    uint64_t vertSize = uint64_t(sizeof(vertex_t)) * header.numVertices;
+    uint64_t indexSize = uint64_t(sizeof(uint16_t)) * header.numIndices;
 
-    if (bytesRead != vertSize)
+    if ((sizeof(header_t) + vertSize + indexSize) > fileInfo.EndOfFile.LowPart)
         return E_FAIL;
 
-    DWORD indexSize = static_cast<DWORD>(sizeof(uint16_t) * header.numIndices );
+    const uint8_t* vb = view.get() + sizeof(header_t);
+    auto ib = reinterpret_cast<const uint16_t*>(vb + vertSize);
 
-    if (!ReadFile(hFile.get(), ib.get(), indexSize, &bytesRead, nullptr))
-    {
-        return HRESULT_FROM_WIN32(GetLastError());
-    }
-
-    if (bytesRead != indexSize)
-        return E_FAIL;
-
-    // Copy VB to result
-    std::unique_ptr<XMFLOAT3[]> pos(new (std::nothrow) XMFLOAT3[header.numVertices]);
-    std::unique_ptr<XMFLOAT3[]> norm(new (std::nothrow) XMFLOAT3[header.numVertices]);
-    std::unique_ptr<XMFLOAT2[]> texcoord(new (std::nothrow) XMFLOAT2[header.numVertices]);
-    if (!pos || !norm || !texcoord)
+    std::unique_ptr<Mesh> mesh(new (std::nothrow) Mesh);
+    if (!mesh)
         return E_OUTOFMEMORY;
 
-    auto vptr = vb.get();
-    for (size_t j = 0; j < header.numVertices; ++j, ++vptr)
     {
-        pos[ j ] = vptr->position;
-        norm[ j ] = vptr->normal;
-        texcoord[ j] = vptr->textureCoordinate;
-    }
+        VBReader reader;
 
-    // Copy IB to result
-    std::unique_ptr<uint32_t[]> indices(new (std::nothrow) uint32_t[header.numIndices]);
-    if (!indices)
-        return E_OUTOFMEMORY;
+        HRESULT hr = reader.Initialize(s_vboLayout, _countof(s_vboLayout));
+        if (FAILED(hr))
+            return hr;
 
-    auto iptr = ib.get();
-    for (size_t j = 0; j < header.numIndices; ++j, ++iptr)
-    {
-        uint16_t index = *iptr;
-        if (index == uint16_t(-1))
-            indices[ j ] = uint32_t(-1);
-        else
-            indices[ j ] = index;
+        hr = reader.AddStream(vb, header.numVertices, 0, sizeof(vertex_t));
+        if (FAILED(hr))
+            return hr;
+
+        hr = mesh->SetVertexData(reader, header.numVertices);
+        if (FAILED(hr))
+            return hr;
     }
 
-    result->mPositions.swap(pos);
-    result->mNormals.swap(norm);
-    result->mTexCoords.swap(texcoord);
-    result->mIndices.swap(indices);
-    result->mnVerts = header.numVertices;
-    result->mnFaces = header.numIndices / 3;
+    HRESULT hr = mesh->SetIndexData(header.numIndices / 3, ib);
+    if (FAILED(hr))
+        return hr;
+
+    result.swap(mesh);
 
     return S_OK;
 }
@@ -1376,6 +1964,11 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
     if (nMaterials > 0 && !materials)
         return E_INVALIDARG;
 
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_NORMALS | DERIVED_TANGENTS);
+    if (FAILED(hr))
+        return hr;
+
     if (!mnFaces || !mIndices || !mnVerts || !mPositions || !mNormals || !mTexCoords || !mTangents)
         return E_UNEXPECTED;
 
@@ -1387,75 +1980,11 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
 
     UINT nIndices = static_cast<UINT>( mnFaces * 3 );
 
-    // Setup vertices/indices for CMO
-    std::unique_ptr<Vertex []> vb(new (std::nothrow) Vertex[mnVerts]);
-    std::unique_ptr<uint16_t []> ib(new (std::nothrow) uint16_t[nIndices]);
-    if (!vb || !ib)
-        return E_OUTOFMEMORY;
-
-    std::unique_ptr<SkinningVertex []> vbSkin;
-    if (mBlendIndices && mBlendWeights)
-    {
-        vbSkin.reset(new (std::nothrow) SkinningVertex[mnVerts]);
-        if (!vbSkin)
-            return E_OUTOFMEMORY;
-    }
-
-    // Copy to VB
-    auto vptr = vb.get();
-    for (size_t j = 0; j < mnVerts; ++j, ++vptr)
-    {
-        vptr->Position = mPositions[j];
-        vptr->Normal = mNormals[j];
-        vptr->Tangent = mTangents[j];
-        vptr->TextureCoordinates = mTexCoords[j];
-
-        if (mColors)
-        {
-            XMVECTOR icolor = XMLoadFloat4(&mColors[j]);
-            PackedVector::XMUBYTEN4 rgba;
-            PackedVector::XMStoreUByteN4(&rgba, icolor);
-            vptr->color = rgba.v;
-        }
-        else
-            vptr->color = 0xFFFFFFFF;
-    }
-
-    // Copy to SkinVB
-    auto sptr = vbSkin.get();
-    if ( sptr )
-    {
-        for (size_t j = 0; j < mnVerts; ++j, ++sptr)
-        {
-            XMVECTOR v = XMLoadFloat4(&mBlendIndices[j]);
-            XMStoreUInt4( reinterpret_cast<XMUINT4*>( &sptr->boneIndex[0] ), v);
-
-            const XMFLOAT4* w = &mBlendWeights[j];
-            sptr->boneWeight[0] = w->x;
-            sptr->boneWeight[1] = w->y;
-            sptr->boneWeight[2] = w->z;
-            sptr->boneWeight[3] = w->w;
-        }
-    }
+    // Vertices and indices are converted as they are written
+    if (!Is16BitIndexBuffer())
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-    // Copy to IB
-    auto iptr = ib.get();
-    for (size_t j = 0; j < nIndices; ++j, ++iptr)
-    {
-        uint32_t index = mIndices[j];
-        if (index == uint32_t(-1))
-        {
-            *iptr = uint16_t(-1);
-        }
-        else if (index >= UINT16_MAX)
-        {
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
-        else
-        {
-            *iptr = static_cast<uint16_t>(index);
-        }
-    }
+    bool skinning = (mBlendIndices && mBlendWeights);
 
     // Create CMO file
 #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
@@ -1468,7 +1997,7 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
 
     // Write 1 mesh, name based on the filename
     UINT n = 1;
-    HRESULT hr = write_file(hFile.get(), n);
+    hr = write_file(hFile.get(), n);
     if (FAILED(hr))
         return hr;
 
@@ -1644,14 +2173,13 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
     if (FAILED(hr))
         return hr;
 
-    DWORD indexSize = static_cast<DWORD>(sizeof(uint16_t) * nIndices);
-
-    DWORD bytesWritten;
-    if (!WriteFile(hFile.get(), ib.get(), indexSize, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != indexSize)
-        return E_FAIL;
+    const uint32_t* indices = mIndices.get();
+    hr = write_file_records<uint16_t>(hFile.get(), nIndices, [=](size_t j, uint16_t& index)
+    {
+        index = (indices[j] == uint32_t(-1)) ? uint16_t(-1) : static_cast<uint16_t>(indices[j]);
+    });
+    if (FAILED(hr))
+        return hr;
 
     // Write vertices (one VB shared across submeshes)
     n = 1;
@@ -1664,16 +2192,28 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
     if (FAILED(hr))
         return hr;
 
-    DWORD vertSize = static_cast<DWORD>(sizeof(Vertex) * mnVerts);
-
-    if (!WriteFile(hFile.get(), vb.get(), vertSize, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+    hr = write_file_records<Vertex>(hFile.get(), mnVerts, [this](size_t j, Vertex& vertex)
+    {
+        vertex.Position = mPositions[j];
+        vertex.Normal = mNormals[j];
+        vertex.Tangent = mTangents[j];
+        vertex.TextureCoordinates = mTexCoords[j];
 
-    if (bytesWritten != vertSize)
-        return E_FAIL;
+        if (mColors)
+        {
+            XMVECTOR icolor = XMLoadFloat4(&mColors[j]);
+            PackedVector::XMUBYTEN4 rgba;
+            PackedVector::XMStoreUByteN4(&rgba, icolor);
+            vertex.color = rgba.v;
+        }
+        else
+            vertex.color = 0xFFFFFFFF;
+    });
+    if (FAILED(hr))
+        return hr;
 
     // Write skinning vertices (one SkinVB shared across submeshes)
-    if ( vbSkin )
+    if ( skinning )
     {
         n = 1;
         hr = write_file(hFile.get(), n);
@@ -1685,13 +2225,19 @@ HRESULT Mesh::ExportToCMO(const wchar_t* szFileName, size_t nMaterials, const Ma
         if (FAILED(hr))
             return hr;
 
-        DWORD skinVertSize = static_cast<DWORD>(sizeof(SkinningVertex) * mnVerts);
-
-        if (!WriteFile(hFile.get(), vbSkin.get(), skinVertSize, &bytesWritten, nullptr))
-            return HRESULT_FROM_WIN32(GetLastError());
+        hr = write_file_records<SkinningVertex>(hFile.get(), mnVerts, [this](size_t j, SkinningVertex& vertex)
+        {
+            XMVECTOR v = XMLoadFloat4(&mBlendIndices[j]);
+            XMStoreUInt4( reinterpret_cast<XMUINT4*>( &vertex.boneIndex[0] ), v);
 
-        if (bytesWritten != skinVertSize)
-            return E_FAIL;
+            const XMFLOAT4* w = &mBlendWeights[j];
+            vertex.boneWeight[0] = w->x;
+            vertex.boneWeight[1] = w->y;
+            vertex.boneWeight[2] = w->z;
+            vertex.boneWeight[3] = w->w;
+        });
+        if (FAILED(hr))
+            return hr;
     }
     else
     {
@@ -2082,7 +2628,7 @@ static_assert(sizeof(DXUT::SDKANIMATION_FRAME_DATA) == 112, "SDK Mesh structure
 
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
-HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, const Material* materials) const
+HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, const Material* materials, float quantizeTolerance) const
 {
     using namespace DXUT;
 
@@ -2092,10 +2638,19 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
     if (nMaterials > 0 && !materials)
         return E_INVALIDARG;
 
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_NORMALS | DERIVED_TANGENTS | DERIVED_DEPTH);
+    if (FAILED(hr))
+        return hr;
+
     if (!mnFaces || !mIndices || !mnVerts || !mPositions)
         return E_UNEXPECTED;
 
-    if ((uint64_t(mnFaces) * 3) >= UINT32_MAX)
+    // Any LODs follow the mesh's faces in IB 0, and each is a further mesh over a prefix of VB 0 that no frame references
+    size_t nMeshes = 1 + GetLODCount();
+    size_t nTotalFaces = mnFaces + ((nMeshes > 1) ? mLODFaceOffsets.back() : 0);
+
+    if ((uint64_t(nTotalFaces) * 3) >= UINT32_MAX)
         return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
 
     // Build input layout/vertex decalaration
@@ -2109,6 +2664,10 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 5
         { "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 6
         { "BLENDWEIGHT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 7
+        { "NORMAL", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 8
+        { "TANGENT", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 9
+        { "BINORMAL", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 10
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }, // 11
     };
 
     static const D3DVERTEXELEMENT9 s_decls [] =
@@ -2121,6 +2680,10 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
         { 0, 0, D3DDECLTYPE_FLOAT2, 0, D3DDECLUSAGE_TEXCOORD, 0 }, // 5
         { 0, 0, D3DDECLTYPE_UBYTE4, 0, D3DDECLUSAGE_BLENDINDICES, 0 }, // 6
         { 0, 0, D3DDECLTYPE_UBYTE4N, 0, D3DDECLUSAGE_BLENDWEIGHT, 0 }, // 7
+        { 0, 0, D3DDECLTYPE_FLOAT16_4, 0, D3DDECLUSAGE_NORMAL, 0 }, // 8
+        { 0, 0, D3DDECLTYPE_FLOAT16_4, 0, D3DDECLUSAGE_TANGENT, 0 }, // 9
+        { 0, 0, D3DDECLTYPE_FLOAT16_4, 0, D3DDECLUSAGE_BINORMAL, 0 }, // 10
+        { 0, 0, D3DDECLTYPE_FLOAT16_2, 0, D3DDECLUSAGE_TEXCOORD, 0 }, // 11
         { 0xFF, 0, D3DDECLTYPE_UNUSED, 0, 0, 0 },
     };
 
@@ -2155,11 +2718,17 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
 
     if (mNormals)
     {
-        vbHeader.Decl[nDecl] = s_decls[1];
+        bool half;
+        HRESULT hr = fits_half(mNormals.get(), mnVerts, 3, QUANTIZE_DATA_UNIT_VECTOR, quantizeTolerance, half);
+        if (FAILED(hr))
+            return hr;
+
+        size_t element = half ? 8 : 1;
+        vbHeader.Decl[nDecl] = s_decls[element];
         vbHeader.Decl[nDecl].Offset = static_cast<WORD>(stride);
-        inputLayout[nDecl] = s_elements[1];
+        inputLayout[nDecl] = s_elements[element];
         ++nDecl;
-        stride += sizeof(XMFLOAT3);
+        stride += BytesPerElement(s_elements[element].Format);
     }
 
     if (mColors)
@@ -2173,78 +2742,90 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
 
     if (mTexCoords)
     {
-        vbHeader.Decl[nDecl] = s_decls[5];
+        bool half;
+        HRESULT hr = fits_half(mTexCoords.get(), mnVerts, 2, QUANTIZE_DATA_RANGE, quantizeTolerance, half);
+        if (FAILED(hr))
+            return hr;
+
+        size_t element = half ? 11 : 5;
+        vbHeader.Decl[nDecl] = s_decls[element];
         vbHeader.Decl[nDecl].Offset = static_cast<WORD>(stride);
-        inputLayout[nDecl] = s_elements[5];
+        inputLayout[nDecl] = s_elements[element];
         ++nDecl;
-        stride += sizeof(XMFLOAT2);
+        stride += BytesPerElement(s_elements[element].Format);
     }
 
     if (mTangents)
     {
-        vbHeader.Decl[nDecl] = s_decls[3];
+        bool half;
+        HRESULT hr = fits_half(mTangents.get(), mnVerts, 3, QUANTIZE_DATA_UNIT_VECTOR, quantizeTolerance, half);
+        if (FAILED(hr))
+            return hr;
+
+        size_t element = half ? 9 : 3;
+        vbHeader.Decl[nDecl] = s_decls[element];
         vbHeader.Decl[nDecl].Offset = static_cast<WORD>(stride);
-        inputLayout[nDecl] = s_elements[3];
+        inputLayout[nDecl] = s_elements[element];
         ++nDecl;
-        stride += sizeof(XMFLOAT3);
+        stride += BytesPerElement(s_elements[element].Format);
     }
 
     if (mBiTangents)
     {
-        vbHeader.Decl[nDecl] = s_decls[4];
+        bool half;
+        HRESULT hr = fits_half(mBiTangents.get(), mnVerts, 3, QUANTIZE_DATA_UNIT_VECTOR, quantizeTolerance, half);
+        if (FAILED(hr))
+            return hr;
+
+        size_t element = half ? 10 : 4;
+        vbHeader.Decl[nDecl] = s_decls[element];
         vbHeader.Decl[nDecl].Offset = static_cast<WORD>(stride);
-        inputLayout[nDecl] = s_elements[4];
+        inputLayout[nDecl] = s_elements[element];
         ++nDecl;
-        stride += sizeof(XMFLOAT3);
+        stride += BytesPerElement(s_elements[element].Format);
     }
 
     assert(nDecl < MAX_VERTEX_ELEMENTS);
     vbHeader.Decl[nDecl] = s_decls[_countof(s_decls) - 1];
 
-    // Build vertex buffer
-    std::unique_ptr<uint8_t> vb(new (std::nothrow) uint8_t[mnVerts * stride]);
-    if (!vb)
-        return E_OUTOFMEMORY;
-
+    // Vertex buffer is built directly in the output file
     vbHeader.SizeBytes = mnVerts * stride;
     vbHeader.StrideBytes = stride;
 
-    {
-        VBWriter writer;
-
-        HRESULT hr = writer.Initialize(inputLayout, nDecl);
-        if (FAILED(hr))
-            return hr;
-
-        hr = writer.AddStream(vb.get(), mnVerts, 0, stride);
-        if (FAILED(hr))
-            return hr;
-
-        hr = GetVertexBuffer(writer);
-        if (FAILED(hr))
-            return hr;
-    }
-
-    // Build index buffer
+    // Index buffer is likewise converted in place
     SDKMESH_INDEX_BUFFER_HEADER ibHeader = {};
-    ibHeader.NumIndices = mnFaces * 3;
+    ibHeader.NumIndices = nTotalFaces * 3;
 
-    std::unique_ptr<uint16_t[]> ib16;
-    if (Is16BitIndexBuffer())
+    bool ib16 = Is16BitIndexBuffer();
+    if (ib16)
     {
-        ibHeader.SizeBytes = mnFaces * 3 * sizeof(uint16_t);
+        ibHeader.SizeBytes = nTotalFaces * 3 * sizeof(uint16_t);
         ibHeader.IndexType = IT_16BIT;
-
-        ib16 = GetIndexBuffer16();
-        if (!ib16)
-            return E_OUTOFMEMORY;
     }
     else
     {
-        ibHeader.SizeBytes = mnFaces * 3 * sizeof(uint32_t);
+        ibHeader.SizeBytes = nTotalFaces * 3 * sizeof(uint32_t);
         ibHeader.IndexType = IT_32BIT;
     }
 
+    // Any depth stream is a position-only VB and an IB of the same index type, which no mesh references
+    bool depth = (mnDepthFaces > 0 && mDepthIndices && mDepthPositions);
+
+    SDKMESH_VERTEX_BUFFER_HEADER depthVBHeader = {};
+    SDKMESH_INDEX_BUFFER_HEADER depthIBHeader = {};
+    if (depth)
+    {
+        depthVBHeader.NumVertices = mnDepthVerts;
+        depthVBHeader.SizeBytes = mnDepthVerts * sizeof(XMFLOAT3);
+        depthVBHeader.StrideBytes = sizeof(XMFLOAT3);
+        depthVBHeader.Decl[0] = s_decls[0];
+        depthVBHeader.Decl[1] = s_decls[_countof(s_decls) - 1];
+
+        depthIBHeader.NumIndices = mnDepthFaces * 3;
+        depthIBHeader.SizeBytes = mnDepthFaces * 3 * ((ib16) ? sizeof(uint16_t) : sizeof(uint32_t));
+        depthIBHeader.IndexType = ibHeader.IndexType;
+    }
+
     // Build materials buffer
     std::unique_ptr<SDKMESH_MATERIAL[]> mats;
     if (!nMaterials)
@@ -2317,139 +2898,179 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
         }
     }
 
-    // Build subsets
+    // Build subsets, one list per mesh
     std::vector<SDKMESH_SUBSET> submeshes;
     std::vector<UINT> subsetArray;
-    if (mAttributes)
+    std::vector<size_t> meshSubsets;
+    for (size_t mesh = 0; mesh < nMeshes; ++mesh)
     {
-        auto subsets = ComputeSubsets(mAttributes.get(), mnFaces);
+        meshSubsets.push_back(submeshes.size());
 
-        UINT64 startIndex = 0;
-        for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+        size_t firstFace = (mesh > 0) ? mnFaces + mLODFaceOffsets[mesh - 1] : 0;
+        size_t nFaces = GetLODFaceCount(mesh);
+        size_t nVerts = GetLODVertexCount(mesh);
+        const uint32_t* attributes = (mesh > 0) ? mLODAttributes.get() : mAttributes.get();
+        if (attributes && mesh > 0)
         {
-            subsetArray.push_back(static_cast<UINT>(submeshes.size()));
+            attributes += mLODFaceOffsets[mesh - 1];
+        }
 
-            SDKMESH_SUBSET s = {};
-            s.MaterialID = mAttributes[it->first];
-            if (s.MaterialID >= nMaterials)
-                s.MaterialID = 0;
+        if (attributes)
+        {
+            auto subsets = ComputeSubsets(attributes, nFaces);
 
-            s.PrimitiveType = PT_TRIANGLE_LIST;
-            s.IndexStart = startIndex;
-            s.IndexCount = it->second * 3;
-            s.VertexCount = mnVerts;
-            submeshes.push_back(s);
+            UINT64 startIndex = firstFace * 3;
+            for (auto it = subsets.cbegin(); it != subsets.cend(); ++it)
+            {
+                subsetArray.push_back(static_cast<UINT>(submeshes.size()));
 
-            if ((startIndex + s.IndexCount) > mnFaces * 3)
-                return E_FAIL;
+                SDKMESH_SUBSET s = {};
+                s.MaterialID = attributes[it->first];
+                if (s.MaterialID >= nMaterials)
+                    s.MaterialID = 0;
 
-            startIndex += s.IndexCount;
+                s.PrimitiveType = PT_TRIANGLE_LIST;
+                s.IndexStart = startIndex;
+                s.IndexCount = it->second * 3;
+                s.VertexCount = nVerts;
+                submeshes.push_back(s);
+
+                if ((startIndex + s.IndexCount) > (firstFace + nFaces) * 3)
+                    return E_FAIL;
+
+                startIndex += s.IndexCount;
+            }
+        }
+        else
+        {
+            SDKMESH_SUBSET s = {};
+            s.PrimitiveType = PT_TRIANGLE_LIST;
+            s.IndexStart = firstFace * 3;
+            s.IndexCount = nFaces * 3;
+            s.VertexCount = nVerts;
+            subsetArray.push_back(static_cast<UINT>(submeshes.size()));
+            submeshes.push_back(s);
         }
     }
-    else
-    {
-        SDKMESH_SUBSET s = {};
-        s.PrimitiveType = PT_TRIANGLE_LIST;
-        s.IndexCount = mnFaces * 3;
-        s.VertexCount = mnVerts;
-        subsetArray.push_back(0);
-        submeshes.push_back(s);
-    }
-
-    // Create file
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    ScopedHandle hFile(safe_handle(CreateFile2(szFileName, GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr)));
-#else
-    ScopedHandle hFile(safe_handle(CreateFileW(szFileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, 0, nullptr)));
-#endif
-    if (!hFile)
-        return HRESULT_FROM_WIN32(GetLastError());
+    meshSubsets.push_back(submeshes.size());
 
     // Write file header
     SDKMESH_HEADER header = {};
     header.Version = SDKMESH_FILE_VERSION;
     header.IsBigEndian = 0;
 
-    header.NumVertexBuffers = 1;
-    header.NumIndexBuffers = 1;
-    header.NumMeshes = 1;
+    header.NumVertexBuffers = (depth) ? 2 : 1;
+    header.NumIndexBuffers = (depth) ? 2 : 1;
+    header.NumMeshes = static_cast<UINT>(nMeshes);
     header.NumTotalSubsets = static_cast<UINT>( submeshes.size() );
     header.NumFrames = 1;
     header.NumMaterials = (nMaterials > 0) ? static_cast<UINT>(nMaterials) : 1;
 
-    header.HeaderSize = sizeof(SDKMESH_HEADER) + sizeof(SDKMESH_VERTEX_BUFFER_HEADER) + sizeof(SDKMESH_INDEX_BUFFER_HEADER);
+    header.HeaderSize = sizeof(SDKMESH_HEADER)
+                        + header.NumVertexBuffers * sizeof(SDKMESH_VERTEX_BUFFER_HEADER)
+                        + header.NumIndexBuffers * sizeof(SDKMESH_INDEX_BUFFER_HEADER);
 
-    size_t staticDataSize = sizeof(SDKMESH_MESH)
+    size_t staticDataSize = nMeshes * sizeof(SDKMESH_MESH)
                             + header.NumTotalSubsets * sizeof(SDKMESH_SUBSET)
                             + sizeof(SDKMESH_FRAME)
                             + header.NumMaterials * sizeof(SDKMESH_MATERIAL);
 
-    header.NonBufferDataSize = staticDataSize + subsetArray.size() * sizeof(UINT) + sizeof(UINT);
+    header.NonBufferDataSize = staticDataSize + subsetArray.size() * sizeof(UINT) + nMeshes * sizeof(UINT);
 
-    header.BufferDataSize = roundup4k( vbHeader.SizeBytes ) + roundup4k( ibHeader.SizeBytes );
+    header.BufferDataSize = roundup4k( vbHeader.SizeBytes ) + roundup4k( ibHeader.SizeBytes )
+                            + roundup4k( depthVBHeader.SizeBytes ) + roundup4k( depthIBHeader.SizeBytes );
 
     header.VertexStreamHeadersOffset = sizeof(SDKMESH_HEADER);
-    header.IndexStreamHeadersOffset = header.VertexStreamHeadersOffset + sizeof(SDKMESH_VERTEX_BUFFER_HEADER); 
-    header.MeshDataOffset = header.IndexStreamHeadersOffset + sizeof(SDKMESH_INDEX_BUFFER_HEADER);
-    header.SubsetDataOffset = header.MeshDataOffset + sizeof(SDKMESH_MESH);
+    header.IndexStreamHeadersOffset = header.VertexStreamHeadersOffset + header.NumVertexBuffers * sizeof(SDKMESH_VERTEX_BUFFER_HEADER); 
+    header.MeshDataOffset = header.IndexStreamHeadersOffset + header.NumIndexBuffers * sizeof(SDKMESH_INDEX_BUFFER_HEADER);
+    header.SubsetDataOffset = header.MeshDataOffset + nMeshes * sizeof(SDKMESH_MESH);
     header.FrameDataOffset = header.SubsetDataOffset + header.NumTotalSubsets * sizeof(SDKMESH_SUBSET);
     header.MaterialDataOffset = header.FrameDataOffset + sizeof(SDKMESH_FRAME);
 
-    HRESULT hr = write_file(hFile.get(), header);
+    // Create file at its final size
+    mapped_file_writer file;
+    hr = file.create(szFileName, header.HeaderSize + header.NonBufferDataSize + header.BufferDataSize);
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write(header);
     if (FAILED(hr))
         return hr;
 
-    // Write buffer headers
+    // Write buffer headers; buffer data is all VBs followed by all IBs
     UINT64 offset = header.HeaderSize + header.NonBufferDataSize;
 
     vbHeader.DataOffset = offset;
     offset += roundup4k(vbHeader.SizeBytes);
 
-    hr = write_file(hFile.get(), vbHeader);
+    hr = file.write(vbHeader);
     if (FAILED(hr))
         return hr;
 
+    if (depth)
+    {
+        depthVBHeader.DataOffset = offset;
+        offset += roundup4k(depthVBHeader.SizeBytes);
+
+        hr = file.write(depthVBHeader);
+        if (FAILED(hr))
+            return hr;
+    }
+
     ibHeader.DataOffset = offset;
     offset += roundup4k(ibHeader.SizeBytes);
 
-    hr = write_file(hFile.get(), ibHeader);
+    hr = file.write(ibHeader);
     if (FAILED(hr))
         return hr;
 
-    // Write mesh headers
-    assert(header.NumMeshes == 1);
-    offset = header.HeaderSize + staticDataSize;
+    if (depth)
+    {
+        depthIBHeader.DataOffset = offset;
+        offset += roundup4k(depthIBHeader.SizeBytes);
+
+        hr = file.write(depthIBHeader);
+        if (FAILED(hr))
+            return hr;
+    }
 
-    SDKMESH_MESH meshHeader = {};
-    meshHeader.NumVertexBuffers = 1;
-    meshHeader.NumFrameInfluences = 1;
+    // Write mesh headers; each mesh's subset index list is followed by its frame influence list
+    offset = header.HeaderSize + staticDataSize;
 
+    for (size_t mesh = 0; mesh < nMeshes; ++mesh)
     {
-        BoundingBox box;
-        BoundingBox::CreateFromPoints(box, mnVerts, mPositions.get(), sizeof(XMFLOAT3));
+        SDKMESH_MESH meshHeader = {};
+        meshHeader.NumVertexBuffers = 1;
+        meshHeader.NumFrameInfluences = 1;
 
-        meshHeader.BoundingBoxCenter = box.Center;
-        meshHeader.BoundingBoxExtents = box.Extents;
-    }
+        if (mesh > 0)
+        {
+            sprintf_s(meshHeader.Name, "LOD%u", static_cast<unsigned int>(mesh));
+        }
 
-    meshHeader.NumSubsets = static_cast<UINT>(submeshes.size());
-    meshHeader.SubsetOffset = offset;
-    offset += meshHeader.NumSubsets * sizeof(UINT);
-    meshHeader.FrameInfluenceOffset = offset;
-    offset += sizeof(UINT);
+        {
+            BoundingBox box;
+            BoundingBox::CreateFromPoints(box, GetLODVertexCount(mesh), mPositions.get(), sizeof(XMFLOAT3));
 
-    hr = write_file(hFile.get(), meshHeader);
-    if (FAILED(hr))
-        return hr;
+            meshHeader.BoundingBoxCenter = box.Center;
+            meshHeader.BoundingBoxExtents = box.Extents;
+        }
 
-    // Write subsets
-    DWORD bytesToWrite = static_cast<DWORD>( sizeof(SDKMESH_SUBSET) * submeshes.size() );
-    DWORD bytesWritten;
-    if ( !WriteFile(hFile.get(), submeshes.data(), bytesToWrite, &bytesWritten, nullptr) )
-        return HRESULT_FROM_WIN32(GetLastError());
+        meshHeader.NumSubsets = static_cast<UINT>(meshSubsets[mesh + 1] - meshSubsets[mesh]);
+        meshHeader.SubsetOffset = offset;
+        offset += meshHeader.NumSubsets * sizeof(UINT);
+        meshHeader.FrameInfluenceOffset = offset;
+        offset += sizeof(UINT);
 
-    if (bytesWritten != bytesToWrite)
-        return E_FAIL;
+        hr = file.write(meshHeader);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    // Write subsets
+    hr = file.write(submeshes.data(), sizeof(SDKMESH_SUBSET) * submeshes.size());
+    if (FAILED(hr))
+        return hr;
 
     // Write frames
     SDKMESH_FRAME frame = {};
@@ -2459,72 +3080,711 @@ HRESULT Mesh::ExportToSDKMESH(const wchar_t* szFileName, size_t nMaterials, cons
     XMMATRIX id = XMMatrixIdentity();
     XMStoreFloat4x4(&frame.Matrix, id);
 
-    hr = write_file(hFile.get(), frame);
+    hr = file.write(frame);
     if (FAILED(hr))
         return hr;
 
     // Write materials
-    bytesToWrite = static_cast<DWORD>(sizeof(SDKMESH_MATERIAL) * ((nMaterials > 0) ? nMaterials : 1));
-    if (!WriteFile(hFile.get(), mats.get(), bytesToWrite, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != bytesToWrite)
-        return E_FAIL;
-
-    // Write subset index list
-    assert(meshHeader.NumSubsets == subsetArray.size());
-    bytesToWrite = meshHeader.NumSubsets * sizeof(UINT);
-    if (!WriteFile(hFile.get(), subsetArray.data(), bytesToWrite, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != bytesToWrite)
-        return E_FAIL;
-
-    // Write frame influence list
-    assert(meshHeader.NumFrameInfluences == 1);
-    UINT frameIndex = 0;
-    hr = write_file(hFile.get(), frameIndex);
+    hr = file.write(mats.get(), sizeof(SDKMESH_MATERIAL) * ((nMaterials > 0) ? nMaterials : 1));
     if (FAILED(hr))
         return hr;
 
-    // Write VB data
-    bytesToWrite = static_cast<DWORD>(vbHeader.SizeBytes);
-    if (!WriteFile(hFile.get(), vb.get(), bytesToWrite, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
-
-    if (bytesWritten != bytesToWrite)
-        return E_FAIL;
-
-    bytesToWrite = static_cast<DWORD>( roundup4k(vbHeader.SizeBytes) - vbHeader.SizeBytes );
-    if (bytesToWrite > 0)
+    // Write subset index and frame influence lists
+    assert(meshSubsets.back() == subsetArray.size());
+    for (size_t mesh = 0; mesh < nMeshes; ++mesh)
     {
-        assert(bytesToWrite < sizeof(g_padding));
-        if (!WriteFile(hFile.get(), g_padding, bytesToWrite, &bytesWritten, nullptr))
-            return HRESULT_FROM_WIN32(GetLastError());
+        hr = file.write(&subsetArray[meshSubsets[mesh]], (meshSubsets[mesh + 1] - meshSubsets[mesh]) * sizeof(UINT));
+        if (FAILED(hr))
+            return hr;
 
-        if (bytesWritten != bytesToWrite)
-            return E_FAIL;
+        UINT frameIndex = 0;
+        hr = file.write(frameIndex);
+        if (FAILED(hr))
+            return hr;
     }
 
-    // Write IB data
-    bytesToWrite = static_cast<DWORD>(ibHeader.SizeBytes);
-    if (!WriteFile(hFile.get(), (ib16) ? static_cast<void*>( ib16.get() ) : static_cast<void*>( mIndices.get() ),
-                   bytesToWrite, &bytesWritten, nullptr))
-        return HRESULT_FROM_WIN32(GetLastError());
+    // Write VB data
+    {
+        uint8_t* vb = file.reserve(static_cast<size_t>(vbHeader.SizeBytes));
+        if (!vb)
+            return E_FAIL;
+
+        VBWriter writer;
+
+        hr = writer.Initialize(inputLayout, nDecl);
+        if (FAILED(hr))
+            return hr;
+
+        hr = writer.AddStream(vb, mnVerts, 0, stride);
+        if (FAILED(hr))
+            return hr;
+
+        hr = GetVertexBuffer(writer);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    hr = file.skip(static_cast<size_t>(roundup4k(vbHeader.SizeBytes) - vbHeader.SizeBytes));
+    if (FAILED(hr))
+        return hr;
 
-    if (bytesWritten != bytesToWrite)
+    if (depth)
+    {
+        hr = file.write(mDepthPositions.get(), static_cast<size_t>(depthVBHeader.SizeBytes));
+        if (FAILED(hr))
+            return hr;
+
+        hr = file.skip(static_cast<size_t>(roundup4k(depthVBHeader.SizeBytes) - depthVBHeader.SizeBytes));
+        if (FAILED(hr))
+            return hr;
+    }
+
+    // Write IB data
+    uint8_t* ib = file.reserve(static_cast<size_t>(ibHeader.SizeBytes));
+    if (!ib)
         return E_FAIL;
 
-    bytesToWrite = static_cast<DWORD>(roundup4k(ibHeader.SizeBytes) - ibHeader.SizeBytes);
-    if (bytesToWrite > 0)
+    if (ib16)
     {
-        assert(bytesToWrite < sizeof(g_padding));
-        if (!WriteFile(hFile.get(), g_padding, bytesToWrite, &bytesWritten, nullptr))
-            return HRESULT_FROM_WIN32(GetLastError());
+        auto ib16ptr = reinterpret_cast<uint16_t*>(ib);
+
+        hr = copy_indices16(mIndices.get(), mnFaces * 3, ib16ptr);
+        if (FAILED(hr))
+            return hr;
+
+        if (nTotalFaces > mnFaces)
+        {
+            hr = copy_indices16(mLODIndices.get(), (nTotalFaces - mnFaces) * 3, ib16ptr + mnFaces * 3);
+            if (FAILED(hr))
+                return hr;
+        }
+    }
+    else
+    {
+        memcpy(ib, mIndices.get(), sizeof(uint32_t) * mnFaces * 3);
+
+        if (nTotalFaces > mnFaces)
+        {
+            memcpy(ib + sizeof(uint32_t) * mnFaces * 3, mLODIndices.get(), sizeof(uint32_t) * (nTotalFaces - mnFaces) * 3);
+        }
+    }
+
+    hr = file.skip(static_cast<size_t>(roundup4k(ibHeader.SizeBytes) - ibHeader.SizeBytes));
+    if (FAILED(hr))
+        return hr;
 
-        if (bytesWritten != bytesToWrite)
+    if (depth)
+    {
+        uint8_t* depthIB = file.reserve(static_cast<size_t>(depthIBHeader.SizeBytes));
+        if (!depthIB)
             return E_FAIL;
+
+        if (ib16)
+        {
+            hr = copy_indices16(mDepthIndices.get(), mnDepthFaces * 3, reinterpret_cast<uint16_t*>(depthIB));
+            if (FAILED(hr))
+                return hr;
+        }
+        else
+        {
+            memcpy(depthIB, mDepthIndices.get(), static_cast<size_t>(depthIBHeader.SizeBytes));
+        }
+
+        hr = file.skip(static_cast<size_t>(roundup4k(depthIBHeader.SizeBytes) - depthIBHeader.SizeBytes));
+        if (FAILED(hr))
+            return hr;
     }
 
+    assert(file.complete());
+
+    return S_OK;
+}
+
+
+//======================================================================================
+// Meshlets
+//======================================================================================
+
+namespace MESHLETS
+{
+    const uint32_t FILE_MAGIC = 0x4C48534D; // "MSHL"
+    const uint32_t FILE_VERSION = 1;
+
+#pragma pack(push,1)
+
+    struct header_t
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t indexSize;             // 2 or 4 bytes per unique vertex index, matching the exported IB
+        uint32_t numSubsets;
+        uint32_t numMeshlets;
+        uint32_t numUniqueIndices;
+        uint32_t numPrimitives;
+        uint32_t reserved;
+    };
+
+    struct subset_t
+    {
+        uint32_t meshletOffset;
+        uint32_t meshletCount;
+    };
+
+#pragma pack(pop)
+
+    // Header, subset_t[numSubsets], Meshlet[numMeshlets], unique vertex indices padded to 4 bytes,
+    // MeshletTriangle[numPrimitives], CullData[numMeshlets]
+    static_assert(sizeof(header_t) == 32, "Meshlet header size mismatch");
+    static_assert(sizeof(subset_t) == 8, "Meshlet subset size mismatch");
+    static_assert(sizeof(Meshlet) == 16, "Meshlet size mismatch");
+    static_assert(sizeof(MeshletTriangle) == 4, "Meshlet triangle size mismatch");
+    static_assert(sizeof(CullData) == 24, "Meshlet cull data size mismatch");
+}; // namespace
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT Mesh::ExportMeshlets( const wchar_t* szFileName, size_t maxVerts, size_t maxPrims, bool clockwise ) const
+{
+    using namespace MESHLETS;
+
+    if ( !szFileName )
+        return E_INVALIDARG;
+
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_ADJACENCY);
+    if (FAILED(hr))
+        return hr;
+
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions || !mAdjacency)
+        return E_UNEXPECTED;
+
+    // Meshlets never span attributes, so each subset maps to a contiguous range of meshlets
+    auto subsets = ComputeSubsets(mAttributes.get(), mnFaces);
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint8_t> uniqueVertexIB;
+    std::vector<MeshletTriangle> primitiveIndices;
+    std::vector<std::pair<size_t, size_t>> meshletSubsets(subsets.size());
+
+    hr = ComputeMeshlets(mIndices.get(), mnFaces, mPositions.get(), mnVerts,
+                         subsets.data(), subsets.size(), mAdjacency.get(),
+                         meshlets, uniqueVertexIB, primitiveIndices, meshletSubsets.data(),
+                         maxVerts, maxPrims);
+    if (FAILED(hr))
+        return hr;
+
+    if (meshlets.empty())
+        return E_FAIL;
+
+    auto uniqueIndices = reinterpret_cast<const uint32_t*>(uniqueVertexIB.data());
+    size_t nUniqueIndices = uniqueVertexIB.size() / sizeof(uint32_t);
+
+    if (subsets.size() >= UINT32_MAX || meshlets.size() >= UINT32_MAX
+        || nUniqueIndices >= UINT32_MAX || primitiveIndices.size() >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    std::unique_ptr<CullData[]> cullData(new (std::nothrow) CullData[meshlets.size()]);
+    if (!cullData)
+        return E_OUTOFMEMORY;
+
+    hr = ComputeCullData(mPositions.get(), mnVerts, meshlets.data(), meshlets.size(),
+                         uniqueIndices, nUniqueIndices, primitiveIndices.data(), primitiveIndices.size(),
+                         cullData.get(), clockwise ? MESHLET_WIND_CW : MESHLET_DEFAULT);
+    if (FAILED(hr))
+        return hr;
+
+    // Setup header
+    bool ib16 = Is16BitIndexBuffer();
+
+    header_t header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.indexSize = ib16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.numSubsets = static_cast<uint32_t>(subsets.size());
+    header.numMeshlets = static_cast<uint32_t>(meshlets.size());
+    header.numUniqueIndices = static_cast<uint32_t>(nUniqueIndices);
+    header.numPrimitives = static_cast<uint32_t>(primitiveIndices.size());
+
+    size_t indexBytes = nUniqueIndices * header.indexSize;
+    size_t indexPadding = (4 - (indexBytes & 3)) & 3;
+
+    uint64_t size = uint64_t(sizeof(header_t))
+                    + uint64_t(sizeof(subset_t)) * header.numSubsets
+                    + uint64_t(sizeof(Meshlet)) * header.numMeshlets
+                    + indexBytes + indexPadding
+                    + uint64_t(sizeof(MeshletTriangle)) * header.numPrimitives
+                    + uint64_t(sizeof(CullData)) * header.numMeshlets;
+
+    mapped_file_writer file;
+    hr = file.create(szFileName, size);
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write(header);
+    if (FAILED(hr))
+        return hr;
+
+    for (auto it = meshletSubsets.cbegin(); it != meshletSubsets.cend(); ++it)
+    {
+        subset_t s;
+        s.meshletOffset = static_cast<uint32_t>(it->first);
+        s.meshletCount = static_cast<uint32_t>(it->second);
+
+        hr = file.write(s);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    hr = file.write(meshlets.data(), sizeof(Meshlet) * meshlets.size());
+    if (FAILED(hr))
+        return hr;
+
+    if (ib16)
+    {
+        uint8_t* ib = file.reserve(indexBytes);
+        if (!ib)
+            return E_FAIL;
+
+        hr = copy_indices16(uniqueIndices, nUniqueIndices, reinterpret_cast<uint16_t*>(ib));
+    }
+    else
+    {
+        hr = file.write(uniqueIndices, indexBytes);
+    }
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.skip(indexPadding);
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write(primitiveIndices.data(), sizeof(MeshletTriangle) * primitiveIndices.size());
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write(cullData.get(), sizeof(CullData) * meshlets.size());
+    if (FAILED(hr))
+        return hr;
+
+    assert(file.complete());
+
+    return S_OK;
+}
+
+
+//======================================================================================
+// Intermediate cache
+//======================================================================================
+
+namespace CACHE
+{
+    const uint32_t FILE_MAGIC = 0x4843534D; // "MSCH"
+    const uint32_t FILE_VERSION = 2;
+
+    enum STREAMS
+    {
+        STREAM_ATTRIBUTES       = 0x1,
+        STREAM_ADJACENCY        = 0x2,
+        STREAM_NORMALS          = 0x4,
+        STREAM_TANGENTS         = 0x8,
+        STREAM_BITANGENTS       = 0x10,
+        STREAM_TEXCOORDS        = 0x20,
+        STREAM_COLORS           = 0x40,
+        STREAM_BLENDINDICES     = 0x80,
+        STREAM_BLENDWEIGHTS     = 0x100,
+        STREAM_DEPTH            = 0x200,    // Depth indices, then depth positions
+    };
+
+#pragma pack(push,1)
+
+    struct header_t
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint64_t numFaces;
+        uint64_t numVertices;
+        uint32_t streams;               // STREAM_* present after the indices and positions
+        uint32_t numMaterials;
+        uint64_t materialBytes;
+        uint64_t userBytes;
+        uint32_t derived;               // Mesh::DERIVED_* streams, and which of them are stale
+        uint32_t stale;
+        float    adjacencyEpsilon;      // How the derived streams are rebuilt
+        uint32_t normalFlags;
+        uint32_t biTangents;
+        uint32_t depthFlags;
+        uint64_t numDepthFaces;
+        uint64_t numDepthVertices;
+    };
+
+    struct material_t
+    {
+        uint32_t            nameLength;     // wchar_t count, followed by the name and then the texture
+        uint32_t            textureLength;
+        uint32_t            perVertexColor;
+        float               specularPower;
+        float               alpha;
+        DirectX::XMFLOAT3   ambientColor;
+        DirectX::XMFLOAT3   diffuseColor;
+        DirectX::XMFLOAT3   specularColor;
+        DirectX::XMFLOAT3   emissiveColor;
+    };
+
+#pragma pack(pop)
+
+    // Header, user data, indices, positions, each present stream in STREAM_* order, materials
+    static_assert(sizeof(header_t) == 96, "Cache header size mismatch");
+    static_assert(sizeof(material_t) == 68, "Cache material size mismatch");
+
+    // Copies count elements of a stream from the mapped file, once they are known to be in it
+    template<typename T>
+    HRESULT read_stream(_In_reads_bytes_(size) const uint8_t* data, size_t size, size_t& offset, size_t count, std::unique_ptr<T[]>& dest)
+    {
+        uint64_t bytes = uint64_t(count) * sizeof(T);
+        if (bytes > (size - offset))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        dest.reset(new (std::nothrow) T[count]);
+        if (!dest)
+            return E_OUTOFMEMORY;
+
+        memcpy(dest.get(), data + offset, static_cast<size_t>(bytes));
+        offset += static_cast<size_t>(bytes);
+        return S_OK;
+    }
+}; // namespace
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT Mesh::ExportToCache( const wchar_t* szFileName, uint64_t key, size_t nMaterials, const Material* materials,
+                             const void* userData, size_t userBytes ) const
+{
+    using namespace CACHE;
+
+    if (!szFileName)
+        return E_INVALIDARG;
+
+    if ((nMaterials > 0 && !materials) || (userBytes > 0 && !userData))
+        return E_INVALIDARG;
+
+    // Bring derived streams up to date before they are read
+    HRESULT hr = UpdateDerived(DERIVED_ALL);
+    if (FAILED(hr))
+        return hr;
+
+    if (!mnFaces || !mIndices || !mnVerts || !mPositions)
+        return E_UNEXPECTED;
+
+    if ((uint64_t(mnFaces) * 3) >= UINT32_MAX || nMaterials >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+    struct stream_t
+    {
+        uint32_t    flag;
+        const void* data;
+        size_t      bytes;
+    };
+
+    const stream_t streams[] =
+    {
+        { 0, mIndices.get(), sizeof(uint32_t) * mnFaces * 3 },
+        { 0, mPositions.get(), sizeof(XMFLOAT3) * mnVerts },
+        { STREAM_ATTRIBUTES, mAttributes.get(), sizeof(uint32_t) * mnFaces },
+        { STREAM_ADJACENCY, mAdjacency.get(), sizeof(uint32_t) * mnFaces * 3 },
+        { STREAM_NORMALS, mNormals.get(), sizeof(XMFLOAT3) * mnVerts },
+        { STREAM_TANGENTS, mTangents.get(), sizeof(XMFLOAT4) * mnVerts },
+        { STREAM_BITANGENTS, mBiTangents.get(), sizeof(XMFLOAT3) * mnVerts },
+        { STREAM_TEXCOORDS, mTexCoords.get(), sizeof(XMFLOAT2) * mnVerts },
+        { STREAM_COLORS, mColors.get(), sizeof(XMFLOAT4) * mnVerts },
+        { STREAM_BLENDINDICES, mBlendIndices.get(), sizeof(XMFLOAT4) * mnVerts },
+        { STREAM_BLENDWEIGHTS, mBlendWeights.get(), sizeof(XMFLOAT4) * mnVerts },
+        { STREAM_DEPTH, mDepthIndices.get(), sizeof(uint32_t) * mnDepthFaces * 3 },
+        { STREAM_DEPTH, mDepthPositions.get(), sizeof(XMFLOAT3) * mnDepthVerts },
+    };
+
+    header_t header = {};
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.key = key;
+    header.numFaces = mnFaces;
+    header.numVertices = mnVerts;
+    header.numMaterials = static_cast<uint32_t>(nMaterials);
+    header.userBytes = userBytes;
+    header.derived = mDerived;
+    header.stale = mStale;
+    header.adjacencyEpsilon = mAdjacencyEpsilon;
+    header.normalFlags = mNormalFlags;
+    header.biTangents = (mBiTangentsWanted) ? 1u : 0u;
+    header.depthFlags = mDepthFlags;
+    header.numDepthFaces = mnDepthFaces;
+    header.numDepthVertices = mnDepthVerts;
+
+    uint64_t size = sizeof(header_t) + userBytes;
+    for (size_t j = 0; j < _countof(streams); ++j)
+    {
+        if (streams[j].data)
+        {
+            header.streams |= streams[j].flag;
+            size += streams[j].bytes;
+        }
+    }
+
+    for (size_t j = 0; j < nMaterials; ++j)
+    {
+        header.materialBytes += sizeof(material_t)
+            + sizeof(wchar_t) * (uint64_t(materials[j].name.size()) + materials[j].texture.size());
+    }
+    size += header.materialBytes;
+
+    mapped_file_writer file;
+    hr = file.create(szFileName, size);
+    if (FAILED(hr))
+        return hr;
+
+    hr = file.write(header);
+    if (FAILED(hr))
+        return hr;
+
+    if (userBytes > 0)
+    {
+        hr = file.write(userData, userBytes);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    for (size_t j = 0; j < _countof(streams); ++j)
+    {
+        if (streams[j].data)
+        {
+            hr = file.write(streams[j].data, streams[j].bytes);
+            if (FAILED(hr))
+                return hr;
+        }
+    }
+
+    for (size_t j = 0; j < nMaterials; ++j)
+    {
+        auto& m = materials[j];
+
+        material_t mdata = {};
+        mdata.nameLength = static_cast<uint32_t>(m.name.size());
+        mdata.textureLength = static_cast<uint32_t>(m.texture.size());
+        mdata.perVertexColor = (m.perVertexColor) ? 1u : 0u;
+        mdata.specularPower = m.specularPower;
+        mdata.alpha = m.alpha;
+        mdata.ambientColor = m.ambientColor;
+        mdata.diffuseColor = m.diffuseColor;
+        mdata.specularColor = m.specularColor;
+        mdata.emissiveColor = m.emissiveColor;
+
+        hr = file.write(mdata);
+        if (FAILED(hr))
+            return hr;
+
+        hr = file.write(m.name.c_str(), sizeof(wchar_t) * m.name.size());
+        if (FAILED(hr))
+            return hr;
+
+        hr = file.write(m.texture.c_str(), sizeof(wchar_t) * m.texture.size());
+        if (FAILED(hr))
+            return hr;
+    }
+
+    assert(file.complete());
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT Mesh::CreateFromCache( const wchar_t* szFileName, uint64_t key, std::unique_ptr<Mesh>& result,
+                               std::vector<Material>& materials, void* userData, size_t userBytes )
+{
+    using namespace CACHE;
+
+    if (!szFileName || (userBytes > 0 && !userData))
+        return E_INVALIDARG;
+
+    result.reset();
+    materials.clear();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile(safe_handle(CreateFile2(szFileName, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+#else
+    ScopedHandle hFile(safe_handle(CreateFileW(szFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)));
+#endif
+    if (!hFile)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (uint64_t(fileInfo.EndOfFile.QuadPart) > SIZE_MAX)
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+    size_t fileSize = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+    if (fileSize < sizeof(header_t))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    // Map the file, copying each stream out of the view
+    ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hMapping)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    std::unique_ptr<const uint8_t, view_unmapper> view(static_cast<const uint8_t*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+    if (!view)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    size_t offset = 0;
+    auto read = [&](void* dest, uint64_t bytes) -> bool
+    {
+        if (bytes > (fileSize - offset))
+            return false;
+
+        memcpy(dest, view.get() + offset, static_cast<size_t>(bytes));
+        offset += static_cast<size_t>(bytes);
+        return true;
+    };
+
+    header_t header;
+    read(&header, sizeof(header_t));
+
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.key != key || header.userBytes != userBytes)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    if (!header.numFaces || !header.numVertices
+        || header.numFaces >= (UINT32_MAX / 3) || header.numVertices >= UINT32_MAX)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    auto nFaces = static_cast<size_t>(header.numFaces);
+    auto nVerts = static_cast<size_t>(header.numVertices);
+
+    if (header.numDepthFaces > nFaces || header.numDepthVertices > nVerts
+        || ((header.streams & STREAM_DEPTH) != 0) != (header.numDepthFaces > 0))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    auto nDepthFaces = static_cast<size_t>(header.numDepthFaces);
+    auto nDepthVerts = static_cast<size_t>(header.numDepthVertices);
+
+    std::unique_ptr<Mesh> mesh(new (std::nothrow) Mesh);
+    if (!mesh)
+        return E_OUTOFMEMORY;
+
+    if (userBytes > 0 && !read(userData, userBytes))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    const uint32_t present = header.streams;
+    const uint8_t* data = view.get();
+
+    HRESULT hr = read_stream(data, fileSize, offset, nFaces * 3, mesh->mIndices);
+    if (SUCCEEDED(hr))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mPositions);
+    if (SUCCEEDED(hr) && (present & STREAM_ATTRIBUTES))
+        hr = read_stream(data, fileSize, offset, nFaces, mesh->mAttributes);
+    if (SUCCEEDED(hr) && (present & STREAM_ADJACENCY))
+        hr = read_stream(data, fileSize, offset, nFaces * 3, mesh->mAdjacency);
+    if (SUCCEEDED(hr) && (present & STREAM_NORMALS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mNormals);
+    if (SUCCEEDED(hr) && (present & STREAM_TANGENTS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mTangents);
+    if (SUCCEEDED(hr) && (present & STREAM_BITANGENTS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mBiTangents);
+    if (SUCCEEDED(hr) && (present & STREAM_TEXCOORDS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mTexCoords);
+    if (SUCCEEDED(hr) && (present & STREAM_COLORS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mColors);
+    if (SUCCEEDED(hr) && (present & STREAM_BLENDINDICES))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mBlendIndices);
+    if (SUCCEEDED(hr) && (present & STREAM_BLENDWEIGHTS))
+        hr = read_stream(data, fileSize, offset, nVerts, mesh->mBlendWeights);
+    if (SUCCEEDED(hr) && (present & STREAM_DEPTH))
+        hr = read_stream(data, fileSize, offset, nDepthFaces * 3, mesh->mDepthIndices);
+    if (SUCCEEDED(hr) && (present & STREAM_DEPTH))
+        hr = read_stream(data, fileSize, offset, nDepthVerts, mesh->mDepthPositions);
+    if (FAILED(hr))
+        return hr;
+
+    // Indices are copied out as written, so check them like SetIndexData would
+    for (size_t j = 0; j < nFaces * 3; ++j)
+    {
+        uint32_t index = mesh->mIndices[j];
+        if (index != uint32_t(-1) && index >= nVerts)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    for (size_t j = 0; j < nDepthFaces * 3; ++j)
+    {
+        if (mesh->mDepthIndices[j] >= nDepthVerts)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    if (header.materialBytes != (fileSize - offset))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    std::vector<Material> mats;
+    mats.reserve(header.numMaterials);
+
+    for (uint32_t j = 0; j < header.numMaterials; ++j)
+    {
+        material_t mdata;
+        if (!read(&mdata, sizeof(material_t)))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        if ((uint64_t(mdata.nameLength) + mdata.textureLength) * sizeof(wchar_t) > (fileSize - offset))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        Material m;
+        m.name.resize(mdata.nameLength);
+        m.texture.resize(mdata.textureLength);
+        read(&m.name[0], sizeof(wchar_t) * uint64_t(mdata.nameLength));
+        read(&m.texture[0], sizeof(wchar_t) * uint64_t(mdata.textureLength));
+
+        m.perVertexColor = (mdata.perVertexColor != 0);
+        m.specularPower = mdata.specularPower;
+        m.alpha = mdata.alpha;
+        m.ambientColor = mdata.ambientColor;
+        m.diffuseColor = mdata.diffuseColor;
+        m.specularColor = mdata.specularColor;
+        m.emissiveColor = mdata.emissiveColor;
+
+        mats.push_back(m);
+    }
+
+    if (offset != fileSize)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    mesh->mnFaces = nFaces;
+    mesh->mnVerts = nVerts;
+    mesh->mnDepthFaces = nDepthFaces;
+    mesh->mnDepthVerts = nDepthVerts;
+
+    // Derived streams keep rebuilding as they did before the mesh was cached, and any that are
+    // missing from the file are rebuilt on first use
+    mesh->mDerived = header.derived & DERIVED_ALL;
+    mesh->mStale = header.stale & mesh->mDerived;
+    mesh->mAdjacencyEpsilon = header.adjacencyEpsilon;
+    mesh->mNormalFlags = header.normalFlags;
+    mesh->mBiTangentsWanted = (header.biTangents != 0);
+    mesh->mDepthFlags = header.depthFlags;
+
+    if (!mesh->mAdjacency)
+        mesh->mStale |= mesh->mDerived & DERIVED_ADJACENCY;
+    if (!mesh->mNormals)
+        mesh->mStale |= mesh->mDerived & DERIVED_NORMALS;
+    if (!mesh->mTangents || (mesh->mBiTangentsWanted && !mesh->mBiTangents))
+        mesh->mStale |= mesh->mDerived & DERIVED_TANGENTS;
+
+    result.swap(mesh);
+    materials.swap(mats);
+
     return S_OK;
 }
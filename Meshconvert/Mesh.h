@@ -35,7 +35,8 @@
 class Mesh
 {
 public:
-    Mesh() : mnFaces(0), mnVerts(0) {}
+    Mesh() : mnFaces(0), mnVerts(0), mnDepthFaces(0), mnDepthVerts(0),
+        mDerived(0), mStale(0), mAdjacencyEpsilon(0.f), mNormalFlags(0), mBiTangentsWanted(false), mDepthFlags(0), mChunkFaces(0) {}
     Mesh(Mesh&& moveFrom);
     Mesh& operator= (Mesh&& moveFrom);
 
@@ -54,13 +55,30 @@ public:
 
     HRESULT Clean();
 
+    // Adjacency, normals, tangent frames, and the depth stream made by these methods are remembered with their parameters;
+    // edits that invalidate them only mark them stale, and they are rebuilt when next read or exported
+    void SetChunkSize( _In_ size_t maxChunkFaces );
+        // With a chunk size, topological adjacency and normals are built and Optimize reorders faces one spatial chunk
+        // of up to maxChunkFaces at a time, stitching adjacency and normals across chunks; 0 works on the whole mesh
+
     HRESULT GenerateAdjacency( _In_ float epsilon );
 
     HRESULT ComputeNormals( _In_ DWORD flags );
 
     HRESULT ComputeTangentFrame( _In_ bool bitangents );
 
-    HRESULT Optimize( bool lru );
+    HRESULT Optimize( bool lru, bool overdraw = false, bool clockwise = false );
+
+    HRESULT GenerateDepthStream( bool lru, bool overdraw = false, bool clockwise = false );
+        // Builds a welded, optimized position-only IB and VB for depth and shadow passes from the mesh as it is now;
+        // ExportToSDKMESH writes them as IB and VB 1, which no submesh references. CMO has a single vertex layout, so
+        // ExportToCMO does not write them
+
+    HRESULT GenerateLODs( _In_ size_t nLODs, _In_ bool lru );
+        // Builds up to nLODs simplified levels, each with about half the faces of the one before, with seams and attribute
+        // boundaries kept. Vertices are reordered so that every level uses a prefix of them, coarsest first, and all share
+        // the one VB; ExportToSDKMESH writes the levels as meshes 1 to nLODs. SetIndexData, SetVertexData, Clean, and
+        // Optimize discard them
 
     HRESULT ReverseWinding();
 
@@ -71,15 +89,24 @@ public:
 
     // Accessors
     const uint32_t* GetAttributeBuffer() const { return mAttributes.get(); }
-    const uint32_t* GetAdjacencyBuffer() const { return mAdjacency.get(); }
+    const uint32_t* GetAdjacencyBuffer() const { return SUCCEEDED(UpdateDerived(DERIVED_ADJACENCY)) ? mAdjacency.get() : nullptr; }
     const DirectX::XMFLOAT3* GetPositionBuffer() const { return mPositions.get(); }
-    const DirectX::XMFLOAT3* GetNormalBuffer() const { return mNormals.get(); }
+    const DirectX::XMFLOAT3* GetNormalBuffer() const { return SUCCEEDED(UpdateDerived(DERIVED_NORMALS)) ? mNormals.get() : nullptr; }
     const DirectX::XMFLOAT2* GetTexCoordBuffer() const { return mTexCoords.get(); }
-    const DirectX::XMFLOAT4* GetTangentBuffer() const { return mTangents.get(); }
+    const DirectX::XMFLOAT4* GetTangentBuffer() const { return SUCCEEDED(UpdateDerived(DERIVED_TANGENTS)) ? mTangents.get() : nullptr; }
+        // Stale derived streams are rebuilt here; a failed rebuild reads as a missing stream
 
     size_t GetFaceCount() const { return mnFaces; }
     size_t GetVertexCount() const { return mnVerts; }
 
+    size_t GetLODCount() const { return mLODVertexCounts.size(); }
+    size_t GetLODFaceCount( _In_ size_t lod ) const;
+    size_t GetLODVertexCount( _In_ size_t lod ) const;
+        // LOD 0 is the mesh itself
+
+    size_t GetDepthFaceCount() const { return SUCCEEDED(UpdateDerived(DERIVED_DEPTH)) ? mnDepthFaces : 0; }
+    size_t GetDepthVertexCount() const { return SUCCEEDED(UpdateDerived(DERIVED_DEPTH)) ? mnDepthVerts : 0; }
+
     bool Is16BitIndexBuffer() const;
 
     const uint32_t* GetIndexBuffer() const { return mIndices.get(); }
@@ -103,23 +130,75 @@ public:
 
     HRESULT ExportToVBO( _In_z_ const wchar_t* szFileName ) const;
     HRESULT ExportToCMO( _In_z_ const wchar_t* szFileName, _In_ size_t nMaterials, _In_reads_opt_(nMaterials) const Material* materials ) const;
-    HRESULT ExportToSDKMESH( _In_z_ const wchar_t* szFileName, _In_ size_t nMaterials, _In_reads_opt_(nMaterials) const Material* materials  ) const;
+    HRESULT ExportToSDKMESH( _In_z_ const wchar_t* szFileName, _In_ size_t nMaterials, _In_reads_opt_(nMaterials) const Material* materials,
+                             _In_ float quantizeTolerance = -1.f ) const;
+        // Normals, tangents, bi-tangents, and texcoords are written as half floats when within quantizeTolerance
+
+    // Save meshlets and culling data for mesh shading (requires adjacency)
+    HRESULT ExportMeshlets( _In_z_ const wchar_t* szFileName, _In_ size_t maxVerts, _In_ size_t maxPrims, _In_ bool clockwise ) const;
+
+    // Save and restore the full processed state (faces, adjacency, every vertex stream, the depth stream, how the
+    // derived streams are rebuilt, and materials) for reuse by later conversions; userData is stored alongside it
+    // verbatim. LODs are not saved
+    HRESULT ExportToCache( _In_z_ const wchar_t* szFileName, _In_ uint64_t key,
+                           _In_ size_t nMaterials, _In_reads_opt_(nMaterials) const Material* materials,
+                           _In_reads_bytes_opt_(userBytes) const void* userData, _In_ size_t userBytes ) const;
 
     // Create mesh from file
     static HRESULT CreateFromVBO( _In_z_ const wchar_t* szFileName, _Inout_ std::unique_ptr<Mesh>& result );
 
+    static HRESULT CreateFromCache( _In_z_ const wchar_t* szFileName, _In_ uint64_t key,
+                                    _Inout_ std::unique_ptr<Mesh>& result, _Inout_ std::vector<Material>& materials,
+                                    _Out_writes_bytes_opt_(userBytes) void* userData, _In_ size_t userBytes );
+        // Fails with HRESULT_FROM_WIN32(ERROR_INVALID_DATA) unless the file was written with the same key and userBytes
+
 private:
+    enum DERIVED_STREAMS : uint32_t
+    {
+        DERIVED_ADJACENCY   = 0x1,
+        DERIVED_NORMALS     = 0x2,
+        DERIVED_TANGENTS    = 0x4,  // Tangents and, if requested, bi-tangents
+        DERIVED_DEPTH       = 0x8,
+        DERIVED_ALL         = 0xF,
+    };
+
+    HRESULT UpdateDerived( uint32_t streams ) const;
+        // Rebuilds whichever of these derived streams are stale, along with the derived streams they are built from
+
+    void Invalidate( uint32_t streams );
+        // Marks derived streams stale, along with the derived streams built from them
+
+    void ReleaseLODs();
+        // LODs are dropped rather than rebuilt when the mesh changes, since building them reorders the vertices
+
     size_t                                      mnFaces;
     size_t                                      mnVerts;
     std::unique_ptr<uint32_t[]>                 mIndices;
     std::unique_ptr<uint32_t[]>                 mAttributes;
-    std::unique_ptr<uint32_t[]>                 mAdjacency;
+    mutable std::unique_ptr<uint32_t[]>         mAdjacency;
     std::unique_ptr<DirectX::XMFLOAT3[]>        mPositions;
-    std::unique_ptr<DirectX::XMFLOAT3[]>        mNormals;
-    std::unique_ptr<DirectX::XMFLOAT4[]>        mTangents;
-    std::unique_ptr<DirectX::XMFLOAT3[]>        mBiTangents;
+    mutable std::unique_ptr<DirectX::XMFLOAT3[]> mNormals;
+    mutable std::unique_ptr<DirectX::XMFLOAT4[]> mTangents;
+    mutable std::unique_ptr<DirectX::XMFLOAT3[]> mBiTangents;
     std::unique_ptr<DirectX::XMFLOAT2[]>        mTexCoords;
     std::unique_ptr<DirectX::XMFLOAT4[]>        mColors;
     std::unique_ptr<DirectX::XMFLOAT4[]>        mBlendIndices;
     std::unique_ptr<DirectX::XMFLOAT4[]>        mBlendWeights;
+    mutable size_t                              mnDepthFaces;
+    mutable size_t                              mnDepthVerts;
+    mutable std::unique_ptr<uint32_t[]>         mDepthIndices;
+    mutable std::unique_ptr<DirectX::XMFLOAT3[]> mDepthPositions;
+    std::unique_ptr<uint32_t[]>                 mLODIndices;        // Faces of every LOD, in order
+    std::unique_ptr<uint32_t[]>                 mLODAttributes;
+    std::vector<size_t>                         mLODFaceOffsets;    // First face of each LOD, plus the total
+    std::vector<size_t>                         mLODVertexCounts;
+
+    // Derived streams and how to rebuild them
+    uint32_t                                    mDerived;
+    mutable uint32_t                            mStale;
+    float                                       mAdjacencyEpsilon;
+    DWORD                                       mNormalFlags;
+    bool                                        mBiTangentsWanted;
+    DWORD                                       mDepthFlags;
+    size_t                                      mChunkFaces;
 };
\ No newline at end of file
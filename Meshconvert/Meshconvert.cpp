@@ -20,13 +20,23 @@
 #define NOHELP
 #pragma warning(pop)
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <list>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Mesh.h"
 #include "WaveFrontReader.h"
@@ -43,6 +53,7 @@ enum OPTIONS
     OPT_CTF,
     OPT_OPTIMIZE,
     OPT_OPTIMIZE_LRU,
+    OPT_OPTIMIZE_OVERDRAW,
     OPT_CLEAN,
     OPT_TOPOLOGICAL_ADJ,
     OPT_GEOMETRIC_ADJ,
@@ -59,10 +70,22 @@ enum OPTIONS
     OPT_FLIPZ,
     OPT_NOLOGO,
     OPT_FILELIST,
+    OPT_JOBS,
+    OPT_JOB_FACES,
+    OPT_TIMING,
+    OPT_TIMING_JSON,
+    OPT_MESHLETS,
+    OPT_QUANTIZE,
+    OPT_DEPTH,
+    OPT_CACHE,
+    OPT_LOD,
+    OPT_CHUNKS,
     OPT_MAX
 };
 
-static_assert(OPT_MAX <= 32, "dwOptions is a DWORD bitfield");
+static_assert(OPT_MAX <= 64, "dwOptions is a 64-bit bitfield");
+
+const size_t c_DefaultMaxFaces = 32 * 1024 * 1024;
 
 struct SConversion
 {
@@ -89,6 +112,7 @@ const SValue g_pOptions[] =
     { L"tb",        OPT_CTF },
     { L"op",        OPT_OPTIMIZE },
     { L"oplru",     OPT_OPTIMIZE_LRU },
+    { L"opod",      OPT_OPTIMIZE_OVERDRAW },
     { L"c",         OPT_CLEAN },
     { L"ta",        OPT_TOPOLOGICAL_ADJ },
     { L"ga",        OPT_GEOMETRIC_ADJ },
@@ -105,6 +129,16 @@ const SValue g_pOptions[] =
     { L"flipz",     OPT_FLIPZ },
     { L"nologo",    OPT_NOLOGO },
     { L"flist",     OPT_FILELIST },
+    { L"j",         OPT_JOBS },
+    { L"jfaces",    OPT_JOB_FACES },
+    { L"timing",    OPT_TIMING },
+    { L"timingjson", OPT_TIMING_JSON },
+    { L"meshlets",  OPT_MESHLETS },
+    { L"quant",     OPT_QUANTIZE },
+    { L"depth",     OPT_DEPTH },
+    { L"cache",     OPT_CACHE },
+    { L"lod",       OPT_LOD },
+    { L"chunks",    OPT_CHUNKS },
     { nullptr,      0 }
 };
 
@@ -116,6 +150,12 @@ namespace
 {
     inline HANDLE safe_handle(HANDLE h) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
 
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    typedef public std::unique_ptr<void, handle_closer> ScopedHandle;
+
+    struct view_unmapper { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
     struct find_closer { void operator()(HANDLE h) { assert(h != INVALID_HANDLE_VALUE); if (h) FindClose(h); } };
 
     typedef public std::unique_ptr<void, find_closer> ScopedFindHandle;
@@ -248,6 +288,7 @@ namespace
         wprintf(L"   -tb                 generate tangents & bi-tangents\n");
         wprintf(L"   -cw                 faces are clockwise (defaults to counter-clockwise)\n");
         wprintf(L"   -op | -oplru        vertex cache optimize the mesh (implies -c)\n");
+        wprintf(L"   -opod               also reorder the optimized faces to reduce overdraw (implies -op)\n");
         wprintf(L"   -c                  mesh cleaning including vertex dups for atttribute sets\n");
         wprintf(L"   -ta | -ga           generate topological vs. geometric adjancecy (def: ta)\n");
         wprintf(L"   -sdkmesh|-cmo|-vbo  output file type\n");
@@ -260,16 +301,32 @@ namespace
         wprintf(L"   -y                  overwrite existing output file (if any)\n");
         wprintf(L"   -nologo             suppress copyright message\n");
         wprintf(L"   -flist <filename>   use text file with a list of input files (one per line)\n");
+        wprintf(L"   -j <count>          convert up to <count> files in parallel (0 for one per core)\n");
+        wprintf(L"   -jfaces <count>     with -j, limit on total faces in flight (def: 32M)\n");
+        wprintf(L"   -timing             print time and temporary memory used by each stage, and the\n");
+        wprintf(L"                       output vertex cache miss rates and vertex dups\n");
+        wprintf(L"   -timingjson <filename> write per-stage timing and output quality for each file as JSON\n");
+        wprintf(L"   -meshlets           also write meshlets with culling data to <output>.meshlets\n");
+        wprintf(L"   -quant <tolerance>  sdkmesh normals, tangents, and texcoords as half floats when within\n");
+        wprintf(L"                       <tolerance> (radians for normals and tangents, texcoord units for uvs)\n");
+        wprintf(L"   -depth              also write a welded position-only IB and VB for depth passes\n");
+        wprintf(L"                       (sdkmesh only, as buffers 1 which no mesh references)\n");
+        wprintf(L"   -cache <directory>  reuse the processed mesh when the input and processing options\n");
+        wprintf(L"                       are unchanged, keeping it in <directory>\n");
+        wprintf(L"   -lod <count>        also write up to <count> simplified LODs, each with half the faces\n");
+        wprintf(L"                       of the one before, sharing the VB (sdkmesh only, implies -c)\n");
+        wprintf(L"   -chunks <faces>     build adjacency and normals and optimize faces in spatial chunks\n");
+        wprintf(L"                       of up to <faces>, stitching them across chunks (not with -ga)\n");
 
         wprintf(L"\n");
     }
 
 
     //--------------------------------------------------------------------------------------
-    HRESULT LoadFromOBJ(const wchar_t* szFilename, std::unique_ptr<Mesh>& inMesh, std::vector<Mesh::Material>& inMaterial, DWORD options)
+    HRESULT LoadFromOBJ(const wchar_t* szFilename, std::unique_ptr<Mesh>& inMesh, std::vector<Mesh::Material>& inMaterial, uint64_t options)
     {
         WaveFrontReader<uint32_t> wfReader;
-        HRESULT hr = wfReader.Load(szFilename, (options & (1 << OPT_CLOCKWISE)) ? false : true);
+        HRESULT hr = wfReader.LoadFast(szFilename, (options & (uint64_t(1) << OPT_CLOCKWISE)) ? false : true);
         if (FAILED(hr))
             return hr;
 
@@ -352,7 +409,7 @@ namespace
                     wchar_t txfname[_MAX_FNAME];
                     _wsplitpath_s(it->strTexture, nullptr, 0, nullptr, 0, txfname, _MAX_FNAME, txext, _MAX_EXT);
 
-                    if (!(options & (1 << OPT_NODDS)))
+                    if (!(options & (uint64_t(1) << OPT_NODDS)))
                     {
                         wcscpy_s(txext, L".dds");
                     }
@@ -368,439 +425,846 @@ namespace
 
         return S_OK;
     }
-}
-
-
-//--------------------------------------------------------------------------------------
-// Entry-point
-//--------------------------------------------------------------------------------------
-#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
-
-int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
-{
-    // Parameters and defaults
-    wchar_t szOutputFile[MAX_PATH] = {};
 
-    // Process command line
-    DWORD dwOptions = 0;
-    std::list<SConversion> conversion;
 
-    for (int iArg = 1; iArg < argc; iArg++)
+    //--------------------------------------------------------------------------------------
+    // Logs to stdout, or appends to a buffer when conversions run in parallel
+    void Print(_Inout_opt_ std::wstring* log, _In_z_ _Printf_format_string_ const wchar_t* format, ...)
     {
-        PWSTR pArg = argv[iArg];
+        va_list args;
+        va_start(args, format);
 
-        if (('-' == pArg[0]) || ('/' == pArg[0]))
+        if (log)
         {
-            pArg++;
-            PWSTR pValue;
-
-            for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
-
-            if (*pValue)
-                *pValue++ = 0;
-
-            DWORD dwOption = LookupByName(pArg, g_pOptions);
-
-            if (!dwOption || (dwOptions & (1 << dwOption)))
-            {
-                wprintf(L"ERROR: unknown command-line option '%ls'\n\n", pArg);
-                PrintUsage();
-                return 1;
-            }
+            va_list args2;
+            va_copy(args2, args);
 
-            dwOptions |= (1 << dwOption);
+            int len = _vscwprintf(format, args2);
+            va_end(args2);
 
-            // Handle options with additional value parameter
-            switch (dwOption)
+            if (len > 0)
             {
-            case OPT_OUTPUTFILE:
-            case OPT_FILELIST:
-                if (!*pValue)
-                {
-                    if ((iArg + 1 >= argc))
-                    {
-                        wprintf(L"ERROR: missing value for command-line option '%ls'\n\n", pArg);
-                        PrintUsage();
-                        return 1;
-                    }
-
-                    iArg++;
-                    pValue = argv[iArg];
-                }
-                break;
+                size_t pos = log->size();
+                log->resize(pos + size_t(len) + 1);
+                vswprintf_s(&(*log)[pos], size_t(len) + 1, format, args);
+                log->resize(pos + size_t(len));
             }
+        }
+        else
+        {
+            vwprintf(format, args);
+        }
 
-            switch (dwOption)
-            {
-            case OPT_OPTIMIZE_LRU:
-                dwOptions |= (1 << OPT_OPTIMIZE);
-                break;
-
-            case OPT_WEIGHT_BY_AREA:
-                if (dwOptions & (1 << OPT_WEIGHT_BY_EQUAL))
-                {
-                    wprintf(L"Cannot use both na and ne at the same time\n");
-                    return 1;
-                }
-                dwOptions |= (1 << OPT_NORMALS);
-                break;
-
-            case OPT_WEIGHT_BY_EQUAL:
-                if (dwOptions & (1 << OPT_WEIGHT_BY_AREA))
-                {
-                    wprintf(L"Cannot use both na and ne at the same time\n");
-                    return 1;
-                }
-                dwOptions |= (1 << OPT_NORMALS);
-                break;
-
-            case OPT_OUTPUTFILE:
-                wcscpy_s(szOutputFile, MAX_PATH, pValue);
-                break;
-
-            case OPT_TOPOLOGICAL_ADJ:
-                if (dwOptions & (1 << OPT_GEOMETRIC_ADJ))
-                {
-                    wprintf(L"Cannot use both ta and ga at the same time\n");
-                    return 1;
-                }
-                break;
-
-            case OPT_GEOMETRIC_ADJ:
-                if (dwOptions & (1 << OPT_TOPOLOGICAL_ADJ))
-                {
-                    wprintf(L"Cannot use both ta and ga at the same time\n");
-                    return 1;
-                }
-                break;
-
-            case OPT_SDKMESH:
-                if (dwOptions & ((1 << OPT_VBO) | (1 << OPT_CMO)))
-                {
-                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
-                    return 1;
-                }
-                break;
+        va_end(args);
+    }
 
-            case OPT_CMO:
-                if (dwOptions & ((1 << OPT_VBO) | (1 << OPT_SDKMESH)))
-                {
-                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
-                    return 1;
-                }
-                break;
 
-            case OPT_VBO:
-                if (dwOptions & ((1 << OPT_SDKMESH) | (1 << OPT_CMO)))
-                {
-                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
-                    return 1;
-                }
-                break;
+    //--------------------------------------------------------------------------------------
+    // Limits the total face count of the meshes being processed at once
+    class FaceBudget
+    {
+    public:
+        explicit FaceBudget(size_t maxFaces) : mMaxFaces(maxFaces), mInFlight(0) {}
 
-            case OPT_FILELIST:
-                {
-                    std::wifstream inFile(pValue);
-                    if (!inFile)
-                    {
-                        wprintf(L"Error opening -flist file %ls\n", pValue);
-                        return 1;
-                    }
-                    wchar_t fname[1024] = {};
-                    for (;;)
-                    {
-                        inFile >> fname;
-                        if (!inFile)
-                            break;
+        FaceBudget(FaceBudget const&) = delete;
+        FaceBudget& operator= (FaceBudget const&) = delete;
 
-                        if (*fname == L'#')
-                        {
-                            // Comment
-                        }
-                        else if (*fname == L'-')
-                        {
-                            wprintf(L"Command-line arguments not supported in -flist file\n");
-                            return 1;
-                        }
-                        else if (wcspbrk(fname, L"?*") != nullptr)
-                        {
-                            wprintf(L"Wildcards not supported in -flist file\n");
-                            return 1;
-                        }
-                        else
-                        {
-                            SConversion conv;
-                            wcscpy_s(conv.szSrc, MAX_PATH, fname);
-                            conversion.push_back(conv);
-                        }
+        void Acquire(size_t nFaces)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
 
-                        inFile.ignore(1000, '\n');
-                    }
-                    inFile.close();
-                }
-                break;
-            }
+            // A mesh larger than the whole budget runs once nothing else is in flight
+            mCondition.wait(lock, [&]() { return !mInFlight || (mInFlight + nFaces <= mMaxFaces); });
+            mInFlight += nFaces;
         }
-        else if (wcspbrk(pArg, L"?*") != nullptr)
+
+        void Release(size_t nFaces)
         {
-            size_t count = conversion.size();
-            SearchForFiles(pArg, conversion, (dwOptions & (1 << OPT_RECURSIVE)) != 0);
-            if (conversion.size() <= count)
             {
-                wprintf(L"No matching files found for %ls\n", pArg);
-                return 1;
+                std::lock_guard<std::mutex> lock(mMutex);
+                mInFlight -= nFaces;
             }
+            mCondition.notify_all();
         }
-        else
+
+        class Scope
         {
-            SConversion conv;
-            wcscpy_s(conv.szSrc, MAX_PATH, pArg);
+        public:
+            Scope(_In_opt_ FaceBudget* budget, size_t nFaces) : mBudget(budget), mFaces(nFaces)
+            {
+                if (mBudget)
+                    mBudget->Acquire(mFaces);
+            }
 
-            conversion.push_back(conv);
-        }
-    }
+            ~Scope()
+            {
+                if (mBudget)
+                    mBudget->Release(mFaces);
+            }
 
-    if (conversion.empty())
-    {
-        PrintUsage();
-        return 0;
-    }
+            Scope(Scope const&) = delete;
+            Scope& operator= (Scope const&) = delete;
 
-    if (*szOutputFile && conversion.size() > 1)
-    {
-        wprintf(L"Cannot use -o with multiple input files\n");
-        return 1;
-    }
+        private:
+            FaceBudget* mBudget;
+            size_t      mFaces;
+        };
 
-    if (~dwOptions & (1 << OPT_NOLOGO))
-        PrintLogo();
+    private:
+        size_t                  mMaxFaces;
+        size_t                  mInFlight;
+        std::mutex              mMutex;
+        std::condition_variable mCondition;
+    };
 
-    // Process files
-    for (auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv)
-    {
-        wchar_t ext[_MAX_EXT];
-        wchar_t fname[_MAX_FNAME];
-        _wsplitpath_s(pConv->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
 
-        if (pConv != conversion.begin())
-            wprintf(L"\n");
+    //--------------------------------------------------------------------------------------
+    // Per-stage statistics for -timing and -timingjson
+    typedef std::vector<MeshStageStats> StageList;
 
-        wprintf(L"reading %ls", pConv->szSrc);
-        fflush(stdout);
+    void __cdecl RecordStage(const MeshStageStats& stats, _In_opt_ void* context)
+    {
+        reinterpret_cast<StageList*>(context)->push_back(stats);
+    }
 
-        std::unique_ptr<Mesh> inMesh;
-        std::vector<Mesh::Material> inMaterial;
-        HRESULT hr = E_NOTIMPL;
-        if (_wcsicmp(ext, L".vbo") == 0)
-        {
-            hr = Mesh::CreateFromVBO(pConv->szSrc, inMesh);
-        }
-        else if (_wcsicmp(ext, L".sdkmesh") == 0)
-        {
-            wprintf(L"\nERROR: Importing SDKMESH files not supported\n");
-            return 1;
-        }
-        else if (_wcsicmp(ext, L".cmo") == 0)
-        {
-            wprintf(L"\nERROR: Importing Visual Studio CMO files not supported\n");
-            return 1;
-        }
-        else if (_wcsicmp(ext, L".x") == 0)
+    // Collects the library's stage reports made on this thread while converting a file
+    class StageRecorder
+    {
+    public:
+        explicit StageRecorder(_In_opt_ StageList* stages) : mStages(stages)
         {
-            wprintf(L"\nERROR: Legacy Microsoft X files not supported\n");
-            return 1;
+            if (mStages)
+                SetMeshStatsCallback(RecordStage, mStages);
         }
-        else if (_wcsicmp(ext, L".fbx") == 0)
+
+        ~StageRecorder()
         {
-            wprintf(L"\nERROR: Autodesk FBX files not supported\n");
-            return 1;
+            if (mStages)
+                SetMeshStatsCallback(nullptr);
         }
-        else
+
+        StageRecorder(StageRecorder const&) = delete;
+        StageRecorder& operator= (StageRecorder const&) = delete;
+
+        int64_t Start() const
         {
-            hr = LoadFromOBJ(pConv->szSrc, inMesh, inMaterial, dwOptions);
+            LARGE_INTEGER t = {};
+            if (mStages)
+                QueryPerformanceCounter(&t);
+            return t.QuadPart;
         }
-        if (FAILED(hr))
+
+        // Records work done by the tool itself, such as loading and exporting
+        void Stop(_In_z_ const char* stage, int64_t start, size_t nFaces, size_t nVerts) const
         {
-            wprintf(L" FAILED (%08X)\n", hr);
-            return 1;
-        }
+            if (!mStages)
+                return;
 
-        size_t nVerts = inMesh->GetVertexCount();
-        size_t nFaces = inMesh->GetFaceCount();
+            LARGE_INTEGER t, f;
+            QueryPerformanceCounter(&t);
+            QueryPerformanceFrequency(&f);
 
-        if (!nVerts || !nFaces)
-        {
-            wprintf(L"\nERROR: Invalid mesh\n");
-            return 1;
+            MeshStageStats stats = {};
+            stats.stage = stage;
+            stats.elapsedMicroseconds = uint64_t((t.QuadPart - start) * 1000000 / f.QuadPart);
+            stats.nFaces = nFaces;
+            stats.nVerts = nVerts;
+            mStages->push_back(stats);
         }
 
-        assert(inMesh->GetPositionBuffer() != 0);
-        assert(inMesh->GetIndexBuffer() != 0);
+    private:
+        StageList* mStages;
+    };
 
-        wprintf(L"\n%Iu vertices, %Iu faces", nVerts, nFaces);
+    struct StageSummary
+    {
+        const char* stage;
+        size_t      calls;
+        uint64_t    elapsedMicroseconds;
+        size_t      tempBytes;
+        size_t      nFaces;
+        size_t      nVerts;
+    };
+
+    // Merges repeated calls to the same stage, in order of first use
+    std::vector<StageSummary> SummarizeStages(const StageList& stages)
+    {
+        std::vector<StageSummary> summary;
 
-        if (dwOptions & (1 << OPT_FLIPU))
+        for (auto it = stages.cbegin(); it != stages.cend(); ++it)
         {
-            hr = inMesh->InvertUTexCoord();
-            if (FAILED(hr))
+            auto sit = summary.begin();
+            for (; sit != summary.end(); ++sit)
             {
-                wprintf(L"\nERROR: Failed inverting u texcoord (%08X)\n", hr);
-                return 1;
+                if (!strcmp(sit->stage, it->stage))
+                    break;
             }
-        }
 
-        if (dwOptions & (1 << OPT_FLIPV))
-        {
-            hr = inMesh->InvertVTexCoord();
-            if (FAILED(hr))
+            if (sit == summary.end())
             {
-                wprintf(L"\nERROR: Failed inverting v texcoord (%08X)\n", hr);
-                return 1;
+                StageSummary entry = { it->stage, 1, it->elapsedMicroseconds, it->tempBytes, it->nFaces, it->nVerts };
+                summary.push_back(entry);
             }
-        }
-
-        if (dwOptions & (1 << OPT_FLIPZ))
-        {
-            hr = inMesh->ReverseHandedness();
-            if (FAILED(hr))
+            else
             {
-                wprintf(L"\nERROR: Failed reversing handedness (%08X)\n", hr);
-                return 1;
+                sit->calls += 1;
+                sit->elapsedMicroseconds += it->elapsedMicroseconds;
+                sit->tempBytes += it->tempBytes;
+                sit->nFaces = std::max(sit->nFaces, it->nFaces);
+                sit->nVerts = std::max(sit->nVerts, it->nVerts);
             }
         }
 
-        // Prepare mesh for processing
-        if (dwOptions & ((1 << OPT_OPTIMIZE) | (1 << OPT_CLEAN)))
+        return summary;
+    }
+
+    // Output quality of a converted file, reported with its stages
+    struct MeshQuality
+    {
+        size_t  nFaces;
+        size_t  nVerts;
+        size_t  dupVerts;
+            // Size of the written mesh, and how many vertices Clean duplicated
+
+        float   inputACMR;
+        float   inputATVR;
+        float   acmr;
+        float   atvr;
+            // Vertex cache miss rates before optimization and as written
+    };
+
+    struct FileStats
+    {
+        StageList   stages;
+        MeshQuality quality;
+    };
+
+    void PrintStages(_Inout_opt_ std::wstring* log, const FileStats& stats)
+    {
+        auto summary = SummarizeStages(stats.stages);
+
+        Print(log, L"\n%-32hs %5ls %12ls %12ls %10ls %10ls\n", "stage", L"calls", L"ms", L"temp KB", L"faces", L"verts");
+        for (auto it = summary.cbegin(); it != summary.cend(); ++it)
         {
-            // Adjacency
-            float epsilon = (dwOptions & (1 << OPT_GEOMETRIC_ADJ)) ? 1e-5f : 0.f;
+            Print(log, L"%-32hs %5Iu %12.3f %12Iu %10Iu %10Iu\n", it->stage, it->calls,
+                double(it->elapsedMicroseconds) / 1000.0, (it->tempBytes + 1023) / 1024, it->nFaces, it->nVerts);
+        }
 
-            hr = inMesh->GenerateAdjacency(epsilon);
-            if (FAILED(hr))
+        const MeshQuality& quality = stats.quality;
+        Print(log, L"\n%Iu vertices, %Iu faces, %Iu vertex dups, ACMR %f -> %f, ATVR %f -> %f\n",
+            quality.nVerts, quality.nFaces, quality.dupVerts, quality.inputACMR, quality.acmr, quality.inputATVR, quality.atvr);
+    }
+
+    void AppendJSONString(std::string& json, _In_z_ const wchar_t* str)
+    {
+        int len = WideCharToMultiByte(CP_UTF8, 0, str, -1, nullptr, 0, nullptr, nullptr);
+        std::string utf8(size_t(std::max(len, 1)), '\0');
+        if (len > 0)
+            WideCharToMultiByte(CP_UTF8, 0, str, -1, &utf8[0], len, nullptr, nullptr);
+
+        json += '"';
+        for (const char* c = utf8.c_str(); *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
             {
-                wprintf(L"\nERROR: Failed generating adjacency (%08X)\n", hr);
-                return 1;
+                json += '\\';
+                json += *c;
             }
-
-            // Validation
-            std::wstring msgs;
-            hr = inMesh->Validate(VALIDATE_BACKFACING, &msgs);
-            if (!msgs.empty())
+            else if (static_cast<unsigned char>(*c) < 0x20)
             {
-                wprintf(L"\nWARNING: \n");
-                wprintf(msgs.c_str());
+                char buff[8];
+                sprintf_s(buff, "\\u%04x", static_cast<unsigned int>(*c));
+                json += buff;
             }
+            else
+            {
+                json += *c;
+            }
+        }
+        json += '"';
+    }
 
-            // Clean (also handles attribute reuse split if needed)
-            hr = inMesh->Clean();
-            if (FAILED(hr))
+    // Writes the stages and output quality of every file converted as a JSON array
+    bool WriteStagesJSON(_In_z_ const wchar_t* szFile, const std::vector<SConversion>& files, const std::vector<FileStats>& stats)
+    {
+        std::string json = "[";
+
+        bool first = true;
+        for (size_t j = 0; j < files.size() && j < stats.size(); ++j)
+        {
+            if (stats[j].stages.empty())
+                continue;
+
+            json += (first) ? "\n  { \"file\": " : ",\n  { \"file\": ";
+            first = false;
+
+            AppendJSONString(json, files[j].szSrc);
+            json += ", \"stages\": [";
+
+            auto summary = SummarizeStages(stats[j].stages);
+            for (auto it = summary.cbegin(); it != summary.cend(); ++it)
             {
-                wprintf(L"\nERROR: Failed mesh clean (%08X)\n", hr);
-                return 1;
+                char buff[512];
+                sprintf_s(buff, "%s\n    { \"stage\": \"%s\", \"calls\": %Iu, \"ms\": %.3f, \"tempBytes\": %Iu, \"faces\": %Iu, \"verts\": %Iu }",
+                    (it == summary.cbegin()) ? "" : ",", it->stage, it->calls,
+                    double(it->elapsedMicroseconds) / 1000.0, it->tempBytes, it->nFaces, it->nVerts);
+                json += buff;
             }
-            else
+
+            const MeshQuality& quality = stats[j].quality;
+
+            char buff[512];
+            sprintf_s(buff, "\n  ], \"quality\": { \"faces\": %Iu, \"verts\": %Iu, \"dupVerts\": %Iu, \"inputACMR\": %.6f, \"inputATVR\": %.6f, \"acmr\": %.6f, \"atvr\": %.6f } }",
+                quality.nFaces, quality.nVerts, quality.dupVerts, quality.inputACMR, quality.inputATVR, quality.acmr, quality.atvr);
+            json += buff;
+        }
+
+        json += "\n]\n";
+
+        std::ofstream outFile(szFile, std::ios::binary);
+        if (!outFile)
+            return false;
+
+        outFile.write(json.c_str(), static_cast<std::streamsize>(json.size()));
+        return !outFile.fail();
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Intermediate cache
+
+    // Bump whenever processing changes what the same input and options convert to
+    const uint64_t c_CacheVersion = 1;
+
+    // Options that change the processed mesh or its materials; the rest only change how it is written
+    const uint64_t c_CacheOptions = (uint64_t(1) << OPT_NORMALS) | (uint64_t(1) << OPT_WEIGHT_BY_AREA)
+        | (uint64_t(1) << OPT_WEIGHT_BY_EQUAL) | (uint64_t(1) << OPT_TANGENTS) | (uint64_t(1) << OPT_CTF)
+        | (uint64_t(1) << OPT_OPTIMIZE) | (uint64_t(1) << OPT_OPTIMIZE_LRU) | (uint64_t(1) << OPT_OPTIMIZE_OVERDRAW)
+        | (uint64_t(1) << OPT_CLEAN) | (uint64_t(1) << OPT_TOPOLOGICAL_ADJ) | (uint64_t(1) << OPT_GEOMETRIC_ADJ)
+        | (uint64_t(1) << OPT_CMO) | (uint64_t(1) << OPT_CLOCKWISE) | (uint64_t(1) << OPT_NODDS)
+        | (uint64_t(1) << OPT_FLIPU) | (uint64_t(1) << OPT_FLIPV) | (uint64_t(1) << OPT_FLIPZ);
+
+    // What processing reported, kept with the cached mesh so a hit reports the same
+    struct CacheInfo
+    {
+        uint64_t    inputVerts;
+        uint64_t    dupVerts;
+        float       inputACMR;
+        float       inputATVR;
+    };
+
+    // FNV-1a over 8-byte words, folding the high half back in after each multiply
+    uint64_t HashBytes(uint64_t hash, _In_reads_bytes_(bytes) const void* data, size_t bytes)
+    {
+        const uint64_t prime = 0x100000001B3ull;
+
+        auto ptr = static_cast<const uint8_t*>(data);
+        for (; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t), ptr += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, ptr, sizeof(uint64_t));
+
+            hash = (hash ^ word) * prime;
+            hash ^= hash >> 32;
+        }
+
+        for (; bytes > 0; --bytes, ++ptr)
+        {
+            hash = (hash ^ *ptr) * prime;
+        }
+
+        return hash;
+    }
+
+    // Hashes the contents of a file through a mapped view, collecting the material libraries it names when it is an OBJ
+    HRESULT HashFile(_In_z_ const wchar_t* szFile, uint64_t& hash, _Inout_opt_ std::vector<std::wstring>* libraries)
+    {
+        ScopedHandle hFile(safe_handle(CreateFileW(szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)));
+        if (!hFile)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile.get(), &fileSize))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (uint64_t(fileSize.QuadPart) > SIZE_MAX)
+            return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+
+        auto size = static_cast<size_t>(fileSize.QuadPart);
+        hash = HashBytes(hash, &size, sizeof(size));
+
+        if (!size)
+            return S_OK;
+
+        ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!hMapping)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        std::unique_ptr<const char, view_unmapper> view(static_cast<const char*>(MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0)));
+        if (!view)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        const char* data = view.get();
+
+        hash = HashBytes(hash, data, size);
+
+        if (libraries)
+        {
+            // Every 'mtllib <name>' at the start of a line, matching how WaveFrontReader reads it
+            for (size_t j = 0; j + 7 < size; ++j)
             {
-                size_t nNewVerts = inMesh->GetVertexCount();
-                if (nVerts != nNewVerts)
+                if ((j > 0 && data[j - 1] != '\n') || memcmp(&data[j], "mtllib", 6) != 0 || (data[j + 6] != ' ' && data[j + 6] != '\t'))
+                    continue;
+
+                size_t start = j + 6;
+                while (start < size && (data[start] == ' ' || data[start] == '\t'))
+                    ++start;
+
+                size_t end = start;
+                while (end < size && !isspace(static_cast<unsigned char>(data[end])))
+                    ++end;
+
+                wchar_t name[MAX_PATH] = {};
+                if (end > start && (end - start) < MAX_PATH
+                    && MultiByteToWideChar(CP_ACP, 0, &data[start], static_cast<int>(end - start), name, MAX_PATH - 1))
                 {
-                    wprintf(L" [%Iu vertex dups] ", nNewVerts - nVerts);
-                    nVerts = nNewVerts;
+                    libraries->push_back(name);
                 }
+
+                j = end;
             }
         }
 
-        if (!inMesh->GetNormalBuffer())
+        return S_OK;
+    }
+
+    // Key for the processed mesh: the input, any material libraries it loads, and the processing options
+    HRESULT ComputeCacheKey(_In_z_ const wchar_t* szFile, bool obj, uint64_t dwOptions, size_t chunkFaces, uint64_t& key)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+
+        uint64_t header[3] = { c_CacheVersion, (dwOptions & c_CacheOptions) | ((obj) ? 1u : 0u), uint64_t(chunkFaces) };
+        hash = HashBytes(hash, header, sizeof(header));
+
+        std::vector<std::wstring> libraries;
+        HRESULT hr = HashFile(szFile, hash, (obj) ? &libraries : nullptr);
+        if (FAILED(hr))
+            return hr;
+
+        wchar_t drive[_MAX_DRIVE] = {};
+        wchar_t dir[_MAX_DIR] = {};
+        _wsplitpath_s(szFile, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0);
+
+        for (auto it = libraries.cbegin(); it != libraries.cend(); ++it)
         {
-            dwOptions |= 1 << OPT_NORMALS;
+            wchar_t fname[_MAX_FNAME] = {};
+            wchar_t ext[_MAX_EXT] = {};
+            _wsplitpath_s(it->c_str(), nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+
+            wchar_t szPath[MAX_PATH] = {};
+            _wmakepath_s(szPath, drive, dir, fname, ext);
+
+            // A missing library still keys differently from one that appears later
+            hr = HashFile(szPath, hash, nullptr);
+            if (FAILED(hr))
+            {
+                hash = HashBytes(hash, &hr, sizeof(hr));
+            }
         }
 
-        if (!inMesh->GetTangentBuffer() && (dwOptions & (1 << OPT_CMO)))
+        key = hash;
+        return S_OK;
+    }
+
+    // Writes the cache entry under a temporary name and then renames it, so parallel conversions never read a partial entry
+    HRESULT WriteCache(const Mesh& mesh, _In_z_ const wchar_t* szCachePath, uint64_t key,
+        const std::vector<Mesh::Material>& materials, const CacheInfo& info)
+    {
+        wchar_t tempPath[MAX_PATH] = {};
+        swprintf_s(tempPath, L"%ls.%08X.tmp", szCachePath, GetCurrentThreadId());
+
+        HRESULT hr = mesh.ExportToCache(tempPath, key, materials.size(), materials.empty() ? nullptr : materials.data(),
+                                        &info, sizeof(info));
+        if (SUCCEEDED(hr) && !MoveFileExW(tempPath, szCachePath, MOVEFILE_REPLACE_EXISTING))
         {
-            dwOptions |= 1 << OPT_TANGENTS;
+            hr = HRESULT_FROM_WIN32(GetLastError());
         }
 
-        // Compute vertex normals from faces
-        if ((dwOptions & (1 << OPT_NORMALS))
-            || ((dwOptions & ((1 << OPT_TANGENTS) | (1 << OPT_CTF))) && !inMesh->GetNormalBuffer()))
+        if (FAILED(hr))
         {
-            DWORD flags = CNORM_DEFAULT;
+            DeleteFileW(tempPath);
+        }
+
+        return hr;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Converts one file, returning the process exit code
+    int ConvertFile(const SConversion& conv, uint64_t dwOptions, _In_z_ const wchar_t* szOutputFile, float quantizeTolerance,
+        _In_z_ const wchar_t* szCacheDir, size_t lodCount, size_t chunkFaces, _Inout_opt_ std::wstring* log, _In_opt_ FaceBudget* budget,
+        _Inout_opt_ FileStats* stats)
+    {
+        StageRecorder recorder(stats ? &stats->stages : nullptr);
+        int64_t convertStart = recorder.Start();
+
+        wchar_t ext[_MAX_EXT];
+        wchar_t fname[_MAX_FNAME];
+        _wsplitpath_s(conv.szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT);
+
+        Print(log, L"reading %ls", conv.szSrc);
+        if (!log)
+            fflush(stdout);
+
+        int64_t loadStart = recorder.Start();
+
+        std::unique_ptr<Mesh> inMesh;
+        std::vector<Mesh::Material> inMaterial;
+        HRESULT hr = E_NOTIMPL;
+
+        // A cache hit replaces loading and every processing stage before the final winding
+        uint64_t cacheKey = 0;
+        wchar_t cachePath[MAX_PATH] = {};
+        CacheInfo cacheInfo = {};
+        bool cached = false;
 
-            if (dwOptions & (1 << OPT_WEIGHT_BY_EQUAL))
+        if (*szCacheDir)
+        {
+            hr = ComputeCacheKey(conv.szSrc, _wcsicmp(ext, L".vbo") != 0, dwOptions, chunkFaces, cacheKey);
+            if (FAILED(hr))
             {
-                flags |= CNORM_WEIGHT_EQUAL;
+                Print(log, L"\nWARNING: Failed reading input for the cache key (%08X)\n", hr);
             }
-            else if (dwOptions & (1 << OPT_WEIGHT_BY_AREA))
+            else
             {
-                flags |= CNORM_WEIGHT_BY_AREA;
+                wchar_t cacheName[_MAX_FNAME] = {};
+                swprintf_s(cacheName, L"%016llX", cacheKey);
+                _wmakepath_s(cachePath, nullptr, szCacheDir, cacheName, L".meshcache");
+
+                cached = SUCCEEDED(Mesh::CreateFromCache(cachePath, cacheKey, inMesh, inMaterial, &cacheInfo, sizeof(cacheInfo)));
             }
+        }
 
-            if (dwOptions & (1 << OPT_CLOCKWISE))
+        if (cached)
+        {
+            hr = S_OK;
+        }
+        else
+        {
+            if (_wcsicmp(ext, L".vbo") == 0)
             {
-                flags |= CNORM_WIND_CW;
+                hr = Mesh::CreateFromVBO(conv.szSrc, inMesh);
             }
-
-            hr = inMesh->ComputeNormals(flags);
-            if (FAILED(hr))
+            else if (_wcsicmp(ext, L".sdkmesh") == 0)
+            {
+                Print(log, L"\nERROR: Importing SDKMESH files not supported\n");
+                return 1;
+            }
+            else if (_wcsicmp(ext, L".cmo") == 0)
+            {
+                Print(log, L"\nERROR: Importing Visual Studio CMO files not supported\n");
+                return 1;
+            }
+            else if (_wcsicmp(ext, L".x") == 0)
+            {
+                Print(log, L"\nERROR: Legacy Microsoft X files not supported\n");
+                return 1;
+            }
+            else if (_wcsicmp(ext, L".fbx") == 0)
             {
-                wprintf(L"\nERROR: Failed computing normals (flags:%1X, %08X)\n", flags, hr);
+                Print(log, L"\nERROR: Autodesk FBX files not supported\n");
                 return 1;
             }
+            else
+            {
+                hr = LoadFromOBJ(conv.szSrc, inMesh, inMaterial, dwOptions);
+            }
+        }
+        if (FAILED(hr))
+        {
+            Print(log, L" FAILED (%08X)\n", hr);
+            return 1;
+        }
+
+        size_t nVerts = inMesh->GetVertexCount();
+        size_t nFaces = inMesh->GetFaceCount();
+
+        if (!nVerts || !nFaces)
+        {
+            Print(log, L"\nERROR: Invalid mesh\n");
+            return 1;
+        }
+
+        assert(inMesh->GetPositionBuffer() != 0);
+        assert(inMesh->GetIndexBuffer() != 0);
+
+        // Not kept in the cache, so a cached mesh rebuilds its derived streams the same way
+        inMesh->SetChunkSize(chunkFaces);
+
+        recorder.Stop((cached) ? "CacheLoad" : "Load", loadStart, nFaces, nVerts);
+
+        // Bound the faces being processed by parallel conversions
+        FaceBudget::Scope faceScope(budget, nFaces);
+
+        if (cached)
+        {
+            Print(log, L"\n%Iu vertices, %Iu faces (cached)", static_cast<size_t>(cacheInfo.inputVerts), nFaces);
+
+            if (cacheInfo.dupVerts > 0)
+            {
+                Print(log, L" [%Iu vertex dups] ", static_cast<size_t>(cacheInfo.dupVerts));
+            }
+
+            if (dwOptions & (uint64_t(1) << OPT_OPTIMIZE))
+            {
+                Print(log, L" [ACMR %f, ATVR %f] ", cacheInfo.inputACMR, cacheInfo.inputATVR);
+            }
+
+            if (stats)
+            {
+                stats->quality.dupVerts = static_cast<size_t>(cacheInfo.dupVerts);
+                stats->quality.inputACMR = cacheInfo.inputACMR;
+                stats->quality.inputATVR = cacheInfo.inputATVR;
+            }
+        }
+        else
+        {
+            Print(log, L"\n%Iu vertices, %Iu faces", nVerts, nFaces);
+
+            cacheInfo.inputVerts = nVerts;
         }
 
-        // Compute tangents and bitangents
-        if (dwOptions & ((1 << OPT_TANGENTS) | (1 << OPT_CTF)))
+        if (!cached)
         {
-            if (!inMesh->GetTexCoordBuffer())
+            if (dwOptions & (uint64_t(1) << OPT_FLIPU))
             {
-                wprintf(L"\nERROR: Computing tangents/bi-tangents requires texture coordinates\n");
-                return 1;
+                hr = inMesh->InvertUTexCoord();
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed inverting u texcoord (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            if (dwOptions & (uint64_t(1) << OPT_FLIPV))
+            {
+                hr = inMesh->InvertVTexCoord();
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed inverting v texcoord (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            if (dwOptions & (uint64_t(1) << OPT_FLIPZ))
+            {
+                hr = inMesh->ReverseHandedness();
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed reversing handedness (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            // Prepare mesh for processing
+            if (dwOptions & ((uint64_t(1) << OPT_OPTIMIZE) | (uint64_t(1) << OPT_CLEAN)))
+            {
+                // Adjacency
+                float epsilon = (dwOptions & (uint64_t(1) << OPT_GEOMETRIC_ADJ)) ? 1e-5f : 0.f;
+
+                hr = inMesh->GenerateAdjacency(epsilon);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed generating adjacency (%08X)\n", hr);
+                    return 1;
+                }
+
+                // Validation
+                std::wstring msgs;
+                hr = inMesh->Validate(VALIDATE_BACKFACING, &msgs);
+                if (!msgs.empty())
+                {
+                    Print(log, L"\nWARNING: \n");
+                    Print(log, L"%ls", msgs.c_str());
+                }
+
+                // Clean (also handles attribute reuse split if needed)
+                hr = inMesh->Clean();
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed mesh clean (%08X)\n", hr);
+                    return 1;
+                }
+                else
+                {
+                    size_t nNewVerts = inMesh->GetVertexCount();
+                    if (nVerts != nNewVerts)
+                    {
+                        Print(log, L" [%Iu vertex dups] ", nNewVerts - nVerts);
+
+                        cacheInfo.dupVerts = nNewVerts - nVerts;
+
+                        if (stats)
+                            stats->quality.dupVerts = nNewVerts - nVerts;
+
+                        nVerts = nNewVerts;
+                    }
+                }
+            }
+
+            if (!inMesh->GetNormalBuffer())
+            {
+                dwOptions |= uint64_t(1) << OPT_NORMALS;
+            }
+
+            if (!inMesh->GetTangentBuffer() && (dwOptions & (uint64_t(1) << OPT_CMO)))
+            {
+                dwOptions |= uint64_t(1) << OPT_TANGENTS;
             }
 
-            hr = inMesh->ComputeTangentFrame((dwOptions & (1 << OPT_CTF)) ? true : false);
+            // Compute vertex normals from faces
+            if ((dwOptions & (uint64_t(1) << OPT_NORMALS))
+                || ((dwOptions & ((uint64_t(1) << OPT_TANGENTS) | (uint64_t(1) << OPT_CTF))) && !inMesh->GetNormalBuffer()))
+            {
+                DWORD flags = CNORM_DEFAULT;
+
+                if (dwOptions & (uint64_t(1) << OPT_WEIGHT_BY_EQUAL))
+                {
+                    flags |= CNORM_WEIGHT_EQUAL;
+                }
+                else if (dwOptions & (uint64_t(1) << OPT_WEIGHT_BY_AREA))
+                {
+                    flags |= CNORM_WEIGHT_BY_AREA;
+                }
+
+                if (dwOptions & (uint64_t(1) << OPT_CLOCKWISE))
+                {
+                    flags |= CNORM_WIND_CW;
+                }
+
+                hr = inMesh->ComputeNormals(flags);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed computing normals (flags:%1X, %08X)\n", flags, hr);
+                    return 1;
+                }
+            }
+
+            // Compute tangents and bitangents
+            if (dwOptions & ((uint64_t(1) << OPT_TANGENTS) | (uint64_t(1) << OPT_CTF)))
+            {
+                if (!inMesh->GetTexCoordBuffer())
+                {
+                    Print(log, L"\nERROR: Computing tangents/bi-tangents requires texture coordinates\n");
+                    return 1;
+                }
+
+                hr = inMesh->ComputeTangentFrame((dwOptions & (uint64_t(1) << OPT_CTF)) ? true : false);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed computing tangent frame (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            // Perform attribute and vertex-cache optimization
+            if (dwOptions & (uint64_t(1) << OPT_OPTIMIZE))
+            {
+                assert(inMesh->GetAdjacencyBuffer() != 0);
+
+                float acmr, atvr;
+                ComputeVertexCacheMissRate(inMesh->GetIndexBuffer(), nFaces, nVerts, OPTFACES_V_DEFAULT, acmr, atvr);
+
+                Print(log, L" [ACMR %f, ATVR %f] ", acmr, atvr);
+
+                cacheInfo.inputACMR = acmr;
+                cacheInfo.inputATVR = atvr;
+
+                if (stats)
+                {
+                    stats->quality.inputACMR = acmr;
+                    stats->quality.inputATVR = atvr;
+                }
+
+                hr = inMesh->Optimize((dwOptions & (uint64_t(1) << OPT_OPTIMIZE_LRU)) ? true : false,
+                                      (dwOptions & (uint64_t(1) << OPT_OPTIMIZE_OVERDRAW)) ? true : false,
+                                      (dwOptions & (uint64_t(1) << OPT_CLOCKWISE)) ? true : false);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed vertex-cache optimization (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            // Failing to write the cache only costs the next conversion the work
+            if (*cachePath)
+            {
+                hr = WriteCache(*inMesh, cachePath, cacheKey, inMaterial, cacheInfo);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nWARNING: Failed writing cache (%08X):-> '%ls'\n", hr, cachePath);
+                }
+            }
+        }
+
+        if (dwOptions & (uint64_t(1) << OPT_FLIP))
+        {
+            hr = inMesh->ReverseWinding();
             if (FAILED(hr))
             {
-                wprintf(L"\nERROR: Failed computing tangent frame (%08X)\n", hr);
+                Print(log, L"\nERROR: Failed reversing winding (%08X)\n", hr);
                 return 1;
             }
         }
 
-        // Perform attribute and vertex-cache optimization
-        if (dwOptions & (1 << OPT_OPTIMIZE))
+        // Position-only streams for depth passes are built from the final faces and winding
+        if (dwOptions & (uint64_t(1) << OPT_DEPTH))
         {
-            assert(inMesh->GetAdjacencyBuffer() != 0);
-
-            float acmr, atvr;
-            ComputeVertexCacheMissRate(inMesh->GetIndexBuffer(), nFaces, nVerts, OPTFACES_V_DEFAULT, acmr, atvr);
-
-            wprintf(L" [ACMR %f, ATVR %f] ", acmr, atvr);
+            bool clockwise = ((dwOptions & (uint64_t(1) << OPT_CLOCKWISE)) != 0) != ((dwOptions & (uint64_t(1) << OPT_FLIP)) != 0);
 
-            hr = inMesh->Optimize((dwOptions & (1 << OPT_OPTIMIZE_LRU)) ? true : false);
+            hr = inMesh->GenerateDepthStream((dwOptions & (uint64_t(1) << OPT_OPTIMIZE_LRU)) ? true : false,
+                                             (dwOptions & (uint64_t(1) << OPT_OPTIMIZE_OVERDRAW)) ? true : false,
+                                             clockwise);
             if (FAILED(hr))
             {
-                wprintf(L"\nERROR: Failed vertex-cache optimization (%08X)\n", hr);
+                Print(log, L"\nERROR: Failed generating depth stream (%08X)\n", hr);
                 return 1;
             }
         }
 
-        if (dwOptions & (1 << OPT_FLIP))
+        // LODs reorder the vertices, so they are built last
+        if (lodCount > 0)
         {
-            hr = inMesh->ReverseWinding();
+            hr = inMesh->GenerateLODs(lodCount, (dwOptions & (uint64_t(1) << OPT_OPTIMIZE_LRU)) ? true : false);
             if (FAILED(hr))
             {
-                wprintf(L"\nERROR: Failed reversing winding (%08X)\n", hr);
+                Print(log, L"\nERROR: Failed generating LODs (%08X)\n", hr);
                 return 1;
             }
         }
 
         // Write results
-        wprintf(L"\n\t->\n");
+        Print(log, L"\n\t->\n");
 
-        if (dwOptions & (1 << OPT_OPTIMIZE))
+        if (dwOptions & (uint64_t(1) << OPT_OPTIMIZE))
         {
             float acmr, atvr;
             ComputeVertexCacheMissRate(inMesh->GetIndexBuffer(), nFaces, nVerts, OPTFACES_V_DEFAULT, acmr, atvr);
 
-            wprintf(L" [ACMR %f, ATVR %f] ", acmr, atvr);
+            Print(log, L" [ACMR %f, ATVR %f] ", acmr, atvr);
+
+            if (stats)
+            {
+                stats->quality.acmr = acmr;
+                stats->quality.atvr = atvr;
+            }
+        }
+        else if (stats)
+        {
+            ComputeVertexCacheMissRate(inMesh->GetIndexBuffer(), nFaces, nVerts, OPTFACES_V_DEFAULT, stats->quality.acmr, stats->quality.atvr);
+
+            stats->quality.inputACMR = stats->quality.acmr;
+            stats->quality.inputATVR = stats->quality.atvr;
         }
 
 
@@ -815,11 +1279,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
         else
         {
-            if (dwOptions & (1 << OPT_VBO))
+            if (dwOptions & (uint64_t(1) << OPT_VBO))
             {
                 wcscpy_s(outputExt, L".vbo");
             }
-            else if (dwOptions & (1 << OPT_CMO))
+            else if (dwOptions & (uint64_t(1) << OPT_CMO))
             {
                 wcscpy_s(outputExt, L".cmo");
             }
@@ -834,26 +1298,61 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             _wmakepath_s(outputPath, nullptr, nullptr, outFilename, outputExt);
         }
 
-        if (~dwOptions & (1 << OPT_OVERWRITE))
+        if (~dwOptions & (uint64_t(1) << OPT_OVERWRITE))
         {
             if (GetFileAttributesW(outputPath) != INVALID_FILE_ATTRIBUTES)
             {
-                wprintf(L"\nERROR: Output file already exists, use -y to overwrite:\n'%ls'\n", outputPath);
+                Print(log, L"\nERROR: Output file already exists, use -y to overwrite:\n'%ls'\n", outputPath);
                 return 1;
             }
         }
 
-        if (!_wcsicmp(outputExt, L".vbo"))
+        wchar_t meshletPath[MAX_PATH] = {};
+
+        if (dwOptions & (uint64_t(1) << OPT_MESHLETS))
         {
-            if (!inMesh->GetNormalBuffer() || !inMesh->GetTexCoordBuffer())
-            {
-                wprintf(L"\nERROR: VBO requires position, normal, and texcoord\n");
-                return 1;
-            }
+            wchar_t drive[_MAX_DRIVE] = {};
+            wchar_t dir[_MAX_DIR] = {};
+            wchar_t outFilename[_MAX_FNAME] = {};
+            _wsplitpath_s(outputPath, drive, _MAX_DRIVE, dir, _MAX_DIR, outFilename, _MAX_FNAME, nullptr, 0);
+
+            _wmakepath_s(meshletPath, drive, dir, outFilename, L".meshlets");
+
+            if (~dwOptions & (uint64_t(1) << OPT_OVERWRITE))
+            {
+                if (GetFileAttributesW(meshletPath) != INVALID_FILE_ATTRIBUTES)
+                {
+                    Print(log, L"\nERROR: Output file already exists, use -y to overwrite:\n'%ls'\n", meshletPath);
+                    return 1;
+                }
+            }
+        }
+
+        int64_t exportStart = recorder.Start();
+
+        if (!_wcsicmp(outputExt, L".vbo"))
+        {
+            if (!inMesh->GetNormalBuffer() || !inMesh->GetTexCoordBuffer())
+            {
+                Print(log, L"\nERROR: VBO requires position, normal, and texcoord\n");
+                return 1;
+            }
 
             if (!inMesh->Is16BitIndexBuffer())
             {
-                wprintf(L"\nERROR: VBO only supports 16-bit indices\n");
+                Print(log, L"\nERROR: VBO only supports 16-bit indices\n");
+                return 1;
+            }
+
+            if (dwOptions & (uint64_t(1) << OPT_DEPTH))
+            {
+                Print(log, L"\nERROR: VBO does not support a depth stream\n");
+                return 1;
+            }
+
+            if (lodCount > 0)
+            {
+                Print(log, L"\nERROR: LODs are only written to SDKMESH\n");
                 return 1;
             }
 
@@ -861,19 +1360,31 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
         else if (!_wcsicmp(outputExt, L".sdkmesh"))
         {
-            hr = inMesh->ExportToSDKMESH(outputPath, inMaterial.size(), inMaterial.empty() ? nullptr : inMaterial.data());
+            hr = inMesh->ExportToSDKMESH(outputPath, inMaterial.size(), inMaterial.empty() ? nullptr : inMaterial.data(), quantizeTolerance);
         }
         else if (!_wcsicmp(outputExt, L".cmo"))
         {
             if (!inMesh->GetNormalBuffer() || !inMesh->GetTexCoordBuffer() || !inMesh->GetTangentBuffer())
             {
-                wprintf(L"\nERROR: Visual Studio CMO requires position, normal, tangents, and texcoord\n");
+                Print(log, L"\nERROR: Visual Studio CMO requires position, normal, tangents, and texcoord\n");
                 return 1;
             }
 
             if (!inMesh->Is16BitIndexBuffer())
             {
-                wprintf(L"\nERROR: Visual Studio CMO only supports 16-bit indices\n");
+                Print(log, L"\nERROR: Visual Studio CMO only supports 16-bit indices\n");
+                return 1;
+            }
+
+            if (dwOptions & (uint64_t(1) << OPT_DEPTH))
+            {
+                Print(log, L"\nERROR: Visual Studio CMO does not support a depth stream\n");
+                return 1;
+            }
+
+            if (lodCount > 0)
+            {
+                Print(log, L"\nERROR: LODs are only written to SDKMESH\n");
                 return 1;
             }
 
@@ -881,23 +1392,484 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
         else if (!_wcsicmp(outputExt, L".x"))
         {
-            wprintf(L"\nERROR: Legacy Microsoft X files not supported\n");
+            Print(log, L"\nERROR: Legacy Microsoft X files not supported\n");
             return 1;
         }
         else
         {
-            wprintf(L"\nERROR: Unknown output file type '%ls'\n", outputExt);
+            Print(log, L"\nERROR: Unknown output file type '%ls'\n", outputExt);
             return 1;
         }
 
         if (FAILED(hr))
         {
-            wprintf(L"\nERROR: Failed write (%08X):-> '%ls'\n", hr, outputPath);
+            Print(log, L"\nERROR: Failed write (%08X):-> '%ls'\n", hr, outputPath);
             return 1;
         }
 
-        wprintf(L" %Iu vertices, %Iu faces written:\n'%ls'\n", nVerts, nFaces, outputPath);
+        recorder.Stop("Export", exportStart, nFaces, nVerts);
+
+        Print(log, L" %Iu vertices, %Iu faces written:\n'%ls'\n", nVerts, nFaces, outputPath);
+
+        if (dwOptions & (uint64_t(1) << OPT_DEPTH))
+        {
+            Print(log, L" depth stream %Iu vertices, %Iu faces\n", inMesh->GetDepthVertexCount(), inMesh->GetDepthFaceCount());
+        }
+
+        for (size_t lod = 1; lod <= inMesh->GetLODCount(); ++lod)
+        {
+            Print(log, L" LOD%Iu %Iu vertices, %Iu faces\n", lod, inMesh->GetLODVertexCount(lod), inMesh->GetLODFaceCount(lod));
+        }
+
+        // Meshlets are built from the final IB so they match the exported mesh
+        if (dwOptions & (uint64_t(1) << OPT_MESHLETS))
+        {
+            if (!inMesh->GetAdjacencyBuffer())
+            {
+                float epsilon = (dwOptions & (uint64_t(1) << OPT_GEOMETRIC_ADJ)) ? 1e-5f : 0.f;
+
+                hr = inMesh->GenerateAdjacency(epsilon);
+                if (FAILED(hr))
+                {
+                    Print(log, L"\nERROR: Failed generating adjacency (%08X)\n", hr);
+                    return 1;
+                }
+            }
+
+            bool clockwise = ((dwOptions & (uint64_t(1) << OPT_CLOCKWISE)) != 0) != ((dwOptions & (uint64_t(1) << OPT_FLIP)) != 0);
+
+            hr = inMesh->ExportMeshlets(meshletPath, MESHLET_DEFAULT_MAX_VERTS, MESHLET_DEFAULT_MAX_PRIMS, clockwise);
+            if (FAILED(hr))
+            {
+                Print(log, L"\nERROR: Failed writing meshlets (%08X):-> '%ls'\n", hr, meshletPath);
+                return 1;
+            }
+
+            Print(log, L" meshlets written:\n'%ls'\n", meshletPath);
+        }
+
+        if (stats)
+        {
+            recorder.Stop("Total", convertStart, nFaces, nVerts);
+
+            stats->quality.nFaces = nFaces;
+            stats->quality.nVerts = nVerts;
+
+            if (dwOptions & (uint64_t(1) << OPT_TIMING))
+            {
+                PrintStages(log, *stats);
+            }
+        }
+
+        return 0;
+    }
+
+
+#ifdef _OPENMP
+    //--------------------------------------------------------------------------------------
+    // Converts files on a pool of workers, printing each log in input order
+    int ConvertParallel(const std::vector<SConversion>& files, uint64_t dwOptions, _In_z_ const wchar_t* szOutputFile,
+        float quantizeTolerance, _In_z_ const wchar_t* szCacheDir, size_t lodCount, size_t chunkFaces, size_t jobs, size_t maxFaces,
+        std::vector<FileStats>& stats)
+    {
+        FaceBudget budget(maxFaces);
+
+        std::vector<std::wstring> logs(files.size());
+        std::vector<int> results(files.size(), -1);
+
+        std::mutex mutex;
+        size_t next = 0;
+        size_t printed = 0;
+        bool failed = false;
+
+        // Library calls made from the workers run single-threaded since nested parallelism is off
+        #pragma omp parallel num_threads(static_cast<int>(jobs))
+        {
+            for (;;)
+            {
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (failed || next >= files.size())
+                        break;
+
+                    index = next++;
+                }
+
+                std::wstring& log = logs[index];
+                if (index > 0)
+                    log = L"\n";
+
+                int result = ConvertFile(files[index], dwOptions, szOutputFile, quantizeTolerance, szCacheDir, lodCount, chunkFaces, &log, &budget,
+                    stats.empty() ? nullptr : &stats[index]);
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                results[index] = result;
+                if (result)
+                    failed = true;
+
+                // Like the serial loop, nothing is reported past the first failure
+                while (printed < files.size() && results[printed] >= 0)
+                {
+                    wprintf(L"%ls", logs[printed].c_str());
+                    std::wstring().swap(logs[printed]);
+
+                    if (results[printed])
+                    {
+                        printed = files.size();
+                        break;
+                    }
+
+                    ++printed;
+                }
+
+                fflush(stdout);
+            }
+        }
+
+        return (failed) ? 1 : 0;
+    }
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    // Parameters and defaults
+    wchar_t szOutputFile[MAX_PATH] = {};
+    wchar_t szTimingFile[MAX_PATH] = {};
+    wchar_t szCacheDir[MAX_PATH] = {};
+
+    size_t jobs = 1;
+    size_t maxFaces = c_DefaultMaxFaces;
+    float quantizeTolerance = -1.f;
+    size_t lodCount = 0;
+    size_t chunkFaces = 0;
+
+    // Process command line
+    uint64_t dwOptions = 0;
+    std::list<SConversion> conversion;
+
+    for (int iArg = 1; iArg < argc; iArg++)
+    {
+        PWSTR pArg = argv[iArg];
+
+        if (('-' == pArg[0]) || ('/' == pArg[0]))
+        {
+            pArg++;
+            PWSTR pValue;
+
+            for (pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+            if (*pValue)
+                *pValue++ = 0;
+
+            DWORD dwOption = LookupByName(pArg, g_pOptions);
+
+            if (!dwOption || (dwOptions & (uint64_t(1) << dwOption)))
+            {
+                wprintf(L"ERROR: unknown command-line option '%ls'\n\n", pArg);
+                PrintUsage();
+                return 1;
+            }
+
+            dwOptions |= (uint64_t(1) << dwOption);
+
+            // Handle options with additional value parameter
+            switch (dwOption)
+            {
+            case OPT_OUTPUTFILE:
+            case OPT_FILELIST:
+            case OPT_JOBS:
+            case OPT_JOB_FACES:
+            case OPT_TIMING_JSON:
+            case OPT_QUANTIZE:
+            case OPT_CACHE:
+            case OPT_LOD:
+            case OPT_CHUNKS:
+                if (!*pValue)
+                {
+                    if ((iArg + 1 >= argc))
+                    {
+                        wprintf(L"ERROR: missing value for command-line option '%ls'\n\n", pArg);
+                        PrintUsage();
+                        return 1;
+                    }
+
+                    iArg++;
+                    pValue = argv[iArg];
+                }
+                break;
+            }
+
+            switch (dwOption)
+            {
+            case OPT_OPTIMIZE_LRU:
+            case OPT_OPTIMIZE_OVERDRAW:
+                dwOptions |= (uint64_t(1) << OPT_OPTIMIZE);
+                break;
+
+            case OPT_LOD:
+                // Clean splits vertices shared between attributes, which keeps attribute boundaries as seams
+                if (swscanf_s(pValue, L"%Iu", &lodCount) != 1 || !lodCount)
+                {
+                    wprintf(L"Invalid value specified with -lod (%ls)\n", pValue);
+                    return 1;
+                }
+                dwOptions |= (uint64_t(1) << OPT_CLEAN);
+                break;
+
+            case OPT_WEIGHT_BY_AREA:
+                if (dwOptions & (uint64_t(1) << OPT_WEIGHT_BY_EQUAL))
+                {
+                    wprintf(L"Cannot use both na and ne at the same time\n");
+                    return 1;
+                }
+                dwOptions |= (uint64_t(1) << OPT_NORMALS);
+                break;
+
+            case OPT_WEIGHT_BY_EQUAL:
+                if (dwOptions & (uint64_t(1) << OPT_WEIGHT_BY_AREA))
+                {
+                    wprintf(L"Cannot use both na and ne at the same time\n");
+                    return 1;
+                }
+                dwOptions |= (uint64_t(1) << OPT_NORMALS);
+                break;
+
+            case OPT_OUTPUTFILE:
+                wcscpy_s(szOutputFile, MAX_PATH, pValue);
+                break;
+
+            case OPT_TIMING_JSON:
+                wcscpy_s(szTimingFile, MAX_PATH, pValue);
+                break;
+
+            case OPT_CACHE:
+                wcscpy_s(szCacheDir, MAX_PATH, pValue);
+                if (!CreateDirectoryW(szCacheDir, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+                {
+                    wprintf(L"Cannot create cache directory (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
+
+            case OPT_JOBS:
+                if (swscanf_s(pValue, L"%Iu", &jobs) != 1)
+                {
+                    wprintf(L"Invalid value specified with -j (%ls)\n", pValue);
+                    return 1;
+                }
+#ifdef _OPENMP
+                if (!jobs)
+                {
+                    jobs = static_cast<size_t>(omp_get_num_procs());
+                }
+#else
+                wprintf(L"WARNING: -j requires OpenMP, files will be converted one at a time\n");
+#endif
+                break;
+
+            case OPT_JOB_FACES:
+                if (swscanf_s(pValue, L"%Iu", &maxFaces) != 1 || !maxFaces)
+                {
+                    wprintf(L"Invalid value specified with -jfaces (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
+
+            case OPT_CHUNKS:
+                // Chunks are stitched by exact positions, which is topological adjacency
+                if (swscanf_s(pValue, L"%Iu", &chunkFaces) != 1 || !chunkFaces)
+                {
+                    wprintf(L"Invalid value specified with -chunks (%ls)\n", pValue);
+                    return 1;
+                }
+                if (dwOptions & (uint64_t(1) << OPT_GEOMETRIC_ADJ))
+                {
+                    wprintf(L"Cannot use both ga and chunks at the same time\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_QUANTIZE:
+                if (swscanf_s(pValue, L"%f", &quantizeTolerance) != 1 || !(quantizeTolerance >= 0.f))
+                {
+                    wprintf(L"Invalid value specified with -quant (%ls)\n", pValue);
+                    return 1;
+                }
+                break;
+
+            case OPT_TOPOLOGICAL_ADJ:
+                if (dwOptions & (uint64_t(1) << OPT_GEOMETRIC_ADJ))
+                {
+                    wprintf(L"Cannot use both ta and ga at the same time\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_GEOMETRIC_ADJ:
+                if (dwOptions & (uint64_t(1) << OPT_TOPOLOGICAL_ADJ))
+                {
+                    wprintf(L"Cannot use both ta and ga at the same time\n");
+                    return 1;
+                }
+                if (dwOptions & (uint64_t(1) << OPT_CHUNKS))
+                {
+                    wprintf(L"Cannot use both ga and chunks at the same time\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_SDKMESH:
+                if (dwOptions & ((uint64_t(1) << OPT_VBO) | (uint64_t(1) << OPT_CMO)))
+                {
+                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_CMO:
+                if (dwOptions & ((uint64_t(1) << OPT_VBO) | (uint64_t(1) << OPT_SDKMESH)))
+                {
+                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_VBO:
+                if (dwOptions & ((uint64_t(1) << OPT_SDKMESH) | (uint64_t(1) << OPT_CMO)))
+                {
+                    wprintf(L"Can only use one of sdkmesh, cmo, or vbo\n");
+                    return 1;
+                }
+                break;
+
+            case OPT_FILELIST:
+                {
+                    std::wifstream inFile(pValue);
+                    if (!inFile)
+                    {
+                        wprintf(L"Error opening -flist file %ls\n", pValue);
+                        return 1;
+                    }
+                    wchar_t fname[1024] = {};
+                    for (;;)
+                    {
+                        inFile >> fname;
+                        if (!inFile)
+                            break;
+
+                        if (*fname == L'#')
+                        {
+                            // Comment
+                        }
+                        else if (*fname == L'-')
+                        {
+                            wprintf(L"Command-line arguments not supported in -flist file\n");
+                            return 1;
+                        }
+                        else if (wcspbrk(fname, L"?*") != nullptr)
+                        {
+                            wprintf(L"Wildcards not supported in -flist file\n");
+                            return 1;
+                        }
+                        else
+                        {
+                            SConversion conv;
+                            wcscpy_s(conv.szSrc, MAX_PATH, fname);
+                            conversion.push_back(conv);
+                        }
+
+                        inFile.ignore(1000, '\n');
+                    }
+                    inFile.close();
+                }
+                break;
+            }
+        }
+        else if (wcspbrk(pArg, L"?*") != nullptr)
+        {
+            size_t count = conversion.size();
+            SearchForFiles(pArg, conversion, (dwOptions & (uint64_t(1) << OPT_RECURSIVE)) != 0);
+            if (conversion.size() <= count)
+            {
+                wprintf(L"No matching files found for %ls\n", pArg);
+                return 1;
+            }
+        }
+        else
+        {
+            SConversion conv;
+            wcscpy_s(conv.szSrc, MAX_PATH, pArg);
+
+            conversion.push_back(conv);
+        }
+    }
+
+    if (conversion.empty())
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    if (*szOutputFile && conversion.size() > 1)
+    {
+        wprintf(L"Cannot use -o with multiple input files\n");
+        return 1;
+    }
+
+    if (~dwOptions & (uint64_t(1) << OPT_NOLOGO))
+        PrintLogo();
+
+    // Process files
+    std::vector<SConversion> files(conversion.cbegin(), conversion.cend());
+
+    std::vector<FileStats> stats;
+    if (dwOptions & ((uint64_t(1) << OPT_TIMING) | (uint64_t(1) << OPT_TIMING_JSON)))
+    {
+        stats.resize(files.size());
+    }
+
+    int result = 0;
+
+#ifdef _OPENMP
+    if (jobs > 1 && files.size() > 1)
+    {
+        result = ConvertParallel(files, dwOptions, szOutputFile, quantizeTolerance, szCacheDir, lodCount, chunkFaces, jobs, maxFaces, stats);
+    }
+    else
+#else
+    UNREFERENCED_PARAMETER(jobs);
+    UNREFERENCED_PARAMETER(maxFaces);
+#endif
+    {
+        for (size_t j = 0; j < files.size(); ++j)
+        {
+            if (j > 0)
+                wprintf(L"\n");
+
+            result = ConvertFile(files[j], dwOptions, szOutputFile, quantizeTolerance, szCacheDir, lodCount, chunkFaces, nullptr, nullptr,
+                stats.empty() ? nullptr : &stats[j]);
+            if (result)
+                break;
+        }
+    }
+
+    if (*szTimingFile)
+    {
+        if (!WriteStagesJSON(szTimingFile, files, stats))
+        {
+            wprintf(L"\nERROR: Failed writing timing file '%ls'\n", szTimingFile);
+            return 1;
+        }
     }
 
-    return 0;
+    return result;
 }
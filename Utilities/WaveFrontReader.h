@@ -32,11 +32,17 @@
 
 #include <algorithm>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
 #include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include <directxmath.h>
 #include <directxcollision.h>
@@ -60,8 +66,6 @@ public:
     {
         Clear();
 
-        static const size_t MAX_POLY = 64;
-
         using namespace DirectX;
 
         std::wifstream InFile( szFileName );
@@ -291,31 +295,7 @@ public:
                     return E_FAIL;
                 }
 
-                // Convert polygons to triangles
-                DWORD i0 = faceIndex[0];
-                DWORD i1 = faceIndex[1];
-
-                for( size_t j = 2; j < iFace; ++ j )
-                {
-                    DWORD index = faceIndex[ j ];
-                    indices.emplace_back( static_cast<index_t>( i0 ) );
-                    if ( ccw )
-                    {
-                        indices.emplace_back( static_cast<index_t>( i1 ) );
-                        indices.emplace_back( static_cast<index_t>( index ) );
-                    }
-                    else
-                    {
-                        indices.emplace_back( static_cast<index_t>( index ) );
-                        indices.emplace_back( static_cast<index_t>( i1 ) );
-                    }                        
-                     
-                    attributes.emplace_back( curSubset );
-
-                    i1 = index;
-                }
-
-                assert( attributes.size()*3 == indices.size() );
+                AddPolygon( faceIndex, iFace, curSubset, ccw );
             }
             else if( 0 == wcscmp( strCommand.c_str(), L"mtllib" ) )
             {
@@ -328,25 +308,7 @@ public:
                 wchar_t strName[MAX_PATH] = {};
                 InFile >> strName;
 
-                bool bFound = false;
-                uint32_t count = 0;
-                for( auto it = materials.cbegin(); it != materials.cend(); ++it, ++count )
-                {
-                    if( 0 == wcscmp( it->strName, strName ) )
-                    {
-                        bFound = true;
-                        curSubset = count;
-                        break;
-                    }
-                }
-
-                if( !bFound )
-                {
-                    Material mat;
-                    curSubset = static_cast<uint32_t>( materials.size() );
-                    wcscpy_s( mat.strName, MAX_PATH - 1, strName );
-                    materials.emplace_back( mat );
-                }
+                curSubset = FindMaterial( strName );
             }
             else
             {
@@ -368,24 +330,219 @@ public:
         BoundingBox::CreateFromPoints( bounds, positions.size(), positions.data(), sizeof(XMFLOAT3) );
 
         // If an associated material file was found, read that in as well.
-        if( *strMaterialFilename )
+        return LoadAssociatedMTL( szFileName, strMaterialFilename );
+    }
+
+    // Same results as Load, but reads the file through a memory mapping with a narrow-char
+    // tokenizer and a flat vertex hash. Large files are split into chunks of whole lines
+    // which are parsed in parallel when built with OpenMP, then merged in file order.
+    HRESULT LoadFast( _In_z_ const wchar_t* szFileName, bool ccw = true )
+    {
+        Clear();
+
+        using namespace DirectX;
+
+        ScopedHandle hFile( safe_handle( CreateFileW( szFileName, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr ) ) );
+        if ( !hFile )
+            return HRESULT_FROM_WIN32( GetLastError() );
+
+        LARGE_INTEGER fileSize = {};
+        if ( !GetFileSizeEx( hFile.get(), &fileSize ) )
+            return HRESULT_FROM_WIN32( GetLastError() );
+
+#if defined(_WIN64)
+        size_t size = static_cast<size_t>( fileSize.QuadPart );
+#else
+        if ( fileSize.HighPart > 0 )
+            return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+
+        size_t size = fileSize.LowPart;
+#endif
+        if ( !size )
+            return E_FAIL;
+
+        ScopedHandle hMapping( CreateFileMappingW( hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr ) );
+        if ( !hMapping )
+            return HRESULT_FROM_WIN32( GetLastError() );
+
+        std::unique_ptr<const char, view_unmapper> view( static_cast<const char*>( MapViewOfFile( hMapping.get(), FILE_MAP_READ, 0, 0, 0 ) ) );
+        if ( !view )
+            return HRESULT_FROM_WIN32( GetLastError() );
+
+        wchar_t fname[_MAX_FNAME] = {};
+        _wsplitpath_s( szFileName, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, nullptr, 0 );
+
+        name = fname;
+
+        Material defmat;
+
+        wcscpy_s( defmat.strName, L"default" );
+        materials.emplace_back( defmat );
+
+        // Split the file into chunks of whole lines
+        size_t nChunks = 1;
+#ifdef _OPENMP
+        if ( size >= c_MinParallelBytes * 2 && omp_get_max_threads() > 1 )
         {
-            wchar_t ext[_MAX_EXT] = {};
-            _wsplitpath_s( strMaterialFilename, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT );
+            nChunks = std::min( size / c_MinParallelBytes, size_t( omp_get_max_threads() ) * 4 );
+        }
+#endif
 
-            wchar_t drive[_MAX_DRIVE] = {};
-            wchar_t dir[_MAX_DIR] = {};
-            _wsplitpath_s( szFileName, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0 );
+        const char* data = view.get();
+        const char* eof = data + size;
 
-            wchar_t szPath[ MAX_PATH ] = {};
-            _wmakepath_s( szPath, MAX_PATH, drive, dir, fname, ext );
+        std::vector<ObjChunk> chunks( nChunks );
+        const char* begin = data;
+        for( size_t j = 0; j < nChunks; ++j )
+        {
+            const char* end = eof;
+            if ( j + 1 < nChunks )
+            {
+                end = std::max( begin, data + ( size / nChunks ) * ( j + 1 ) );
+                auto nl = static_cast<const char*>( memchr( end, '\n', size_t( eof - end ) ) );
+                end = ( nl ) ? ( nl + 1 ) : eof;
+            }
 
-            HRESULT hr = LoadMTL( szPath );
-            if ( FAILED(hr) )
-                return hr;
+            chunks[ j ].begin = begin;
+            chunks[ j ].end = end;
+            begin = end;
         }
 
-        return S_OK;
+        // Count the elements in each chunk so every chunk knows where its data lands
+        // in the shared arrays, which is required to resolve relative indices
+#ifdef _OPENMP
+        #pragma omp parallel for if (nChunks > 1)
+#endif
+        for( int j = 0; j < static_cast<int>( nChunks ); ++j )
+        {
+            CountChunk( chunks[ j ] );
+        }
+
+        size_t nPositions = 0;
+        size_t nNormals = 0;
+        size_t nTexCoords = 0;
+        for( auto it = chunks.begin(); it != chunks.end(); ++it )
+        {
+            it->positionBase = nPositions;
+            it->normalBase = nNormals;
+            it->texCoordBase = nTexCoords;
+            nPositions += it->positionCount;
+            nNormals += it->normalCount;
+            nTexCoords += it->texCoordCount;
+        }
+
+        if ( !nPositions )
+            return E_FAIL;
+
+        std::vector<XMFLOAT3>   positions( nPositions );
+        std::vector<XMFLOAT3>   normals( nNormals );
+        std::vector<XMFLOAT2>   texCoords( nTexCoords );
+
+        hasNormals = ( nNormals > 0 );
+        hasTexcoords = ( nTexCoords > 0 );
+
+#ifdef _OPENMP
+        #pragma omp parallel for if (nChunks > 1) schedule(dynamic,1)
+#endif
+        for( int j = 0; j < static_cast<int>( nChunks ); ++j )
+        {
+            try
+            {
+                chunks[ j ].hr = ParseChunk( chunks[ j ], positions.data(), normals.data(), texCoords.data() );
+            }
+            catch( const std::bad_alloc& )
+            {
+                chunks[ j ].hr = E_OUTOFMEMORY;
+            }
+        }
+
+        for( auto it = chunks.cbegin(); it != chunks.cend(); ++it )
+        {
+            if ( FAILED( it->hr ) )
+                return it->hr;
+        }
+
+        // Merge in file order so vertices, indices, and materials match Load
+        VertexHash vertexCache( nPositions );
+
+        uint32_t curSubset = 0;
+
+        wchar_t strMaterialFilename[MAX_PATH] = {};
+        for( auto it = chunks.cbegin(); it != chunks.cend(); ++it )
+        {
+            const uint32_t* corner = it->corners.data();
+            auto cmd = it->commands.cbegin();
+
+            for( size_t face = 0; face <= it->faceSizes.size(); ++face )
+            {
+                for( ; cmd != it->commands.cend() && cmd->face == face; ++cmd )
+                {
+                    wchar_t strName[MAX_PATH] = {};
+                    if ( !MultiByteToWideChar( CP_ACP, 0, cmd->name.c_str(), -1, strName, MAX_PATH - 1 ) )
+                        return E_FAIL;
+
+                    if ( cmd->library )
+                    {
+                        // Material library
+                        wcscpy_s( strMaterialFilename, strName );
+                    }
+                    else
+                    {
+                        // Material
+                        curSubset = FindMaterial( strName );
+                    }
+                }
+
+                if ( face == it->faceSizes.size() )
+                    break;
+
+                DWORD faceIndex[ MAX_POLY ];
+                size_t iFace = it->faceSizes[ face ];
+                for( size_t k = 0; k < iFace; ++k, corner += 3 )
+                {
+                    Vertex vertex;
+                    memset( &vertex, 0, sizeof( vertex ) );
+
+                    vertex.position = positions[ corner[0] ];
+
+                    if ( corner[1] != uint32_t(-1) )
+                        vertex.textureCoordinate = texCoords[ corner[1] ];
+
+                    if ( corner[2] != uint32_t(-1) )
+                        vertex.normal = normals[ corner[2] ];
+
+                    DWORD index = vertexCache.find_or_add( vertex, vertices );
+
+#pragma warning( suppress : 4127 )
+                    if ( sizeof(index_t) == 2 && ( index >= 0xFFFF ) )
+                    {
+                        // Too many indices for 16-bit IB!
+                        return E_FAIL;
+                    }
+#pragma warning( suppress : 4127 )
+                    else if ( sizeof(index_t) == 4 && ( index >= 0xFFFFFFFF ) )
+                    {
+                        // Too many indices for 32-bit IB!
+                        return E_FAIL;
+                    }
+
+                    faceIndex[ k ] = index;
+                }
+
+                AddPolygon( faceIndex, iFace, curSubset, ccw );
+            }
+        }
+
+        // Cleanup
+        view.reset();
+        hMapping.reset();
+        hFile.reset();
+
+        BoundingBox::CreateFromPoints( bounds, positions.size(), positions.data(), sizeof(XMFLOAT3) );
+
+        // If an associated material file was found, read that in as well.
+        return LoadAssociatedMTL( szFileName, strMaterialFilename );
     }
 
     HRESULT LoadMTL( _In_z_ const wchar_t* szFileName )
@@ -596,6 +753,8 @@ public:
     DirectX::BoundingBox    bounds;
 
 private:
+    static const size_t MAX_POLY = 64;
+
     typedef std::unordered_multimap<UINT, UINT> VertexCache;
 
     DWORD AddVertex( UINT hash, Vertex* pVertex, VertexCache& cache )
@@ -619,4 +778,530 @@ private:
         cache.insert( entry );
         return index;
     }
+
+    uint32_t FindMaterial( _In_z_ const wchar_t* strName )
+    {
+        uint32_t count = 0;
+        for( auto it = materials.cbegin(); it != materials.cend(); ++it, ++count )
+        {
+            if( 0 == wcscmp( it->strName, strName ) )
+                return count;
+        }
+
+        Material mat;
+        wcscpy_s( mat.strName, MAX_PATH - 1, strName );
+        materials.emplace_back( mat );
+        return static_cast<uint32_t>( materials.size() - 1 );
+    }
+
+    void AddPolygon( _In_reads_(iFace) const DWORD* faceIndex, size_t iFace, uint32_t curSubset, bool ccw )
+    {
+        // Convert polygons to triangles
+        DWORD i0 = faceIndex[0];
+        DWORD i1 = faceIndex[1];
+
+        for( size_t j = 2; j < iFace; ++ j )
+        {
+            DWORD index = faceIndex[ j ];
+            indices.emplace_back( static_cast<index_t>( i0 ) );
+            if ( ccw )
+            {
+                indices.emplace_back( static_cast<index_t>( i1 ) );
+                indices.emplace_back( static_cast<index_t>( index ) );
+            }
+            else
+            {
+                indices.emplace_back( static_cast<index_t>( index ) );
+                indices.emplace_back( static_cast<index_t>( i1 ) );
+            }
+
+            attributes.emplace_back( curSubset );
+
+            i1 = index;
+        }
+
+        assert( attributes.size()*3 == indices.size() );
+    }
+
+    HRESULT LoadAssociatedMTL( _In_z_ const wchar_t* szFileName, _In_z_ const wchar_t* strMaterialFilename )
+    {
+        if( !*strMaterialFilename )
+            return S_OK;
+
+        wchar_t fname[_MAX_FNAME] = {};
+        wchar_t ext[_MAX_EXT] = {};
+        _wsplitpath_s( strMaterialFilename, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT );
+
+        wchar_t drive[_MAX_DRIVE] = {};
+        wchar_t dir[_MAX_DIR] = {};
+        _wsplitpath_s( szFileName, drive, _MAX_DRIVE, dir, _MAX_DIR, nullptr, 0, nullptr, 0 );
+
+        wchar_t szPath[ MAX_PATH ] = {};
+        _wmakepath_s( szPath, MAX_PATH, drive, dir, fname, ext );
+
+        return LoadMTL( szPath );
+    }
+
+    //----------------------------------------------------------------------------------
+    // LoadFast support
+    //----------------------------------------------------------------------------------
+    static const size_t c_MinParallelBytes = 4 * 1024 * 1024;
+
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+    struct view_unmapper { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+    typedef std::unique_ptr<void, handle_closer> ScopedHandle;
+
+    static HANDLE safe_handle( HANDLE h ) { return (h == INVALID_HANDLE_VALUE) ? 0 : h; }
+
+    struct ObjCommand
+    {
+        size_t          face;       // Applies before this face of the chunk
+        bool            library;    // mtllib, otherwise usemtl
+        std::string     name;
+    };
+
+    struct ObjChunk
+    {
+        const char*             begin;
+        const char*             end;
+        size_t                  positionCount;
+        size_t                  normalCount;
+        size_t                  texCoordCount;
+        size_t                  positionBase;
+        size_t                  normalBase;
+        size_t                  texCoordBase;
+        std::vector<uint32_t>   corners;    // position, texcoord, normal index per face corner
+        std::vector<uint8_t>    faceSizes;
+        std::vector<ObjCommand> commands;
+        HRESULT                 hr;
+
+        ObjChunk() : begin(nullptr), end(nullptr),
+            positionCount(0), normalCount(0), texCoordCount(0),
+            positionBase(0), normalBase(0), texCoordBase(0), hr(S_OK) {}
+    };
+
+    // Open addressing hash of vertex indices keyed on the full packed vertex
+    class VertexHash
+    {
+    public:
+        explicit VertexHash( size_t expected ) : mCount(0)
+        {
+            size_t capacity = 1024;
+            while ( capacity < expected * 2 )
+                capacity <<= 1;
+            mSlots.resize( capacity, uint32_t(-1) );
+        }
+
+        uint32_t find_or_add( const Vertex& vertex, std::vector<Vertex>& vertices )
+        {
+            size_t mask = mSlots.size() - 1;
+            size_t slot = static_cast<size_t>( hash( vertex ) ) & mask;
+
+            for( ;; )
+            {
+                uint32_t index = mSlots[ slot ];
+                if ( index == uint32_t(-1) )
+                    break;
+
+                if ( 0 == memcmp( &vertex, &vertices[ index ], sizeof(Vertex) ) )
+                    return index;
+
+                slot = ( slot + 1 ) & mask;
+            }
+
+            auto index = static_cast<uint32_t>( vertices.size() );
+            vertices.emplace_back( vertex );
+            mSlots[ slot ] = index;
+
+            if ( ++mCount * 2 > mSlots.size() )
+                grow( vertices );
+
+            return index;
+        }
+
+    private:
+        static uint64_t hash( const Vertex& vertex )
+        {
+            uint32_t words[ sizeof(Vertex) / sizeof(uint32_t) ];
+            memcpy( words, &vertex, sizeof(Vertex) );
+
+            // FNV-1a over 32-bit words
+            uint64_t h = 14695981039346656037ULL;
+            for( size_t j = 0; j < _countof(words); ++j )
+            {
+                h = ( h ^ words[ j ] ) * 1099511628211ULL;
+            }
+            return h ^ ( h >> 32 );
+        }
+
+        void grow( const std::vector<Vertex>& vertices )
+        {
+            std::vector<uint32_t> slots( mSlots.size() * 2, uint32_t(-1) );
+            size_t mask = slots.size() - 1;
+
+            for( auto it = mSlots.cbegin(); it != mSlots.cend(); ++it )
+            {
+                if ( *it == uint32_t(-1) )
+                    continue;
+
+                size_t slot = static_cast<size_t>( hash( vertices[ *it ] ) ) & mask;
+                while ( slots[ slot ] != uint32_t(-1) )
+                {
+                    slot = ( slot + 1 ) & mask;
+                }
+                slots[ slot ] = *it;
+            }
+
+            mSlots.swap( slots );
+        }
+
+        std::vector<uint32_t>   mSlots;
+        size_t                  mCount;
+    };
+
+    static bool IsBlank( char c ) { return ( c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' ); }
+    static bool IsSpace( char c ) { return ( c == '\n' || IsBlank( c ) ); }
+    static bool IsDigit( char c ) { return ( c >= '0' && c <= '9' ); }
+
+    static void SkipBlanks( const char*& ptr, const char* end )
+    {
+        while ( ptr < end && IsBlank( *ptr ) )
+            ++ptr;
+    }
+
+    static void SkipLine( const char*& ptr, const char* end )
+    {
+        auto nl = static_cast<const char*>( memchr( ptr, '\n', size_t( end - ptr ) ) );
+        ptr = ( nl ) ? ( nl + 1 ) : end;
+    }
+
+    // Reads the next command token, skipping blank lines
+    static size_t ReadToken( const char*& ptr, const char* end, const char*& token )
+    {
+        while ( ptr < end && IsSpace( *ptr ) )
+            ++ptr;
+
+        token = ptr;
+        while ( ptr < end && !IsSpace( *ptr ) )
+            ++ptr;
+
+        return size_t( ptr - token );
+    }
+
+    static bool ParseInt( const char*& ptr, const char* end, int& value )
+    {
+        SkipBlanks( ptr, end );
+
+        bool negative = false;
+        if ( ptr < end && ( *ptr == '-' || *ptr == '+' ) )
+        {
+            negative = ( *ptr == '-' );
+            ++ptr;
+        }
+
+        if ( ptr >= end || !IsDigit( *ptr ) )
+            return false;
+
+        int64_t result = 0;
+        while ( ptr < end && IsDigit( *ptr ) )
+        {
+            result = result * 10 + ( *ptr - '0' );
+            if ( result > INT32_MAX )
+                return false;
+            ++ptr;
+        }
+
+        value = static_cast<int>( negative ? -result : result );
+        return true;
+    }
+
+    static bool ParseFloat( const char*& ptr, const char* end, float& value )
+    {
+        // Powers of ten that are exact in a float
+        static const float s_pow10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+        SkipBlanks( ptr, end );
+
+        const char* start = ptr;
+
+        bool negative = false;
+        if ( ptr < end && ( *ptr == '-' || *ptr == '+' ) )
+        {
+            negative = ( *ptr == '-' );
+            ++ptr;
+        }
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool any = false;
+
+        for( ; ptr < end && IsDigit( *ptr ); ++ptr )
+        {
+            any = true;
+            if ( digits < 19 )
+            {
+                mantissa = mantissa * 10 + uint64_t( *ptr - '0' );
+                if ( mantissa )
+                    ++digits;
+            }
+            else
+            {
+                ++exponent;
+            }
+        }
+
+        if ( ptr < end && *ptr == '.' )
+        {
+            for( ++ptr; ptr < end && IsDigit( *ptr ); ++ptr )
+            {
+                any = true;
+                if ( digits < 19 )
+                {
+                    mantissa = mantissa * 10 + uint64_t( *ptr - '0' );
+                    if ( mantissa )
+                        ++digits;
+                    --exponent;
+                }
+            }
+        }
+
+        if ( !any )
+            return false;
+
+        if ( ptr < end && ( *ptr == 'e' || *ptr == 'E' ) )
+        {
+            const char* exp = ptr + 1;
+            int e;
+            if ( exp < end && !IsBlank( *exp ) && ParseInt( exp, end, e ) )
+            {
+                exponent += std::max( -1000, std::min( e, 1000 ) );
+                ptr = exp;
+            }
+        }
+
+        if ( mantissa <= ( 1u << 24 ) && exponent >= -10 && exponent <= 10 )
+        {
+            // Both operands are exact, so one IEEE operation gives the correctly rounded result
+            float f = static_cast<float>( mantissa );
+            f = ( exponent < 0 ) ? ( f / s_pow10[ -exponent ] ) : ( f * s_pow10[ exponent ] );
+            value = ( negative ) ? -f : f;
+            return true;
+        }
+
+        // Let the CRT handle the rest so rounding matches stream extraction
+        std::string token( start, ptr );
+        value = strtof( token.c_str(), nullptr );
+        return true;
+    }
+
+    static HRESULT ResolveIndex( int raw, size_t count, uint32_t& index )
+    {
+        if ( !raw )
+        {
+            // 0 is not allowed for index
+            return E_UNEXPECTED;
+        }
+        else if ( raw < 0 )
+        {
+            // Negative values are relative indices
+            if ( size_t( -int64_t( raw ) ) > count )
+                return E_FAIL;
+
+            index = static_cast<uint32_t>( count - size_t( -int64_t( raw ) ) );
+        }
+        else
+        {
+            // OBJ format uses 1-based arrays
+            if ( size_t( raw ) > count )
+                return E_FAIL;
+
+            index = static_cast<uint32_t>( raw - 1 );
+        }
+
+        return S_OK;
+    }
+
+    static void CountChunk( ObjChunk& chunk )
+    {
+        const char* ptr = chunk.begin;
+        while ( ptr < chunk.end )
+        {
+            const char* token;
+            size_t len = ReadToken( ptr, chunk.end, token );
+
+            if ( len == 1 && token[0] == 'v' )
+                ++chunk.positionCount;
+            else if ( len == 2 && token[0] == 'v' && token[1] == 't' )
+                ++chunk.texCoordCount;
+            else if ( len == 2 && token[0] == 'v' && token[1] == 'n' )
+                ++chunk.normalCount;
+
+            SkipLine( ptr, chunk.end );
+        }
+    }
+
+    static HRESULT ParseChunk( ObjChunk& chunk,
+                               _Inout_ DirectX::XMFLOAT3* positions, _Inout_ DirectX::XMFLOAT3* normals, _Inout_ DirectX::XMFLOAT2* texCoords )
+    {
+        using namespace DirectX;
+
+        size_t nPositions = chunk.positionBase;
+        size_t nNormals = chunk.normalBase;
+        size_t nTexCoords = chunk.texCoordBase;
+
+        const char* ptr = chunk.begin;
+        const char* end = chunk.end;
+        while ( ptr < end )
+        {
+            const char* token;
+            size_t len = ReadToken( ptr, end, token );
+
+            if ( !len || *token == '#' )
+            {
+                // Comment
+            }
+            else if ( len == 1 && token[0] == 'v' )
+            {
+                // Vertex Position
+                float x, y, z;
+                if ( !ParseFloat( ptr, end, x ) || !ParseFloat( ptr, end, y ) || !ParseFloat( ptr, end, z ) )
+                    return E_FAIL;
+
+                positions[ nPositions++ ] = XMFLOAT3( x, y, z );
+            }
+            else if ( len == 2 && token[0] == 'v' && token[1] == 't' )
+            {
+                // Vertex TexCoord
+                float u, v;
+                if ( !ParseFloat( ptr, end, u ) || !ParseFloat( ptr, end, v ) )
+                    return E_FAIL;
+
+                texCoords[ nTexCoords++ ] = XMFLOAT2( u, v );
+            }
+            else if ( len == 2 && token[0] == 'v' && token[1] == 'n' )
+            {
+                // Vertex Normal
+                float x, y, z;
+                if ( !ParseFloat( ptr, end, x ) || !ParseFloat( ptr, end, y ) || !ParseFloat( ptr, end, z ) )
+                    return E_FAIL;
+
+                normals[ nNormals++ ] = XMFLOAT3( x, y, z );
+            }
+            else if ( len == 1 && token[0] == 'f' )
+            {
+                // Face
+                size_t iFace = 0;
+                for(;;)
+                {
+                    if ( iFace >= MAX_POLY )
+                    {
+                        // Too many polygon verts for the reader
+                        return E_FAIL;
+                    }
+
+                    int iPosition;
+                    if ( !ParseInt( ptr, end, iPosition ) )
+                        return E_FAIL;
+
+                    uint32_t vertexIndex = 0;
+                    HRESULT hr = ResolveIndex( iPosition, nPositions, vertexIndex );
+                    if ( FAILED(hr) )
+                        return hr;
+
+                    uint32_t coordIndex = uint32_t(-1);
+                    uint32_t normIndex = uint32_t(-1);
+
+                    if ( ptr < end && *ptr == '/' )
+                    {
+                        ++ptr;
+
+                        if ( ptr < end && *ptr != '/' )
+                        {
+                            // Optional texture coordinate
+                            int iTexCoord;
+                            if ( !ParseInt( ptr, end, iTexCoord ) )
+                                return E_FAIL;
+
+                            hr = ResolveIndex( iTexCoord, nTexCoords, coordIndex );
+                            if ( FAILED(hr) )
+                                return hr;
+                        }
+
+                        if ( ptr < end && *ptr == '/' )
+                        {
+                            ++ptr;
+
+                            // Optional vertex normal
+                            int iNormal;
+                            if ( !ParseInt( ptr, end, iNormal ) )
+                                return E_FAIL;
+
+                            hr = ResolveIndex( iNormal, nNormals, normIndex );
+                            if ( FAILED(hr) )
+                                return hr;
+                        }
+                    }
+
+                    chunk.corners.push_back( vertexIndex );
+                    chunk.corners.push_back( coordIndex );
+                    chunk.corners.push_back( normIndex );
+                    ++iFace;
+
+                    // Check for more face data or end of the face statement
+                    bool faceEnd = false;
+                    for(;;)
+                    {
+                        if ( ptr >= end || *ptr == '\n' )
+                        {
+                            faceEnd = true;
+                            break;
+                        }
+                        else if ( IsDigit( *ptr ) || *ptr == '-' || *ptr == '+' )
+                            break;
+
+                        ++ptr;
+                    }
+
+                    if ( faceEnd )
+                        break;
+                }
+
+                if ( iFace < 3 )
+                {
+                    // Need at least 3 points to form a triangle
+                    return E_FAIL;
+                }
+
+                chunk.faceSizes.push_back( static_cast<uint8_t>( iFace ) );
+            }
+            else if ( ( len == 6 && 0 == memcmp( token, "mtllib", 6 ) )
+                      || ( len == 6 && 0 == memcmp( token, "usemtl", 6 ) ) )
+            {
+                // Material library or material
+                bool library = ( token[0] == 'm' );
+
+                SkipBlanks( ptr, end );
+
+                const char* arg = ptr;
+                while ( ptr < end && !IsSpace( *ptr ) )
+                    ++ptr;
+
+                ObjCommand cmd;
+                cmd.face = chunk.faceSizes.size();
+                cmd.library = library;
+                cmd.name.assign( arg, ptr );
+                chunk.commands.emplace_back( cmd );
+            }
+
+            SkipLine( ptr, end );
+        }
+
+        assert( nPositions == chunk.positionBase + chunk.positionCount );
+        assert( nNormals == chunk.normalBase + chunk.normalCount );
+        assert( nTexCoords == chunk.texCoordBase + chunk.texCoordCount );
+
+        return S_OK;
+    }
 };